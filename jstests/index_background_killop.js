@@ -0,0 +1,42 @@
+// killOp stops a background index build, which leaves no index behind.
+
+t = db.jstests_index_background_killop;
+t.drop();
+
+var pad = new Array( 200 ).join( "x" );
+for ( var i = 0; i < 200000; i++ ) {
+    t.insert( { _id: i, a: i % 1000, b: [ i, -i - 1 ], pad: pad } );
+}
+assert.eq( null, db.getLastError() );
+
+function ops() {
+    var ids = [];
+    db.currentOp().inprog.forEach( function( o ) {
+        if ( o.active && o.op == "insert" && o.ns == db.getName() + ".system.indexes" ) {
+            ids.push( o.opid );
+        }
+    } );
+    return ids;
+}
+
+function killBuild( key ) {
+    var s = startParallelShell(
+        "db.jstests_index_background_killop.ensureIndex( " + tojson( key ) + ", { background: true } );" +
+        "assert.neq( null, db.getLastError() );" );
+    var o = [];
+    assert.soon( function() { o = ops(); return o.length == 1; } );
+    db.killOp( o[ 0 ] );
+    s();
+    assert.eq( 1, t.getIndexes().length, tojson( key ) );
+}
+
+killBuild( { a: 1 } );
+// multikey
+killBuild( { b: 1 } );
+
+// the collection is still usable, and a new build succeeds
+t.insert( { _id: -1, a: 5, b: [ 1 ] } );
+t.ensureIndex( { a: 1 }, { background: true } );
+assert.eq( null, db.getLastError() );
+assert.eq( 2, t.getIndexes().length );
+assert.eq( 201, t.find( { a: 5 } ).hint( { a: 1 } ).itcount() );
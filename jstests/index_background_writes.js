@@ -0,0 +1,90 @@
+// Background index builds while another client inserts, updates and removes
+// documents that are multikey, missing from a sparse index, or plain.
+
+t = db.jstests_index_background_writes;
+t.drop();
+ctl = db.jstests_index_background_writes_ctl;
+ctl.drop();
+
+function doc( i ) {
+    var o = { _id: i, a: i };
+    o.b = ( i % 3 == 0 ) ? [ i, -i - 1 ] : i;
+    if ( i % 2 == 0 ) {
+        o.c = i;
+    }
+    return o;
+}
+
+for ( var i = 0; i < 50000; i++ ) {
+    t.insert( doc( i ) );
+}
+assert.eq( null, db.getLastError() );
+
+// number of entries each index should have, from a table scan
+function expectedKeys( field, sparse ) {
+    var n = 0;
+    t.find().hint( { $natural: 1 } ).forEach( function( o ) {
+        if ( !( field in o ) ) {
+            n += sparse ? 0 : 1;
+        } else if ( Array.isArray( o[ field ] ) ) {
+            n += o[ field ].length;
+        } else {
+            n += 1;
+        }
+    } );
+    return n;
+}
+
+function check( key, sparse ) {
+    var field = Object.keySet( key )[ 0 ];
+    assert.eq( expectedKeys( field, sparse ), t.find().hint( key ).explain().nscanned, tojson( key ) );
+    t.find().hint( { $natural: 1 } ).limit( 1000 ).forEach( function( o ) {
+        if ( field in o ) {
+            var q = {};
+            q[ field ] = Array.isArray( o[ field ] ) ? o[ field ][ 1 ] : o[ field ];
+            assert.eq( 1, t.find( q ).hint( key ).itcount(), tojson( q ) );
+        }
+    } );
+}
+
+function build( key, sparse ) {
+    ctl.remove();
+    db.getLastError();
+    var next = t.find().sort( { _id: -1 } ).limit( 1 ).next()._id + 1;
+    var s = startParallelShell(
+        "var t = db.jstests_index_background_writes;" +
+        "for ( var i = " + next + "; db.jstests_index_background_writes_ctl.count() == 0; i++ ) {" +
+        "    var o = { _id: i, a: i, b: ( i % 3 == 0 ) ? [ i, -i - 1 ] : i };" +
+        "    if ( i % 2 == 0 ) { o.c = i; }" +
+        "    t.insert( o );" +
+        "    var j = Math.floor( Math.random() * i );" +
+        "    if ( i % 4 == 0 ) {" +
+        "        t.update( { _id: j }, { $set: { b: [ j + 10000000, j + 20000000 ] }, $unset: { c: 1 } } );" +
+        "    } else if ( i % 4 == 1 ) {" +
+        "        t.update( { _id: j }, { $set: { b: j + 30000000, c: j } } );" +
+        "    } else {" +
+        "        t.remove( { _id: j } );" +
+        "    }" +
+        "    db.getLastError();" +
+        "}" );
+    var opts = { background: true };
+    if ( sparse ) {
+        opts.sparse = true;
+    }
+    t.ensureIndex( key, opts );
+    assert.eq( null, db.getLastError() );
+    ctl.insert( {} );
+    db.getLastError();
+    s();
+    check( key, sparse );
+}
+
+build( { a: 1 }, false );
+build( { b: 1 }, false );
+build( { c: 1 }, true );
+
+// every index was maintained through the later builds too
+check( { a: 1 }, false );
+check( { b: 1 }, false );
+check( { c: 1 }, true );
+assert( t.validate().valid );
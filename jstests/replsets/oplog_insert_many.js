@@ -0,0 +1,45 @@
+// A batch insert is logged as one "i" op per document, which every member
+// can apply, unless oplogInsertMany says the whole set understands "im" ops.
+
+var replTest = new ReplSetTest( {name: "oplog_insert_many", nodes: 2} );
+replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var t = master.getDB("test").oplog_insert_many;
+
+function lastOps() {
+    var entry = master.getDB("local").oplog.rs.find().sort({$natural : -1}).limit(1).next();
+    printjson(entry);
+    return entry.ops;
+}
+
+function batch(from) {
+    var docs = [];
+    for (var i = from; i < from + 10; i++) {
+        docs.push({_id : i});
+    }
+    return docs;
+}
+
+// off by default
+assert.eq(false, master.getDB("admin").runCommand({getParameter : 1, oplogInsertMany : 1}).oplogInsertMany);
+t.insert(batch(0));
+assert.eq(null, master.getDB("test").getLastError(2, 60000));
+var ops = lastOps();
+assert.eq(10, ops.length);
+ops.forEach(function(op) { assert.eq("i", op.op); });
+
+assert.commandWorked(master.getDB("admin").runCommand({setParameter : 1, oplogInsertMany : true}));
+t.insert(batch(10));
+assert.eq(null, master.getDB("test").getLastError(2, 60000));
+ops = lastOps();
+assert.eq(1, ops.length);
+assert.eq("im", ops[0].op);
+assert.eq(10, ops[0].o.length);
+
+var slave = replTest.liveNodes.slaves[0];
+slave.setSlaveOk();
+assert.eq(20, slave.getDB("test").oplog_insert_many.count());
+
+replTest.stopSet();
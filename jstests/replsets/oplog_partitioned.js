@@ -0,0 +1,25 @@
+// The oplog is a partitioned collection whose partitions the server starts
+// and drops by time, so the partition commands refuse it.
+
+var replTest = new ReplSetTest( {name: "oplog_partitioned", nodes: 1} );
+replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var local = master.getDB("local");
+master.getDB("test").foo.insert({_id : 1});
+assert.eq(null, master.getDB("test").getLastError());
+
+var stats = local.oplog.rs.stats();
+printjson(stats);
+assert(stats.partitioned, "oplog is not partitioned");
+assert.lte(1, stats.partitions.length);
+stats.partitions.forEach(function(p) {
+    assert(p.created instanceof Date, tojson(p));
+});
+
+assert.commandFailed(local.runCommand({addPartition : "oplog.rs", newMax : {_id : MaxKey}}));
+assert.commandFailed(local.runCommand({dropPartition : "oplog.rs", id : stats.partitions[0]._id}));
+assert.eq(stats.partitions.length, local.oplog.rs.stats().partitions.length);
+
+replTest.stopSet();
@@ -0,0 +1,94 @@
+/**
+ * Test initial sync with --initialSyncThreads while the primary takes writes
+ *
+ * 1. Bring up a one member set and insert into several collections
+ * 2. Start writing to every collection in a parallel shell
+ * 3. Add a second member with --initialSyncThreads 3
+ * 4. It should become a secondary, having cloned the collections in parallel
+ * 5. Stop writing, once replicated both members should have the same data
+ */
+
+load("jstests/replsets/rslib.js");
+var basename = "jstests_parallel_initial_sync";
+
+print("1. Bring up a one member set and insert into several collections");
+var replTest = new ReplSetTest( {name: basename, nodes: 1} );
+replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var foo = master.getDB("foo");
+var colls = ["a", "b", "c", "d", "e"];
+colls.forEach(function(c) {
+    for (var i = 0; i < 5000; i++) {
+        foo[c].insert({_id : i, x : i, str : "all the talk on the market"});
+    }
+    foo[c].ensureIndex({x : 1});
+});
+assert.eq(null, foo.getLastError());
+
+print("2. Start writing to every collection in a parallel shell");
+var writer = startParallelShell(
+    "var foo = db.getSisterDB('foo');" +
+    "var colls = " + tojson(colls) + ";" +
+    "for (var i = 5000; db.getSisterDB('ctl').stop.count() == 0; i++) {" +
+    "    colls.forEach(function(c) {" +
+    "        foo[c].insert({_id : i, x : i});" +
+    "        foo[c].update({_id : i - 4000}, {$inc : {x : 1}});" +
+    "        foo[c].remove({_id : i - 4500});" +
+    "    });" +
+    "    foo.getLastError();" +
+    "}", master.port);
+
+print("3. Add a second member with --initialSyncThreads 3");
+var port = allocatePorts(2)[1];
+var hostname = getHostName();
+var config = replTest.getReplSetConfig();
+config.version = 2;
+config.members.push({_id : 1, host : hostname + ":" + port, priority : 0});
+assert.commandWorked(master.getDB("admin").runCommand({replSetReconfig : config}));
+master = replTest.getMaster();
+foo = master.getDB("foo");
+
+var slave = startMongodTest(port, basename + "-parallel", false,
+                            {replSet : basename, initialSyncThreads : 3});
+
+print("4. It should become a secondary, having cloned the collections in parallel");
+assert.soon(function() {
+    var result = slave.getDB("admin").runCommand({isMaster : 1});
+    printjson(result);
+    return result.secondary;
+}, "member syncing in parallel never became a secondary", 300000);
+
+var status = slave.getDB("admin").runCommand({replSetGetStatus : 1});
+printjson(status.initialSync);
+assert(status.initialSync, "no parallel initial sync reported");
+assert.eq(3, status.initialSync.threads);
+assert.eq(colls.length, status.initialSync.collections.length);
+status.initialSync.collections.forEach(function(c) {
+    assert.eq("done", c.state, c.ns);
+});
+
+print("5. Stop writing, once replicated both members should have the same data");
+master.getDB("ctl").stop.insert({});
+writer();
+// the writer's last writes come before this one in the oplog
+master.getDB("ctl").done.insert({});
+assert.eq(null, master.getDB("ctl").getLastError(2, 120000));
+
+slave.setSlaveOk();
+var slaveFoo = slave.getDB("foo");
+colls.forEach(function(c) {
+    assert.eq(foo[c].count(), slaveFoo[c].count(), "count of " + c);
+    assert.eq(2, slaveFoo.system.indexes.count({ns : "foo." + c}), "indexes of " + c);
+    assert.eq(foo[c].find().sort({_id : 1}).toArray(),
+              slaveFoo[c].find().sort({_id : 1}).toArray(), "documents of " + c);
+    assert.eq(foo[c].find({}, {_id : 0, x : 1}).hint({x : 1}).toArray(),
+              slaveFoo[c].find({}, {_id : 0, x : 1}).hint({x : 1}).toArray(), "x index of " + c);
+});
+var masterHash = foo.runCommand("dbhash");
+var slaveHash = slaveFoo.runCommand("dbhash");
+assert.eq(masterHash.md5, slaveHash.md5, "dbhash of foo");
+
+stopMongod(port);
+replTest.stopSet();
@@ -0,0 +1,66 @@
+/**
+ * Test physical initial sync
+ *
+ * 1. Bring up a one member set and insert some data
+ * 2. Add a second member to the config
+ * 3. Start it with an empty dbpath and --physicalSyncFrom the primary
+ * 4. It should become a secondary with the primary's data and indexes
+ * 5. It should keep replicating
+ * 6. The primary should checkpoint again once the copy is done
+ */
+
+load("jstests/replsets/rslib.js");
+var basename = "jstests_physical_initial_sync";
+
+print("1. Bring up a one member set and insert some data");
+var replTest = new ReplSetTest( {name: basename, nodes: 1} );
+replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var foo = master.getDB("foo");
+for (var i = 0; i < 10000; i++) {
+    foo.bar.insert({x : i, str : "all the talk on the market"});
+}
+foo.bar.ensureIndex({x : 1});
+foo.baz.insert({y : 1});
+assert.eq(null, foo.getLastError());
+
+print("2. Add a second member to the config");
+var port = allocatePorts(2)[1];
+var hostname = getHostName();
+var config = replTest.getReplSetConfig();
+config.version = 2;
+config.members.push({_id : 1, host : hostname + ":" + port, priority : 0});
+assert.commandWorked(master.getDB("admin").runCommand({replSetReconfig : config}));
+master = replTest.getMaster();
+foo = master.getDB("foo");
+
+print("3. Start it with an empty dbpath and --physicalSyncFrom the primary");
+var slave = startMongodTest(port, basename + "-physical", false,
+                            {replSet : basename, physicalSyncFrom : master.host});
+
+print("4. It should become a secondary with the primary's data and indexes");
+assert.soon(function() {
+    var result = slave.getDB("admin").runCommand({isMaster : 1});
+    printjson(result);
+    return result.secondary;
+}, "physically synced member never became a secondary", 120000);
+
+slave.setSlaveOk();
+var slaveFoo = slave.getDB("foo");
+assert.eq(10000, slaveFoo.bar.count());
+assert.eq(1, slaveFoo.baz.count());
+assert.eq(2, slaveFoo.system.indexes.count({ns : "foo.bar"}));
+assert.eq(5000, slaveFoo.bar.find({x : 5000}).hint({x : 1}).next().x);
+
+print("5. It should keep replicating");
+foo.bar.insert({x : 10000});
+assert.eq(null, foo.getLastError(2, 60000));
+assert.eq(10001, slaveFoo.bar.count());
+
+print("6. The primary should checkpoint again once the copy is done");
+assert.commandWorked(master.getDB("admin").runCommand({checkpoint : 1}));
+
+stopMongod(port);
+replTest.stopSet();
@@ -0,0 +1,58 @@
+// With --networkWorkers, more connections than workers are served, and
+// messages blocked on a row lock don't starve the connection holding it:
+// the pool grows until its commit gets a worker, then shrinks once idle.
+
+var conn = MongoRunner.runMongod({ networkWorkers: 2, lockTimeout: 60000 });
+db = conn.getDB("test");
+var t = db.network_workers;
+t.drop();
+t.insert({ _id: 1, n: 0 });
+assert.eq(null, db.getLastError());
+
+// many more idle connections than workers, each still answers
+var conns = [];
+for (var i = 0; i < 20; i++) {
+    conns.push(new Mongo(conn.host));
+}
+conns.forEach(function(c) {
+    assert.commandWorked(c.getDB("admin").runCommand({ ping: 1 }));
+});
+
+// hold the document's row lock in a multi-statement transaction
+assert.commandWorked(db.runCommand({ beginTransaction: 1 }));
+t.update({ _id: 1 }, { $inc: { n: 1 } });
+assert.eq(null, db.getLastError());
+
+// more writers than workers, all waiting on that lock
+var nWriters = 4;
+var joins = [];
+for (var i = 0; i < nWriters; i++) {
+    joins.push(startParallelShell("db.network_workers.update({ _id: 1 }, { $inc: { n: 1 } });" +
+                                  "assert.eq(null, db.getLastError());"));
+}
+sleep(2000);
+
+// the commit is queued behind the blocked writers until a worker is added
+assert.commandWorked(db.runCommand({ commitTransaction: 1 }));
+joins.forEach(function(join) { join(); });
+
+assert.eq(1 + nWriters, t.findOne({ _id: 1 }).n);
+var stats = db.serverStatus().networkWorkers;
+printjson(stats);
+assert.lte(1, stats.workersAdded, "no worker added");
+assert.lt(2, stats.workers);
+assert.eq(8, stats.maxWorkers);
+assert.lte(stats.workers, stats.maxWorkers);
+
+// once idle, the pool shrinks back to its starting size
+assert.soon(function() {
+    stats = db.serverStatus().networkWorkers;
+    return stats.workers == 2;
+}, "idle workers not stopped", 5 * 60 * 1000);
+assert.eq(stats.workersAdded, stats.workersRemoved);
+
+conns.forEach(function(c) {
+    assert.commandWorked(c.getDB("admin").runCommand({ ping: 1 }));
+});
+
+MongoRunner.stopMongod(conn.port);
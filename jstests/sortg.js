@@ -1,6 +1,9 @@
 // Test that a memory exception is triggered for in memory sorts, but not for indexed sorts.
+// In memory sorts only fail when they aren't allowed to spill to disk.
 
 t = db.jstests_sortg;
+var adminDb = db.getSisterDB( "admin" );
+assert.commandWorked( adminDb.runCommand( { setParameter:1, externalSort:false } ) );
 t.drop();
 
 big = new Array( 1000000 ).toString()
@@ -66,4 +69,11 @@ noMemoryException( {_id:1}, {b:null} );
 // retried when the unindexed plan exhausts its memory limit.
 assert.eq( 'IndexCursor b_1', t.find( {b:0} ).sort( {_id:1} ).explain().cursor ); // Record b:1 plan
 noMemoryException( {_id:1}, {b:null} );
+
+// With external sort allowed, the unindexed sorts spill to disk and succeed.
+assert.commandWorked( adminDb.runCommand( { setParameter:1, externalSort:true } ) );
+assert.eq( 140, t.find( {}, {_id:1} ).sort( {a:1} ).batchSize( 1000 ).itcount() );
+assert.eq( 140, t.find( {b:null,c:null}, {_id:1} ).sort( {d:1} ).batchSize( 1000 ).itcount() );
+// Unprojected, the sorted result is far bigger than one reply, and comes back through getMore.
+assert.eq( 140, t.find().sort( {a:1} ).itcount() );
 t.drop();
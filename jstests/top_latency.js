@@ -0,0 +1,46 @@
+// latency percentiles in top and serverStatus
+
+t = db.jstests_top_latency;
+t.drop();
+
+for ( i = 0; i < 100; i++ ) {
+    t.insert( { _id : i } );
+}
+t.update( { _id : 1 } , { $set : { x : 1 } } );
+t.remove( { _id : 2 } );
+for ( i = 0; i < 10; i++ ) {
+    t.findOne( { _id : i } );
+}
+t.count();
+db.getLastError();
+
+admin = db.getSisterDB( "admin" );
+
+function latencies() {
+    return admin.runCommand( { top : 1 } ).totals[ t.getFullName() ].latencyMicros;
+}
+
+l = latencies();
+printjson( l );
+assert.eq( 100 , l.insert.count , "insert" );
+assert.eq( 1 , l.update.count , "update" );
+assert.eq( 1 , l.remove.count , "remove" );
+assert.lte( 10 , l.queries.count , "queries" );
+assert.lte( 1 , l.commands.count , "commands" );
+assert.lte( l.insert.p50 , l.insert.p99 );
+assert.lte( l.insert.p99 , l.insert.p999 );
+
+s = db.serverStatus().opLatencyMicros;
+assert( s , "no opLatencyMicros in serverStatus" );
+assert.lte( 100 , s.insert.count );
+assert.lte( 1 , s.commands.count );
+
+// reporting then starting over
+assert.commandWorked( admin.runCommand( { top : 1 , resetLatencies : true } ) );
+l = latencies();
+assert.eq( 0 , l.insert.count , "insert after reset" );
+assert.eq( 0 , l.insert.p99 , "insert p99 after reset" );
+
+t.insert( { _id : 1000 } );
+db.getLastError();
+assert.eq( 1 , latencies().insert.count , "insert after reset and one insert" );
@@ -113,11 +113,13 @@ namespace mongo {
         ourMachineAndPid = x;
     }
 
-    void OID::init() {
-        static AtomicUInt inc = (unsigned) Security::getNonce();
+    static AtomicWord<unsigned> &nextInc() {
+        static AtomicWord<unsigned> inc((unsigned) Security::getNonce());
+        return inc;
+    }
 
+    void OID::initFrom(unsigned t, unsigned inc) {
         {
-            unsigned t = (unsigned) time(0);
             unsigned char *T = (unsigned char *) &t;
             _time[0] = T[3]; // big endian order because we use memcmp() to compare OID's
             _time[1] = T[2];
@@ -128,14 +130,25 @@ namespace mongo {
         _machineAndPid = ourMachineAndPid;
 
         {
-            int new_inc = inc++;
-            unsigned char *T = (unsigned char *) &new_inc;
+            unsigned char *T = (unsigned char *) &inc;
             _inc[0] = T[2];
             _inc[1] = T[1];
             _inc[2] = T[0];
         }
     }
 
+    void OID::init() {
+        initFrom((unsigned) time(0), nextInc().fetchAndAdd(1));
+    }
+
+    void OID::gen(OID *oids, size_t n) {
+        const unsigned t = (unsigned) time(0);
+        const unsigned first = nextInc().fetchAndAdd(n);
+        for (size_t i = 0; i < n; i++) {
+            oids[i].initFrom(t, first + i);
+        }
+    }
+
     static AtomicUInt64 _initSequential_sequence;
     void OID::initSequential() {
 
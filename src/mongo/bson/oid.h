@@ -68,6 +68,11 @@ namespace mongo {
 
         static OID gen() { OID o; o.init(); return o; }
 
+        /** sets oids[0..n) to new oids with one timestamp and consecutive
+         *  counters, so that no other oid this process generates sorts
+         *  between the first and the last, unless the 24 bit counter wraps */
+        static void gen(OID *oids, size_t n);
+
         /** sets the contents to a new oid / randomized value */
         void init();
 
@@ -130,6 +135,8 @@ namespace mongo {
             unsigned char data[12];
         };
 
+        void initFrom(unsigned time, unsigned inc);
+
         static unsigned ourPid();
         static void foldInPid(MachineAndPid& x);
         static MachineAndPid genMachineAndPid();
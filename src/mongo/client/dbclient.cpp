@@ -28,11 +28,10 @@
 #include "mongo/db/namespacestring.h"
 #include "mongo/s/util.h"
 #include "mongo/util/md5.hpp"
+#include "mongo/util/net/message_compressor.h"
 
-#ifdef MONGO_SSL
 // TODO: Remove references to cmdline from the client.
 #include "mongo/db/cmdline.h"
-#endif  // defined MONGO_SSL
 
 namespace mongo {
 
@@ -803,6 +802,17 @@ namespace mongo {
         }
 #endif
 
+        if ( ! cmdLine.networkMessageCompressors.empty() ) {
+            // servers that predate compression ignore the field and pick nothing
+            BSONObjBuilder cmd;
+            cmd.append( "isMaster" , 1 );
+            MessageCompressor::appendRequest( cmd );
+            BSONObj info;
+            if ( runCommand( "admin" , cmd.obj() , info ) ) {
+                MessageCompressor::applyReply( info , *p );
+            }
+        }
+
         return true;
     }
 
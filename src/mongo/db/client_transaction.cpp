@@ -24,6 +24,7 @@
 #include "pch.h"
 
 #include "mongo/db/client.h"
+#include "mongo/db/storage/group_commit.h"
 
 namespace mongo {
 
@@ -44,8 +45,20 @@ namespace mongo {
     }
 
     void Client::TransactionStack::commitTxn() {
-        int flags = (cmdLine.logFlushPeriod == 0) ? 0 : DB_TXN_NOSYNC;
-        commitTxn(flags);
+        if (cmdLine.logFlushPeriod != 0) {
+            commitTxn(DB_TXN_NOSYNC);
+        } else if (!cmdLine.groupCommit) {
+            commitTxn(0);
+        } else {
+            // Only a root transaction that wrote something has a commit
+            // worth waiting for.
+            TxnContext &txnToCommit = txn();
+            const bool durable = !txnToCommit.hasParent() && !txnToCommit.readOnly();
+            commitTxn(DB_TXN_NOSYNC);
+            if (durable) {
+                storage::groupCommit.waitDurable();
+            }
+        }
     }
 
     void Client::TransactionStack::abortTxn() {
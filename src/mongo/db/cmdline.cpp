@@ -23,6 +23,7 @@
 #include "../util/password.h"
 #include "../util/processinfo.h"
 #include "../util/net/listen.h"
+#include "../util/net/message_compressor.h"
 #include "../bson/util/builder.h"
 #include "security_common.h"
 #include "mongo/util/mongoutils/str.h"
@@ -121,6 +122,8 @@ namespace mongo {
         ("bind_ip", po::value<string>(&cmdLine.bind_ip), "comma separated list of ip addresses to listen on - all local ips by default")
         ("maxConns",po::value<int>(), maxConnInfoBuilder.str().c_str())
         ("objcheck", "inspect client data for validity on receipt")
+        ("networkMessageCompressors", po::value<string>(), "comma separated list of compressors (zlib) to offer and accept for messages between servers, in order of preference")
+        ("networkCompressionMinBytes", po::value<int>(&cmdLine.networkCompressionMinBytes), "only compress messages at least this big")
         ("logpath", po::value<string>() , "log file to send write to instead of stdout - has to be a file, not directory" )
         ("logappend" , "append to logpath instead of over-writing" )
         ("pidfilepath", po::value<string>(), "full path to pidfile (if not set, no pidfile is created)")
@@ -320,6 +323,16 @@ namespace mongo {
             cmdLine.objcheck = true;
         }
 
+        if (params.count("networkMessageCompressors")) {
+            string compressors = params["networkMessageCompressors"].as<string>();
+            string errmsg;
+            if (!MessageCompressor::validate(compressors, errmsg)) {
+                out() << errmsg << endl;
+                ::_exit( EXIT_BADOPTIONS );
+            }
+            cmdLine.networkMessageCompressors = compressors == "none" ? "" : compressors;
+        }
+
         if (params.count("bind_ip")) {
             // passing in wildcard is the same as default behavior; remove and warn
             if ( cmdLine.bind_ip ==  "0.0.0.0" ) {
@@ -83,12 +83,19 @@ namespace mongo {
         bool cpu;              // --cpu show cpu time periodically
 
         uint32_t logFlushPeriod; // group/batch commit interval ms
+        bool groupCommit;        // --groupCommit, with logFlushPeriod 0 concurrent commits share log fsyncs
         uint32_t expireOplogDays;  // number of days before an oplog entry is eligible for removal
         uint32_t expireOplogHours; // number of hours, in addition to days above.
+        uint32_t replApplierThreads; // --replApplierThreads, 1 means apply the oplog serially
+        uint32_t initialSyncThreads; // --initialSyncThreads, 1 means clone one collection at a time
+        string physicalSyncFrom; // --physicalSyncFrom, member whose files an empty dbpath is copied from
 
 
         bool objcheck;         // --objcheck
 
+        string networkMessageCompressors; // --networkMessageCompressors, comma separated in order of preference
+        int networkCompressionMinBytes;   // --networkCompressionMinBytes, smaller messages are sent as is
+
         int defaultProfile;    // --profile
         int slowMS;            // --time in ms that is "slow"
         int defaultLocalThresholdMillis;    // --localThreshold in ms to consider a node local
@@ -126,6 +133,12 @@ namespace mongo {
         string logDir;
         string tmpDir;
         uint64_t txnMemLimit;
+        bool fastUpdates;      // --fastupdates, blind $ mod updates by _id
+        bool externalSort;     // unindexed sorts that outgrow memory spill to --tmpDir
+        bool planEstimates;    // pick a query plan by estimated keys scanned instead of racing plans
+        bool oplogInsertMany;  // --oplogInsertMany, log batch inserts as "im" ops, which older members can't apply
+        int scanParallelism;   // threads a count or distinct that scans the whole collection may use
+        int networkWorkers;    // --networkWorkers, 0 for a thread per connection
 
         static void launchOk();
 
@@ -156,12 +169,17 @@ namespace mongo {
         noTableScan(false),
         configsvr(false), quota(false), quotaFiles(8), cpu(false),
         logFlushPeriod(100), // 0 means fsync every transaction, 100 means fsync log once every 100 ms
+        groupCommit(false),
         expireOplogDays(0), expireOplogHours(0), // default of 0 means never purge entries from oplog
-        objcheck(false), defaultProfile(0),
+        replApplierThreads(1), initialSyncThreads(1), physicalSyncFrom(""),
+        objcheck(false), networkMessageCompressors(""), networkCompressionMinBytes(1024),
+        defaultProfile(0),
         slowMS(100), defaultLocalThresholdMillis(15), moveParanoia( true ),
         syncdelay(60), noUnixSocket(false), doFork(0), socket("/tmp"),
         directio(false), cacheSize(0), checkpointPeriod(60), cleanerPeriod(2),
-        cleanerIterations(5), lockTimeout(4000), fsRedzone(5), logDir(""), tmpDir(""), txnMemLimit(1ULL<<20)
+        cleanerIterations(5), lockTimeout(4000), fsRedzone(5), logDir(""), tmpDir(""), txnMemLimit(1ULL<<20),
+        fastUpdates(false), externalSort(true), planEstimates(true), oplogInsertMany(false),
+        scanParallelism(1), networkWorkers(0)
     {
         started = time(0);
 
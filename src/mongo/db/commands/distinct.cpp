@@ -19,15 +19,84 @@
 #include "mongo/db/instance.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/namespace_details.h"
+#include "mongo/db/ops/parallel_scan.h"
 #include "mongo/util/timer.h"
 
 namespace mongo {
 
+    /**
+     * Collects the distinct values of a key in each range of a parallel
+     * scan. Values are deduplicated within a range here and across ranges
+     * when they are appended to the result, in range order, so the values
+     * come out in the same order a serial table scan would produce.
+     */
+    class ParallelDistinct : public ParallelScan {
+    public:
+        ParallelDistinct(NamespaceDetails *d, const BSONObj &query, const string &key, int nThreads) :
+            ParallelScan(d, query, nThreads),
+            _key(key),
+            _ranges(nRanges()) {
+        }
+        // @return the distinct values found in range, each wrapped in an object
+        const vector<BSONObj> &values(size_t range) const { return _ranges[range].values; }
+        // @return the number of matching documents
+        long long n() const {
+            long long n = 0;
+            for ( vector<Range>::const_iterator it = _ranges.begin(); it != _ranges.end(); ++it ) {
+                n += it->n;
+            }
+            return n;
+        }
+    protected:
+        virtual void match(size_t range, const BSONObj &obj) {
+            Range &r = _ranges[range];
+            r.n++;
+            BSONElementSet temp;
+            obj.getFieldsDotted(_key, temp);
+            for ( BSONElementSet::iterator i=temp.begin(); i!=temp.end(); ++i ) {
+                if ( r.seen.count( *i ) )
+                    continue;
+                r.bytes += i->size();
+                uassert( 10044, "distinct too big, 16mb cap", r.bytes + 1024 < BSONObjMaxUserSize - 4096 );
+                // the wrapper owns its buffer, so the element stays valid in seen
+                r.values.push_back( i->wrap( "" ) );
+                r.seen.insert( r.values.back().firstElement() );
+            }
+        }
+    private:
+        // each only touched by the worker scanning it
+        struct Range {
+            Range() : bytes(0), n(0) {}
+            vector<BSONObj> values;
+            BSONElementSet seen;
+            int bytes;
+            long long n;
+        };
+        const string _key;
+        vector<Range> _ranges;
+    };
+
     class DistinctCommand : public QueryCommand {
     public:
         DistinctCommand() : QueryCommand("distinct") {}
         virtual void help( stringstream &help ) const {
-            help << "{ distinct : 'collection name' , key : 'a.b' , query : {} }";
+            help << "{ distinct : 'collection name' , key : 'a.b' , query : {} [, parallelism : <threads>] }";
+        }
+
+        // Appends e to arr, which is built in bb, unless it is already in values.
+        static void addValue( const BSONElement &e, BSONElementSet &values, BSONArrayBuilder &arr,
+                              BufBuilder &bb, int bufSize ) {
+            if ( values.count( e ) )
+                return;
+
+            int now = bb.len();
+
+            uassert(10044,  "distinct too big, 16mb cap", ( now + e.size() + 1024 ) < bufSize );
+
+            arr.append( e );
+            BSONElement x( bb.buf() + now );
+
+            values.insert( x );
         }
 
         bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
@@ -91,6 +160,35 @@ namespace mongo {
             
             verify( cursor );
             string cursorName = cursor->toString();
+
+            // A full collection scan can be split across threads, if the
+            // command's read-only transaction is the only one.
+            const int parallelism = ParallelScan::parallelism( cmdObj );
+            if ( parallelism > 1 && ParallelScan::inTopLevelReadOnlyTxn() &&
+                 dynamic_cast<BasicCursor *>( cursor.get() ) != NULL ) {
+                cursor.reset();
+                ParallelDistinct pd( d, query, key, parallelism );
+                pd.run();
+                for ( size_t r = 0; r < pd.nRanges(); r++ ) {
+                    const vector<BSONObj> &rangeValues = pd.values( r );
+                    for ( vector<BSONObj>::const_iterator it = rangeValues.begin(); it != rangeValues.end(); ++it ) {
+                        addValue( it->firstElement(), values, arr, bb, bufSize );
+                    }
+                }
+                verify( start == bb.buf() );
+
+                result.appendArray( "values" , arr.done() );
+
+                BSONObjBuilder b;
+                b.appendNumber( "n" , pd.n() );
+                b.appendNumber( "nscanned" , pd.nscanned() );
+                b.appendNumber( "nscannedObjects" , pd.nscanned() );
+                b.appendNumber( "timems" , t.millis() );
+                b.append( "cursor" , cursorName );
+                b.append( "parallelism" , pd.nThreads() );
+                result.append( "stats" , b.obj() );
+                return true;
+            }
             
             auto_ptr<ClientCursor> cc (new ClientCursor(QueryOption_NoCursorTimeout, cursor, ns));
 
@@ -106,18 +204,7 @@ namespace mongo {
                     loadedRecord = ! cc->getFieldsDotted( key , temp, holder );
 
                     for ( BSONElementSet::iterator i=temp.begin(); i!=temp.end(); ++i ) {
-                        BSONElement e = *i;
-                        if ( values.count( e ) )
-                            continue;
-
-                        int now = bb.len();
-
-                        uassert(10044,  "distinct too big, 16mb cap", ( now + e.size() + 1024 ) < bufSize );
-
-                        arr.append( e );
-                        BSONElement x( start + now );
-
-                        values.insert( x );
+                        addValue( *i, values, arr, bb, bufSize );
                     }
                 }
 
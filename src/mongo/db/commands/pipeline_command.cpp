@@ -130,7 +130,7 @@ namespace mongo {
     }
 
     void PipelineCommand::help(stringstream &help) const {
-        help << "{ pipeline : [ { <data-pipe-op>: {...}}, ... ] }";
+        help << "{ pipeline : [ { <data-pipe-op>: {...}}, ... ] [, allowDiskUse : true] }";
     }
 
     PipelineCommand::~PipelineCommand() {
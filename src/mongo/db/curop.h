@@ -218,8 +218,8 @@ namespace mongo {
 
         void recordGlobalTime( long long micros ) const;
         
-        const LockStat& lockStat() const { return _lockStat; }
-        LockStat& lockStat() { return _lockStat; }
+        const OpLockStat& lockStat() const { return _lockStat; }
+        OpLockStat& lockStat() { return _lockStat; }
     private:
         friend class Client;
         void _reset();
@@ -242,7 +242,7 @@ namespace mongo {
         ThreadSafeString _message;
         ProgressMeter _progressMeter;
         volatile bool _killed;
-        LockStat _lockStat;
+        OpLockStat _lockStat;
         
         // this is how much "extra" time a query might take
         // a writebacklisten for example will block for 30s 
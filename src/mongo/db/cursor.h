@@ -291,6 +291,10 @@ namespace mongo {
 
         /** Initialize the internal DBC */
         void initializeDBC();
+        /** Open a DBC on the given partition of the primary key, see _partition */
+        void setPartition(const int partition);
+        /** Move to the next partition within our bounds and fetch its first rows */
+        bool fetchFromNextPartition();
         void _prelockCompoundBounds(const int currentRange, vector<const FieldInterval *> &combo,
                                     BufBuilder &startKeyBuilder, BufBuilder &endKeyBuilder);
         void _prelockBounds();
@@ -345,7 +349,14 @@ namespace mongo {
         long long _nscanned;
         const int _numWanted;
 
-        IndexDetails::Cursor _cursor;
+        // A cursor over the primary key of a partitioned collection only visits
+        // the partitions that intersect its bounds: _partition through
+        // _lastPartition, in the direction of iteration. Everything else has
+        // one partition, and _cursor is always over _idx.
+        const bool _partitioned;
+        int _partition;
+        int _lastPartition;
+        scoped_ptr<IndexDetails::Cursor> _cursor;
         // An exhausted cursor has no more rows and is done iterating,
         // unless it's tailable. If so, it may try to read more rows.
         bool _tailable;
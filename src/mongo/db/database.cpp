@@ -122,10 +122,23 @@ namespace mongo {
         return true;
     }
 
+    // True if a client other than this one is in a transaction, whose work
+    // the in-memory collection stats would include before it completes.
+    static bool otherClientsHaveTxns() {
+        scoped_lock bl(Client::clientsMutex);
+        for (set<Client*>::const_iterator i = Client::clients.begin(); i != Client::clients.end(); i++) {
+            if (*i != &cc() && (*i)->hasTxn()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void DatabaseHolder::closeDatabases(const StringData &path) {
         Paths::const_iterator pi = _paths.find(path);
         if (pi != _paths.end()) {
             const DBs &dbs = pi->second;
+            const bool persistStats = !otherClientsHaveTxns();
             while (!dbs.empty()) {
                 DBs::const_iterator it = dbs.begin();
                 Database *db = it->second;
@@ -133,6 +146,17 @@ namespace mongo {
                 // This erases dbs[db->name] for us, can't lift it out yet until we understand the callers of closeDatabase().
                 // That's why we have a weird loop here.
                 Client::WriteContext ctx(db->name());
+                if (persistStats) {
+                    try {
+                        Client::Transaction txn(DB_SERIALIZABLE);
+                        nsindex(db->name())->persist_stats();
+                        txn.commit();
+                    } catch (DBException &e) {
+                        // Not fatal, the stats are recomputed when the collections are opened.
+                        warning() << "failed to persist collection stats for " << db->name()
+                                  << ": " << e.what() << endl;
+                    }
+                }
                 db->closeDatabase(db->name(), path);
             }
             _paths.erase(path);
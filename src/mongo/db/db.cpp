@@ -32,16 +32,21 @@
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/dbwebserver.h"
 #include "mongo/db/instance.h"
+#include "mongo/db/index.h"
 #include "mongo/db/introspect.h"
 #include "mongo/db/json.h"
 #include "mongo/db/module.h"
+#include "mongo/db/ops/update.h"
 #include "mongo/db/repl.h"
+#include "mongo/db/repl/physical_sync.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/restapi.h"
+#include "mongo/db/security.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/stats/snapshots.h"
 #include "mongo/db/storage/env.h"
 #include "mongo/db/ttl.h"
+#include "mongo/s/d_logic.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/background.h"
@@ -158,6 +163,23 @@ namespace mongo {
     }
 
     class MyMessageHandler : public MessageHandler {
+        // Everything a connection keeps in thread locals between messages.
+        class DbConnectionState : public ConnectionState {
+        public:
+            DbConnectionState() : client( 0 ) , nonce( 0 ) , sharding( 0 ) , jsTimeSkew( 0 ) {}
+            virtual ~DbConnectionState() {
+                delete jsTimeSkew;
+                delete sharding;
+                delete nonce;
+                delete client;
+            }
+            Client* client;
+            nonce64* nonce;
+            // set by setShardVersion on connections from mongos
+            ShardedConnectionInfo* sharding;
+            // set by the _skewClockCommand test command
+            long long* jsTimeSkew;
+        };
     public:
         virtual void connected( AbstractMessagingPort* p ) {
             Client& c = Client::initThread("conn", p);
@@ -219,6 +241,33 @@ namespace mongo {
             globalScriptEngine->threadDone();
         }
 
+        virtual bool canSuspend() const { return true; }
+
+        virtual ConnectionState* suspend( AbstractMessagingPort* p ) {
+            DbConnectionState* s = new DbConnectionState();
+            s->client = currentClient.release();
+            s->nonce = lastNonce.release();
+            s->sharding = ShardedConnectionInfo::release();
+            s->jsTimeSkew = releaseJSTimeVirtualThreadSkew();
+            return s;
+        }
+
+        virtual void resume( AbstractMessagingPort* p , ConnectionState* state ) {
+            DbConnectionState* s = static_cast<DbConnectionState*>( state );
+            verify( currentClient.get() == 0 );
+            currentClient.reset( s->client );
+            lastNonce.reset( s->nonce );
+            ShardedConnectionInfo::reset( s->sharding );
+            resetJSTimeVirtualThreadSkew( s->jsTimeSkew );
+            s->client = 0;
+            s->nonce = 0;
+            s->sharding = 0;
+            s->jsTimeSkew = 0;
+            delete s;
+            if ( cc().desc().size() )
+                setThreadName( cc().desc().c_str() );
+        }
+
     };
 
     void listen(int port) {
@@ -226,6 +275,7 @@ namespace mongo {
         MessageServer::Options options;
         options.port = port;
         options.ipList = cmdLine.bind_ip;
+        options.workers = cmdLine.networkWorkers;
 
         MessageServer * server = createServer( options , new MyMessageHandler() );
         server->setAsTimeTracker();
@@ -336,15 +386,26 @@ namespace mongo {
 
         acquirePathLock();
 
+        // an empty dbpath gets the files of another member before the
+        // storage engine starts, recovery then makes them consistent
+        const bool physicallySynced = physicalSyncCopy();
+
         // the last thing we do before initializing storage is to install the
         // txn complete hooks, which live in namespace_details.cpp
         extern TxnCompleteHooks _txnCompleteHooks;
         setTxnCompleteHooks(&_txnCompleteHooks);
+        storage::set_update_message_function(applyUpdateMessage);
+        storage::set_generate_keys_function(IndexDetails::generateKeys);
+        storage::set_note_misfit_function(IndexDetails::noteMisfit);
         storage::startup();
 
         // comes after storage::startup() because this reads from the database
         clearTmpCollections();
 
+        if (physicallySynced) {
+            physicalSyncCleanup();
+        }
+
         unsigned long long missingRepl = checkIfReplMissingFromCommandLine();
         if (missingRepl) {
             log() << startupWarningsLog;
@@ -496,11 +557,14 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
     ("journal", "DEPRECATED")
     ("journalCommitInterval", po::value<uint32_t>(), "how often to fsync recovery log (same as logFlushPeriod)")
     ("logFlushPeriod", po::value<uint32_t>(), "how often to fsync recovery log")
+    ("groupCommit", "with --logFlushPeriod 0, let concurrent commits share one fsync of the recovery log")
     ("expireOplogDays", po::value<uint32_t>(), "how many days of oplog data to keep")
     ("expireOplogHours", po::value<uint32_t>(), "how many hours, in addition to expireOplogDays, of oplog data to keep")
+    ("fastupdates", "apply $ modifier updates by _id without reading the object first, when not replicating (getLastError reports n and updatedExisting as null for them, and mods that turn out not to apply are skipped with a warning)")
     ("journalOptions", po::value<int>(), "DEPRECATED")
     ("jsonp","allow JSONP access via http (has security implications)")
     ("lockTimeout", po::value<uint64_t>(), "tokumx row lock wait timeout (in ms), 0 means wait as long as necessary")
+    ("networkWorkers", po::value<int>(), "run client requests on this many worker threads instead of a thread per connection (Linux only)")
     ("noauth", "run without security")
     ("nohttpinterface", "disable http interface")
     ("nojournal", "DEPRECATED)")
@@ -544,6 +608,10 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
     rs_options.add_options()
     ("replSet", po::value<string>(), "arg is <setname>[/<optionalseedhostlist>]")
     ("replIndexPrefetch", po::value<string>(), "specify index prefetching behavior (if secondary) [none|_id_only|all]")
+    ("replApplierThreads", po::value<uint32_t>(), "number of threads a secondary uses to apply non-conflicting transactions concurrently (default 1)")
+    ("initialSyncThreads", po::value<uint32_t>(), "number of collections initial sync bulk loads concurrently, each over its own connection (default 1)")
+    ("physicalSyncFrom", po::value<string>(), "when dbpath is empty, copy the data files and logs of the given member at startup instead of cloning it")
+    ("oplogInsertMany", "log multi-document inserts as one oplog op per batch; only once every member of the set understands them")
     ;
 
     sharding_options.add_options()
@@ -692,6 +760,9 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
                 dbexit( EXIT_BADOPTIONS );
             }
         }
+        if( params.count("groupCommit") ) {
+            cmdLine.groupCommit = true;
+        }
         if( params.count("expireOplogDays") ) {
             cmdLine.expireOplogDays = params["expireOplogDays"].as<uint32_t>();
         }
@@ -795,6 +866,16 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
         if (params.count("notablescan")) {
             cmdLine.noTableScan = true;
         }
+        if (params.count("fastupdates")) {
+            cmdLine.fastUpdates = true;
+        }
+        if (params.count("networkWorkers")) {
+            cmdLine.networkWorkers = params["networkWorkers"].as<int>();
+            if (cmdLine.networkWorkers < 0) {
+                out() << "--networkWorkers cannot be negative" << endl;
+                dbexit( EXIT_BADOPTIONS );
+            }
+        }
         if (params.count("master")) {
             out() << " master is a deprecated parameter" << endl;
         }
@@ -834,6 +915,30 @@ static int mongoDbMain(int argc, char* argv[], char **envp) {
             /* seed list of hosts for the repl set */
             cmdLine._replSet = params["replSet"].as<string>().c_str();
         }
+        if (params.count("replApplierThreads")) {
+            cmdLine.replApplierThreads = params["replApplierThreads"].as<uint32_t>();
+            if (cmdLine.replApplierThreads < 1 || cmdLine.replApplierThreads > 128) {
+                out() << "--replApplierThreads must be between 1 and 128" << endl;
+                dbexit( EXIT_BADOPTIONS );
+            }
+        }
+        if (params.count("initialSyncThreads")) {
+            cmdLine.initialSyncThreads = params["initialSyncThreads"].as<uint32_t>();
+            if (cmdLine.initialSyncThreads < 1 || cmdLine.initialSyncThreads > 64) {
+                out() << "--initialSyncThreads must be between 1 and 64" << endl;
+                dbexit( EXIT_BADOPTIONS );
+            }
+        }
+        if (params.count("oplogInsertMany")) {
+            cmdLine.oplogInsertMany = true;
+        }
+        if (params.count("physicalSyncFrom")) {
+            if (!params.count("replSet")) {
+                out() << "--physicalSyncFrom requires --replSet" << endl;
+                dbexit( EXIT_BADOPTIONS );
+            }
+            cmdLine.physicalSyncFrom = params["physicalSyncFrom"].as<string>();
+        }
         if (params.count("replIndexPrefetch")) {
             out() << " replIndexPrefetch is a deprecated parameter" << endl;
         }
@@ -43,15 +43,20 @@
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/ops/count.h"
 #include "mongo/db/ops/insert.h"
+#include "mongo/db/ops/update.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/db/stats/top.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/db/storage/group_commit.h"
 #include "mongo/db/oplog_helpers.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/version.h"
 #include "mongo/util/lruishmap.h"
 #include "mongo/util/md5.hpp"
+#include "mongo/util/net/message_compressor.h"
+#include "mongo/util/net/message_server.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/ramlog.h"
 
@@ -161,9 +166,10 @@ namespace mongo {
                 //
                 if ( cmdObj["j"].trueValue() || cmdObj["fsync"].trueValue()) {
                     // only bother to flush recovery log 
-                    // if we are not already fsyncing on commit
-                    if (!cmdLine.logFlushPeriod != 0) {
-                        storage::log_flush();
+                    // if we are not already fsyncing on commit,
+                    // sharing the fsync with anyone else waiting
+                    if (cmdLine.logFlushPeriod != 0) {
+                        storage::groupCommit.waitDurable();
                     }
                 }
 
@@ -521,12 +527,37 @@ namespace mongo {
                 bb.done();
             }
 
+            {
+                BSONObjBuilder bb( result.subobjStart( "cachetable" ) );
+                storage::get_cachetable_status( bb );
+                bb.done();
+            }
+
+            {
+                BSONObjBuilder bb( result.subobjStart( "groupCommit" ) );
+                bb.appendBool( "enabled" , cmdLine.logFlushPeriod == 0 && cmdLine.groupCommit );
+                storage::groupCommit.appendStats( bb );
+                bb.done();
+            }
+
             {
                 BSONObjBuilder bb( result.subobjStart( "network" ) );
                 networkCounter.append( bb );
+                {
+                    BSONObjBuilder cb( bb.subobjStart( "compression" ) );
+                    MessageCompressor::appendStats( cb );
+                    cb.done();
+                }
                 bb.done();
             }
 
+            {
+                BSONObjBuilder bb;
+                if ( appendMessageServerStats( bb ) ) {
+                    result.append( "networkWorkers" , bb.obj() );
+                }
+            }
+
 
             timeBuilder.appendNumber( "after counters" , Listener::getElapsedTimeMillis() - start );
 
@@ -548,6 +579,18 @@ namespace mongo {
 
             result.append( "opcounters" , globalOpCounters.getObj() );
 
+            {
+                BSONObjBuilder bb( result.subobjStart( "fastUpdates" ) );
+                appendFastUpdateStats( bb );
+                bb.done();
+            }
+
+            {
+                BSONObjBuilder bb( result.subobjStart( "opLatencyMicros" ) );
+                Top::global.appendGlobalLatencies( bb );
+                bb.done();
+            }
+
             {
                 BSONObjBuilder asserts( result.subobjStart( "asserts" ) );
                 asserts.append( "regular" , assertionCount.regular );
@@ -771,6 +814,132 @@ namespace mongo {
         }
     } cmdDropIndexes;
 
+    class CmdCreateIndexes : public FileopsCommand {
+    public:
+        CmdCreateIndexes() : FileopsCommand("createIndexes") { }
+        virtual bool logTheOp() { return true; }
+        virtual bool slaveOk() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "create several indexes for a collection with a single pass over its data\n"
+                "{ createIndexes: <collection>, indexes: [ { key: <keyPattern>, name: <name>[, unique: <bool>, ...] }, ... ] }";
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool /*fromRepl*/) {
+            uassert(16856, "must pass name of collection to createIndexes", jsobj.firstElement().valuestrsafe()[0] != '\0');
+            const string ns = dbname + '.' + jsobj.firstElement().valuestr();
+            if ( jsobj["indexes"].type() != Array ) {
+                errmsg = "indexes must be an array of index specs";
+                return false;
+            }
+
+            vector<BSONObj> infos;
+            for ( BSONObjIterator it( jsobj["indexes"].embeddedObject() ); it.more(); ) {
+                BSONElement e = it.next();
+                if ( e.type() != Object || e["key"].type() != Object || e["name"].type() != String ) {
+                    errmsg = str::stream() << "bad index spec, need a key and a name: " << e;
+                    return false;
+                }
+                BSONObj spec = e.embeddedObject();
+                if ( spec["ns"].ok() && spec["ns"].str() != ns ) {
+                    errmsg = str::stream() << "index spec ns does not match collection " << ns << ": " << spec;
+                    return false;
+                }
+                BSONObjBuilder b;
+                b.append( "ns", ns );
+                b.appendElements( spec.removeField( "ns" ) );
+                infos.push_back( b.obj() );
+            }
+            if ( infos.empty() ) {
+                errmsg = "no indexes specified";
+                return false;
+            }
+
+            if ( !cmdLine.quiet ) {
+                tlog() << "CMD: createIndexes " << ns << ", " << infos.size() << " indexes" << endl;
+            }
+            NamespaceDetails *d = getAndMaybeCreateNS( ns, false );
+            const int nBefore = d->nIndexes();
+            d->createIndexes( infos );
+
+            // Record the new indexes in the catalog, as an insert into system.indexes would.
+            const string indexesNs = dbname + ".system.indexes";
+            NamespaceDetails *indexesd = nsdetails_maybe_create( indexesNs );
+            NamespaceDetailsTransient *indexesnsdt = &NamespaceDetailsTransient::get( indexesNs );
+            for ( vector<BSONObj>::iterator it = infos.begin(); it != infos.end(); ++it ) {
+                insertOneObject( indexesd, indexesnsdt, *it );
+            }
+
+            result.append( "numIndexesBefore", nBefore );
+            result.append( "numIndexesAfter", d->nIndexes() );
+            return true;
+        }
+    } cmdCreateIndexes;
+
+    class CmdAddPartition : public FileopsCommand {
+    public:
+        CmdAddPartition() : FileopsCommand("addPartition") { }
+        virtual bool logTheOp() { return true; }
+        virtual bool slaveOk() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "start a new partition of a partitioned collection, for the _ids from newMax on\n"
+                "{ addPartition: <collection>, newMax: { _id: <value> } }";
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool /*fromRepl*/) {
+            const string ns = dbname + '.' + jsobj.firstElement().valuestrsafe();
+            if ( ns == rsoplog ) {
+                errmsg = "the oplog is partitioned by expireOplogDays/expireOplogHours";
+                return false;
+            }
+            NamespaceDetails *d = nsdetails( ns );
+            if ( d == NULL ) {
+                errmsg = "ns not found";
+                return false;
+            }
+            if ( jsobj["newMax"].type() != Object ) {
+                errmsg = "addPartition requires newMax";
+                return false;
+            }
+            if ( !cmdLine.quiet ) {
+                tlog() << "CMD: addPartition " << ns << ", newMax " << jsobj["newMax"] << endl;
+            }
+            d->addPartition( jsobj["newMax"].embeddedObject() );
+            result.append( "numPartitions", d->nPartitions() );
+            return true;
+        }
+    } cmdAddPartition;
+
+    class CmdDropPartition : public FileopsCommand {
+    public:
+        CmdDropPartition() : FileopsCommand("dropPartition") { }
+        virtual bool logTheOp() { return true; }
+        virtual bool slaveOk() const { return false; }
+        virtual void help( stringstream& help ) const {
+            help << "drop a partition of a partitioned collection, and every document in it\n"
+                "{ dropPartition: <collection>, id: <partition id> }";
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool /*fromRepl*/) {
+            const string ns = dbname + '.' + jsobj.firstElement().valuestrsafe();
+            if ( ns == rsoplog ) {
+                errmsg = "the oplog is partitioned by expireOplogDays/expireOplogHours";
+                return false;
+            }
+            NamespaceDetails *d = nsdetails( ns );
+            if ( d == NULL ) {
+                errmsg = "ns not found";
+                return false;
+            }
+            if ( !jsobj["id"].isNumber() ) {
+                errmsg = "dropPartition requires the id of a partition";
+                return false;
+            }
+            if ( !cmdLine.quiet ) {
+                tlog() << "CMD: dropPartition " << ns << ", id " << jsobj["id"] << endl;
+            }
+            d->dropPartition( jsobj["id"].numberLong() );
+            result.append( "numPartitions", d->nPartitions() );
+            return true;
+        }
+    } cmdDropPartition;
+
     class CmdReIndex : public ModifyCommand {
     public:
         CmdReIndex() : ModifyCommand("reIndex") { }
@@ -1227,7 +1396,11 @@ namespace mongo {
         CollectionStats() : QueryCommand( "collStats", false, "collstats" ) {}
         virtual void help( stringstream &help ) const {
             help << "{ collStats:\"blog.posts\" , scale : 1 } scale divides sizes e.g. for KB use 1024\n"
-                    "    avgObjSize - in bytes";
+                    "    avgObjSize - in bytes\n"
+                    "    indexDetails - per index sizes, compression, data blocks and unused space in its\n"
+                    "                   file, and the operations it served since startup. Cache residency,\n"
+                    "                   fetches, evictions and buffered messages are only kept for the\n"
+                    "                   whole engine, see serverStatus.cachetable";
         }
         bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
             string ns = dbname + "." + jsobj.firstElement().valuestr();
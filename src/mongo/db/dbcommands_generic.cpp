@@ -84,6 +84,11 @@ namespace mongo {
             help << "supported so far:\n";
             help << "  quiet\n";
             help << "  notablescan\n";
+            help << "  fastupdates\n";
+            help << "  externalSort\n";
+            help << "  planEstimates\n";
+            help << "  oplogInsertMany\n";
+            help << "  scanParallelism\n";
             help << "  logLevel\n";
             help << "  syncdelay\n";
             help << "{ getParameter:'*' } to get everything\n";
@@ -99,6 +104,21 @@ namespace mongo {
             if( all || cmdObj.hasElement("notablescan") ) {
                 result.append("notablescan", cmdLine.noTableScan);
             }
+            if( all || cmdObj.hasElement("fastupdates") ) {
+                result.append("fastupdates", cmdLine.fastUpdates);
+            }
+            if( all || cmdObj.hasElement("externalSort") ) {
+                result.append("externalSort", cmdLine.externalSort);
+            }
+            if( all || cmdObj.hasElement("planEstimates") ) {
+                result.append("planEstimates", cmdLine.planEstimates);
+            }
+            if( all || cmdObj.hasElement("oplogInsertMany") ) {
+                result.append("oplogInsertMany", cmdLine.oplogInsertMany);
+            }
+            if( all || cmdObj.hasElement("scanParallelism") ) {
+                result.append("scanParallelism", cmdLine.scanParallelism);
+            }
             if( all || cmdObj.hasElement("logLevel") ) {
                 result.append("logLevel", logLevel);
             }
@@ -134,11 +154,16 @@ namespace mongo {
             help << "set administrative option(s)\n";
             help << "{ setParameter:1, <param>:<value> }\n";
             help << "supported so far:\n";
+            help << "  externalSort\n";
+            help << "  fastupdates\n";
             help << "  journalCommitInterval\n";
             help << "  logFlushPeriod\n";
             help << "  logLevel\n";
             help << "  notablescan\n";
+            help << "  oplogInsertMany\n";
+            help << "  planEstimates\n";
             help << "  quiet\n";
+            help << "  scanParallelism\n";
             help << "  syncdelay\n";
         }
         bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
@@ -183,6 +208,46 @@ namespace mongo {
                 cmdLine.noTableScan = cmdObj["notablescan"].Bool();
                 s++;
             }
+            if( cmdObj.hasElement("fastupdates") ) {
+                verify( !cmdLine.isMongos() );
+                if( s == 0 )
+                    result.append("was", cmdLine.fastUpdates);
+                cmdLine.fastUpdates = cmdObj["fastupdates"].Bool();
+                s++;
+            }
+            if( cmdObj.hasElement("externalSort") ) {
+                verify( !cmdLine.isMongos() );
+                if( s == 0 )
+                    result.append("was", cmdLine.externalSort);
+                cmdLine.externalSort = cmdObj["externalSort"].Bool();
+                s++;
+            }
+            if( cmdObj.hasElement("planEstimates") ) {
+                verify( !cmdLine.isMongos() );
+                if( s == 0 )
+                    result.append("was", cmdLine.planEstimates);
+                cmdLine.planEstimates = cmdObj["planEstimates"].Bool();
+                s++;
+            }
+            if( cmdObj.hasElement("oplogInsertMany") ) {
+                verify( !cmdLine.isMongos() );
+                if( s == 0 )
+                    result.append("was", cmdLine.oplogInsertMany);
+                cmdLine.oplogInsertMany = cmdObj["oplogInsertMany"].Bool();
+                s++;
+            }
+            if( cmdObj.hasElement("scanParallelism") ) {
+                verify( !cmdLine.isMongos() );
+                const int n = cmdObj["scanParallelism"].numberInt();
+                if ( n < 1 ) {
+                    errmsg = "scanParallelism must be at least 1";
+                    return false;
+                }
+                if( s == 0 )
+                    result.append("was", cmdLine.scanParallelism);
+                cmdLine.scanParallelism = n;
+                s++;
+            }
             if( cmdObj.hasElement("quiet") ) {
                 if( s == 0 )
                     result.append("was", cmdLine.quiet );
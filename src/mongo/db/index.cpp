@@ -39,7 +39,9 @@ namespace mongo {
         _info(info.copy()),
         _keyPattern(info["key"].Obj().copy()),
         _unique(info["unique"].trueValue()),
-        _clustering(info["clustering"].trueValue()) {
+        _clustering(info["clustering"].trueValue()),
+        _hotBuilding(false),
+        _misfitsMutex("IndexDetails::_misfits") {
 
         string dbname = indexNamespace();
         TOKULOG(1) << "Opening IndexDetails " << dbname << endl;
@@ -51,6 +53,8 @@ namespace mongo {
         if (may_create) {
             addNewNamespaceToCatalog(dbname);
         }
+        // for generateKeys, which is called with only the DB
+        _db->app_private = this;
     }
 
     IndexDetails::~IndexDetails() {
@@ -112,6 +116,30 @@ namespace mongo {
         getSpec().getKeys( obj, keys );
     }
 
+    void IndexDetails::generateKeys(DB *db, const BSONObj &info, const BSONObj &obj, BSONObjSet &keys) {
+        const IndexDetails *idx = static_cast<const IndexDetails *>(db->app_private);
+        if (idx != NULL) {
+            idx->getKeysFromObject(obj, keys);
+        } else {
+            // recovery opens dictionaries on its own, without an IndexDetails
+            IndexSpec spec(info["key"].Obj(), info);
+            spec.getKeys(obj, keys);
+        }
+    }
+
+    void IndexDetails::noteMisfit(DB *db, const BSONObj &pk) {
+        IndexDetails *idx = static_cast<IndexDetails *>(db->app_private);
+        // Recovery only replays the rows, the indexer's fixes are logged too.
+        if (idx != NULL && idx->_hotBuilding) {
+            SimpleMutex::scoped_lock lk(idx->_misfitsMutex);
+            idx->_misfits.insert(pk.getOwned());
+        }
+    }
+
+    bool IndexDetails::mayGenerateRows() const {
+        return storage::descriptor_has_info(_db);
+    }
+
     const IndexSpec& IndexDetails::getSpec() const {
         SimpleRWLock::Exclusive lk(NamespaceDetailsTransient::_qcRWLock);
         return NamespaceDetailsTransient::get_inlock( info()["ns"].String() ).getIndexSpec( this );
@@ -191,6 +219,7 @@ namespace mongo {
         if (r != 0) {
             storage::handle_ydb_error(r);
         }
+        _counters.add(INSERTS, 1);
         TOKULOG(3) << "index " << info()["key"].Obj() << ": inserted " << key << ", pk " << (pk ? *pk : BSONObj()) << ", val " << val << endl;
     }
 
@@ -203,6 +232,21 @@ namespace mongo {
         if (r != 0) {
             storage::handle_ydb_error(r);
         }
+        _counters.add(DELETES, 1);
+    }
+
+    void IndexDetails::updatePair(const BSONObj &key, const BSONObj *pk, const BSONObj &msg, uint64_t flags) {
+        storage::Key skey(key, pk);
+        DBT kdbt = skey.dbt();
+        DBT mdbt = storage::make_dbt(msg.objdata(), msg.objsize());
+
+        const int update_flags = (flags & NamespaceDetails::NO_LOCKTREE) ? DB_PRELOCKED_WRITE : 0;
+        int r = _db->update(_db, cc().txn().db_txn(), &kdbt, &mdbt, update_flags);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+        _counters.add(UPDATES, 1);
+        TOKULOG(3) << "index " << info()["key"].Obj() << ": updated " << key << ", pk " << (pk ? *pk : BSONObj()) << ", msg " << msg << endl;
     }
 
     enum toku_compression_method IndexDetails::getCompressionMethod() const {
@@ -239,6 +283,22 @@ namespace mongo {
         }
     }
 
+    void IndexDetails::keyRange(const storage::Key &key, uint64_t *less, uint64_t *equal, uint64_t *greater) const {
+        DBT keyDBT = key.dbt();
+        int isExact;
+        int r = _db->key_range64(_db, cc().txn().db_txn(), &keyDBT, less, equal, greater, &isExact);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+    }
+
+    void IndexDetails::getFragmentation(TOKU_DB_FRAGMENTATION_S *frag) const {
+        int r = _db->get_fragmentation(_db, frag);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+    }
+
     int IndexDetails::hot_opt_callback(void *extra, float progress) {
         int retval = 0;
         uint64_t iter = *(uint64_t *)extra;
@@ -275,14 +335,59 @@ namespace mongo {
         _init();
     }
 
+    IndexKeyDiff::IndexKeyDiff(const BSONObjSet &oldKeys, const BSONObjSet &newKeys) {
+        const BSONObjSet::key_compare less = oldKeys.key_comp();
+        BSONObjSet::const_iterator o = oldKeys.begin();
+        BSONObjSet::const_iterator n = newKeys.begin();
+        while (o != oldKeys.end() && n != newKeys.end()) {
+            if (less(*o, *n)) {
+                deleted.push_back(&*o++);
+            } else if (less(*n, *o)) {
+                inserted.push_back(&*n++);
+            } else {
+                unchanged.push_back(&*n++);
+                ++o;
+            }
+        }
+        for ( ; o != oldKeys.end(); ++o) {
+            deleted.push_back(&*o);
+        }
+        for ( ; n != newKeys.end(); ++n) {
+            inserted.push_back(&*n);
+        }
+    }
+
     IndexStats::IndexStats(const IndexDetails &idx)
             : _name(idx.indexName()),
               _compressionMethod(idx.getCompressionMethod()),
               _readPageSize(idx.getReadPageSize()),
-              _pageSize(idx.getPageSize()) {
+              _pageSize(idx.getPageSize()),
+              _queries(idx.counters().get(IndexDetails::QUERIES)),
+              _nscanned(idx.counters().get(IndexDetails::NSCANNED)),
+              _inserts(idx.counters().get(IndexDetails::INSERTS)),
+              _deletes(idx.counters().get(IndexDetails::DELETES)),
+              _updates(idx.counters().get(IndexDetails::UPDATES)) {
         idx.getStat64(&_stats);
+        idx.getFragmentation(&_frag);
     }
     
+    void IndexStats::add(const IndexStats &other) {
+        _stats.bt_nkeys += other._stats.bt_nkeys;
+        _stats.bt_ndata += other._stats.bt_ndata;
+        _stats.bt_dsize += other._stats.bt_dsize;
+        _stats.bt_fsize += other._stats.bt_fsize;
+        _frag.file_size_bytes += other._frag.file_size_bytes;
+        _frag.data_bytes += other._frag.data_bytes;
+        _frag.data_blocks += other._frag.data_blocks;
+        _frag.unused_bytes += other._frag.unused_bytes;
+        _frag.largest_unused_block = std::max(_frag.largest_unused_block, other._frag.largest_unused_block);
+        _queries += other._queries;
+        _nscanned += other._nscanned;
+        _inserts += other._inserts;
+        _deletes += other._deletes;
+        _updates += other._updates;
+    }
+
     BSONObj IndexStats::bson(int scale) const {
         BSONObjBuilder b;
         b.append("name", _name);
@@ -324,6 +429,27 @@ namespace mongo {
             b.append("compression", "unknown");
             break;
         }
+        // Blocks in use in the dictionary's file. Most are nodes, but the
+        // header and block table are blocks too, and the ydb doesn't tell
+        // leaves from internal nodes here. Leaf and internal node counts,
+        // cache residency, fetches, evictions and buffered messages are not
+        // reported per index: the ydb has no per dictionary call for them,
+        // only engine wide totals (serverStatus.cachetable).
+        b.appendNumber("dataBlocks", (long long) _frag.data_blocks);
+        b.appendNumber("avgDataBlockSize", (_frag.data_blocks == 0
+                                            ? 0.0
+                                            : ((double)_frag.data_bytes/_frag.data_blocks/scale)));
+        b.appendNumber("unusedBytes", (long long) _frag.unused_bytes / scale);
+        b.appendNumber("largestUnusedBlock", (long long) _frag.largest_unused_block / scale);
+        {
+            BSONObjBuilder ops(b.subobjStart("operations"));
+            ops.appendNumber("queries", _queries);
+            ops.appendNumber("nscanned", _nscanned);
+            ops.appendNumber("inserts", _inserts);
+            ops.appendNumber("deletes", _deletes);
+            ops.appendNumber("updates", _updates);
+            ops.done();
+        }
         return b.obj();
         // TODO: (Zardosht) Need to figure out how to display these dates
         /*
@@ -359,4 +485,34 @@ namespace mongo {
             storage::handle_ydb_error(r);
         }
     }
+
+    std::vector<DB *> IndexDetails::MultiBuilder::dbsOf(const std::vector<IndexDetails *> &indexes) {
+        std::vector<DB *> dbs;
+        for (std::vector<IndexDetails *>::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+            verify((*it)->mayGenerateRows());
+            dbs.push_back((*it)->_db);
+        }
+        return dbs;
+    }
+
+    IndexDetails::MultiBuilder::MultiBuilder(const std::vector<IndexDetails *> &indexes) :
+        _dbs(dbsOf(indexes)), _loader(&_dbs[0], _dbs.size()) {
+    }
+
+    void IndexDetails::MultiBuilder::insertRow(const BSONObj &pk, const BSONObj &obj) {
+        storage::Key skey(pk, NULL);
+        DBT kdbt = skey.dbt();
+        DBT vdbt = storage::make_dbt(obj.objdata(), obj.objsize());
+        const int r = _loader.put(&kdbt, &vdbt);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+    }
+
+    void IndexDetails::MultiBuilder::done() {
+        const int r = _loader.close();
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+    }
 }
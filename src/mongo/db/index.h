@@ -22,6 +22,7 @@
 #include "mongo/pch.h"
 
 #include <db.h>
+#include <set>
 #include <vector>
 
 #include "mongo/db/client.h"
@@ -32,6 +33,9 @@
 #include "mongo/db/storage/key.h"
 #include "mongo/db/storage/txn.h"
 #include "mongo/db/storage/loader.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/striped_counters.h"
 
 namespace mongo {
 
@@ -89,8 +93,15 @@ namespace mongo {
         }
 
         // returns name of this index's storage area
-        // database.table.$index
+        // database.table.$index, or database.table.$index$p<id> for
+        // one partition of a partitioned collection's primary key
         string indexNamespace() const {
+            const BSONElement partition = _info["partition"];
+            if (partition.ok()) {
+                stringstream ss;
+                ss << indexNamespace(parentNS(), indexName()) << "$p" << partition.numberLong();
+                return ss.str();
+            }
             return indexNamespace(parentNS(), indexName());
         }
 
@@ -147,13 +158,47 @@ namespace mongo {
 
         void insertPair(const BSONObj &key, const BSONObj *pk, const BSONObj &val, uint64_t flags);
         void deletePair(const BSONObj &key, const BSONObj *pk, uint64_t flags);
+        // Generates the keys for obj in db's index, for put_multiple and
+        // del_multiple row generation (see storage::set_generate_keys_function).
+        static void generateKeys(DB *db, const BSONObj &info, const BSONObj &obj, BSONObjSet &keys);
+
+        // @return true if rows in this index may be written with put_multiple
+        // and del_multiple. Not true of dictionaries created before their
+        // descriptor carried the index info.
+        bool mayGenerateRows() const;
+
+        // While the hot indexer builds this index, writers send every object's
+        // row in it through put_multiple and del_multiple, so that the indexer
+        // decides whether it's theirs to write yet. An object that doesn't
+        // have exactly one key gets a placeholder row (see generate_key in
+        // storage/env.cpp), and its pk is noted here for the indexer to fix.
+        bool hotBuilding() const { return _hotBuilding; }
+        static void noteMisfit(DB *db, const BSONObj &pk);
+
+        // Send an update message for key, applied to the stored value by the
+        // storage layer's update callback (see storage::update_callback).
+        void updatePair(const BSONObj &key, const BSONObj *pk, const BSONObj &msg, uint64_t flags);
 
         enum toku_compression_method getCompressionMethod() const;
         uint32_t getPageSize() const;
         uint32_t getReadPageSize() const;
         void getStat64(DB_BTREE_STAT64* stats) const;
+        // Estimates, without reading rows, how many keys in this index sort
+        // before, equal to, and after key.  Used to cost query plans.
+        void keyRange(const storage::Key &key, uint64_t *less, uint64_t *equal, uint64_t *greater) const;
+        void getFragmentation(TOKU_DB_FRAGMENTATION_S *frag) const;
         void optimize();
 
+        // Operations done on this index since it was opened, for collStats.
+        // Striped, since every write to a collection bumps one of these on
+        // each of its indexes. A cursor adds its query and nscanned when it's
+        // destroyed, so that reads don't bump a counter for every row.
+        enum { QUERIES, NSCANNED, INSERTS, DELETES, UPDATES, NCOUNTERS };
+        typedef StripedCounters<NCOUNTERS> Counters;
+        Counters &counters() const {
+            return _counters;
+        }
+
         struct UniqueCheckExtra {
             const BSONObj &newkey;
             const Ordering &ordering;
@@ -189,6 +234,25 @@ namespace mongo {
             storage::Loader _loader;
         };
 
+        // Loads several empty indexes of one collection with a single loader,
+        // fed the collection's rows. The environment generates each index's
+        // row from them, so every index must mayGenerateRows() and each
+        // object inserted must have exactly one key in every index.
+        class MultiBuilder {
+        public:
+            MultiBuilder(const std::vector<IndexDetails *> &indexes);
+
+            void insertRow(const BSONObj &pk, const BSONObj &obj);
+
+            void done();
+
+        private:
+            static std::vector<DB *> dbsOf(const std::vector<IndexDetails *> &indexes);
+
+            std::vector<DB *> _dbs;
+            storage::Loader _loader;
+        };
+
     private:
         // Open dictionary representing the index on disk.
         DB *_db;
@@ -205,14 +269,37 @@ namespace mongo {
         const bool _unique;
         const bool _clustering;
 
+        mutable Counters _counters;
+
+        // Set by NamespaceDetails::HotIndexer for the length of the build.
+        bool _hotBuilding;
+        SimpleMutex _misfitsMutex;
+        std::set<BSONObj> _misfits;
+
         friend class NamespaceDetails;
     };
 
+    // The changes an update makes to one index's keys for a document, found
+    // with a single merge of the sorted old and new key sets. The entries
+    // point into those sets, which must outlive the diff.
+    struct IndexKeyDiff {
+        IndexKeyDiff(const BSONObjSet &oldKeys, const BSONObjSet &newKeys);
+        // keys only in oldKeys, to delete
+        std::vector<const BSONObj *> deleted;
+        // keys only in newKeys, to insert
+        std::vector<const BSONObj *> inserted;
+        // keys in both, which a clustering index overwrites with the new object
+        std::vector<const BSONObj *> unchanged;
+    };
+
     // class to store statistics about an IndexDetails
     class IndexStats {
     public:
         explicit IndexStats(const IndexDetails &idx);
         BSONObj bson(int scale) const;
+        // Accumulate the counts and sizes of another dictionary holding part
+        // of the same index (see partitioned collections).
+        void add(const IndexStats &other);
         uint64_t getCount() const {
             return _stats.bt_nkeys;
         }
@@ -225,6 +312,12 @@ namespace mongo {
     private:
         string _name;
         DB_BTREE_STAT64 _stats;
+        TOKU_DB_FRAGMENTATION_S _frag;
+        long long _queries;
+        long long _nscanned;
+        long long _inserts;
+        long long _deletes;
+        long long _updates;
         enum toku_compression_method _compressionMethod;
         uint32_t _readPageSize;
         uint32_t _pageSize;
@@ -221,7 +221,9 @@ namespace mongo {
         _bounds(),
         _nscanned(0),
         _numWanted(numWanted),
-        _cursor(_idx, cursor_flags()),
+        _partitioned(_d->isPKIndex(_idx) && _d->isPartitioned()),
+        _partition(0),
+        _lastPartition(0),
         _tailable(false),
         _ok(false),
         _getf_iteration(0)
@@ -245,7 +247,9 @@ namespace mongo {
         _bounds(bounds),
         _nscanned(0),
         _numWanted(numWanted),
-        _cursor(_idx, cursor_flags()),
+        _partitioned(_d->isPKIndex(_idx) && _d->isPartitioned()),
+        _partition(0),
+        _lastPartition(0),
         _tailable(false),
         _ok(false),
         _getf_iteration(0)
@@ -260,6 +264,9 @@ namespace mongo {
     }
 
     IndexCursor::~IndexCursor() {
+        IndexDetails::Counters &counters = _idx.counters();
+        counters.add(IndexDetails::QUERIES, 1);
+        counters.add(IndexDetails::NSCANNED, _nscanned);
     }
 
     int IndexCursor::cursor_getf(const DBT *key, const DBT *val, void *extra) {
@@ -331,7 +338,7 @@ namespace mongo {
         DBT start = sKey.dbt();
         DBT end = eKey.dbt();
 
-        DBC *cursor = _cursor.dbc();
+        DBC *cursor = _cursor->dbc();
         const int r = cursor->c_pre_acquire_range_lock( cursor, &start, &end );
         if ( r != 0 ) {
             storage::handle_ydb_error(r);
@@ -432,6 +439,16 @@ namespace mongo {
     }
 
     void IndexCursor::initializeDBC() {
+        if ( _partitioned ) {
+            // Partition pruning: only the partitions from the one holding the
+            // start key to the one holding the end key can have anything for us.
+            const int n = _d->nPartitions();
+            _partition = !_startKey.isEmpty() ? _d->findPartition( _startKey ) : ( forward() ? 0 : n - 1 );
+            _lastPartition = !_endKey.isEmpty() ? _d->findPartition( _endKey ) : ( forward() ? n - 1 : 0 );
+        }
+        _cursor.reset( new IndexDetails::Cursor( _partitioned ? _d->getPartition( _partition ) : _idx,
+                                                 cursor_flags() ) );
+
         // We need to prelock first, then position the cursor.
         prelock();
 
@@ -451,6 +468,42 @@ namespace mongo {
         checkCurrentAgainstBounds();
     }
 
+    void IndexCursor::setPartition(const int partition) {
+        TOKULOG(3) << toString() << ": moving to partition " << partition << endl;
+        _partition = partition;
+        _cursor.reset( new IndexDetails::Cursor( _d->getPartition( _partition ), cursor_flags() ) );
+        // Row locks are per dictionary, so the new cursor takes its own.
+        prelock();
+    }
+
+    bool IndexCursor::fetchFromNextPartition() {
+        while ( _partitioned && ( forward() ? _partition < _lastPartition : _partition > _lastPartition ) ) {
+            setPartition( _partition + ( forward() ? 1 : -1 ) );
+
+            int r;
+            const int rows_to_fetch = getf_fetch_count();
+            struct cursor_getf_extra extra(&_buffer, rows_to_fetch);
+            DBC *cursor = _cursor->dbc();
+            if ( forward() ) {
+                r = cursor->c_getf_first(cursor, getf_flags(), cursor_getf, &extra);
+            } else {
+                r = cursor->c_getf_last(cursor, getf_flags(), cursor_getf, &extra);
+            }
+            if ( extra.ex != NULL ) {
+                throw *extra.ex;
+            }
+            if ( r != 0 && r != DB_NOTFOUND ) {
+                storage::handle_ydb_error(r);
+            }
+
+            _getf_iteration++;
+            if ( extra.rows_fetched > 0 ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     int IndexCursor::cursor_flags() {
         QueryCursorMode mode = cc().opSettings().getQueryCursorMode();
         switch ( mode ) {
@@ -520,13 +573,20 @@ namespace mongo {
         _buffer.empty();
         _getf_iteration = 0;
 
+        if ( _partitioned ) {
+            const int partition = _d->findPartition( key );
+            if ( partition != _partition ) {
+                setPartition( partition );
+            }
+        }
+
         storage::Key sKey( key, !pk.isEmpty() ? &pk : NULL );
         DBT key_dbt = sKey.dbt();;
 
         int r;
         const int rows_to_fetch = getf_fetch_count();
         struct cursor_getf_extra extra(&_buffer, rows_to_fetch);
-        DBC *cursor = _cursor.dbc();
+        DBC *cursor = _cursor->dbc();
         if ( forward() ) {
             r = cursor->c_getf_set_range(cursor, getf_flags(), &key_dbt, cursor_getf, &extra);
         } else {
@@ -540,7 +600,9 @@ namespace mongo {
         }
 
         _getf_iteration++;
-        _ok = extra.rows_fetched > 0 ? true : false;
+        // Nothing left in this partition, the next one's first row is the
+        // closest key to the one we wanted.
+        _ok = extra.rows_fetched > 0 || fetchFromNextPartition();
         if ( ok() ) {
             getCurrentFromBuffer();
         }
@@ -711,7 +773,7 @@ again:      while ( !allInclusive && ok() ) {
         int r;
         const int rows_to_fetch = getf_fetch_count();
         struct cursor_getf_extra extra(&_buffer, rows_to_fetch);
-        DBC *cursor = _cursor.dbc();
+        DBC *cursor = _cursor->dbc();
         if ( forward() ) {
             r = cursor->c_getf_next(cursor, getf_flags(), cursor_getf, &extra);
         } else {
@@ -725,7 +787,7 @@ again:      while ( !allInclusive && ok() ) {
         }
 
         _getf_iteration++;
-        return extra.rows_fetched > 0 ? true : false;
+        return extra.rows_fetched > 0 || fetchFromNextPartition();
     }
 
     void IndexCursor::_advance() {
@@ -44,6 +44,7 @@
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/index.h"
 #include "mongo/db/jsobjmanipulator.h"
+#include "mongo/db/oplog_helpers.h"
 #include "mongo/db/relock.h"
 #include "mongo/db/ops/count.h"
 #include "mongo/db/ops/delete.h"
@@ -444,6 +445,7 @@ namespace mongo {
         currentOp.ensureStarted();
         currentOp.done();
         debug.executionTime = currentOp.totalTimeMillis();
+        Top::global.recordLatency( currentOp.getNS() , op , isCommand , currentOp.totalTimeMicros() );
 
         logThreshold += currentOp.getExpectedLatencyMs();
 
@@ -536,8 +538,15 @@ namespace mongo {
 
         Client::Context ctx(ns);
         Client::Transaction transaction(DB_SERIALIZABLE);
-        UpdateResult res = updateObjects(ns, toupdate, query, upsert, multi, true, op.debug() );
-        lastError.getSafe()->recordUpdate( res.existing , res.num , res.upserted ); // for getlasterror
+        UpdateResult res = updateObjects(ns, toupdate, query, upsert, multi, true, op.debug(),
+                                         false, QueryPlanSelectionPolicy::any(), true );
+        // for getlasterror
+        if ( res.blind ) {
+            lastError.getSafe()->recordBlindUpdate();
+        }
+        else {
+            lastError.getSafe()->recordUpdate( res.existing , res.num , res.upserted );
+        }
         transaction.commit();
     }
 
@@ -791,6 +800,49 @@ namespace mongo {
         transaction.commit();
     }
 
+    // ensureIndex with background: true. The index is built with the hot indexer
+    // in a single transaction, but the database is only write locked while the
+    // index is registered and while it's made visible, not while it's built.
+    static void receivedBackgroundIndexInsert(const char *ns, Message &m, const BSONObj &info) {
+        const string coll = info["ns"].String();
+        Client::Transaction transaction(DB_SERIALIZABLE);
+        scoped_ptr<NamespaceDetails::HotIndexer> indexer;
+        {
+            Lock::DBWrite lk(ns);
+            uassert(10058, "not master", isMasterNs(ns));
+            if (handlePossibleShardedMessage(m, 0)) {
+                return;
+            }
+            Client::Context ctx(ns);
+            NamespaceDetails *d = getAndMaybeCreateNS(coll, true);
+            if (d->findIndexByKeyPattern(info["key"].Obj()) >= 0) {
+                // already exists, same as a foreground ensureIndex
+                transaction.commit();
+                return;
+            }
+            indexer.reset(new NamespaceDetails::HotIndexer(d, info));
+            indexer->prepare();
+        }
+        {
+            Lock::DBRead lk(ns);
+            Client::Context ctx(ns);
+            indexer->build();
+        }
+        {
+            Lock::DBWrite lk(ns);
+            Client::Context ctx(ns);
+            indexer->commit();
+
+            // The index already exists, so insert the catalog entry directly
+            // instead of through insertObjects, which would try to build it.
+            BSONObj obj = info;
+            insertOneObject(getAndMaybeCreateNS(ns, true), &NamespaceDetailsTransient::get(ns), obj);
+            OpLogHelpers::logInsert(ns, obj, &cc().txn());
+            globalOpCounters.incInsertInWriteLock(1);
+            transaction.commit();
+        }
+    }
+
     void receivedInsert(Message& m, CurOp& op) {
         DbMessage d(m);
         const char *ns = d.getns();
@@ -812,6 +864,12 @@ namespace mongo {
         settings.setQueryCursorMode(WRITE_LOCK_CURSOR);
         cc().setOpSettings(settings);
 
+        if (objs.size() == 1 && objs[0]["background"].trueValue() &&
+            str::endsWith(ns, ".system.indexes")) {
+            receivedBackgroundIndexInsert(ns, m, objs[0]);
+            return;
+        }
+
         try {
             Lock::DBRead lk(ns);
             lockedReceivedInsert(ns, m, objs, keepGoing);
@@ -76,12 +76,17 @@ namespace mongo {
 
         if ( code )
             b.append( "code" , code );
-        if ( updatedExisting != NotUpdate )
+        if ( updatedExisting == Unknown )
+            b.appendNull( "updatedExisting" );
+        else if ( updatedExisting != NotUpdate )
             b.appendBool( "updatedExisting", updatedExisting == True );
         if ( upsertedId.isSet() )
             b.append( "upserted" , upsertedId );
 
-        b.appendNumber( "n", nObjects );
+        if ( updatedExisting == Unknown )
+            b.appendNull( "n" );
+        else
+            b.appendNumber( "n", nObjects );
 
         return ! msg.empty();
     }
@@ -27,7 +27,9 @@ namespace mongo {
     struct LastError {
         int code;
         string msg;
-        enum UpdatedExistingType { NotUpdate, True, False } updatedExisting;
+        // Unknown for a blind update (--fastupdates), which never reads the
+        // object, so getLastError reports both updatedExisting and n as null
+        enum UpdatedExistingType { NotUpdate, True, False, Unknown } updatedExisting;
         OID upsertedId;
         OID writebackId; // this shouldn't get reset so that old GLE are handled
         int writebackSince;
@@ -53,6 +55,10 @@ namespace mongo {
                 upsertedId = _upsertedId;
 
         }
+        void recordBlindUpdate() {
+            reset( true );
+            updatedExisting = Unknown;
+        }
         void recordDelete( long long nDeleted ) {
             reset( true );
             nObjects = nDeleted;
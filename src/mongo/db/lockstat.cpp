@@ -23,24 +23,27 @@
 
 namespace mongo { 
 
-    BSONObj LockStat::report() const { 
+    template <int Stripes>
+    BSONObj LockStats<Stripes>::report() const { 
         BSONObjBuilder b;
 
         BSONObjBuilder t( b.subobjStart( "timeLockedMicros" ) );
-        _append( b , timeLocked );
+        _append( b , LOCKED );
         t.done();
         
         BSONObjBuilder a( b.subobjStart( "timeAcquiringMicros" ) );
-        _append( a , timeAcquiring );
+        _append( a , ACQUIRING );
         a.done();
         
         return b.obj();
     }
 
-    void LockStat::report( StringBuilder& builder ) const {
+    template <int Stripes>
+    void LockStats<Stripes>::report( StringBuilder& builder ) const {
         bool prefixPrinted = false;
         for ( int i=0; i < N; i++ ) {
-            if ( timeLocked[i].load() == 0 )
+            const long long micros = _counters.get( LOCKED + i );
+            if ( micros == 0 )
                 continue;
             
             if ( ! prefixPrinted ) {
@@ -48,24 +51,31 @@ namespace mongo {
                 prefixPrinted = true;
             }
 
-            builder << ' ' << nameFor( i ) << ':' << timeLocked[i].load();
+            builder << ' ' << nameFor( i ) << ':' << micros;
         }
         
     }
 
-    void LockStat::_append( BSONObjBuilder& builder, const AtomicInt64* data ) {
-        if ( data[0].load() || data[1].load() ) {
-            builder.append( "R" , data[0].load() );
-            builder.append( "W" , data[1].load() );
+    template <int Stripes>
+    void LockStats<Stripes>::_append( BSONObjBuilder& builder, int first ) const {
+        long long data[N];
+        for ( int i = 0; i < N; i++ ) {
+            data[i] = _counters.get( first + i );
+        }
+
+        if ( data[0] || data[1] ) {
+            builder.append( "R" , data[0] );
+            builder.append( "W" , data[1] );
         }
         
-        if ( data[2].load() || data[3].load() ) {
-            builder.append( "r" , data[2].load() );
-            builder.append( "w" , data[3].load() );
+        if ( data[2] || data[3] ) {
+            builder.append( "r" , data[2] );
+            builder.append( "w" , data[3] );
         }
     }
 
-    unsigned LockStat::mapNo(char type) {
+    template <int Stripes>
+    unsigned LockStats<Stripes>::mapNo(char type) {
         switch( type ) { 
         case 'R' : return 0;
         case 'W' : return 1;
@@ -77,7 +87,8 @@ namespace mongo {
         return 0;
     }
 
-    char LockStat::nameFor(unsigned offset) {
+    template <int Stripes>
+    char LockStats<Stripes>::nameFor(unsigned offset) {
         switch ( offset ) {
         case 0: return 'R';
         case 1: return 'W';
@@ -88,17 +99,20 @@ namespace mongo {
     }
 
 
-    void LockStat::recordAcquireTimeMicros( char type , long long micros ) {
-        timeAcquiring[mapNo(type)].fetchAndAdd( micros );
+    template <int Stripes>
+    void LockStats<Stripes>::recordAcquireTimeMicros( char type , long long micros ) {
+        _counters.add( ACQUIRING + mapNo(type) , micros );
     }
-    void LockStat::recordLockTimeMicros( char type , long long micros ) {
-        timeLocked[mapNo(type)].fetchAndAdd( micros );
+    template <int Stripes>
+    void LockStats<Stripes>::recordLockTimeMicros( char type , long long micros ) {
+        _counters.add( LOCKED + mapNo(type) , micros );
     }
 
-    void LockStat::reset() {
-        for ( int i = 0; i < N; i++ ) {
-            timeAcquiring[i].store(0);
-            timeLocked[i].store(0);
-        }
+    template <int Stripes>
+    void LockStats<Stripes>::reset() {
+        _counters.reset();
     }
+
+    template class LockStats<DefaultCounterStripes>;
+    template class LockStats<1>;
 }
@@ -20,13 +20,21 @@
 #pragma once
 
 #include "util/timer.h"
-#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/striped_counters.h"
 
 namespace mongo { 
 
     class BSONObj;
 
-    class LockStat { 
+    /**
+     * Time spent acquiring and holding each kind of lock, in micros.
+     *
+     * Every thread that takes a lock adds to its stats, so those are striped
+     * (LockStat). A CurOp's are only added to by its own thread and are reset
+     * for every operation, so they use a single stripe (OpLockStat).
+     */
+    template <int Stripes>
+    class LockStats : boost::noncopyable { 
         enum { N = 4 };
     public:
         void recordAcquireTimeMicros( char type , long long micros );
@@ -37,17 +45,19 @@ namespace mongo {
         BSONObj report() const;
         void report( StringBuilder& builder ) const;
 
-        long long getTimeLocked( char type ) const { return timeLocked[mapNo(type)].load(); }
+        long long getTimeLocked( char type ) const { return _counters.get(LOCKED + mapNo(type)); }
     private:
-        static void _append( BSONObjBuilder& builder, const AtomicInt64* data );
+        void _append( BSONObjBuilder& builder, int first ) const;
         
-        // RWrw
-        // in micros
-        AtomicInt64 timeAcquiring[N];
-        AtomicInt64 timeLocked[N];
+        // RWrw acquiring, then RWrw locked
+        enum { ACQUIRING = 0, LOCKED = N };
+        StripedCounters<2 * N, Stripes> _counters;
 
         static unsigned mapNo(char type);
         static char nameFor(unsigned offset);
     };
 
+    typedef LockStats<DefaultCounterStripes> LockStat;
+    typedef LockStats<1> OpLockStat;
+
 }
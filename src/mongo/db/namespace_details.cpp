@@ -38,6 +38,7 @@
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/db/storage/indexer.h"
 #include "mongo/db/storage/txn.h"
 #include "mongo/db/storage/key.h"
 #include "mongo/platform/atomic_word.h"
@@ -133,6 +134,52 @@ namespace mongo {
         }
     }
 
+    struct getfLastExtra {
+        BSONObj &key;
+        std::exception *ex;
+        getfLastExtra(BSONObj &k) : key(k), ex(NULL) { }
+    };
+
+    static int getfLastCallback(const DBT *key, const DBT *value, void *extra) {
+        struct getfLastExtra *info = reinterpret_cast<struct getfLastExtra *>(extra);
+        try {
+            if (key != NULL) {
+                const storage::Key sKey(key);
+                info->key = sKey.key().getOwned();
+            }
+            return 0;
+        } catch (std::exception &e) {
+            info->ex = &e;
+        }
+        return -1;
+    }
+
+    // @return the first or last key in the given index, or an empty object if it's empty
+    static BSONObj getEndKey(const IndexDetails &idx, const bool last, const int cursorFlags) {
+        IndexDetails::Cursor c(idx, cursorFlags);
+        DBC *cursor = c.dbc();
+
+        BSONObj key = BSONObj();
+        struct getfLastExtra extra(key);
+        const int r = last ? cursor->c_getf_last(cursor, 0, getfLastCallback, &extra) :
+                             cursor->c_getf_first(cursor, 0, getfLastCallback, &extra);
+        if (extra.ex != NULL) {
+            throw *extra.ex;
+        }
+        if (r != 0 && r != DB_NOTFOUND) {
+            storage::handle_ydb_error(r);
+        }
+        return key;
+    }
+
+    static BSONObj getLastKey(const IndexDetails &idx, const int cursorFlags = 0) {
+        return getEndKey(idx, true, cursorFlags);
+    }
+
+    static BSONObj getFirstKey(const IndexDetails &idx, const int cursorFlags = 0) {
+        return getEndKey(idx, false, cursorFlags);
+    }
+
     class IndexedCollection : public NamespaceDetails {
     public:
         IndexedCollection(const StringData &ns, const BSONObj &options) :
@@ -168,13 +215,240 @@ namespace mongo {
         }
     };
 
-    class OplogCollection : public IndexedCollection {
+    // Partitioned collections split the primary key index into several
+    // dictionaries by _id range, so that old data (say, the oldest days of a
+    // time series) can be dropped by removing whole dictionaries instead of
+    // deleting documents one by one. Partition i holds the keys from the max
+    // of partition i - 1 (inclusive) up to its own max (exclusive), and the
+    // last partition's max is MaxKey. The list of partitions is kept in the
+    // nsindex entry, and each partition's dictionary is listed in
+    // system.namespaces like any index. The first partition is the original
+    // _id_ dictionary, the ones added later are named <ns>.$_id_$p<id>.
+    //
+    // _indexes[0] is always the last partition, which can't be dropped.
+    // Secondary indexes are not supported: dropping a partition would have to
+    // delete its documents' keys from each of them, one by one.
+    class PartitionedCollection : public IndexedCollection {
+    public:
+        PartitionedCollection(const StringData &ns, const BSONObj &options) :
+            IndexedCollection(ns, options),
+            _nextPartitionId(1) {
+            _partitions.push_back(Partition(0, maxKey, _indexes[0], curTimeMillis64()));
+            nsindex(_ns)->update_ns(_ns, serialize(), true);
+        }
+        PartitionedCollection(const BSONObj &serialized) :
+            IndexedCollection(serialized),
+            _nextPartitionId(std::max(serialized["nextPartitionId"].numberLong(), 1LL)) {
+
+            if (!serialized["partitions"].ok()) {
+                // An oplog from before it was partitioned is all one partition.
+                _partitions.push_back(Partition(0, maxKey, _indexes[0], 0));
+                return;
+            }
+            // The last partition was opened as the pk index, open the others.
+            std::vector<BSONElement> partitions = serialized["partitions"].Array();
+            try {
+                for (std::vector<BSONElement>::const_iterator it = partitions.begin(); it != partitions.end(); ++it) {
+                    const BSONObj p = it->Obj();
+                    const long long id = p["_id"].numberLong();
+                    shared_ptr<IndexDetails> idx = it + 1 == partitions.end() ? _indexes[0] :
+                                                   shared_ptr<IndexDetails>(new IndexDetails(partitionInfo(id), false));
+                    const unsigned long long created = p["created"].ok() ? p["created"].date().millis : 0;
+                    _partitions.push_back(Partition(id, p["max"].Obj(), idx, created));
+                }
+            }
+            catch (DBException &) {
+                for (PartitionVector::const_iterator it = _partitions.begin(); it != _partitions.end(); ++it) {
+                    if (it->idx != _indexes[0]) {
+                        it->idx->close();
+                    }
+                }
+                throw;
+            }
+            verify(!_partitions.empty() && _partitions.back().idx == _indexes[0]);
+        }
+
+        void close() {
+            for (PartitionVector::const_iterator it = _partitions.begin(); it + 1 < _partitions.end(); ++it) {
+                it->idx->close();
+            }
+            NamespaceDetails::close();
+        }
+
+        BSONObj serialize() const {
+            BSONObjBuilder b;
+            b.appendElements(NamespaceDetails::serialize());
+            b.append("nextPartitionId", _nextPartitionId);
+            BSONArrayBuilder partitions(b.subarrayStart("partitions"));
+            for (PartitionVector::const_iterator it = _partitions.begin(); it != _partitions.end(); ++it) {
+                partitions.append(BSON("_id" << it->id << "max" << it->max <<
+                                       "created" << Date_t(it->created)));
+            }
+            partitions.done();
+            return b.obj();
+        }
+
+        bool isPartitioned() const {
+            return true;
+        }
+
+        int nPartitions() const {
+            return _partitions.size();
+        }
+
+        IndexDetails &getPartition(int i) const {
+            return *_partitions[i].idx;
+        }
+
+        BSONObj getPartitionInfo(int i) const {
+            const Partition &p = _partitions[i];
+            return BSON("_id" << p.id << "max" << p.max << "created" << Date_t(p.created));
+        }
+
+        int findPartition(const BSONObj &pk) const {
+            // binary search for the first partition whose max is greater than pk
+            int lo = 0;
+            int hi = _partitions.size() - 1;
+            while (lo < hi) {
+                const int mid = (lo + hi) / 2;
+                if (pk.woCompare(_partitions[mid].max, BSONObj(), false) < 0) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            return lo;
+        }
+
+        void addPartition(const BSONObj &newMax) {
+            Lock::assertWriteLocked(_ns);
+            uassert(16863, "addPartition requires newMax to have an _id", newMax["_id"].ok());
+            const BSONObj max = newMax["_id"].wrap("");
+            if (_partitions.size() > 1) {
+                const BSONObj &prevMax = _partitions[_partitions.size() - 2].max;
+                uassert(16864, str::stream() << "newMax " << newMax << " must be greater than the max of the previous partition, "
+                               << prevMax.replaceFieldNames(_pk), max.woCompare(prevMax, BSONObj(), false) > 0);
+            }
+            // Every key already in the last partition has to stay below newMax.
+            // The serializable write cursor also locks the range after the last
+            // key, so an uncommitted insert there makes us fail instead of
+            // ending up in the wrong partition.
+            const BSONObj lastKey = getLastKey(*_indexes[0], DB_SERIALIZABLE | DB_RMW);
+            uassert(16865, str::stream() << "newMax " << newMax << " must be greater than every _id in the last partition, "
+                           << lastKey.replaceFieldNames(_pk),
+                    lastKey.isEmpty() || lastKey.woCompare(max, BSONObj(), false) < 0);
+
+            // Note this ns in the rollback so if this transaction aborts, we'll
+            // close this ns, forcing the next user to reload in-memory metadata.
+            NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
+            rollback.noteNs(_ns);
+            ClientCursor::invalidate(_ns);
+
+            shared_ptr<IndexDetails> idx(new IndexDetails(partitionInfo(_nextPartitionId)));
+            _partitions.back().max = max.getOwned();
+            _partitions.push_back(Partition(_nextPartitionId, maxKey, idx, curTimeMillis64()));
+            _indexes[0] = idx;
+            _nextPartitionId++;
+            nsindex(_ns)->update_ns(_ns, serialize(), true);
+        }
+
+        void dropPartition(long long id) {
+            Lock::assertWriteLocked(_ns);
+            PartitionVector::iterator it = _partitions.begin();
+            while (it != _partitions.end() && it->id != id) {
+                ++it;
+            }
+            uassert(16866, str::stream() << "no partition with id " << id, it != _partitions.end());
+            uassert(16867, "cannot drop the last partition", it + 1 != _partitions.end());
+
+            NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
+            rollback.noteNs(_ns);
+            ClientCursor::invalidate(_ns);
+
+            // The documents go away with the dictionary, there are no
+            // secondary indexes to delete them from.
+            const string dname = it->idx->indexNamespace();
+            it->idx->close();
+            storage::db_remove(dname);
+            removeNamespaceFromCatalog(dname);
+            _partitions.erase(it);
+            nsindex(_ns)->update_ns(_ns, serialize(), true);
+        }
+
+        void optimize() {
+            for (PartitionVector::const_iterator it = _partitions.begin(); it + 1 < _partitions.end(); ++it) {
+                it->idx->optimize();
+            }
+            NamespaceDetails::optimize();
+        }
+
+        void fillSpecificStats(BSONObjBuilder *result, int scale) const {
+            result->appendBool("partitioned", true);
+            BSONArrayBuilder partitions(result->subarrayStart("partitions"));
+            for (PartitionVector::const_iterator it = _partitions.begin(); it != _partitions.end(); ++it) {
+                const IndexStats stats(*it->idx);
+                BSONObjBuilder b(partitions.subobjStart());
+                b.append("_id", it->id);
+                b.append("max", it->max.replaceFieldNames(_pk));
+                b.appendDate("created", it->created);
+                b.appendNumber("count", (long long) stats.getCount());
+                b.appendNumber("size", (long long) stats.getDataSize() / scale);
+                b.appendNumber("storageSize", (long long) stats.getStorageSize() / scale);
+                b.done();
+            }
+            partitions.done();
+        }
+
+    protected:
+        // The pk index's stats are those of all the partitions together.
+        void fillIndexStats(std::vector<IndexStats> &indexStats) const {
+            NamespaceDetails::fillIndexStats(indexStats);
+            for (PartitionVector::const_iterator it = _partitions.begin(); it + 1 < _partitions.end(); ++it) {
+                indexStats[0].add(IndexStats(*it->idx));
+            }
+        }
+
+    private:
+        struct Partition {
+            Partition(long long i, const BSONObj &m, const shared_ptr<IndexDetails> &ix,
+                      unsigned long long c) :
+                id(i), max(m.getOwned()), idx(ix), created(c) {
+            }
+            long long id;
+            // exclusive upper bound, as a pk (single element, no field name)
+            BSONObj max;
+            shared_ptr<IndexDetails> idx;
+            // when it was started, in millis since the epoch, 0 if unknown
+            unsigned long long created;
+        };
+        typedef std::vector<Partition> PartitionVector;
+
+        BSONObj partitionInfo(long long id) const {
+            BSONObjBuilder b;
+            b.appendElements(indexInfo(_pk, true, true));
+            if (id > 0) {
+                b.append("partition", id);
+            }
+            return b.obj();
+        }
+
+        PartitionVector _partitions;
+        long long _nextPartitionId;
+    };
+
+    // The oplog is partitioned by time: the purge thread starts a new
+    // partition every so often (see rotateOplog) and, once everything in the
+    // oldest partition has expired, drops it whole (see purgeOplogPartition)
+    // instead of deleting its entries one by one. Its _id, a GTID, grows with
+    // time, so the entries written while a partition was the last one are
+    // exactly those below its max.
+    class OplogCollection : public PartitionedCollection {
     public:
         OplogCollection(const StringData &ns, const BSONObj &options) :
-            IndexedCollection(ns, options) {
+            PartitionedCollection(ns, options) {
         } 
         OplogCollection(const BSONObj &serialized) :
-            IndexedCollection(serialized) {
+            PartitionedCollection(serialized) {
         }
         // @return the maximum safe key to read for a tailable cursor.
         BSONObj minUnsafeKey() {
@@ -201,21 +475,9 @@ namespace mongo {
             _nextPK(0) {
 
             // the next PK, if it exists, is the last key + 1
-            IndexDetails &pkIdx = getPKIndex();
             Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
             {
-                IndexDetails::Cursor c(pkIdx);
-                DBC *cursor = c.dbc();
-
-                BSONObj key = BSONObj();
-                struct getfLastExtra extra(key);
-                const int r = cursor->c_getf_last(cursor, 0, getfLastCallback, &extra);
-                if (extra.ex != NULL) {
-                    throw *extra.ex;
-                }
-                if (r != 0 && r != DB_NOTFOUND) {
-                    storage::handle_ydb_error(r);
-                }
+                const BSONObj key = getLastKey(getPKIndex());
                 if (!key.isEmpty()) {
                     dassert(key.nFields() == 1);
                     _nextPK = AtomicWord<long long>(key.firstElement().Long() + 1);
@@ -233,27 +495,6 @@ namespace mongo {
 
     protected:
         AtomicWord<long long> _nextPK;
-
-    private:
-        struct getfLastExtra {
-            BSONObj &key;
-            std::exception *ex;
-            getfLastExtra(BSONObj &k) : key(k), ex(NULL) { }
-        };
-
-        static int getfLastCallback(const DBT *key, const DBT *value, void *extra) {
-            struct getfLastExtra *info = reinterpret_cast<struct getfLastExtra *>(extra);
-            try {
-                if (key != NULL) {
-                    const storage::Key sKey(key);
-                    info->key = sKey.key().getOwned();
-                }
-                return 0;
-            } catch (std::exception &e) {
-                info->ex = &e;
-            }
-            return -1;
-        }
     };
 
     class SystemCatalogCollection : public NaturalOrderCollection {
@@ -271,7 +512,7 @@ namespace mongo {
             NaturalOrderCollection::insertObject(obj, flags);
         }
 
-        void createIndex(const BSONObj &info) {
+        void createIndexes(const vector<BSONObj> &infos) {
             msgasserted(16464, "bug: system collections should not be indexed." );
         }
 
@@ -311,6 +552,13 @@ namespace mongo {
     // its document modification strategy from IndexedCollections. The size
     // and count of a capped collection is maintained in memory and kept valid
     // on txn abort through a CappedCollectionRollback class in the TxnContext. 
+    // On a clean shutdown the count and size are written to the "stats" of
+    // the nsindex entry, with the first and last primary keys at the time, so
+    // reopening the collection needn't count the documents. Nothing is written
+    // while running. Inserts always move the last key (and trimming the first),
+    // so after a crash stats whose keys don't match the data are ignored and
+    // the documents counted. Shrinking updates don't move either key, so the
+    // first one to commit removes the stats instead.
     //
     // Tailable cursors over capped collections may only read up to one less
     // than the minimum uncommitted primary key to ensure that they never miss
@@ -348,20 +596,26 @@ namespace mongo {
             _maxObjects(serialized["options"]["max"].numberLong()),
             _currentObjects(0),
             _currentSize(0),
+            _statsOnDisk(0),
             _mutex("cappedMutex"),
             _deleteMutex("cappedDeleteMutex") {
             
-            // Determine the number of objects and the total size.
-            // We'll have to look at the data, but this might not be so bad because:
-            // - you pay for it once, on initialization.
-            // - capped collections are meant to be "small" (fit in memory)
-            // - capped collectiosn are meant to be "read heavy",
-            //   so bringing it all into memory now helps warmup.
             long long n = 0;
             long long size = 0;
             Client::Transaction txn(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
-            for (shared_ptr<Cursor> c( BasicCursor::make(this) ); c->ok(); n++, c->advance()) {
-                size += c->current().objsize();
+            const BSONElement stats = serialized["stats"];
+            if (stats.ok()) {
+                _statsOnDisk.store(1);
+            }
+            if (stats.ok() && stats.Obj()["keys"].Obj() == keyRange()) {
+                n = stats.Obj()["count"].numberLong();
+                size = stats.Obj()["size"].numberLong();
+            } else {
+                // Without stats from a clean shutdown that still match the data,
+                // we have to look at the data to determine the count and size.
+                for (shared_ptr<Cursor> c( BasicCursor::make(this) ); c->ok(); n++, c->advance()) {
+                    size += c->current().objsize();
+                }
             }
             txn.commit();
 
@@ -380,6 +634,20 @@ namespace mongo {
             result->appendNumber("cappedSizeCurrent", _currentSize.load());
         }
 
+        void persistStats() {
+            {
+                SimpleMutex::scoped_lock lk(_mutex);
+                if (!_uncommittedMinPKs.empty()) {
+                    // can't happen on a clean shutdown, but the stats would be wrong
+                    return;
+                }
+            }
+            nsindex(_ns)->update_ns_stats(_ns, BSON("count" << _currentObjects.load() <<
+                                                    "size" << _currentSize.load() <<
+                                                    "keys" << keyRange()));
+            _statsOnDisk.store(1);
+        }
+
         bool isCapped() const {
             dassert(_options["capped"].trueValue());
             return true;
@@ -452,6 +720,12 @@ namespace mongo {
 
             NamespaceDetails::updateObject(pk, oldObj, newObj, flags);
             if (diff < 0) {
+                if (_statsOnDisk.load() && !nsindex(_ns)->clear_ns_stats(_ns)) {
+                    // Gone for good, a committed txn removed them.
+                    _statsOnDisk.store(0);
+                }
+                CappedCollectionRollback &rollback = cc().txn().cappedRollback();
+                rollback.noteUpdate(_ns, diff);
                 _currentSize.addAndFetch(diff);
             }
         }
@@ -490,6 +764,14 @@ namespace mongo {
         }
 
     private:
+        // The first and last primary keys, which persisted stats are checked against.
+        BSONObj keyRange() const {
+            const BSONObj first = getFirstKey(getPKIndex());
+            const BSONObj last = getLastKey(getPKIndex());
+            return BSON("first" << (first.isEmpty() ? -1LL : first.firstElement().Long()) <<
+                        "last" << (last.isEmpty() ? -1LL : last.firstElement().Long()));
+        }
+
         // requires: _mutex is held
         void noteUncommittedPK(const BSONObj &pk) {
             CappedCollectionRollback &rollback = cc().txn().cappedRollback();
@@ -636,6 +918,8 @@ namespace mongo {
         const long long _maxObjects;
         AtomicWord<long long> _currentObjects;
         AtomicWord<long long> _currentSize;
+        // Nonzero if the nsindex entry may have stats a shrinking update must remove.
+        AtomicWord<unsigned> _statsOnDisk;
         BSONObj _lastDeletedPK;
         // The set of minimum-uncommitted-PKs for this capped collection.
         // Each transaction that has done inserts has the minimum PK it
@@ -679,8 +963,10 @@ namespace mongo {
             msgasserted( 16850, "bug: The profile collection should not be updated." );
         }
 
-        void createIndex(const BSONObj &idx_info) {
-            uassert(16851, "Cannot have an _id index on the system profile collection", !idx_info["key"]["_id"].ok());
+        void createIndexes(const vector<BSONObj> &idx_infos) {
+            for (vector<BSONObj>::const_iterator it = idx_infos.begin(); it != idx_infos.end(); ++it) {
+                uassert(16851, "Cannot have an _id index on the system profile collection", !(*it)["key"]["_id"].ok());
+            }
         }
     };
 
@@ -766,6 +1052,10 @@ namespace mongo {
             // We enforce the restriction because it's easier to implement. See SERVER-6937.
             uassert( 16852, "System profile must be a capped collection.", options["capped"].trueValue() );
             return shared_ptr<NamespaceDetails>(new ProfileCollection(ns, options));
+        } else if (options["partitioned"].trueValue()) {
+            uassert(16869, "a partitioned collection cannot be capped or natural ordered",
+                    !options["capped"].trueValue() && !options["natural"].trueValue());
+            return shared_ptr<NamespaceDetails>(new PartitionedCollection(ns, options));
         } else if (options["capped"].trueValue()) {
             return shared_ptr<NamespaceDetails>(new CappedCollection(ns, options));
         } else if (options["natural"].trueValue()) {
@@ -798,6 +1088,8 @@ namespace mongo {
             return shared_ptr<NamespaceDetails>(new SystemCatalogCollection(serialized));
         } else if (isProfileCollection(ns)) {
             return shared_ptr<NamespaceDetails>(new ProfileCollection(serialized));
+        } else if (serialized["options"]["partitioned"].trueValue()) {
+            return shared_ptr<NamespaceDetails>(new PartitionedCollection(serialized));
         } else if (serialized["options"]["capped"].trueValue()) {
             return shared_ptr<NamespaceDetails>(new CappedCollection(serialized));
         } else if (serialized["options"]["natural"].trueValue()) {
@@ -824,10 +1116,10 @@ namespace mongo {
                     "indexes" << indexes_array);
     }
     BSONObj NamespaceDetails::serialize() const {
+        // An index that is still being built isn't persisted until it's done.
         BSONArrayBuilder indexes_array;
-        for (IndexVector::const_iterator it = _indexes.begin(); it != _indexes.end(); it++) {
-            IndexDetails *index = it->get();
-            indexes_array.append(index->info());
+        for (int i = 0; i < _nIndexes; i++) {
+            indexes_array.append(_indexes[i]->info());
         }
         return serialize(_ns, _options, _pk, _multiKeyIndexBits, indexes_array.arr());
     }
@@ -863,7 +1155,7 @@ namespace mongo {
     bool NamespaceDetails::findByPK(const BSONObj &key, BSONObj &result) const {
 
         // get a cursor over the primary key index
-        IndexDetails &pkIdx = getPKIndex();
+        IndexDetails &pkIdx = getPKIndexFor(key);
         IndexDetails::Cursor c(pkIdx);
         DBC *cursor = c.dbc();
 
@@ -893,6 +1185,16 @@ namespace mongo {
         }
     }
 
+    // The primary key and every secondary index that has exactly one key for
+    // obj are written with a single put_multiple/del_multiple, which generates
+    // the secondary rows from the object (see storage::generate_row_for_put).
+    // Multikey and sparse (no key) entries can't be generated that way, so
+    // they are written one key at a time, as are indexes whose dictionary
+    // predates row generation.
+    bool NamespaceDetails::mayGenerateRows(const IndexDetails &idx, const BSONObjSet &keys) const {
+        return (keys.size() == 1 || idx.hotBuilding()) && idx.mayGenerateRows();
+    }
+
     void NamespaceDetails::insertIntoIndexes(const BSONObj &pk, const BSONObj &obj, uint64_t flags) {
         dassert(!pk.isEmpty());
         dassert(!obj.isEmpty());
@@ -900,56 +1202,103 @@ namespace mongo {
             //wunimplemented("overwrite inserts on secondary keys right now don't work");
             //uassert(16432, "can't do overwrite inserts when there are secondary keys yet", !overwrite || _indexes.size() == 1);
         }
-        for (int i = 0; i < nIndexes(); i++) {
+        const bool checkUnique = !(flags & NamespaceDetails::NO_UNIQUE_CHECKS);
+        IndexDetails &pkIdx = getPKIndexFor(pk);
+        if (checkUnique && pkIdx.unique()) {
+            pkIdx.uniqueCheck(pk, NULL);
+        }
+
+        // Generate (and check) every secondary key before writing anything,
+        // including for an index being built in the background.
+        const int n = nIndexesBeingBuilt();
+        std::vector<BSONObjSet> keys(n);
+        for (int i = 1; i < n; i++) {
             IndexDetails &idx = *_indexes[i];
-            if (i == 0) {
-                dassert(isPKIndex(idx));
-                idx.insertPair(pk, NULL, obj, flags);
-            } else {
-                BSONObjSet keys;
-                idx.getKeysFromObject(obj, keys);
-                if (keys.size() > 1) {
-                    setIndexIsMultikey(_ns.c_str(), i);
+            idx.getKeysFromObject(obj, keys[i]);
+            if (keys[i].size() > 1) {
+                setIndexIsMultikey(_ns.c_str(), i);
+            }
+            // An index being built may hold placeholder rows, and gets all
+            // its keys checked when the build commits.
+            if (checkUnique && idx.unique() && !idx.hotBuilding()) {
+                for (BSONObjSet::const_iterator ki = keys[i].begin(); ki != keys[i].end(); ++ki) {
+                    idx.uniqueCheck(*ki, &pk);
                 }
-                for (BSONObjSet::const_iterator ki = keys.begin(); ki != keys.end(); ++ki) {
-                    idx.insertPair(*ki, &pk, obj, flags);
+            }
+        }
+
+        const uint64_t writeFlags = flags | NamespaceDetails::NO_UNIQUE_CHECKS;
+        std::vector<DB *> dbs(1, pkIdx._db);
+        for (int i = 1; i < n; i++) {
+            IndexDetails &idx = *_indexes[i];
+            if (pkIdx.clustering() && mayGenerateRows(idx, keys[i])) {
+                dbs.push_back(idx._db);
+                idx.counters().add(IndexDetails::INSERTS, 1);
+            } else {
+                for (BSONObjSet::const_iterator ki = keys[i].begin(); ki != keys[i].end(); ++ki) {
+                    idx.insertPair(*ki, &pk, obj, writeFlags);
                 }
             }
         }
+        if (dbs.size() == 1) {
+            pkIdx.insertPair(pk, NULL, obj, (flags & NamespaceDetails::NO_PK_LOCKTREE) ?
+                                            writeFlags | NamespaceDetails::NO_LOCKTREE : writeFlags);
+        } else {
+            storage::Key skey(pk, NULL);
+            DBT kdbt = skey.dbt();
+            DBT vdbt = storage::make_dbt(obj.objdata(), obj.objsize());
+            storage::put_multiple(pkIdx._db, &kdbt, &vdbt, dbs, flags & NamespaceDetails::NO_LOCKTREE,
+                                  flags & NamespaceDetails::NO_PK_LOCKTREE);
+            pkIdx.counters().add(IndexDetails::INSERTS, 1);
+        }
+    }
+
+    void NamespaceDetails::lockPKRange(const BSONObj &minPK, const BSONObj &maxPK) {
+        verify(!isPartitioned());
+        dassert(minPK.woCompare(maxPK, _pk, false) <= 0);
+        storage::Key sKey(minPK, NULL);
+        storage::Key eKey(maxPK, NULL);
+        DBT start = sKey.dbt();
+        DBT end = eKey.dbt();
+        IndexDetails::Cursor c(getPKIndex(), DB_SERIALIZABLE | DB_RMW);
+        const int r = c.dbc()->c_pre_acquire_range_lock(c.dbc(), &start, &end);
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
     }
 
     void NamespaceDetails::deleteFromIndexes(const BSONObj &pk, const BSONObj &obj, uint64_t flags) {
         dassert(!pk.isEmpty());
         dassert(!obj.isEmpty());
-        for (int i = 0; i < nIndexes(); i++) {
+        IndexDetails &pkIdx = getPKIndexFor(pk);
+        std::vector<DB *> dbs(1, pkIdx._db);
+        for (int i = 1; i < nIndexesBeingBuilt(); i++) {
             IndexDetails &idx = *_indexes[i];
-
-            if (i == 0) {
-                idx.deletePair(pk, NULL, flags);
+            BSONObjSet keys;
+            idx.getKeysFromObject(obj, keys);
+            if (keys.size() > 1) {
+                // some prior insert should have marked it as multikey, unless the
+                // index is still being built and nobody has looked yet
+                dassert(isMultikey(i) || i >= nIndexes());
+            }
+            if (pkIdx.clustering() && mayGenerateRows(idx, keys)) {
+                dbs.push_back(idx._db);
+                idx.counters().add(IndexDetails::DELETES, 1);
             } else {
-                BSONObjSet keys;
-                idx.getKeysFromObject(obj, keys);
-                if (keys.size() > 1) {
-                    dassert(isMultikey(i)); // some prior insert should have marked it as multikey
-                }
                 for (BSONObjSet::const_iterator ki = keys.begin(); ki != keys.end(); ++ki) {
                     idx.deletePair(*ki, &pk, flags);
                 }
             }
         }
-    }
-
-    // uasserts on duplicate key
-    static bool orderedSetContains(const BSONObjSet &set, const BSONObj &obj) {
-        bool contains = false;
-        for (BSONObjSet::iterator i = set.begin(); i != set.end(); i++) {
-            const int c = i->woCompare(obj);
-            if (c >= 0) {
-                contains = c == 0;
-                break;
-            }
+        if (dbs.size() == 1) {
+            pkIdx.deletePair(pk, NULL, flags);
+        } else {
+            storage::Key skey(pk, NULL);
+            DBT kdbt = skey.dbt();
+            DBT vdbt = storage::make_dbt(obj.objdata(), obj.objsize());
+            storage::del_multiple(pkIdx._db, &kdbt, &vdbt, dbs, flags & NamespaceDetails::NO_LOCKTREE);
+            pkIdx.counters().add(IndexDetails::DELETES, 1);
         }
-        return contains;
     }
 
     // deletes an object from this namespace, taking care of secondary indexes if they exist
@@ -965,8 +1314,8 @@ namespace mongo {
         dassert(!oldObj.isEmpty());
         dassert(!newObj.isEmpty());
 
-        for (int i = 0; i < nIndexes(); i++) {
-            IndexDetails &idx = *_indexes[i];
+        for (int i = 0; i < nIndexesBeingBuilt(); i++) {
+            IndexDetails &idx = i == 0 ? getPKIndexFor(pk) : *_indexes[i];
 
             if (i == 0) {
                 // Overwrite oldObj with newObj using the given pk.
@@ -981,28 +1330,54 @@ namespace mongo {
                     setIndexIsMultikey(_ns.c_str(), i);
                 }
 
-                // Delete the keys that exist in oldKeys but do not exist in newKeys
-                for (BSONObjSet::iterator o = oldKeys.begin(); o != oldKeys.end(); o++) {
-                    const BSONObj &k = *o;
-                    if (!orderedSetContains(newKeys, k)) {
-                        idx.deletePair(k, &pk, flags);
+                const IndexKeyDiff diff(oldKeys, newKeys);
+                if (idx.hotBuilding()) {
+                    // Only the hot indexer knows whether this object's rows
+                    // are ours to change yet, so send them through it.
+                    if (!diff.deleted.empty() || !diff.inserted.empty() || idx.clustering()) {
+                        IndexDetails &pkIdx = getPKIndexFor(pk);
+                        const std::vector<DB *> dbs(1, idx._db);
+                        storage::Key skey(pk, NULL);
+                        DBT kdbt = skey.dbt();
+                        DBT oldvdbt = storage::make_dbt(oldObj.objdata(), oldObj.objsize());
+                        DBT newvdbt = storage::make_dbt(newObj.objdata(), newObj.objsize());
+                        storage::del_multiple(pkIdx._db, &kdbt, &oldvdbt, dbs, flags & NamespaceDetails::NO_LOCKTREE);
+                        storage::put_multiple(pkIdx._db, &kdbt, &newvdbt, dbs, flags & NamespaceDetails::NO_LOCKTREE);
                     }
+                    continue;
                 }
-                // Insert the keys that exist in newKeys but do not exist in oldKeys
-                for (BSONObjSet::iterator n = newKeys.begin(); n != newKeys.end(); n++) {
-                    const BSONObj &k = *n;
-                    if (!orderedSetContains(oldKeys, k)) {
-                        idx.insertPair(k, &pk, newObj, flags);
-                    }
-                    else if (idx.clustering()) {
-                        // if clustering, overwrite every key with the new data
-                        idx.insertPair(k, &pk, newObj, flags | NamespaceDetails::NO_UNIQUE_CHECKS);
+                for (vector<const BSONObj *>::const_iterator k = diff.deleted.begin(); k != diff.deleted.end(); ++k) {
+                    idx.deletePair(**k, &pk, flags);
+                }
+                for (vector<const BSONObj *>::const_iterator k = diff.inserted.begin(); k != diff.inserted.end(); ++k) {
+                    idx.insertPair(**k, &pk, newObj, flags);
+                }
+                if (idx.clustering()) {
+                    // if clustering, overwrite every key with the new data
+                    for (vector<const BSONObj *>::const_iterator k = diff.unchanged.begin(); k != diff.unchanged.end(); ++k) {
+                        idx.insertPair(**k, &pk, newObj, flags | NamespaceDetails::NO_UNIQUE_CHECKS);
                     }
                 }
             }
         }
     }
 
+    void NamespaceDetails::updateObjectMods(const BSONObj &pk, const BSONObj &updateobj, uint64_t flags) {
+        TOKULOG(4) << "NamespaceDetails::updateObjectMods pk "
+            << pk << ", updateobj " << updateobj << endl;
+
+        dassert(!pk.isEmpty());
+        dassert(!updateobj.isEmpty());
+        verify(mayFindById());
+
+        // Only the primary key stores the object. The caller guarantees the
+        // mods do not touch any secondary key, and that none are clustering.
+        for (int i = 1; i < nIndexesBeingBuilt(); i++) {
+            dassert(!_indexes[i]->clustering());
+        }
+        getPKIndexFor(pk).updatePair(pk, NULL, updateobj, flags);
+    }
+
     void NamespaceDetails::setIndexIsMultikey(const StringData& thisns, int i) {
         dassert(thisns == _ns);
         dassert(i < NIndexesMax);
@@ -1021,44 +1396,120 @@ namespace mongo {
         NamespaceDetailsTransient::get(thisns).clearQueryCache();
     }
 
-    void NamespaceDetails::buildIndex(shared_ptr<IndexDetails> &index) {
+    void NamespaceDetails::buildIndexes(const IndexVector &indexes) {
         _indexBuildInProgress = true;
 
-        IndexDetails::Builder builder(*index);
+        // All the new indexes are built from a single scan of the collection.
+        // Those whose rows the environment can generate share one loader,
+        // fed each document once, which only works while every document has
+        // exactly one key in each of them. Any other index gets a loader of
+        // its own, fed its keys. A sparse index may have no key for a
+        // document, so it always gets its own.
+        std::vector<IndexDetails *> generated;
+        std::vector<IndexDetails *> keyed;
+        for (IndexVector::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+            IndexDetails &index = **it;
+            if (index.mayGenerateRows() && !index.info()["sparse"].trueValue()) {
+                generated.push_back(&index);
+            } else {
+                keyed.push_back(&index);
+            }
+        }
+
+        // Whether an index is multikey is only found out during the scan.
+        // The shared loader can't give up a dictionary, so the scan starts
+        // over with that index moved to a loader of its own. That happens
+        // at most once per index, and no document is held aside.
+        while (!loadIndexes(generated, keyed)) {
+            TOKULOG(1) << "rebuilding indexes on " << _ns << ", "
+                       << keyed.size() << " now loaded by key" << endl;
+        }
+
+        for (IndexVector::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
+            IndexDetails &index = **it;
+            if (index.unique()) {
+                checkUniqueKeys(index);
+            }
+        }
+
+        _indexBuildInProgress = false;
+    }
+
+    bool NamespaceDetails::loadIndexes(std::vector<IndexDetails *> &generated,
+                                       std::vector<IndexDetails *> &keyed) {
+        // Loaders that aren't done are aborted when they go out of scope.
+        scoped_ptr<IndexDetails::MultiBuilder> multiBuilder;
+        if (!generated.empty()) {
+            multiBuilder.reset(new IndexDetails::MultiBuilder(generated));
+        }
+        std::vector<shared_ptr<IndexDetails::Builder> > builders;
+        for (std::vector<IndexDetails *>::const_iterator it = keyed.begin(); it != keyed.end(); ++it) {
+            builders.push_back(shared_ptr<IndexDetails::Builder>(new IndexDetails::Builder(**it)));
+        }
 
-        const int indexNum = idxNo(*index);
         for ( shared_ptr<Cursor> cursor(BasicCursor::make(this));
               cursor->ok(); cursor->advance()) {
             BSONObj pk = cursor->currPK();
             BSONObj obj = cursor->current();
-            BSONObjSet keys;
-            index->getKeysFromObject(obj, keys);
-            if (keys.size() > 1) {
-                setIndexIsMultikey(_ns, indexNum);
+            std::vector<IndexDetails *> misfits;
+            for (std::vector<IndexDetails *>::const_iterator it = generated.begin(); it != generated.end(); ++it) {
+                BSONObjSet keys;
+                (*it)->getKeysFromObject(obj, keys);
+                if (keys.size() > 1) {
+                    setIndexIsMultikey(_ns, idxNo(**it));
+                }
+                if (keys.size() != 1) {
+                    misfits.push_back(*it);
+                }
             }
-            for (BSONObjSet::const_iterator ki = keys.begin(); ki != keys.end(); ++ki) {
-                builder.insertPair(*ki, &pk, obj);
+            if (!misfits.empty()) {
+                for (std::vector<IndexDetails *>::const_iterator it = misfits.begin(); it != misfits.end(); ++it) {
+                    generated.erase(std::find(generated.begin(), generated.end(), *it));
+                    keyed.push_back(*it);
+                }
+                return false;
+            }
+            if (multiBuilder) {
+                multiBuilder->insertRow(pk, obj);
+            }
+            for (size_t i = 0; i < keyed.size(); i++) {
+                BSONObjSet keys;
+                keyed[i]->getKeysFromObject(obj, keys);
+                if (keys.size() > 1) {
+                    setIndexIsMultikey(_ns, idxNo(*keyed[i]));
+                }
+                for (BSONObjSet::const_iterator ki = keys.begin(); ki != keys.end(); ++ki) {
+                    builders[i]->insertPair(*ki, &pk, obj);
+                }
             }
             killCurrentOp.checkForInterrupt(false); // uasserts if we should stop
         }
 
-        builder.done();
+        if (multiBuilder) {
+            multiBuilder->done();
+        }
+        for (std::vector<shared_ptr<IndexDetails::Builder> >::const_iterator it = builders.begin();
+             it != builders.end(); ++it) {
+            (*it)->done();
+        }
+        return true;
+    }
 
-        // If the index is unique, check all adjacent keys for a duplicate.
-        if (index->unique()) {
-            IndexScanCursor c(this, *index, 1);
-            BSONObj prevKey = c.currKey().getOwned();
-            c.advance();
-            for ( ; c.ok(); c.advance()) {
-                BSONObj currKey = c.currKey(); 
-                if (currKey == prevKey) {
-                    index->uassertedDupKey(currKey);
-                }
-                prevKey = currKey.getOwned();
+    // Check all adjacent keys for a duplicate. Keys are stored with the pk
+    // appended, so neither the loader nor the hot indexer can tell that two
+    // entries share a key.
+    void NamespaceDetails::checkUniqueKeys(IndexDetails &index) {
+        dassert(index.unique());
+        IndexScanCursor c(this, index, 1);
+        BSONObj prevKey = c.currKey().getOwned();
+        c.advance();
+        for ( ; c.ok(); c.advance()) {
+            BSONObj currKey = c.currKey(); 
+            if (currKey == prevKey) {
+                index.uassertedDupKey(currKey);
             }
+            prevKey = currKey.getOwned();
         }
-
-        _indexBuildInProgress = false;
     }
 
     void NamespaceDetails::empty() {
@@ -1068,30 +1519,49 @@ namespace mongo {
     }
 
     void NamespaceDetails::createIndex(const BSONObj &idx_info) {
-        uassert(16449, "dropDups is not supported and is likely to remain unsupported for some time because it deletes arbitrary data",
-                !idx_info["dropDups"].trueValue());
+        createIndexes(vector<BSONObj>(1, idx_info));
+    }
+
+    void NamespaceDetails::checkIndexInfos(const vector<BSONObj> &idx_infos) {
         uassert(12588, "cannot add index with a background operation in progress", !_indexBuildInProgress);
-        uassert(12523, "no index name specified", idx_info["name"].ok());
+        verify(!idx_infos.empty());
+
+        for (vector<BSONObj>::const_iterator it = idx_infos.begin(); it != idx_infos.end(); ++it) {
+            const BSONObj &idx_info = *it;
+            uassert(16449, "dropDups is not supported and is likely to remain unsupported for some time because it deletes arbitrary data",
+                    !idx_info["dropDups"].trueValue());
+            uassert(12523, "no index name specified", idx_info["name"].ok());
+
+            const StringData &name = idx_info["name"].Stringdata();
+            const BSONObj &keyPattern = idx_info["key"].Obj();
+            for (vector<BSONObj>::const_iterator prev = idx_infos.begin(); prev != it; ++prev) {
+                uassert(16855, mongoutils::str::stream() << "index " << name << " specified more than once",
+                        (*prev)["name"].Stringdata() != name && (*prev)["key"].Obj() != keyPattern);
+            }
+            if (findIndexByName(name) >= 0) {
+                // index already exists.
+                uasserted(16753, mongoutils::str::stream() << "index with name " << name << " already exists");
+            }
+            if (findIndexByKeyPattern(keyPattern) >= 0) {
+                string s = (mongoutils::str::stream() << "index already exists with diff name " << name << ' ' << keyPattern.toString());
+                LOG(2) << s << endl;
+                uasserted(16754, s);
+            }
 
-        const StringData &name = idx_info["name"].Stringdata();
-        if (findIndexByName(name) >= 0) {
-            // index already exists.
-            uasserted(16753, mongoutils::str::stream() << "index with name " << name << " already exists");
-        }
-        const BSONObj &keyPattern = idx_info["key"].Obj();
-        if (findIndexByKeyPattern(keyPattern) >= 0) {
-            string s = (mongoutils::str::stream() << "index already exists with diff name " << name << ' ' << keyPattern.toString());
-            LOG(2) << s << endl;
-            uasserted(16754, s);
-        }
+            uassert(16868, "cannot add secondary indexes to a partitioned collection", !isPartitioned());
 
-        if (nIndexes() >= NIndexesMax ) {
-            string s = (mongoutils::str::stream() <<
-                        "add index fails, too many indexes for " << name <<
-                        " key:" << keyPattern.toString());
-            log() << s << endl;
-            uasserted(12505,s);
+            if (nIndexes() + (it - idx_infos.begin()) >= NIndexesMax ) {
+                string s = (mongoutils::str::stream() <<
+                            "add index fails, too many indexes for " << name <<
+                            " key:" << keyPattern.toString());
+                log() << s << endl;
+                uasserted(12505,s);
+            }
         }
+    }
+
+    void NamespaceDetails::createIndexes(const vector<BSONObj> &idx_infos) {
+        checkIndexInfos(idx_infos);
 
         if (!Lock::isWriteLocked(_ns)) {
             throw RetryWithWriteLock();
@@ -1102,46 +1572,163 @@ namespace mongo {
         NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
         rollback.noteNs(_ns);
 
-        shared_ptr<IndexDetails> index(new IndexDetails(idx_info));
-        // Ensure we initialize the spec in case the collection is empty.
-        // This also causes an error to be thrown if we're trying to create an invalid index on an empty collection.
+        // The first index we create should be the pk index, when we first create the collection.
+        // Every index after it is a secondary index and needs to be built.
         const bool isSecondaryIndex = _nIndexes > 0;
+        IndexVector newIndexes;
+        IndexVector toBuild;
         try {
-            index->getSpec();
-            _indexes.push_back(index);
+            for (vector<BSONObj>::const_iterator it = idx_infos.begin(); it != idx_infos.end(); ++it) {
+                shared_ptr<IndexDetails> index(new IndexDetails(*it));
+                newIndexes.push_back(index);
+                // Ensure we initialize the spec in case the collection is empty.
+                // This also causes an error to be thrown if we're trying to create an invalid index on an empty collection.
+                index->getSpec();
+                _indexes.push_back(index);
+                if (isSecondaryIndex || it != idx_infos.begin()) {
+                    toBuild.push_back(index);
+                }
+            }
 
             // Only secondary indexes need to be built.
-            if (isSecondaryIndex) {
-                try {
-                    buildIndex(index);
-                }
-                catch (DBException) {
-                    _indexes.pop_back();
-                    throw;
-                }
+            if (!toBuild.empty()) {
+                buildIndexes(toBuild);
             }
         }
         catch (DBException &) {
             // Can't let the IndexDetails destructor get called on its own any more, see IndexDetails::close for why.
-            index->close();
+            _indexes.resize(_nIndexes);
+            for (IndexVector::const_iterator it = newIndexes.begin(); it != newIndexes.end(); ++it) {
+                (*it)->close();
+            }
             throw;
         }
-        _nIndexes++;
+        _nIndexes += newIndexes.size();
 
-        const StringData &idx_ns = idx_info["ns"].Stringdata();
+        const StringData &idx_ns = idx_infos[0]["ns"].Stringdata();
 
-        // The first index we create should be the pk index, when we first create the collection.
-        // Therefore the collection's NamespaceDetails should not already exist in the NamespaceIndex
-        // unless we are building a secondary index (and therefore the collection already exists)
+        // Unless we are building secondary indexes, the collection's NamespaceDetails should not
+        // already exist in the NamespaceIndex.
         const bool may_overwrite = isSecondaryIndex;
         if (!may_overwrite) {
-            massert(16435, "first index should be pk index", index->keyPattern() == _pk);
+            massert(16435, "first index should be pk index", newIndexes[0]->keyPattern() == _pk);
         }
         nsindex(idx_ns)->update_ns(idx_ns, serialize(), isSecondaryIndex);
 
         NamespaceDetailsTransient::get(idx_ns).addedIndex();
     }
 
+    NamespaceDetails::HotIndexer::HotIndexer(NamespaceDetails *d, const BSONObj &info) :
+        _d(d), _info(info.getOwned()), _committed(false) {
+    }
+
+    NamespaceDetails::HotIndexer::~HotIndexer() {
+        if (_index && !_committed) {
+            try {
+                abort();
+            } catch (DBException &e) {
+                problem() << "failed to remove background index " << _info["name"] << ": " << e.what() << endl;
+            }
+        }
+    }
+
+    void NamespaceDetails::HotIndexer::prepare() {
+        Lock::assertWriteLocked(_d->_ns);
+        _d->checkIndexInfos(vector<BSONObj>(1, _info));
+        massert(16858, "background index build needs a primary key index", _d->_nIndexes > 0);
+        // Writers send the new index's rows through the indexer, generated
+        // from the object stored in the primary key.
+        massert(16904, "background index build needs a clustering primary key", _d->getPKIndex().clustering());
+
+        // Note this ns in the rollback so if this transaction aborts, we'll
+        // close this ns, forcing the next user to reload in-memory metadata.
+        NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
+        rollback.noteNs(_d->_ns);
+
+        _index.reset(new IndexDetails(_info));
+        _index->getSpec();
+        verify(_index->mayGenerateRows());
+        _index->_hotBuilding = true;
+        // From here on, writers maintain the index (see nIndexesBeingBuilt()).
+        _d->_indexes.push_back(_index);
+        _d->_indexBuildInProgress = true;
+        _indexer.reset(new storage::Indexer(_d->getPKIndex()._db, _index->_db));
+    }
+
+    void NamespaceDetails::HotIndexer::build() {
+        Lock::assertAtLeastReadLocked(_d->_ns);
+        verify(_indexer);
+        int r = _indexer->build();
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+        r = _indexer->close();
+        if (r != 0) {
+            storage::handle_ydb_error(r);
+        }
+        _indexer.reset();
+    }
+
+    void NamespaceDetails::HotIndexer::commit() {
+        Lock::assertWriteLocked(_d->_ns);
+        verify(!_indexer);
+        const int i = _d->idxNo(*_index);
+        verify(i == _d->_nIndexes);
+
+        // Objects without exactly one key only got a placeholder row, see
+        // storage::generate_key. Writers are locked out, so each one's rows
+        // are now final: write the keys it has, every one of which is either
+        // new or the placeholder, and drop the placeholder if it has none.
+        // One that was deleted took its placeholder with it.
+        _index->_hotBuilding = false;
+        std::set<BSONObj> misfits;
+        misfits.swap(_index->_misfits);
+        LOG(1) << "background index " << _info["name"] << " has " << misfits.size()
+               << " objects without exactly one key" << endl;
+        for (std::set<BSONObj>::const_iterator it = misfits.begin(); it != misfits.end(); ++it) {
+            const BSONObj &pk = *it;
+            BSONObj obj;
+            if (!_d->findByPK(pk, obj)) {
+                continue;
+            }
+            BSONObjSet keys;
+            _index->getKeysFromObject(obj, keys);
+            if (keys.size() > 1) {
+                _d->setIndexIsMultikey(_d->_ns, i);
+            }
+            for (BSONObjSet::const_iterator ki = keys.begin(); ki != keys.end(); ++ki) {
+                _index->insertPair(*ki, &pk, obj, NamespaceDetails::NO_UNIQUE_CHECKS);
+            }
+            if (keys.empty()) {
+                BSONObjBuilder b;
+                for (BSONObjIterator ki(_index->keyPattern()); ki.more(); ki.next()) {
+                    b.appendNull("");
+                }
+                _index->deletePair(b.done(), &pk, 0);
+            }
+            killCurrentOp.checkForInterrupt(false); // uasserts if we should stop
+        }
+        if (_index->unique()) {
+            _d->checkUniqueKeys(*_index);
+        }
+
+        _d->_nIndexes++;
+        _d->_indexBuildInProgress = false;
+        _committed = true;
+        nsindex(_d->_ns)->update_ns(_d->_ns, _d->serialize(), true);
+        NamespaceDetailsTransient::get(_d->_ns).addedIndex();
+    }
+
+    void NamespaceDetails::HotIndexer::abort() {
+        _indexer.reset();
+        Lock::DBWrite lk(_d->_ns);
+        _index->_hotBuilding = false;
+        verify(_d->_indexes.back() == _index);
+        _d->_indexes.pop_back();
+        _d->_indexBuildInProgress = false;
+        _index->close();
+    }
+
     // Normally, we cannot drop the _id_ index.
     // The parameters mayDeleteIdIndex is here for the case where we call dropIndexes
     // through dropCollection, in which case we are dropping an entire collection,
@@ -1149,6 +1736,8 @@ namespace mongo {
     bool NamespaceDetails::dropIndexes(const StringData& ns, const StringData& name, string &errmsg, BSONObjBuilder &result, bool mayDeleteIdIndex) {
         Lock::assertWriteLocked(ns);
         TOKULOG(1) << "dropIndexes " << name << endl;
+        uassert(12587, "cannot drop indexes or collection while a background index build is in progress",
+                !_indexBuildInProgress);
 
         // Note this ns in the rollback so if this transaction aborts, we'll
         // close this ns, forcing the next user to reload in-memory metadata.
@@ -1467,6 +2056,12 @@ namespace mongo {
         ClientCursor::invalidate(name.rawData());
         NamespaceDetailsTransient::eraseForPrefix(name);
 
+        // The pk index of a partitioned collection is its last partition,
+        // the others are dropped first.
+        while (d->nPartitions() > 1) {
+            d->dropPartition(d->getPartitionInfo(0)["_id"].numberLong());
+        }
+
         LOG(1) << "\t dropIndexes done" << endl;
         d->dropIndexes(name, "*", errmsg, result, true);
         verify(d->nIndexes() == 0);
@@ -1534,6 +2129,9 @@ namespace mongo {
         Lock::assertWriteLocked(from);
         verify( nsdetails(from) != NULL );
         verify( nsdetails(to) == NULL );
+        uassert(16859, "cannot rename a collection while a background index build is in progress",
+                !nsdetails(from)->indexBuildInProgress());
+        uassert(16870, "cannot rename a partitioned collection", !nsdetails(from)->isPartitioned());
 
         // Invalidate any existing cursors on the old namespace details,
         // and reset the query cache.
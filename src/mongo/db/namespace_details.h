@@ -39,6 +39,10 @@ namespace mongo {
     class NamespaceDetails;
     class Database;
 
+    namespace storage {
+        class Indexer;
+    }
+
     // TODO: Put this in the cmdline abstraction, not extern global.
     extern string dbpath; // --dbpath parm
 
@@ -93,6 +97,7 @@ namespace mongo {
         // Flags for write operations. For performance reasons only. Use with caution.
         static const uint64_t NO_LOCKTREE = 1; // skip acquiring locktree row locks
         static const uint64_t NO_UNIQUE_CHECKS = 2; // skip uniqueness checks
+        static const uint64_t NO_PK_LOCKTREE = 4; // skip row locks in the primary key only, see lockPKRange()
 
         // Creates the appropriate NamespaceDetails implementation based on options.
         static shared_ptr<NamespaceDetails> make(const StringData &ns, const BSONObj &options);
@@ -102,18 +107,18 @@ namespace mongo {
         }
 
         // Closes all the underlying IndexDetails (in case one of them throws, we can't be doing this in a destructor).
-        void close();
+        virtual void close();
 
         int nIndexes() const {
             return _nIndexes;
         }
 
-        /* when a background index build is in progress, we don't count the index in nIndexes until
-           complete, yet need to still use it in _indexRecord() - thus we use this function for that.
+        /* when a background index build is in progress, we don't count the indexes in nIndexes until
+           complete, yet need to still use them in _indexRecord() - thus we use this function for that.
         */
         int nIndexesBeingBuilt() const { 
             if (_indexBuildInProgress) {
-                verify(_nIndexes + 1 == (int) _indexes.size());
+                verify(_nIndexes < (int) _indexes.size());
             } else {
                 verify(_nIndexes == (int) _indexes.size());
             }
@@ -122,7 +127,7 @@ namespace mongo {
 
         IndexDetails& idx(int idxNo) const;
 
-        /** get the IndexDetails for the index currently being built in the background. (there is at most one) */
+        /** get the IndexDetails for the first index currently being built in the background. */
         IndexDetails& inProgIdx() const {
             dassert(_indexBuildInProgress);
             return idx(_nIndexes);
@@ -218,6 +223,42 @@ namespace mongo {
             return _pk;
         }
 
+        // A partitioned collection stores its primary key index in several
+        // dictionaries (partitions), each holding a contiguous range of primary
+        // keys. Every other collection has a single partition, the pk index.
+        virtual bool isPartitioned() const {
+            return false;
+        }
+        virtual int nPartitions() const {
+            return 1;
+        }
+        virtual IndexDetails &getPartition(int i) const {
+            dassert(i == 0);
+            return getPKIndex();
+        }
+        // @return the partition's _id, max (exclusive, a pk without field
+        // names) and when it was created, as a Date
+        virtual BSONObj getPartitionInfo(int i) const {
+            uasserted(16905, "partition info requires a partitioned collection");
+        }
+        // @return the partition whose range contains the given primary key
+        virtual int findPartition(const BSONObj &pk) const {
+            return 0;
+        }
+        // @return the dictionary that holds the row with the given primary key
+        IndexDetails &getPKIndexFor(const BSONObj &pk) const {
+            return getPartition(findPartition(pk));
+        }
+
+        // Start a new last partition for the primary keys >= newMax.
+        virtual void addPartition(const BSONObj &newMax) {
+            uasserted(16861, "addPartition requires a partitioned collection");
+        }
+        // Drop the partition with the given id, and every document in it.
+        virtual void dropPartition(long long id) {
+            uasserted(16862, "dropPartition requires a partitioned collection");
+        }
+
         bool indexBuildInProgress() const {
             return _indexBuildInProgress;
         }
@@ -226,12 +267,12 @@ namespace mongo {
         static BSONObj serialize(const StringData& ns, const BSONObj &options,
                                  const BSONObj &pk, unsigned long long multiKeyIndexBits,
                                  const BSONArray &indexes_array);
-        BSONObj serialize() const;
+        virtual BSONObj serialize() const;
 
         void fillCollectionStats(struct NamespaceDetailsAccStats* accStats, BSONObjBuilder* result, int scale) const;
 
         // Run optimize on each index.
-        void optimize();
+        virtual void optimize();
 
         // Find the first object that matches the query. Force index if requireIndex is true.
         bool findOne(const BSONObj &query, BSONObj &result, const bool requireIndex = false) const;
@@ -281,8 +322,61 @@ namespace mongo {
         // update an object in the namespace by pk, replacing oldObj with newObj
         virtual void updateObject(const BSONObj &pk, const BSONObj &oldObj, BSONObj &newObj, uint64_t flags = 0);
 
+        // update an object in the namespace by pk without reading it first, by
+        // applying the $ modifiers in updateobj lazily in the primary key index.
+        // if no object exists with the given pk, nothing happens.
+        // requires: mayFindById(), the mods are not indexed and there are no
+        //           clustering secondary indexes.
+        void updateObjectMods(const BSONObj &pk, const BSONObj &updateobj, uint64_t flags = 0);
+
+        // write lock the primary keys in [minPK, maxPK] for the current
+        // transaction with one locktree request, so that inserts of keys in
+        // that range may pass NO_PK_LOCKTREE. Secondary keys are still
+        // locked one at a time.
+        // requires: !isPartitioned()
+        void lockPKRange(const BSONObj &minPK, const BSONObj &maxPK);
+
         // create a new index with the given info for this namespace.
-        virtual void createIndex(const BSONObj &info);
+        void createIndex(const BSONObj &info);
+
+        // create several new indexes for this namespace, building all of them
+        // with a single scan over the collection.
+        virtual void createIndexes(const vector<BSONObj> &infos);
+
+        /* Builds one secondary index with the ydb's hot indexer, for ensureIndex
+           with background: true. The caller runs the three phases in one
+           transaction, under these locks on the collection's database:
+
+             prepare() - write lock. Registers the index as being built, so
+                         writers maintain it from now on.
+             build()   - read lock. Fills the index from the existing rows while
+                         other clients keep reading and writing.
+             commit()  - write lock. Makes the index visible to queries.
+
+           Meanwhile writers send the index's rows through the indexer, with
+           put_multiple and del_multiple. An object that doesn't have exactly
+           one key in the index (multikey, or missing from a sparse index) gets
+           a placeholder row and its pk is noted, and commit() writes the keys
+           of just those objects (see IndexDetails::noteMisfit). If the indexer is
+           destroyed without commit(), it takes a write lock and removes the
+           index. While the build is in progress, the collection and its
+           indexes can't be dropped, renamed or added to.
+        */
+        class HotIndexer : boost::noncopyable {
+        public:
+            HotIndexer(NamespaceDetails *d, const BSONObj &info);
+            ~HotIndexer();
+            void prepare();
+            void build();
+            void commit();
+        private:
+            void abort();
+            NamespaceDetails *_d;
+            const BSONObj _info;
+            shared_ptr<IndexDetails> _index;
+            scoped_ptr<storage::Indexer> _indexer;
+            bool _committed;
+        };
 
         // remove everything from a collection
         virtual void empty();
@@ -298,6 +392,11 @@ namespace mongo {
             msgasserted( 16757, "bug: noted an abort, but it wasn't implemented" );
         }
 
+        // write in-memory stats that are expensive to recompute to the nsindex
+        // entry, in the current transaction, see NamespaceIndex::persist_stats()
+        virtual void persistStats() {
+        }
+
         virtual void insertObjectIntoCappedAndLogOps(BSONObj &obj, uint64_t flags) {
             msgasserted( 16775, "bug: should not call insertObjectIntoCappedAndLogOps into non-capped collection" );
         }
@@ -314,8 +413,28 @@ namespace mongo {
         NamespaceDetails(const StringData& ns, const BSONObj &pkIndexPattern, const BSONObj &options);
         explicit NamespaceDetails(const BSONObj &serialized);
 
-        void buildIndex(shared_ptr<IndexDetails> &index);
+        typedef std::vector<shared_ptr<IndexDetails> > IndexVector;
+
+        // uasserts if the given index infos can't be added to this collection
+        void checkIndexInfos(const vector<BSONObj> &idx_infos);
+
+        // build the given indexes, which must already be in _indexes, with one scan
+        void buildIndexes(const IndexVector &indexes);
 
+        // one scan of the collection into the given indexes, the generated
+        // ones through a shared loader; false if one of those turned out
+        // not to have exactly one key per document, in which case it has
+        // been moved to keyed and nothing was loaded
+        bool loadIndexes(std::vector<IndexDetails *> &generated,
+                         std::vector<IndexDetails *> &keyed);
+
+        // uasserts if the given index, which must be built, has a duplicate key
+        void checkUniqueKeys(IndexDetails &index);
+
+        // true if idx's row for an object with the given keys can be generated
+        // by put_multiple/del_multiple from the primary key's row, always
+        // the case for an index the hot indexer is building
+        bool mayGenerateRows(const IndexDetails &idx, const BSONObjSet &keys) const;
         void insertIntoIndexes(const BSONObj &pk, const BSONObj &obj, uint64_t flags);
         void deleteFromIndexes(const BSONObj &pk, const BSONObj &obj, uint64_t flags);
 
@@ -327,7 +446,7 @@ namespace mongo {
 
         // fill the statistics for each index in the NamespaceDetails,
         // indexStats is an array of length nIndexes
-        void fillIndexStats(std::vector<IndexStats> &indexStats) const;
+        virtual void fillIndexStats(std::vector<IndexStats> &indexStats) const;
 
         const string _ns;
         // The options used to create this namespace details. We serialize
@@ -339,7 +458,6 @@ namespace mongo {
         // Each index (including the _id) index has an IndexDetails that describes it.
         bool _indexBuildInProgress;
         int _nIndexes;
-        typedef std::vector<shared_ptr<IndexDetails> > IndexVector;
         IndexVector _indexes;
 
         unsigned long long _multiKeyIndexBits;
@@ -564,9 +682,24 @@ namespace mongo {
         void kill_ns(const StringData& ns);
 
         // If something changes that causes details->serialize() to be different,
-        // call this to persist it to the nsdb.
+        // call this to persist it to the nsdb. When overwriting, the existing
+        // entry's "stats" are kept unless serialized has its own.
         void update_ns(const StringData& ns, const BSONObj &serialized, bool overwrite);
 
+        // Replaces the "stats" of ns's entry with the given ones, or removes
+        // them if stats is empty, in the current transaction. Does nothing if
+        // there is no entry.
+        void update_ns_stats(const StringData& ns, const BSONObj &stats);
+
+        // Removes the "stats" of ns's entry, if it has any.
+        // @return true if it had stats
+        bool clear_ns_stats(const StringData& ns);
+
+        // Has every open collection write its in-memory stats to its entry, in
+        // the current transaction. Only for a clean shutdown, when no other
+        // transaction can be live, see NamespaceDetails::persistStats().
+        void persist_stats();
+
         // Find an NamespaceDetails in the nsindex.
         // Will not open the if its closed, unlike nsdetails()
         NamespaceDetails *find_ns(const StringData& ns) {
@@ -634,6 +767,9 @@ namespace mongo {
         // requires: _openRWLock is locked, exclusively.
         NamespaceDetails *open_ns(const StringData& ns);
 
+        BSONObj get_ns_for_update(const StringData& ns);
+        void put_ns(const StringData& ns, const BSONObj &serialized, bool overwrite);
+
         DB *_nsdb;
         NamespaceDetailsMap _namespaces;
         const string _dir;
@@ -258,6 +258,88 @@ namespace mongo {
         NamespaceIndexRollback &rollback = cc().txn().nsIndexRollback();
         rollback.noteNs(ns);
 
+        BSONObj toWrite = serialized;
+        if (overwrite && !serialized["stats"].ok()) {
+            // The stats are only ever changed by update_ns_stats, carry them over.
+            const BSONObj existing = get_ns_for_update(ns);
+            if (existing["stats"].ok()) {
+                BSONObjBuilder b;
+                b.appendElements(serialized);
+                b.append(existing["stats"]);
+                toWrite = b.obj();
+            }
+        }
+        put_ns(ns, toWrite, overwrite);
+    }
+
+    void NamespaceIndex::update_ns_stats(const StringData& ns, const BSONObj &stats) {
+        init();
+        if (!allocated()) {
+            return;
+        }
+
+        const BSONObj existing = get_ns_for_update(ns);
+        if (existing.isEmpty()) {
+            return;
+        }
+        BSONObjBuilder b;
+        for (BSONObjIterator it(existing); it.more(); ) {
+            const BSONElement e = it.next();
+            if (!mongoutils::str::equals(e.fieldName(), "stats")) {
+                b.append(e);
+            }
+        }
+        if (!stats.isEmpty()) {
+            b.append("stats", stats);
+        }
+        put_ns(ns, b.obj(), true);
+    }
+
+    bool NamespaceIndex::clear_ns_stats(const StringData& ns) {
+        init();
+        if (!allocated()) {
+            return false;
+        }
+
+        // Look before taking the write lock on the entry, so that once the
+        // stats are gone, writers don't serialize on it.
+        BSONObj serialized;
+        BSONObj nsobj = BSON("ns" << ns);
+        storage::Key sKey(nsobj, NULL);
+        DBT ndbt = sKey.dbt();
+        const int r = _nsdb->getf_set(_nsdb, cc().txn().db_txn(), 0, &ndbt, getf_serialized, &serialized);
+        if (r != 0 && r != DB_NOTFOUND) {
+            storage::handle_ydb_error(r);
+        }
+        if (!serialized["stats"].ok()) {
+            return false;
+        }
+        update_ns_stats(ns, BSONObj());
+        return true;
+    }
+
+    void NamespaceIndex::persist_stats() {
+        for (NamespaceDetailsMap::const_iterator it = _namespaces.begin(); it != _namespaces.end(); ++it) {
+            it->second->persistStats();
+        }
+    }
+
+    // Reads ns's entry with a write lock, so no other transaction
+    // can change it before ours completes.
+    BSONObj NamespaceIndex::get_ns_for_update(const StringData& ns) {
+        BSONObj serialized;
+        BSONObj nsobj = BSON("ns" << ns);
+        storage::Key sKey(nsobj, NULL);
+        DBT ndbt = sKey.dbt();
+        const int r = _nsdb->getf_set(_nsdb, cc().txn().db_txn(), DB_SERIALIZABLE | DB_RMW,
+                                      &ndbt, getf_serialized, &serialized);
+        if (r != 0 && r != DB_NOTFOUND) {
+            storage::handle_ydb_error(r);
+        }
+        return serialized;
+    }
+
+    void NamespaceIndex::put_ns(const StringData& ns, const BSONObj &serialized, bool overwrite) {
         BSONObj nsobj = BSON("ns" << ns);
         storage::Key sKey(nsobj, NULL);
         DBT ndbt = sKey.dbt();
@@ -379,18 +379,22 @@ namespace mongo {
         transaction.commit(DB_TXN_NOSYNC);
     }
     
+    // removes the operations of a transaction too big for its oplog entry
+    static void removeOplogRefs(const OID &oid) {
+        Helpers::removeRange(
+            rsOplogRefs,
+            BSON("_id" << BSON("oid" << oid << "seq" << minKey)),
+            BSON("_id" << BSON("oid" << oid << "seq" << maxKey)),
+            BSON("_id" << 1),
+            true,
+            false
+            );
+    }
+
     void purgeEntryFromOplog(BSONObj entry) {
         verify(rsOplogDetails);
         if (entry.hasElement("ref")) {
-            OID oid = entry["ref"].OID();
-            Helpers::removeRange(
-                rsOplogRefs,
-                BSON("_id" << BSON("oid" << oid << "seq" << minKey)),
-                BSON("_id" << BSON("oid" << oid << "seq" << maxKey)),
-                BSON("_id" << 1),
-                true,
-                false
-                );
+            removeOplogRefs(entry["ref"].OID());
         }
 
         BSONObj pk = entry["_id"].wrap("");
@@ -398,6 +402,94 @@ namespace mongo {
         rsOplogDetails->deleteObject(pk, entry, flags);
     }
 
+    // A partition change that aborts closes the oplog's namespace (see
+    // NamespaceIndexRollback), so the cached one has to be found again
+    // before anyone else takes the lock.
+    static void reloadOplogDetails() {
+        rsOplogDetails = nsdetails(rsoplog);
+        massert(16906, "local.oplog.rs missing after a failed partition change", rsOplogDetails);
+    }
+
+    uint64_t rotateOplog(uint64_t partitionMillis) {
+        Client::WriteContext ctx(rsoplog);
+        verify(rsOplogDetails);
+        const int n = rsOplogDetails->nPartitions();
+        const uint64_t started = rsOplogDetails->getPartitionInfo(n - 1)["created"].date().millis;
+        const uint64_t now = curTimeMillis64();
+        if (now < started + partitionMillis) {
+            return started + partitionMillis - now;
+        }
+        GTID last;
+        if (!getLastGTIDinOplog(&last)) {
+            // nothing to close off yet
+            return partitionMillis;
+        }
+        // Every entry from here on gets a greater GTID than the last one.
+        last.inc();
+        BSONObjBuilder b;
+        addGTIDToBSON("_id", last, b);
+        try {
+            Client::Transaction transaction(DB_SERIALIZABLE);
+            rsOplogDetails->addPartition(b.done());
+            transaction.commit(DB_TXN_NOSYNC);
+        }
+        catch (...) {
+            reloadOplogDetails();
+            throw;
+        }
+        return partitionMillis;
+    }
+
+    bool purgeOplogPartition(uint64_t minTime, uint64_t *nextExpiry) {
+        *nextExpiry = 0;
+        BSONObj first;
+        {
+            Client::ReadContext ctx(rsoplog);
+            verify(rsOplogDetails);
+            if (rsOplogDetails->nPartitions() < 2) {
+                return false;
+            }
+            // The partition's entries were all written before the next one started.
+            const uint64_t closed = rsOplogDetails->getPartitionInfo(1)["created"].date().millis;
+            if (closed >= minTime) {
+                *nextExpiry = closed;
+                return false;
+            }
+            first = rsOplogDetails->getPartitionInfo(0);
+
+            // Big transactions keep their operations in oplog.refs, which
+            // isn't partitioned. Only reading the partition, under the read
+            // lock, is still far cheaper than deleting each of its entries.
+            Client::Transaction transaction(DB_SERIALIZABLE);
+            for (shared_ptr<Cursor> c(IndexCursor::make(rsOplogDetails, rsOplogDetails->getPKIndex(),
+                                                        minKey, first["max"].Obj(), false, 1));
+                 c->ok(); c->advance()) {
+                const BSONObj entry = c->current();
+                if (entry.hasElement("ref")) {
+                    removeOplogRefs(entry["ref"].OID());
+                }
+            }
+            transaction.commit(DB_TXN_NOSYNC);
+        }
+
+        Client::WriteContext ctx(rsoplog);
+        if (rsOplogDetails->nPartitions() < 2 ||
+            rsOplogDetails->getPartitionInfo(0)["_id"].numberLong() != first["_id"].numberLong()) {
+            // dropped meanwhile
+            return true;
+        }
+        try {
+            Client::Transaction transaction(DB_SERIALIZABLE);
+            rsOplogDetails->dropPartition(first["_id"].numberLong());
+            transaction.commit(DB_TXN_NOSYNC);
+        }
+        catch (...) {
+            reloadOplogDetails();
+            throw;
+        }
+        return true;
+    }
+
     uint64_t expireOplogMilliseconds() {
         const uint32_t days = cmdLine.expireOplogDays;
         const uint32_t hours = days * 24 + cmdLine.expireOplogHours;
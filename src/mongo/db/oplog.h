@@ -52,6 +52,19 @@ namespace mongo {
     void rollbackTransactionFromOplog(BSONObj entry);
     void purgeEntryFromOplog(BSONObj entry);
 
+    // The oplog is partitioned by time, so that expired entries go a whole
+    // partition at a time instead of one by one.
+    //
+    // Starts a new last partition of the oplog, in a transaction of its own,
+    // if the last one was started partitionMillis or more ago and has
+    // entries. @return the milliseconds until the next one is due.
+    uint64_t rotateOplog(uint64_t partitionMillis);
+    // Drops the first partition of the oplog, and the oplog.refs of its
+    // entries, if every entry in it is older than minTime, each in a
+    // transaction of its own. Otherwise sets nextExpiry to when it will be,
+    // or 0 if there's only the last partition. @return true if it dropped one.
+    bool purgeOplogPartition(uint64_t minTime, uint64_t *nextExpiry);
+
     // @return the age, in milliseconds, when an oplog entry expires.
     uint64_t expireOplogMilliseconds();
     
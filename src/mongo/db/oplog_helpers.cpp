@@ -19,6 +19,7 @@
 #include "txn_context.h"
 #include "repl_block.h"
 #include "stats/counters.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/delete.h"
@@ -84,6 +85,52 @@ namespace OpLogHelpers{
         }
     }
 
+    // Most bytes of rows one "im" op holds, so that it stays far from the
+    // largest BSON object whatever the batch.
+    static const int InsertManyMaxBytes = 1024 * 1024;
+
+    void logInsertMany(const char* ns, const vector<BSONObj> &rows, TxnContext* txn) {
+        if (!cmdLine.oplogInsertMany) {
+            // Members older than "im" can't apply it, so until every member
+            // is known to, the batch is logged the way they expect.
+            for (vector<BSONObj>::const_iterator it = rows.begin(); it != rows.end(); ++it) {
+                logInsert(ns, *it, txn);
+            }
+            return;
+        }
+        if (isLocalNs(ns)) {
+            return;
+        }
+        if (logTxnOpsForSharding()) {
+            for (vector<BSONObj>::const_iterator it = rows.begin(); it != rows.end(); ++it) {
+                if (shouldLogTxnOpForSharding(OP_STR_INSERT, ns, *it)) {
+                    BSONObjBuilder b;
+                    appendOpType(OP_STR_INSERT, &b);
+                    appendNsStr(ns, &b);
+                    b.append(KEY_STR_ROW, *it);
+                    txn->logOpForSharding(b.obj());
+                }
+            }
+        }
+        if (logTxnOpsForReplication()) {
+            vector<BSONObj>::const_iterator it = rows.begin();
+            while (it != rows.end()) {
+                BSONObjBuilder b;
+                appendOpType(OP_STR_INSERT_MANY, &b);
+                appendNsStr(ns, &b);
+                BSONArrayBuilder ab(b.subarrayStart(KEY_STR_ROW));
+                int bytes = 0;
+                do {
+                    ab.append(*it);
+                    bytes += it->objsize();
+                    ++it;
+                } while (it != rows.end() && bytes + it->objsize() <= InsertManyMaxBytes);
+                ab.done();
+                txn->logOpForReplication(b.obj());
+            }
+        }
+    }
+
     void logInsertForCapped(
         const char* ns, 
         BSONObj pk, 
@@ -246,6 +293,24 @@ namespace OpLogHelpers{
         }
     }
 
+    static void runInsertManyFromOplogWithLock(const char* ns, const BSONObj &rows) {
+        for (BSONObjIterator it(rows); it.more(); ) {
+            runNonSystemInsertFromOplogWithLock(ns, it.next().Obj());
+        }
+    }
+
+    static void runInsertManyFromOplog(const char* ns, BSONObj op) {
+        const BSONObj rows = op[KEY_STR_ROW].Obj();
+        try {
+            Client::ReadContext ctx(ns);
+            runInsertManyFromOplogWithLock(ns, rows);
+        }
+        catch (RetryWithWriteLock &e) {
+            Client::WriteContext ctx(ns);
+            runInsertManyFromOplogWithLock(ns, rows);
+        }
+    }
+
     static void runCappedInsertFromOplogWithLock(
         const char* ns, 
         BSONObj& pk,
@@ -390,6 +455,10 @@ namespace OpLogHelpers{
             opCounters->gotInsert();
             runInsertFromOplog(ns, op);
         }
+        else if (strcmp(opType, OP_STR_INSERT_MANY) == 0) {
+            opCounters->gotInserts(op[KEY_STR_ROW].Obj().nFields());
+            runInsertManyFromOplog(ns, op);
+        }
         else if (strcmp(opType, OP_STR_UPDATE) == 0) {
             opCounters->gotUpdate();
             runUpdateFromOplog(ns, op, false);
@@ -442,6 +511,13 @@ namespace OpLogHelpers{
         if (strcmp(opType, OP_STR_INSERT) == 0) {
             runRollbackInsertFromOplog(ns, op);
         }
+        else if (strcmp(opType, OP_STR_INSERT_MANY) == 0) {
+            // the rollback of each insert is to delete its row
+            const vector<BSONElement> rows = op[KEY_STR_ROW].Array();
+            for (vector<BSONElement>::const_reverse_iterator it = rows.rbegin(); it != rows.rend(); ++it) {
+                runDeleteFromOplog(ns, BSON(KEY_STR_ROW << it->Obj()));
+            }
+        }
         else if (strcmp(opType, OP_STR_UPDATE) == 0) {
             runUpdateFromOplog(ns, op, true);
         }
@@ -28,6 +28,7 @@ namespace OpLogHelpers{
 
     // values for types of operations in opLog
     static const char OP_STR_INSERT[] = "i";
+    static const char OP_STR_INSERT_MANY[] = "im";
     static const char OP_STR_CAPPED_INSERT[] = "ci";
     static const char OP_STR_UPDATE[] = "u";
     static const char OP_STR_DELETE[] = "d";
@@ -37,6 +38,10 @@ namespace OpLogHelpers{
 
     void logComment(BSONObj comment, TxnContext* txn);
     void logInsert(const char* ns, BSONObj row, TxnContext* txn);    
+    // Logs a batch of inserts into one collection as few "im" ops with
+    // arrays of rows if --oplogInsertMany, otherwise as one "i" op per row.
+    // Migrations always see one "i" op per row.
+    void logInsertMany(const char* ns, const vector<BSONObj> &rows, TxnContext* txn);
     void logInsertForCapped(const char* ns, BSONObj pk, BSONObj row, TxnContext* txn);
     void logUpdate(const char* ns, const BSONObj& pk, const BSONObj& oldRow, const BSONObj& newRow, bool fromMigrate, TxnContext* txn);
     void logDelete(const char* ns, BSONObj row, bool fromMigrate, TxnContext* txn);
@@ -21,12 +21,39 @@
 #include "mongo/db/client.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/namespace_details.h"
+#include "mongo/db/ops/parallel_scan.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/queryoptimizercursor.h"
 #include "mongo/client/dbclientinterface.h"
 
 namespace mongo {
 
+    namespace {
+
+        class ParallelCount : public ParallelScan {
+        public:
+            ParallelCount(NamespaceDetails *d, const BSONObj &query, int nThreads) :
+                ParallelScan(d, query, nThreads),
+                _counts(nRanges(), 0) {
+            }
+            long long count() const {
+                long long n = 0;
+                for (std::vector<long long>::const_iterator it = _counts.begin(); it != _counts.end(); ++it) {
+                    n += *it;
+                }
+                return n;
+            }
+        protected:
+            virtual void match(size_t range, const BSONObj &obj) {
+                _counts[range]++;
+            }
+        private:
+            // one slot per range, each only touched by the worker scanning it
+            std::vector<long long> _counts;
+        };
+
+    } // namespace
+
     long long runCount( const char *ns, const BSONObj &cmd, string &err, int &errCode ) {
         Client::ReadContext ctx(ns);
         NamespaceDetails *d = nsdetails( ns );
@@ -56,6 +83,10 @@ namespace mongo {
         cc().setOpSettings(settings);
 
         Lock::assertAtLeastReadLocked(ns);
+        // Decided before our own transaction goes on the stack: either it
+        // will be the only one, or it is a child of the command's own
+        // read-only one.
+        const bool mayScanInParallel = !cc().hasTxn() || ParallelScan::inTopLevelReadOnlyTxn();
         Client::Transaction transaction(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
         try {
             bool simpleEqualityMatch = false;
@@ -63,6 +94,17 @@ namespace mongo {
                 shared_ptr<Cursor> cursor =
                         NamespaceDetailsTransient::getCursor( ns, query, BSONObj(), QueryPlanSelectionPolicy::any(),
                                                               &simpleEqualityMatch );
+                // A full collection scan with nothing to skip or limit can be
+                // split across threads.
+                const int parallelism = ParallelScan::parallelism( cmd );
+                if ( parallelism > 1 && skip == 0 && limit == 0 && mayScanInParallel &&
+                     dynamic_cast<BasicCursor *>( cursor.get() ) != NULL ) {
+                    cursor.reset();
+                    ParallelCount pc( d, query, parallelism );
+                    pc.run();
+                    transaction.commit();
+                    return pc.count();
+                }
                 for ( ; cursor->ok() ; cursor->advance() ) {
                     // With simple equality matching there is no need to use the matcher because the bounds
                     // are enforced by the FieldRangeVectorIterator and only key fields have constraints.  There
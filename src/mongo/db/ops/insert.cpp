@@ -65,28 +65,22 @@ namespace mongo {
         }
     }
 
-    void insertObjects(const char *ns, const vector<BSONObj> &objs, bool keepGoing, uint64_t flags, bool logop ) {
-        if (mongoutils::str::contains(ns, "system.")) {
-            massert(16748, "need transaction to run insertObjects", cc().txnStackSize() > 0);
-            uassert(10095, "attempt to insert in reserved database name 'system'", !mongoutils::str::startsWith(ns, "system."));
-            massert(16750, "attempted to insert multiple objects into a system namspace at once", objs.size() == 1);
-            if (handle_system_collection_insert(ns, objs[0], logop) != 0) {
-                return;
-            }
+    static void validateObject(const BSONObj &obj) {
+        uassert( 10059 , "object to insert too large", obj.objsize() <= BSONObjMaxUserSize);
+        BSONObjIterator i( obj );
+        while ( i.more() ) {
+            BSONElement e = i.next();
+            uassert( 13511 , "document to insert can't have $ fields" , e.fieldName()[0] != '$' );
         }
+        uassert( 16440 ,  "_id cannot be an array", obj["_id"].type() != Array );
+    }
 
-        NamespaceDetails *details = getAndMaybeCreateNS(ns, logop);
-        NamespaceDetailsTransient *nsdt = &NamespaceDetailsTransient::get(ns);
+    static void insertObjectsOneAtATime(const char *ns, NamespaceDetails *details, NamespaceDetailsTransient *nsdt,
+                                        const vector<BSONObj> &objs, bool keepGoing, uint64_t flags, bool logop) {
         for (size_t i = 0; i < objs.size(); i++) {
             const BSONObj &obj = objs[i];
             try {
-                uassert( 10059 , "object to insert too large", obj.objsize() <= BSONObjMaxUserSize);
-                BSONObjIterator i( obj );
-                while ( i.more() ) {
-                    BSONElement e = i.next();
-                    uassert( 13511 , "document to insert can't have $ fields" , e.fieldName()[0] != '$' );
-                }
-                uassert( 16440 ,  "_id cannot be an array", obj["_id"].type() != Array );
+                validateObject(obj);
 
                 BSONObj objModified = obj;
                 BSONElementManipulator::lookForTimestamps(objModified);
@@ -115,6 +109,125 @@ namespace mongo {
         }
     }
 
+    namespace {
+
+        struct BatchEntry {
+            BatchEntry(const BSONObj &o, size_t i) : obj(o), index(i) {}
+            BSONObj obj;
+            size_t index; // in the caller's batch
+        };
+
+        bool lessByPK(const BatchEntry &a, const BatchEntry &b) {
+            return a.obj["_id"].woCompare(b.obj["_id"], false) < 0;
+        }
+
+    } // namespace
+
+    // Inserts a batch into a collection keyed by _id. Every object is
+    // validated and given its _id up front, with the missing _ids generated
+    // together, then the objects are written in primary key order (unless
+    // keepGoing, where the order decides which of two conflicting objects
+    // wins) and logged as one array. If all the _ids were generated here,
+    // they are consecutive and no other writer's key falls between the
+    // first and the last (if the OID counter wraps, the range is just
+    // wider), so the whole primary key range is write locked at once
+    // instead of row by row.
+    static void insertBatch(const char *ns, NamespaceDetails *details, NamespaceDetailsTransient *nsdt,
+                            const vector<BSONObj> &objs, bool keepGoing, uint64_t flags, bool logop) {
+        const size_t n = objs.size();
+        vector<BatchEntry> batch;
+        batch.reserve(n);
+        size_t missingIds = 0;
+        for (size_t i = 0; i < n; i++) {
+            try {
+                validateObject(objs[i]);
+            } catch (const UserException &) {
+                if (!keepGoing || i == n - 1) {
+                    throw;
+                }
+                continue;
+            }
+            batch.push_back(BatchEntry(objs[i], i));
+            BSONElementManipulator::lookForTimestamps(batch.back().obj);
+            if (!batch.back().obj.hasField("_id")) {
+                missingIds++;
+            }
+        }
+
+        if (batch.empty()) {
+            return;
+        }
+        if (missingIds > 0) {
+            vector<OID> ids(missingIds);
+            OID::gen(&ids[0], missingIds);
+            vector<OID>::const_iterator id = ids.begin();
+            for (vector<BatchEntry>::iterator it = batch.begin(); it != batch.end(); ++it) {
+                if (!it->obj.hasField("_id")) {
+                    // _id first, everything else after, as addIdField does
+                    BSONObjBuilder b(it->obj.objsize() + 17);
+                    b.append("_id", *id++);
+                    b.appendElements(it->obj);
+                    it->obj = b.obj();
+                }
+            }
+        }
+
+        uint64_t writeFlags = flags;
+        if (!keepGoing) {
+            std::stable_sort(batch.begin(), batch.end(), lessByPK);
+        }
+        if (missingIds == batch.size() && !(flags & NamespaceDetails::NO_LOCKTREE)) {
+            BSONElement minId = batch.front().obj.firstElement();
+            BSONElement maxId = minId;
+            for (vector<BatchEntry>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+                const BSONElement e = it->obj.firstElement();
+                if (e.woCompare(minId, false) < 0) {
+                    minId = e;
+                }
+                if (e.woCompare(maxId, false) > 0) {
+                    maxId = e;
+                }
+            }
+            details->lockPKRange(minId.wrap(""), maxId.wrap(""));
+            writeFlags |= NamespaceDetails::NO_PK_LOCKTREE;
+        }
+
+        vector<BSONObj> inserted;
+        inserted.reserve(batch.size());
+        for (vector<BatchEntry>::iterator it = batch.begin(); it != batch.end(); ++it) {
+            try {
+                insertOneObject(details, nsdt, it->obj, writeFlags);
+                inserted.push_back(it->obj);
+            } catch (const UserException &) {
+                if (!keepGoing || it->index == n - 1) {
+                    throw;
+                }
+            }
+        }
+        if (logop) {
+            OpLogHelpers::logInsertMany(ns, inserted, &cc().txn());
+        }
+    }
+
+    void insertObjects(const char *ns, const vector<BSONObj> &objs, bool keepGoing, uint64_t flags, bool logop ) {
+        if (mongoutils::str::contains(ns, "system.")) {
+            massert(16748, "need transaction to run insertObjects", cc().txnStackSize() > 0);
+            uassert(10095, "attempt to insert in reserved database name 'system'", !mongoutils::str::startsWith(ns, "system."));
+            massert(16750, "attempted to insert multiple objects into a system namspace at once", objs.size() == 1);
+            if (handle_system_collection_insert(ns, objs[0], logop) != 0) {
+                return;
+            }
+        }
+
+        NamespaceDetails *details = getAndMaybeCreateNS(ns, logop);
+        NamespaceDetailsTransient *nsdt = &NamespaceDetailsTransient::get(ns);
+        if (objs.size() > 1 && details->mayFindById() && !details->isPartitioned()) {
+            insertBatch(ns, details, nsdt, objs, keepGoing, flags, logop);
+        } else {
+            insertObjectsOneAtATime(ns, details, nsdt, objs, keepGoing, flags, logop);
+        }
+    }
+
     void insertObject(const char *ns, const BSONObj &obj, uint64_t flags, bool logop) {
         vector<BSONObj> objs(1);
         objs[0] = obj;
@@ -0,0 +1,208 @@
+// parallel_scan.cpp
+
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/ops/parallel_scan.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/client.h"
+#include "mongo/db/cmdline.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/index.h"
+#include "mongo/db/matcher.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Remembers the key get_key_after_bytes stopped at, if any.
+        class SplitPointCallback {
+        public:
+            SplitPointCallback() : done(false) {}
+            void operator()(const storage::KeyV1 *endKey, BSONObj *endPK, uint64_t skipped) {
+                if (endKey == NULL || skipped == 0) {
+                    // Either we ran off the end of the dictionary or a
+                    // single document is bigger than a range.
+                    done = true;
+                    return;
+                }
+                key = endKey->toBson();
+            }
+            BSONObj key;
+            bool done;
+        };
+
+        BSONObj pkBound(const BSONObj &pkPattern, bool max) {
+            BSONObjBuilder b;
+            for (BSONObjIterator it(pkPattern); it.more(); it.next()) {
+                if (max) {
+                    b.appendMaxKey("");
+                }
+                else {
+                    b.appendMinKey("");
+                }
+            }
+            return b.obj();
+        }
+
+    } // namespace
+
+    ParallelScan::ParallelScan(NamespaceDetails *d, const BSONObj &query, int nThreads) :
+        _d(d),
+        _query(query.getOwned()),
+        _nThreads(nThreads),
+        _failed(false),
+        _errorCode(0) {
+        verify(nThreads > 0);
+        split(nThreads > 1 ? nThreads * RangesPerThread : 1);
+    }
+
+    void ParallelScan::split(int nWanted) {
+        const BSONObj minKeys = pkBound(_d->pkPattern(), false);
+        const BSONObj maxKeys = pkBound(_d->pkPattern(), true);
+        const Ordering ordering = Ordering::make(_d->pkPattern());
+
+        uint64_t totalBytes = 0;
+        for (int i = 0; i < _d->nPartitions(); i++) {
+            DB_BTREE_STAT64 st;
+            _d->getPartition(i).getStat64(&st);
+            totalBytes += st.bt_dsize;
+        }
+        const uint64_t step = totalBytes / nWanted;
+
+        std::vector<BSONObj> bounds;
+        bounds.push_back(minKeys);
+        // Partitions hold disjoint, increasing ranges of the primary key, so
+        // split points found in one partition after another stay sorted.
+        for (int i = 0; step > 0 && i < _d->nPartitions(); i++) {
+            const IndexDetails &partition = _d->getPartition(i);
+            storage::Key start(minKeys, NULL);
+            while (bounds.size() < (size_t) nWanted) {
+                SplitPointCallback cb;
+                partition.getKeyAfterBytes(start, step, cb);
+                if (cb.done || cb.key.woCompare(bounds.back(), ordering) <= 0) {
+                    break;
+                }
+                bounds.push_back(cb.key);
+                start.reset(cb.key, NULL);
+            }
+        }
+        bounds.push_back(maxKeys);
+
+        for (size_t i = 0; i + 1 < bounds.size(); i++) {
+            _ranges.push_back(std::make_pair(bounds[i], bounds[i + 1]));
+            _queue.push_back(i);
+        }
+    }
+
+    bool ParallelScan::nextRange(size_t *range) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        if (_failed || _queue.empty()) {
+            return false;
+        }
+        *range = _queue.front();
+        _queue.pop_front();
+        return true;
+    }
+
+    bool ParallelScan::failed() {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        return _failed;
+    }
+
+    void ParallelScan::setError(int code, const string &msg) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        if (!_failed) {
+            _failed = true;
+            _errorCode = code;
+            _errorMsg = msg;
+        }
+    }
+
+    void ParallelScan::run() {
+        boost::thread_group threads;
+        for (int i = 0; i < nThreads(); i++) {
+            threads.create_thread(boost::bind(&ParallelScan::workerThread, this, &cc(), i));
+        }
+        threads.join_all();
+        if (_failed) {
+            if (_errorCode != 0) {
+                uasserted(_errorCode, _errorMsg);
+            }
+            uasserted(16881, str::stream() << "parallel scan failed: " << _errorMsg);
+        }
+    }
+
+    void ParallelScan::workerThread(Client *parent, int id) {
+        const string name = str::stream() << "parallelScan" << id;
+        Client::initThread(name.c_str());
+        try {
+            OpSettings settings;
+            settings.setBulkFetch(true);
+            cc().setOpSettings(settings);
+
+            Client::Transaction transaction(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+            scoped_ptr<Matcher> matcher(_query.isEmpty() ? NULL : new Matcher(_query));
+            const IndexDetails &pkIdx = _d->getPKIndex();
+            size_t r;
+            while (nextRange(&r)) {
+                long long scanned = 0;
+                for (shared_ptr<IndexCursor> c(IndexCursor::make(_d, pkIdx, _ranges[r].first, _ranges[r].second,
+                                                                 r + 1 == _ranges.size(), 1));
+                     c->ok(); c->advance()) {
+                    if ((++scanned & 127) == 0) {
+                        killCurrentOp.checkForInterrupt(*parent);
+                        if (failed()) {
+                            break;
+                        }
+                    }
+                    const BSONObj obj = c->current();
+                    if (!matcher || matcher->matches(obj)) {
+                        match(r, obj);
+                    }
+                }
+                _nscanned.fetchAndAdd(scanned);
+            }
+            transaction.commit();
+        }
+        catch (const DBException &e) {
+            setError(e.getCode(), e.what());
+        }
+        catch (const std::exception &e) {
+            setError(0, e.what());
+        }
+        cc().shutdown();
+    }
+
+    bool ParallelScan::inTopLevelReadOnlyTxn() {
+        return cc().txnStackSize() == 1 && cc().txn().readOnly();
+    }
+
+    int ParallelScan::parallelism(const BSONObj &cmdObj) {
+        BSONElement e = cmdObj["parallelism"];
+        const int n = e.isNumber() ? e.numberInt() : cmdLine.scanParallelism;
+        return std::max(1, std::min(n, (int) MaxParallelism));
+    }
+
+} // namespace mongo
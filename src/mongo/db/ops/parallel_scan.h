@@ -0,0 +1,116 @@
+// parallel_scan.h
+
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    class Client;
+    class NamespaceDetails;
+
+    /**
+     * Scans a collection's primary key on several threads at once.
+     *
+     * The primary key space is divided into ranges holding roughly the same
+     * number of bytes with IndexDetails::getKeyAfterBytes, the way splitVector
+     * finds chunk boundaries, and each worker thread takes ranges off a queue
+     * until none are left. Subclasses see every document that matches the
+     * query through match(), along with the index of the range it came from,
+     * so they can keep per-range state without locking and combine it in
+     * range (and so primary key) order once run() returns.
+     *
+     * Each worker reads under its own snapshot transaction, since a TokuKV
+     * transaction can't be used by several threads, so documents committed
+     * after the caller's transaction began may be seen. Writes the caller's
+     * transactions haven't committed can't be, so a scan may only run in
+     * parallel under inTopLevelReadOnlyTxn(). The caller must hold a read
+     * lock on the collection until run() returns. Workers take no locks of
+     * their own.
+     */
+    class ParallelScan : boost::noncopyable {
+    public:
+        // Divides d's primary key into at most nThreads * RangesPerThread
+        // ranges. Must be called in a transaction.
+        ParallelScan(NamespaceDetails *d, const BSONObj &query, int nThreads);
+        virtual ~ParallelScan() {}
+
+        // Scans every range, returns once all workers are done. Rethrows
+        // the first error any worker hit, in which case the others stop
+        // early and per-range results are incomplete.
+        void run();
+
+        size_t nRanges() const { return _ranges.size(); }
+        // @return the number of threads run() uses
+        int nThreads() const { return std::min(_nThreads, (int) _ranges.size()); }
+        // @return the number of documents looked at
+        long long nscanned() const { return _nscanned.load(); }
+
+        // @return the degree of parallelism requested for a command: its
+        // "parallelism" field if present, otherwise the scanParallelism
+        // server parameter.
+        static int parallelism(const BSONObj &cmdObj);
+
+        // @return true if the current client's only live transaction is a
+        // read-only one, so it has no uncommitted writes the workers would
+        // miss. A command that runs inside someone else's transaction, like
+        // a DBDirectClient call made while writing, must scan serially.
+        static bool inTopLevelReadOnlyTxn();
+
+        // More ranges than threads, so a worker that finishes early can
+        // take over some of the work of a slow one.
+        static const int RangesPerThread = 4;
+        static const int MaxParallelism = 64;
+
+    protected:
+        // Called on a worker thread for every document in the given range
+        // that matches the query. Calls for the same range are made in
+        // primary key order from a single thread.
+        virtual void match(size_t range, const BSONObj &obj) = 0;
+
+    private:
+        void split(int nWanted);
+        bool nextRange(size_t *range);
+        void workerThread(Client *parent, int id);
+        bool failed();
+        void setError(int code, const string &msg);
+
+        NamespaceDetails *_d;
+        const BSONObj _query;
+        const int _nThreads;
+        // [start, end) bounds on the primary key, the last range also
+        // includes its end
+        std::vector< std::pair<BSONObj, BSONObj> > _ranges;
+
+        boost::mutex _mutex;
+        std::deque<size_t> _queue;
+        bool _failed;
+        int _errorCode;
+        string _errorMsg;
+        AtomicInt64 _nscanned;
+    };
+
+} // namespace mongo
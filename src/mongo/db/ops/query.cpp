@@ -385,13 +385,47 @@ namespace mongo {
         _scanAndOrder->add( current( false ) );
     }
 
+    void ReorderBuildStrategy::allowSpill() {
+        _scanAndOrder->allowSpill();
+    }
+
     int ReorderBuildStrategy::rewriteMatches() {
         cc().curop()->debug().scanAndOrder = true;
+        _sorted.reset( new ScanAndOrderCursor( _scanAndOrder, &_parsedQuery ) );
         int ret = 0;
-        _scanAndOrder->fill( _buf, &_parsedQuery, ret );
+        if ( _parsedQuery.isExplain() ) {
+            // explain only needs the count
+            for ( ; _sorted->ok(); _sorted->advance() ) {
+                ++ret;
+            }
+            _bufferedMatches = ret;
+            return ret;
+        }
+        // The sort may have spilled far more than one reply can hold, so
+        // stop where getMore would, and let it return the rest.
+        for ( ; _sorted->ok(); _sorted->advance() ) {
+            if ( _parsedQuery.enough( ret ) || _buf.len() > MaxBytesToReturnToClientAtOnce ) {
+                break;
+            }
+            MatchDetails details;
+            if ( _parsedQuery.getFields() &&
+                 _parsedQuery.getFields()->getArrayOpType() == Projection::ARRAY_OP_POSITIONAL ) {
+                details.requestElemMatchKey();
+            }
+            _sorted->currentMatches( &details );
+            fillQueryResultFromObj( _buf, _parsedQuery.getFields(), _sorted->current(), &details );
+            ++ret;
+        }
         _bufferedMatches = ret;
         return ret;
     }
+
+    shared_ptr<Cursor> ReorderBuildStrategy::reorderedCursor() const {
+        if ( !_sorted || !_sorted->ok() ) {
+            return shared_ptr<Cursor>();
+        }
+        return _sorted;
+    }
     
     ScanAndOrder *
     ReorderBuildStrategy::newScanAndOrder( const QueryPlanSummary &queryPlan ) const {
@@ -457,6 +491,12 @@ namespace mongo {
                     _queryOptimizerCursor->abortOutOfOrderPlans();
                     return true;
                 }
+                else if ( cmdLine.externalSort ) {
+                    // no in order plan to fall back on, sort on disk instead
+                    _reorderBuild->allowSpill();
+                    _reorderBuild->_handleMatchNoDedup();
+                    return true;
+                }
             }
             throw;
         }
@@ -481,6 +521,13 @@ namespace mongo {
     void HybridBuildStrategy::finishedFirstBatch() {
         _queryOptimizerCursor->abortOutOfOrderPlans();
     }
+
+    shared_ptr<Cursor> HybridBuildStrategy::reorderedCursor() const {
+        if ( !_reorderedMatches ) {
+            return shared_ptr<Cursor>();
+        }
+        return _reorderBuild->reorderedCursor();
+    }
     
     QueryResponseBuilder *QueryResponseBuilder::make( const ParsedQuery &parsedQuery,
                                                      const shared_ptr<Cursor> &cursor,
@@ -562,6 +609,10 @@ namespace mongo {
         return _builder->bufferedMatches();
     }
 
+    shared_ptr<Cursor> QueryResponseBuilder::reorderedCursor() const {
+        return _builder->reorderedCursor();
+    }
+
     ShardChunkManagerPtr QueryResponseBuilder::newChunkManager() const {
         if ( !shardingState.needShardChunkManager( _parsedQuery.ns() ) ) {
             return ShardChunkManagerPtr();
@@ -607,8 +658,12 @@ namespace mongo {
         }
         if ( singlePlan ||
             !queryOptimizerPlans.mayRunInOrderPlan() ) {
-            return shared_ptr<ResponseBuildStrategy>
+            shared_ptr<ReorderBuildStrategy> ret
             ( ReorderBuildStrategy::make( _parsedQuery, _cursor, _buf, queryPlan ) );
+            if ( cmdLine.externalSort ) {
+                ret->allowSpill();
+            }
+            return ret;
         }
         return shared_ptr<ResponseBuildStrategy>
         ( HybridBuildStrategy::make( _parsedQuery, _queryOptimizerCursor, _buf ) );
@@ -750,11 +805,21 @@ namespace mongo {
         
         int nReturned = queryResponseBuilder->handoff( result );
 
+        // The rest of a sorted result that didn't fit in this reply comes
+        // from the sort's own cursor, whose matches were already filtered.
+        shared_ptr<Cursor> reordered;
+        if ( !pq.isExplain() && pq.wantMore() && pq.getNumToReturn() != 1 ) {
+            reordered = queryResponseBuilder->reorderedCursor();
+            if ( reordered ) {
+                saveClientCursor = true;
+            }
+        }
+
         ccPointer.reset();
         long long cursorid = 0;
         if ( saveClientCursor ) {
             // Create a new ClientCursor, with a default timeout.
-            ccPointer.reset( new ClientCursor( queryOptions, cursor, ns,
+            ccPointer.reset( new ClientCursor( queryOptions, reordered ? reordered : cursor, ns,
                                                jsobj.getOwned(), inMultiStatementTxn ) );
             cursorid = ccPointer->cursorid();
             DEV tlog(2) << "query has more, cursorid: " << cursorid << endl;
@@ -768,7 +833,9 @@ namespace mongo {
             }
             
             // Set attributes for getMore.
-            ccPointer->setChunkManager( queryResponseBuilder->chunkManager() );
+            if ( !reordered ) {
+                ccPointer->setChunkManager( queryResponseBuilder->chunkManager() );
+            }
             ccPointer->setPos( nReturned );
             ccPointer->pq = pq_shared;
             ccPointer->fields = pq.getFieldPtr();
@@ -148,6 +148,11 @@ namespace mongo {
          * to getMore.
          */
         virtual void finishedFirstBatch() {}
+        /**
+         * @return a cursor over the reordered matches that rewriteMatches() did not write to the
+         * buffer, if there are any, to be returned through getMore.
+         */
+        virtual shared_ptr<Cursor> reorderedCursor() const { return shared_ptr<Cursor>(); }
         /** Reset the buffer. */
         void resetBuf();
     protected:
@@ -186,8 +191,15 @@ namespace mongo {
         virtual bool handleMatch( bool &orderedMatch, MatchDetails& details );
         /** Handle a match without performing deduping. */
         void _handleMatchNoDedup();
+        /** Let the sort spill to disk rather than fail once it outgrows memory. */
+        void allowSpill();
+        /**
+         * Write the first batch of sorted matches to the buffer, as much as one reply may hold.
+         * The rest are left to reorderedCursor().
+         */
         virtual int rewriteMatches();
         virtual int bufferedMatches() const { return _bufferedMatches; }
+        virtual shared_ptr<Cursor> reorderedCursor() const;
     private:
         ReorderBuildStrategy( const ParsedQuery& parsedQuery,
                               const shared_ptr<Cursor>& cursor,
@@ -195,6 +207,7 @@ namespace mongo {
         void init( const QueryPlanSummary& queryPlan );
         ScanAndOrder *newScanAndOrder( const QueryPlanSummary &queryPlan ) const;
         shared_ptr<ScanAndOrder> _scanAndOrder;
+        shared_ptr<Cursor> _sorted;
         int _bufferedMatches;
     };
 
@@ -228,6 +241,7 @@ namespace mongo {
         virtual int rewriteMatches();
         virtual int bufferedMatches() const;
         virtual void finishedFirstBatch();
+        virtual shared_ptr<Cursor> reorderedCursor() const;
         bool handleReorderMatch();
         PKDupSet _scanAndOrderDups;
         OrderedBuildStrategy _orderedBuild;
@@ -265,6 +279,11 @@ namespace mongo {
          * @return the number of results in the buffer.
          */
         int handoff( Message &result );
+        /**
+         * After handoff(), a cursor over the sorted matches that didn't fit in the result, which
+         * getMore should return in place of the query's own cursor.
+         */
+        shared_ptr<Cursor> reorderedCursor() const;
         /** A chunk manager found at the beginning of the query. */
         ShardChunkManagerPtr chunkManager() const { return _chunkManager; }
 
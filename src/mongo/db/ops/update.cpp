@@ -20,6 +20,7 @@
 #include "pch.h"
 
 #include "mongo/client/dbclientinterface.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/oplog.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/namespace_details.h"
@@ -28,6 +29,8 @@
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/update_internal.h"
 #include "mongo/db/oplog_helpers.h"
+#include "mongo/db/txn_context.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 
@@ -92,6 +95,32 @@ namespace mongo {
         updateOneObject( d, nsdt, pk, obj, updateobj, loud );
     }
 
+    static AtomicUInt64 blindUpdates;
+    static AtomicUInt64 failedUpdateMessages;
+
+    bool applyUpdateMessage(const BSONObj &oldObj, const BSONObj &msg, BSONObj &newObj) {
+        try {
+            ModSet mods(msg);
+            auto_ptr<ModSetState> mss = mods.prepare(oldObj);
+            newObj = mss->createNewFromMods();
+            checkTooLarge(newObj);
+            return true;
+        } catch (DBException &e) {
+            // The mods can't be applied to this object, e.g. an $inc of a
+            // string field. The update was acknowledged long ago, so all we
+            // can do is leave the object alone and say so where it's seen.
+            const unsigned long long n = failedUpdateMessages.addAndFetch(1);
+            warning() << "fastupdates: could not apply update message " << msg << " to " << oldObj
+                      << ", left it unchanged (" << n << " so far): " << e.what() << endl;
+            return false;
+        }
+    }
+
+    void appendFastUpdateStats(BSONObjBuilder &b) {
+        b.appendNumber("blind", (long long) blindUpdates.load());
+        b.appendNumber("failed", (long long) failedUpdateMessages.load());
+    }
+
     static void insertAndLog(const char *ns, NamespaceDetails *d, NamespaceDetailsTransient *nsdt,
             BSONObj &newObj, bool logop, bool fromMigrate) {
 
@@ -124,6 +153,26 @@ namespace mongo {
         return false;
     }
 
+    /* A blind update sends the mods to the primary key as an update message
+       instead of reading the object first. Since the object is never read, we
+       can't log it for replication or sharding, and can't tell whether it
+       existed. So this is only done when asked for with --fastupdates, for
+
+             - $ mods, not upsert, not multi
+             - no modified field is indexed
+             - not positional ($) mods, which need the matched object
+             - a caller that doesn't need to know whether an object matched
+             - a simple _id query on a collection whose pk is _id
+             - no oplog or migrate log to write
+    */
+    static bool mayUpdateBlindly(NamespaceDetails *d, const ModSet *mods, const BSONObj &patternOrig) {
+        return cmdLine.fastUpdates &&
+               !logTxnOpsForReplication() && !logTxnOpsForSharding() &&
+               d->mayFindById() && !d->indexBuildInProgress() &&
+               !mods->hasDynamicArray() &&
+               mayUpdateById(d, patternOrig);
+    }
+
     /* note: this is only (as-is) called for
 
              - not multi
@@ -185,7 +234,8 @@ namespace mongo {
                                  bool logop ,
                                  OpDebug& debug,
                                  bool fromMigrate,
-                                 const QueryPlanSelectionPolicy& planPolicy ) {
+                                 const QueryPlanSelectionPolicy& planPolicy,
+                                 bool mayBeBlind ) {
 
         TOKULOG(2) << "update: " << ns
                    << " update: " << updateobj
@@ -214,6 +264,21 @@ namespace mongo {
         }
 
 
+        if ( mayBeBlind && isOperatorUpdate && !upsert && !multi && !modsAreIndexed &&
+             planPolicy.permitOptimalIdPlan() && mayUpdateBlindly(d, mods.get(), patternOrig) ) {
+            debug.idhack = true;
+            debug.fastmod = true;
+            BSONObj pk = patternOrig["_id"].wrap("");
+            TOKULOG(3) << "_updateObjects blind update, pattern " << patternOrig << ", pk " << pk << endl;
+            d->updateObjectMods(pk, updateobj);
+            nsdt->notifyOfWriteOp();
+            blindUpdates.addAndFetch(1);
+            // we don't know whether the object exists, and getLastError says so
+            UpdateResult result( 0 , 1 , 0 , BSONObj() );
+            result.blind = true;
+            return result;
+        }
+
         int idIdxNo = -1;
         if ( planPolicy.permitOptimalIdPlan() && !multi && !modsAreIndexed &&
              (idIdxNo = d->findIdIndex()) >= 0 && mayUpdateById(d, patternOrig) ) {
@@ -395,13 +460,14 @@ namespace mongo {
                                 bool logop ,
                                 OpDebug& debug,
                                 bool fromMigrate,
-                                const QueryPlanSelectionPolicy& planPolicy ) {
+                                const QueryPlanSelectionPolicy& planPolicy,
+                                bool mayBeBlind ) {
 
         validateUpdate( ns , updateobj , patternOrig );
 
         UpdateResult ur = _updateObjects(ns, updateobj, patternOrig,
                                          upsert, multi, logop,
-                                         debug, fromMigrate, planPolicy );
+                                         debug, fromMigrate, planPolicy, mayBeBlind );
         debug.nupdated = ur.num;
         return ur;
     }
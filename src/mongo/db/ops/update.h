@@ -35,9 +35,10 @@ namespace mongo {
         const bool mod;      // was this a $ mod
         const long long num; // how many objects touched
         OID upserted;  // if something was upserted, the new _id of the object
+        bool blind;    // a blind update, so existing and num are unknown (and 0)
 
         UpdateResult( bool e, bool m, unsigned long long n , const BSONObj& upsertedObject )
-            : existing(e) , mod(m), num(n) {
+            : existing(e) , mod(m), num(n), blind(false) {
             upserted.clear();
             BSONElement id = upsertedObject["_id"];
             if ( ! e && n == 1 && id.type() == jstOID ) {
@@ -62,9 +63,21 @@ namespace mongo {
         uint64_t flags = 0
         );
 
+    // Applies the $ mods in msg to oldObj, for update messages sent by blind
+    // updates (see storage::set_update_message_function).
+    // @return false, and leaves newObj alone, if the mods can't be applied.
+    bool applyUpdateMessage(const BSONObj &oldObj, const BSONObj &msg, BSONObj &newObj);
+
+    // Number of blind updates sent, and of update messages whose mods
+    // couldn't be applied to the object they reached, for serverStatus.
+    void appendFastUpdateStats(BSONObjBuilder &b);
+
     /* returns true if an existing object was updated, false if no existing object was found.
        multi - update multiple objects - mostly useful with things like $set
        su - allow access to system namespaces (super user)
+       mayBeBlind - the caller can do without knowing whether an object
+                    matched, so with --fastupdates the update may be sent
+                    blindly and come back with result.blind set
     */
     UpdateResult updateObjects(const char* ns,
                                const BSONObj& updateobj,
@@ -74,6 +87,7 @@ namespace mongo {
                                bool logop,
                                OpDebug& debug,
                                bool fromMigrate = false,
-                               const QueryPlanSelectionPolicy& planPolicy = QueryPlanSelectionPolicy::any());
+                               const QueryPlanSelectionPolicy& planPolicy = QueryPlanSelectionPolicy::any(),
+                               bool mayBeBlind = false);
 
 }  // namespace mongo
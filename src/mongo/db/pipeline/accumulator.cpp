@@ -37,6 +37,14 @@ namespace mongo {
         ExpressionNary() {
     }
 
+    intrusive_ptr<const Value> Accumulator::getPartialValue() const {
+        return getValue();
+    }
+
+    size_t Accumulator::getMemUsage() const {
+        return sizeof(Accumulator);
+    }
+
     void Accumulator::opToBson(BSONObjBuilder *pBuilder,
                                const std::string& opName,
                                const std::string& fieldName,
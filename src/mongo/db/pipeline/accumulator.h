@@ -44,6 +44,23 @@ namespace mongo {
          */
         virtual intrusive_ptr<const Value> getValue() const = 0;
 
+        /*
+          Get the accumulated state in a form that an accumulator of the
+          same kind can consume again when its context is doing a merge.
+          This is what a shard sends to the router, and what $group writes
+          out when it spills to disk.
+
+          @returns the partial value
+         */
+        virtual intrusive_ptr<const Value> getPartialValue() const;
+
+        /*
+          Get an estimate of the memory held by this accumulator's state.
+
+          @returns the approximate size in bytes
+         */
+        virtual size_t getMemUsage() const;
+
     protected:
         Accumulator();
 
@@ -71,6 +88,9 @@ namespace mongo {
         virtual intrusive_ptr<const Value> getValue() const;
         virtual const char *getOpName() const;
 
+        // virtuals from Accumulator
+        virtual size_t getMemUsage() const;
+
         /*
           Create an appending accumulator.
 
@@ -82,9 +102,12 @@ namespace mongo {
 
     private:
         AccumulatorAddToSet(const intrusive_ptr<ExpressionContext> &pTheCtx);
+        void insert(const intrusive_ptr<const Value> &pValue) const;
+
         typedef boost::unordered_set<intrusive_ptr<const Value>, Value::Hash > SetType;
         mutable SetType set;
         mutable SetType::iterator itr; 
+        mutable size_t memUsage;
         intrusive_ptr<ExpressionContext> pCtx;
     };
 
@@ -222,10 +245,14 @@ namespace mongo {
         static intrusive_ptr<Accumulator> create(
             const intrusive_ptr<ExpressionContext> &pCtx);
 
+        // virtuals from Accumulator
+        virtual size_t getMemUsage() const;
+
     private:
         AccumulatorPush(const intrusive_ptr<ExpressionContext> &pTheCtx);
 
         mutable vector<intrusive_ptr<const Value> > vpValue;
+        mutable size_t memUsage;
         intrusive_ptr<ExpressionContext> pCtx;
     };
 
@@ -238,6 +265,7 @@ namespace mongo {
         virtual intrusive_ptr<const Value> evaluate(
             const intrusive_ptr<Document> &pDocument) const;
         virtual intrusive_ptr<const Value> getValue() const;
+        virtual intrusive_ptr<const Value> getPartialValue() const;
         virtual const char *getOpName() const;
 
         /*
@@ -30,7 +30,7 @@ namespace mongo {
         if (prhs->getType() == Undefined)
             ; /* nothing to add to the array */
         else if (!pCtx->getDoingMerge())
-            set.insert(prhs);
+            insert(prhs);
         else {
             /*
               If we're in the router, we need to take apart the arrays we
@@ -43,13 +43,23 @@ namespace mongo {
             intrusive_ptr<ValueIterator> pvi(prhs->getArray());
             while(pvi->more()) {
                 intrusive_ptr<const Value> pElement(pvi->next());
-                set.insert(pElement);
+                insert(pElement);
             }
         }
 
         return Value::getNull();
     }
 
+    void AccumulatorAddToSet::insert(
+        const intrusive_ptr<const Value> &pValue) const {
+        if (set.insert(pValue).second)
+            memUsage += pValue->getApproximateSize();
+    }
+
+    size_t AccumulatorAddToSet::getMemUsage() const {
+        return memUsage;
+    }
+
     intrusive_ptr<const Value> AccumulatorAddToSet::getValue() const {
         vector<intrusive_ptr<const Value> > valVec;
 
@@ -64,6 +74,7 @@ namespace mongo {
         const intrusive_ptr<ExpressionContext> &pTheCtx):
         Accumulator(),
         set(),
+        memUsage(sizeof(AccumulatorAddToSet)),
         pCtx(pTheCtx) {
     }
 
@@ -61,14 +61,17 @@ namespace mongo {
     }
 
     intrusive_ptr<const Value> AccumulatorAvg::getValue() const {
-        if (!pCtx->getInShard()) {
-            double avg = 0;
-            if (count)
-                avg = doubleTotal / static_cast<double>(count);
+        if (pCtx->getInShard())
+            return getPartialValue();
 
-            return Value::createDouble(avg);
-        }
+        double avg = 0;
+        if (count)
+            avg = doubleTotal / static_cast<double>(count);
+
+        return Value::createDouble(avg);
+    }
 
+    intrusive_ptr<const Value> AccumulatorAvg::getPartialValue() const {
         intrusive_ptr<Document> pDocument(Document::create());
         pDocument->addField(subTotalName, Value::createDouble(doubleTotal));
         pDocument->addField(countName, Value::createLong(count));
@@ -29,8 +29,10 @@ namespace mongo {
 
         if (prhs->getType() == Undefined)
             ; /* nothing to add to the array */
-        else if (!pCtx->getDoingMerge())
+        else if (!pCtx->getDoingMerge()) {
             vpValue.push_back(prhs);
+            memUsage += prhs->getApproximateSize();
+        }
         else {
             /*
               If we're in the router, we need to take apart the arrays we
@@ -44,6 +46,7 @@ namespace mongo {
             while(pvi->more()) {
                 intrusive_ptr<const Value> pElement(pvi->next());
                 vpValue.push_back(pElement);
+                memUsage += pElement->getApproximateSize();
             }
         }
 
@@ -58,9 +61,14 @@ namespace mongo {
         const intrusive_ptr<ExpressionContext> &pTheCtx):
         Accumulator(),
         vpValue(),
+        memUsage(sizeof(AccumulatorPush)),
         pCtx(pTheCtx) {
     }
 
+    size_t AccumulatorPush::getMemUsage() const {
+        return memUsage;
+    }
+
     intrusive_ptr<Accumulator> AccumulatorPush::create(
         const intrusive_ptr<ExpressionContext> &pCtx) {
         intrusive_ptr<AccumulatorPush> pAccumulator(
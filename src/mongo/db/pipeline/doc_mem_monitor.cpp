@@ -57,6 +57,11 @@ namespace mongo {
         }
     }
 
+    void DocMemMonitor::subtractFromTotal(size_t amount) {
+        verify(amount <= totalUsed);
+        totalUsed -= amount;
+    }
+
     void DocMemMonitor::init(StringWriter *pW,
                              size_t warnLimit, size_t errorLimit) {
         this->pWriter = pW;
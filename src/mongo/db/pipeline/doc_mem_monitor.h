@@ -77,6 +77,14 @@ namespace mongo {
          */
         void addToTotal(size_t amount);
 
+        /*
+          Decrement the total amount of memory used by the given amount, for
+          memory that has been released again.
+
+          @param amount the amount of memory to remove from the current total
+         */
+        void subtractFromTotal(size_t amount);
+
     private:
         /*
           Real constructor body.
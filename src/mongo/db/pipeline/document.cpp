@@ -28,28 +28,65 @@ namespace mongo {
     string Document::idName("_id");
 
     intrusive_ptr<Document> Document::createFromBsonObj(BSONObj* pBsonObj) {
-        return new Document(pBsonObj);
+        return new Document(pBsonObj, *pBsonObj);
     }
 
-    Document::Document(BSONObj* pBsonObj) {
-        const int fields = pBsonObj->nFields();
-        vFieldName.reserve(fields);
-        vpValue.reserve(fields);
-        BSONObjIterator bsonIterator(pBsonObj->begin());
+    intrusive_ptr<Document> Document::createFromBsonObj(
+        BSONObj* pBsonObj, const BSONObj &owner) {
+        return new Document(pBsonObj, owner);
+    }
+
+    Document::Document(BSONObj* pBsonObj, const BSONObj &owner):
+        bsonSource(owner.isOwned() ? *pBsonObj : pBsonObj->getOwned()),
+        bsonOwner(owner.isOwned() ? owner : bsonSource),
+        vFieldName(),
+        vpValue() {
+    }
+
+    intrusive_ptr<const Value> Document::convertField(
+        BSONElement *pBsonElement) const {
+        const size_t n = vConverted.size();
+        for(size_t i = 0; i < n; ++i) {
+            if (vConverted[i].first == pBsonElement->fieldName())
+                return vConverted[i].second;
+        }
+
+        return Value::createFromBsonElement(pBsonElement, bsonOwner);
+    }
+
+    void Document::materializeFields() const {
+        /*
+          Build the fields aside, so that bsonSource is still intact if
+          one of them can't be converted.
+        */
+        const int fields = bsonSource.nFields();
+        vector<string> vName;
+        vector<intrusive_ptr<const Value> > vValue;
+        vName.reserve(fields);
+        vValue.reserve(fields);
+        BSONObjIterator bsonIterator(bsonSource.begin());
         while(bsonIterator.more()) {
             BSONElement bsonElement(bsonIterator.next());
-            string fieldName(bsonElement.fieldName());
 
             // LATER grovel through structures???
-            intrusive_ptr<const Value> pValue(
-                Value::createFromBsonElement(&bsonElement));
-
-            vFieldName.push_back(fieldName);
-            vpValue.push_back(pValue);
+            vValue.push_back(convertField(&bsonElement));
+            vName.push_back(bsonElement.fieldName());
         }
+
+        vFieldName.swap(vName);
+        vpValue.swap(vValue);
+        bsonSource = BSONObj();
+        bsonOwner = BSONObj();
+        vConverted.clear();
     }
 
     void Document::toBson(BSONObjBuilder* pBuilder) const {
+        if (!bsonSource.isEmpty()) {
+            /* nothing has been changed, so the original will do */
+            pBuilder->appendElements(bsonSource);
+            return;
+        }
+
         const size_t n = vFieldName.size();
         for(size_t i = 0; i < n; ++i)
             vpValue[i]->addToBsonObj(pBuilder, vFieldName[i]);
@@ -70,6 +107,9 @@ namespace mongo {
     }
 
     intrusive_ptr<Document> Document::clone() {
+        if (!bsonSource.isEmpty())
+            return Document::createFromBsonObj(&bsonSource, bsonOwner);
+
         const size_t n = vFieldName.size();
         intrusive_ptr<Document> pNew(Document::create(n));
         for(size_t i = 0; i < n; ++i)
@@ -96,6 +136,9 @@ namespace mongo {
           in a particular place as we would with a statically compilable
           reference.
         */
+        if (!bsonSource.isEmpty())
+            return getField(fieldName);
+
         const size_t n = vFieldName.size();
         for(size_t i = 0; i < n; ++i) {
             if (fieldName.compare(vFieldName[i]) == 0)
@@ -107,6 +150,7 @@ namespace mongo {
 
     void Document::addField(const string &fieldName,
                             const intrusive_ptr<const Value> &pValue) {
+        materialize();
         vFieldName.push_back(fieldName);
         vpValue.push_back(pValue);
     }
@@ -114,6 +158,8 @@ namespace mongo {
     void Document::setField(size_t index,
                             const string &fieldName,
                             const intrusive_ptr<const Value> &pValue) {
+        materialize();
+
         /* special case:  should this field be removed? */
         if (!pValue.get()) {
             vFieldName.erase(vFieldName.begin() + index);
@@ -127,6 +173,23 @@ namespace mongo {
     }
 
     intrusive_ptr<const Value> Document::getField(const string &fieldName) const {
+        if (!bsonSource.isEmpty()) {
+            /* only convert the field that was asked for, and only once */
+            const size_t n = vConverted.size();
+            for(size_t i = 0; i < n; ++i) {
+                if (fieldName.compare(vConverted[i].first) == 0)
+                    return vConverted[i].second;
+            }
+
+            BSONElement bsonElement(bsonSource.getField(fieldName));
+            intrusive_ptr<const Value> pValue;
+            if (!bsonElement.eoo())
+                pValue = Value::createFromBsonElement(&bsonElement, bsonOwner);
+
+            vConverted.push_back(FieldPair(fieldName, pValue));
+            return pValue;
+        }
+
         const size_t n = vFieldName.size();
         for(size_t i = 0; i < n; ++i) {
             if (fieldName.compare(vFieldName[i]) == 0)
@@ -139,6 +202,9 @@ namespace mongo {
 
     size_t Document::getApproximateSize() const {
         size_t size = sizeof(Document);
+        if (!bsonSource.isEmpty())
+            return size + bsonSource.objsize();
+
         const size_t n = vpValue.size();
         for(size_t i = 0; i < n; ++i)
             size += vpValue[i]->getApproximateSize();
@@ -147,6 +213,7 @@ namespace mongo {
     }
 
     size_t Document::getFieldIndex(const string &fieldName) const {
+        materialize();
         const size_t n = vFieldName.size();
         size_t i = 0;
         for(; i < n; ++i) {
@@ -158,6 +225,7 @@ namespace mongo {
     }
 
     void Document::hash_combine(size_t &seed) const {
+        materialize();
         const size_t n = vFieldName.size();
         for(size_t i = 0; i < n; ++i) {
             boost::hash_combine(seed, vFieldName[i]);
@@ -167,6 +235,8 @@ namespace mongo {
 
     int Document::compare(const intrusive_ptr<Document> &rL,
                           const intrusive_ptr<Document> &rR) {
+        rL->materialize();
+        rR->materialize();
         const size_t lSize = rL->vFieldName.size();
         const size_t rSize = rR->vFieldName.size();
 
@@ -207,6 +277,7 @@ namespace mongo {
     FieldIterator::FieldIterator(const intrusive_ptr<Document> &pTheDocument):
         pDocument(pTheDocument),
         index(0) {
+        pDocument->materialize();
     }
 
     bool FieldIterator::more() const {
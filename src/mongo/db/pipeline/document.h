@@ -19,10 +19,10 @@
 
 #include "mongo/pch.h"
 
+#include "db/jsobj.h"
 #include "util/intrusive_counter.h"
 
 namespace mongo {
-    class BSONObj;
     class FieldIterator;
     class Value;
 
@@ -34,13 +34,30 @@ namespace mongo {
         /*
           Create a new Document from the given BSONObj.
 
-          Document field values may be pointed to in the BSONObj, so it
-          must live at least as long as the resulting Document.
+          The Document keeps a reference to the BSON, taking its own copy
+          if the BSONObj does not own its buffer, and only converts the
+          fields to Values once something needs more than a lookup by name
+          or the BSON itself.  Documents that are only filtered or passed
+          through never build their fields at all.
 
           @returns shared pointer to the newly created Document
         */
         static intrusive_ptr<Document> createFromBsonObj(BSONObj* pBsonObj);
 
+        /*
+          Create a new Document from BSON embedded in an owned object.
+
+          The Document refers into owner's buffer and keeps it alive,
+          rather than copying the embedded BSON.  If owner doesn't own its
+          buffer, this is the same as createFromBsonObj(pBsonObj).
+
+          @param pBsonObj the embedded object
+          @param owner an object whose buffer contains pBsonObj's
+          @returns shared pointer to the newly created Document
+        */
+        static intrusive_ptr<Document> createFromBsonObj(
+            BSONObj* pBsonObj, const BSONObj &owner);
+
         /*
           Create a new empty Document.
 
@@ -188,11 +205,35 @@ namespace mongo {
         friend class FieldIterator;
 
         Document(size_t sizeHint);
-        Document(BSONObj* pBsonObj);
+        Document(BSONObj* pBsonObj, const BSONObj &owner);
+
+        /*
+          Convert the fields of bsonSource into the vectors below, if that
+          hasn't been done yet.  Anything that looks at the fields by
+          position must call this first.
+         */
+        void materialize() const;
+        void materializeFields() const;
+
+        /* convert one field of bsonSource, reusing it if it was looked up */
+        intrusive_ptr<const Value> convertField(BSONElement *pBsonElement) const;
+
+        /* the BSON this was created from, until it is materialized */
+        mutable BSONObj bsonSource;
+
+        /* owns bsonSource's buffer, which may be part of a larger object */
+        mutable BSONObj bsonOwner;
+
+        /*
+          The fields looked up by name before the Document was
+          materialized, so each is only converted once; a missing field is
+          kept with a null Value.  materializeFields() reuses these.
+        */
+        mutable vector<FieldPair> vConverted;
 
         /* these two vectors parallel each other */
-        vector<string> vFieldName;
-        vector<intrusive_ptr<const Value> > vpValue;
+        mutable vector<string> vFieldName;
+        mutable vector<intrusive_ptr<const Value> > vpValue;
     };
 
 
@@ -238,11 +279,18 @@ namespace mongo {
 
 namespace mongo {
 
+    inline void Document::materialize() const {
+        if (!bsonSource.isEmpty())
+            materializeFields();
+    }
+
     inline size_t Document::getFieldCount() const {
+        materialize();
         return vFieldName.size();
     }
     
     inline Document::FieldPair Document::getField(size_t index) const {
+        materialize();
         verify( index < vFieldName.size() );
         return FieldPair(vFieldName[index], vpValue[index]);
     }
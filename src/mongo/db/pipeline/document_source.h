@@ -35,6 +35,8 @@ namespace mongo {
     class Accumulator;
     class Cursor;
     class Document;
+    class DocumentSourceLimit;
+    class DocumentSourceSort;
     class Expression;
     class ExpressionContext;
     class ExpressionFieldPath;
@@ -319,6 +321,16 @@ namespace mongo {
             const ShardOutput& shardOutput,
             const intrusive_ptr<ExpressionContext>& pExpCtx);
 
+        /**
+          Merge the shards' outputs, each of which is sorted by pSort,
+          instead of returning them one after another.
+
+          Must be called before the first document is read.
+
+          @param pSort the sort the shards' pipelines ended with
+         */
+        void mergeSortedBy(const intrusive_ptr<DocumentSourceSort> &pSort);
+
     protected:
         // virtuals from DocumentSource
         virtual void sourceToBson(BSONObjBuilder *pBuilder, bool explain) const;
@@ -336,7 +348,25 @@ namespace mongo {
          */
         void getNextDocument();
 
+        /**
+          getNextDocument() for mergeSortedBy(): advances whichever shard
+          supplied pCurrent and picks the least of the shards' current
+          documents.
+         */
+        void getNextMergedDocument();
+
+        /**
+          Check a shard's command result and wrap its result array.
+
+          @returns the shard's documents, or NULL if it had none
+         */
+        intrusive_ptr<DocumentSourceBsonArray> shardSource(
+            ShardOutput::const_iterator shard);
+
         bool newSource; // set to true for the first item of a new source
+        intrusive_ptr<DocumentSourceSort> pMergeSort;
+        vector<intrusive_ptr<DocumentSourceBsonArray> > mergeSources;
+        size_t iMergeCurrent; // the merge source pCurrent came from
         intrusive_ptr<DocumentSourceBsonArray> pBsonSource;
         intrusive_ptr<Document> pCurrent;
         ShardOutput::const_iterator iterator;
@@ -641,6 +671,22 @@ namespace mongo {
         virtual intrusive_ptr<DocumentSource> getShardSource();
         virtual intrusive_ptr<DocumentSource> getRouterSource();
 
+        /**
+          Set the amount of memory the groups may use before they are
+          spilled to disk.  Intended for testing.
+
+          @param bytes the new limit
+         */
+        void setMaxMemoryUsageBytes(size_t bytes);
+
+        /**
+          How far the groups were spilled.  Intended for testing.
+
+          @returns -1 if nothing was spilled, otherwise the deepest level
+                a spilled partition was split to, 0 if none was split
+         */
+        int getSpillDepth() const;
+
         static const char groupName[];
 
     protected:
@@ -686,6 +732,43 @@ namespace mongo {
         intrusive_ptr<Document> makeDocument(
             const GroupsType::iterator &rIter);
 
+        /*
+          Find the accumulators for the group with the given _id, adding a
+          new group if there is none yet.  When merging, the accumulators
+          consume partial values from spilled groups rather than the
+          group's own expressions.
+         */
+        vector<intrusive_ptr<Accumulator> > *findGroup(
+            const intrusive_ptr<const Value> &pId, bool merging);
+
+        /*
+          Grace hash spilling, for commands that set allowDiskUse.  When
+          the groups held in memory outgrow maxMemoryUsageBytes, spill()
+          hash partitions them by _id and appends each group's partial
+          state to its partition's file.  Once the input is exhausted, the
+          groups left in memory are spilled as well, and loadPartition()
+          re-aggregates the partitions one at a time.  Every group lives in
+          exactly one partition, so each partition's groups are final once
+          loaded.  A partition whose groups outgrow memory again is split
+          the same way, with the hash mixed differently at each depth.
+         */
+        class SpillFile;
+        typedef vector<boost::shared_ptr<SpillFile> > SpillFiles;
+        void spill();
+        void createSpillFiles(SpillFiles &files);
+        void spillGroups(SpillFiles &files, unsigned depth);
+        void pushPartitions(const SpillFiles &files, unsigned depth);
+        bool loadPartition();
+
+        size_t memoryUsageBytes;
+        size_t maxMemoryUsageBytes;
+        int spillDepth;
+        /* where populate() spills to, until the input is exhausted */
+        SpillFiles spillFiles;
+        /* finished partitions still to be loaded, with their depth */
+        vector<pair<boost::shared_ptr<SpillFile>, unsigned> > partitions;
+        intrusive_ptr<ExpressionContext> pMergeCtx;
+
         GroupsType::iterator groupsIterator;
         intrusive_ptr<Document> pCurrent;
     };
@@ -833,14 +916,18 @@ namespace mongo {
         virtual bool advance();
         virtual const char *getSourceName() const;
         virtual intrusive_ptr<Document> getCurrent();
+        virtual void addToBsonArray(BSONArrayBuilder *pBuilder, bool explain = false) const;
 
         virtual GetDepsReturn getDependencies(set<string>& deps) const;
 
         /*
+          A following $limit is absorbed, so that only the top documents are
+          kept while sorting.
+
           TODO
           Adjacent sorts should reduce to the last sort.
+         */
         virtual bool coalesce(const intrusive_ptr<DocumentSource> &pNextSource);
-        */
 
         /**
           Create a new sorting DocumentSource.
@@ -852,11 +939,10 @@ namespace mongo {
             const intrusive_ptr<ExpressionContext> &pExpCtx);
 
         // Virtuals for SplittableDocumentSource
-        // All work for sort is done in router currently
-        // TODO: do partial sorts on the shards then merge in the router
-        //       Not currently possible due to DocumentSource's cursor-like interface
-        virtual intrusive_ptr<DocumentSource> getShardSource() { return NULL; }
-        virtual intrusive_ptr<DocumentSource> getRouterSource() { return this; }
+        // Each shard sorts (and limits) its own documents, and the router
+        // merges the already sorted streams, see DocumentSourceCommandShards.
+        virtual intrusive_ptr<DocumentSource> getShardSource();
+        virtual intrusive_ptr<DocumentSource> getRouterSource();
 
         /**
           Add sort key field.
@@ -878,6 +964,22 @@ namespace mongo {
          */
         void sortKeyToBson(BSONObjBuilder *pBuilder, bool usePrefix) const;
 
+        /**
+          Compare two documents according to the specified sort key.
+
+          @param rL reference to the left document
+          @param rR reference to the right document
+          @returns a number less than, equal to, or greater than zero,
+            indicating pL < pR, pL == pR, or pL > pR, respectively
+         */
+        int compare(const intrusive_ptr<Document> &pL,
+                    const intrusive_ptr<Document> &pR);
+
+        /**
+          @returns the absorbed $limit, or -1 if there is none
+         */
+        long long getLimit() const;
+
         /**
           Create a sorting DocumentSource from BSON.
 
@@ -908,6 +1010,9 @@ namespace mongo {
           the underlying source and group it.  populate() is used to do that
           on the first call to any method on this source.  The populated
           boolean indicates that this has been done.
+
+          When merging presorted input, nothing is buffered: the documents
+          are streamed from the source, which merges the shards' outputs.
          */
         void populate();
         bool populated;
@@ -917,21 +1022,21 @@ namespace mongo {
         SortPaths vSortKey;
         vector<bool> vAscending;
 
-        /*
-          Compare two documents according to the specified sort key.
+        /* a $limit that followed the sort, if any */
+        intrusive_ptr<DocumentSourceLimit> limitSrc;
 
-          @param rL reference to the left document
-          @param rR reference to the right document
-          @returns a number less than, equal to, or greater than zero,
-            indicating pL < pR, pL == pR, or pL > pR, respectively
+        /*
+          On the router, the input is already sorted by each shard and only
+          needs to be merged.  nMerged counts the documents streamed so far,
+          to apply limitSrc.
          */
-        int compare(const intrusive_ptr<Document> &pL,
-                    const intrusive_ptr<Document> &pR);
+        bool mergePresorted;
+        long long nMerged;
 
         /*
           This is a utility class just for the STL sort that is done
           inside.
-         */
+        */
         class Comparator {
         public:
             bool operator()(
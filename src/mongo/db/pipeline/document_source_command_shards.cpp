@@ -65,6 +65,7 @@ namespace mongo {
         const intrusive_ptr<ExpressionContext> &pExpCtx):
         DocumentSource(pExpCtx),
         newSource(false),
+        iMergeCurrent(0),
         pBsonSource(),
         pCurrent(),
         iterator(shardOutput.begin()),
@@ -80,7 +81,43 @@ namespace mongo {
         return pSource;
     }
 
+    void DocumentSourceCommandShards::mergeSortedBy(
+        const intrusive_ptr<DocumentSourceSort> &pSort) {
+        verify(!pCurrent.get() && !pBsonSource.get());
+        pMergeSort = pSort;
+    }
+
+    intrusive_ptr<DocumentSourceBsonArray> DocumentSourceCommandShards::shardSource(
+        ShardOutput::const_iterator shard) {
+        /* grab the command result */
+        BSONObj resultObj = shard->second;
+
+        uassert(16390, str::stream() << "sharded pipeline failed on shard " <<
+                                    shard->first.getName() << ": " <<
+                                    resultObj.toString(),
+                resultObj["ok"].trueValue());
+
+        /* grab the result array out of the shard server's response */
+        BSONElement resultArray = resultObj["result"];
+        massert(16391, str::stream() << "no result array? shard:" <<
+                                    shard->first.getName() << ": " <<
+                                    resultObj.toString(),
+                resultArray.type() == Array);
+
+        if (resultArray.embeddedObject().isEmpty()) {
+            // this shard had no results
+            return intrusive_ptr<DocumentSourceBsonArray>();
+        }
+
+        return DocumentSourceBsonArray::create(&resultArray, pExpCtx);
+    }
+
     void DocumentSourceCommandShards::getNextDocument() {
+        if (pMergeSort) {
+            getNextMergedDocument();
+            return;
+        }
+
         while(true) {
             if (!pBsonSource.get()) {
                 /* if there aren't any more futures, we're done */
@@ -89,30 +126,16 @@ namespace mongo {
                     return;
                 }
 
-                /* grab the next command result */
-                BSONObj resultObj = iterator->second;
-
-                uassert(16390, str::stream() << "sharded pipeline failed on shard " <<
-                                            iterator->first.getName() << ": " <<
-                                            resultObj.toString(),
-                        resultObj["ok"].trueValue());
-
-                /* grab the result array out of the shard server's response */
-                BSONElement resultArray = resultObj["result"];
-                massert(16391, str::stream() << "no result array? shard:" <<
-                                            iterator->first.getName() << ": " <<
-                                            resultObj.toString(),
-                        resultArray.type() == Array);
+                pBsonSource = shardSource(iterator);
 
                 // done with error checking, don't need the shard name anymore
                 ++iterator;
 
-                if (resultArray.embeddedObject().isEmpty()){
+                if (!pBsonSource.get()) {
                     // this shard had no results, on to the next one
                     continue;
                 }
 
-                pBsonSource = DocumentSourceBsonArray::create(&resultArray, pExpCtx);
                 newSource = true;
             }
 
@@ -128,4 +151,34 @@ namespace mongo {
             return;
         }
     }
+
+    void DocumentSourceCommandShards::getNextMergedDocument() {
+        if (iterator != listEnd) {
+            /* first call: every shard's results take part in the merge */
+            for(; iterator != listEnd; ++iterator) {
+                intrusive_ptr<DocumentSourceBsonArray> pSource(shardSource(iterator));
+                if (pSource.get() && !pSource->eof())
+                    mergeSources.push_back(pSource);
+            }
+        }
+        else if (pCurrent.get()) {
+            /* move past the document we returned last */
+            if (!mergeSources[iMergeCurrent]->advance())
+                mergeSources.erase(mergeSources.begin() + iMergeCurrent);
+        }
+
+        /*
+          There are only as many sources as shards, so a linear scan for the
+          least current document is cheap.  On ties the earlier shard wins,
+          which keeps the merge stable.
+        */
+        pCurrent.reset();
+        for(size_t i = 0; i < mergeSources.size(); ++i) {
+            intrusive_ptr<Document> pDocument(mergeSources[i]->getCurrent());
+            if (!pCurrent.get() || pMergeSort->compare(pDocument, pCurrent) < 0) {
+                pCurrent = pDocument;
+                iMergeCurrent = i;
+            }
+        }
+    }
 }
@@ -19,16 +19,136 @@
 
 #include "db/pipeline/document_source.h"
 
+#include <fstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "db/cmdline.h"
 #include "db/jsobj.h"
 #include "db/pipeline/accumulator.h"
 #include "db/pipeline/document.h"
 #include "db/pipeline/expression.h"
 #include "db/pipeline/expression_context.h"
 #include "db/pipeline/value.h"
+#include "platform/atomic_word.h"
+#include "util/mongoutils/str.h"
 
 namespace mongo {
     const char DocumentSourceGroup::groupName[] = "$group";
 
+    /* memory the groups may use before they are spilled to disk */
+    static const size_t MaxMemoryUsageBytes = 100 * 1024 * 1024;
+
+    /* number of hash partitions a spilling $group writes */
+    static const size_t nSpillPartitions = 16;
+
+    /*
+      How many times a spilled partition that still outgrows memory may be
+      split again.  16^8 partitions is far more than any input needs; the
+      limit only stops groups whose hashes collide from recursing forever.
+     */
+    static const unsigned MaxSpillDepth = 8;
+
+    static AtomicWord<unsigned long long> nextSpillFileId;
+
+    /*
+      The partition a group's _id goes to at a given depth.  Each depth
+      mixes the hash differently, so groups that shared a partition at one
+      depth are spread out again at the next.
+     */
+    static size_t spillPartitionOf(const intrusive_ptr<const Value> &pId,
+                                   unsigned depth) {
+        unsigned long long h = Value::Hash()(pId);
+        h ^= (depth + 1) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h % nSpillPartitions;
+    }
+
+    static string newSpillFilePath() {
+        const string &dir = cmdLine.tmpDir.empty() ? dbpath : cmdLine.tmpDir;
+        const string name = str::stream() << "_group." << getpid() << "."
+                                          << nextSpillFileId.fetchAndAdd(1);
+        return (boost::filesystem::path(dir) / name).string();
+    }
+
+    /*
+      One hash partition of a spilled $group.  Each entry is a group's
+      partial state, stored as a BSON object with the group's _id and one
+      field per accumulator.  Entries are appended until finish(), and are
+      then read back in the order they were written.  The file is removed
+      when the partition goes away.
+     */
+    class DocumentSourceGroup::SpillFile :
+        boost::noncopyable {
+    public:
+        SpillFile():
+            path(newSpillFilePath()) {
+            out.open(path.c_str(),
+                     std::ios::out | std::ios::binary | std::ios::trunc);
+            uassert(16876, str::stream() <<
+                    "could not create $group spill file " << path,
+                    out.good());
+        }
+
+        ~SpillFile() {
+            if (out.is_open())
+                out.close();
+            if (in.is_open())
+                in.close();
+            try {
+                boost::filesystem::remove(path);
+            }
+            catch (std::exception &e) {
+                warning() << "could not remove $group spill file " << path <<
+                    ": " << e.what() << endl;
+            }
+        }
+
+        void append(const BSONObj &obj) {
+            out.write(obj.objdata(), obj.objsize());
+        }
+
+        void finish() {
+            out.close();
+            uassert(16877, str::stream() <<
+                    "error writing $group spill file " << path,
+                    !out.fail());
+            in.open(path.c_str(), std::ios::in | std::ios::binary);
+            uassert(16878, str::stream() <<
+                    "could not open $group spill file " << path,
+                    in.good());
+        }
+
+        bool next(BSONObj &obj) {
+            int size;
+            in.read(reinterpret_cast<char *>(&size), sizeof size);
+            if (in.gcount() == 0 && in.eof())
+                return false;
+            massert(16879, str::stream() <<
+                    "corrupt $group spill file " << path,
+                    in.gcount() == (std::streamsize) sizeof size &&
+                    size >= 5 && size <= BSONObjMaxInternalSize);
+            buf.reset(size);
+            buf.appendNum(size);
+            in.read(buf.grow(size - sizeof size), size - sizeof size);
+            massert(16880, str::stream() <<
+                    "error reading $group spill file " << path,
+                    in.gcount() == (std::streamsize) (size - sizeof size));
+            obj = BSONObj(buf.buf()).getOwned();
+            return true;
+        }
+
+    private:
+        const string path;
+        std::ofstream out;
+        std::ifstream in;
+        BufBuilder buf;
+    };
+
     DocumentSourceGroup::~DocumentSourceGroup() {
     }
 
@@ -52,6 +172,10 @@ namespace mongo {
         verify(groupsIterator != groups.end());
 
         ++groupsIterator;
+        if ((groupsIterator == groups.end()) && !partitions.empty()) {
+            loadPartition();
+            groupsIterator = groups.begin();
+        }
         if (groupsIterator == groups.end()) {
             pCurrent.reset();
             return false;
@@ -116,7 +240,20 @@ namespace mongo {
         groups(),
         vFieldName(),
         vpAccumulatorFactory(),
-        vpExpression() {
+        vpExpression(),
+        memoryUsageBytes(0),
+        maxMemoryUsageBytes(MaxMemoryUsageBytes),
+        spillDepth(-1),
+        spillFiles(),
+        partitions() {
+    }
+
+    void DocumentSourceGroup::setMaxMemoryUsageBytes(size_t bytes) {
+        maxMemoryUsageBytes = bytes;
+    }
+
+    int DocumentSourceGroup::getSpillDepth() const {
+        return spillDepth;
     }
 
     void DocumentSourceGroup::addAccumulator(
@@ -312,6 +449,10 @@ namespace mongo {
     }
 
     void DocumentSourceGroup::populate() {
+        /* only when asked for, and mongos has no place to spill to */
+        const bool spillAllowed =
+            pExpCtx->getAllowDiskUse() && !pExpCtx->getInRouter();
+
         for(bool hasNext = !pSource->eof(); hasNext;
                 hasNext = pSource->advance()) {
             intrusive_ptr<Document> pDocument(pSource->getCurrent());
@@ -327,41 +468,32 @@ namespace mongo {
               Look for the _id value in the map; if it's not there, add a
               new entry with a blank accumulator.
             */
-            vector<intrusive_ptr<Accumulator> > *pGroup;
-            GroupsType::iterator it(groups.find(pId));
-            if (it != groups.end()) {
-                /* point at the existing accumulators */
-                pGroup = &it->second;
-            }
-            else {
-                /* insert a new group into the map */
-                groups.insert(it,
-                              pair<intrusive_ptr<const Value>,
-                              vector<intrusive_ptr<Accumulator> > >(
-                                  pId, vector<intrusive_ptr<Accumulator> >()));
-
-                /* find the accumulator vector (the map value) */
-                it = groups.find(pId);
-                pGroup = &it->second;
-
-                /* add the accumulators */
-                const size_t n = vpAccumulatorFactory.size();
-                pGroup->reserve(n);
-                for(size_t i = 0; i < n; ++i) {
-                    intrusive_ptr<Accumulator> pAccumulator(
-                        (*vpAccumulatorFactory[i])(pExpCtx));
-                    pAccumulator->addOperand(vpExpression[i]);
-                    pGroup->push_back(pAccumulator);
-                }
-            }
-
-            /* point at the existing key */
-            // unneeded atm // pId = it.first;
+            vector<intrusive_ptr<Accumulator> > *pGroup =
+                findGroup(pId, false);
 
             /* tickle all the accumulators for the group we found */
             const size_t n = pGroup->size();
-            for(size_t i = 0; i < n; ++i)
-                (*pGroup)[i]->evaluate(pDocument);
+            for(size_t i = 0; i < n; ++i) {
+                Accumulator *pAccumulator = (*pGroup)[i].get();
+                const size_t before = pAccumulator->getMemUsage();
+                pAccumulator->evaluate(pDocument);
+                memoryUsageBytes += pAccumulator->getMemUsage() - before;
+            }
+
+            if (spillAllowed && (memoryUsageBytes > maxMemoryUsageBytes))
+                spill();
+        }
+
+        if (!spillFiles.empty()) {
+            /*
+              Spill what is left as well, after everything spilled before
+              it, so that each partition holds its groups' partial states
+              in input order.  That keeps $first and $last right.
+            */
+            spill();
+            pushPartitions(spillFiles, 0);
+            spillFiles.clear();
+            loadPartition();
         }
 
         /* start the group iterator */
@@ -371,6 +503,162 @@ namespace mongo {
         populated = true;
     }
 
+    vector<intrusive_ptr<Accumulator> > *DocumentSourceGroup::findGroup(
+        const intrusive_ptr<const Value> &pId, bool merging) {
+        GroupsType::iterator it(groups.find(pId));
+        if (it != groups.end()) {
+            /* point at the existing accumulators */
+            return &it->second;
+        }
+
+        /* insert a new group into the map */
+        it = groups.insert(
+            pair<intrusive_ptr<const Value>,
+                 vector<intrusive_ptr<Accumulator> > >(
+                     pId, vector<intrusive_ptr<Accumulator> >())).first;
+        vector<intrusive_ptr<Accumulator> > *pGroup = &it->second;
+        memoryUsageBytes += pId->getApproximateSize();
+
+        /* add the accumulators */
+        const size_t n = vpAccumulatorFactory.size();
+        pGroup->reserve(n);
+        for(size_t i = 0; i < n; ++i) {
+            intrusive_ptr<Accumulator> pAccumulator;
+            if (!merging) {
+                pAccumulator = (*vpAccumulatorFactory[i])(pExpCtx);
+                pAccumulator->addOperand(vpExpression[i]);
+            }
+            else {
+                /* consume the partial value spill() wrote for the field */
+                pAccumulator = (*vpAccumulatorFactory[i])(pMergeCtx);
+                pAccumulator->addOperand(
+                    ExpressionFieldPath::create(vFieldName[i]));
+            }
+            memoryUsageBytes += pAccumulator->getMemUsage();
+            pGroup->push_back(pAccumulator);
+        }
+
+        return pGroup;
+    }
+
+    void DocumentSourceGroup::spill() {
+        if (spillFiles.empty()) {
+            LOG(1) << "$group is spilling to disk after using " <<
+                memoryUsageBytes << " bytes" << endl;
+
+            createSpillFiles(spillFiles);
+
+            /* spilled groups are re-aggregated the way the router merges */
+            pMergeCtx = pExpCtx->clone();
+            pMergeCtx->setDoingMerge(true);
+        }
+
+        spillGroups(spillFiles, 0);
+    }
+
+    void DocumentSourceGroup::createSpillFiles(SpillFiles &files) {
+        files.reserve(nSpillPartitions);
+        for(size_t i = 0; i < nSpillPartitions; ++i)
+            files.push_back(boost::shared_ptr<SpillFile>(new SpillFile()));
+    }
+
+    void DocumentSourceGroup::pushPartitions(const SpillFiles &files,
+                                             unsigned depth) {
+        spillDepth = std::max(spillDepth, (int) depth);
+
+        /* partitions is a stack; keep them in hash order */
+        for(size_t i = files.size(); i-- > 0; ) {
+            files[i]->finish();
+            partitions.push_back(make_pair(files[i], depth));
+        }
+    }
+
+    void DocumentSourceGroup::spillGroups(SpillFiles &files, unsigned depth) {
+        const size_t n = vFieldName.size();
+        for(GroupsType::iterator it = groups.begin(); it != groups.end();
+                ++it) {
+            BSONObjBuilder builder;
+            it->first->addToBsonObj(&builder, Document::idName);
+            for(size_t i = 0; i < n; ++i) {
+                intrusive_ptr<const Value> pValue(
+                    it->second[i]->getPartialValue());
+                if (pValue->getType() != Undefined)
+                    pValue->addToBsonObj(&builder, vFieldName[i]);
+            }
+            files[spillPartitionOf(it->first, depth)]->append(
+                builder.done());
+        }
+
+        groups.clear();
+        memoryUsageBytes = 0;
+    }
+
+    bool DocumentSourceGroup::loadPartition() {
+        groups.clear();
+        memoryUsageBytes = 0;
+
+        while (!partitions.empty()) {
+            /* the file goes away once its groups are loaded */
+            boost::shared_ptr<SpillFile> pFile(partitions.back().first);
+            const unsigned depth = partitions.back().second;
+            partitions.pop_back();
+
+            /*
+              If the partition's groups outgrow memory too, they and the
+              rest of the file are split into partitions of their own,
+              which are loaded before any other.
+            */
+            SpillFiles subPartitions;
+
+            BSONObj entry;
+            while (pFile->next(entry)) {
+                pExpCtx->checkForInterrupt();
+
+                intrusive_ptr<Document> pDocument(
+                    Document::createFromBsonObj(&entry));
+                intrusive_ptr<const Value> pId(
+                    pDocument->getValue(Document::idName));
+
+                if (!subPartitions.empty()) {
+                    subPartitions[spillPartitionOf(pId, depth + 1)]->append(
+                        entry);
+                    continue;
+                }
+
+                vector<intrusive_ptr<Accumulator> > *pGroup =
+                    findGroup(pId, true);
+
+                const size_t n = pGroup->size();
+                for(size_t i = 0; i < n; ++i) {
+                    Accumulator *pAccumulator = (*pGroup)[i].get();
+                    const size_t before = pAccumulator->getMemUsage();
+                    pAccumulator->evaluate(pDocument);
+                    memoryUsageBytes += pAccumulator->getMemUsage() - before;
+                }
+
+                /* a single group can't be split any further */
+                if ((memoryUsageBytes > maxMemoryUsageBytes) &&
+                    (groups.size() > 1) && (depth + 1 < MaxSpillDepth)) {
+                    LOG(1) << "$group is splitting a spilled partition of " <<
+                        groups.size() << " groups at depth " << depth <<
+                        endl;
+                    createSpillFiles(subPartitions);
+                    spillGroups(subPartitions, depth + 1);
+                }
+            }
+
+            if (!subPartitions.empty()) {
+                pushPartitions(subPartitions, depth + 1);
+                continue;
+            }
+
+            if (!groups.empty())
+                return true;
+        }
+
+        return false;
+    }
+
     intrusive_ptr<Document> DocumentSourceGroup::makeDocument(
         const GroupsType::iterator &rIter) {
         vector<intrusive_ptr<Accumulator> > *pGroup = &rIter->second;
@@ -41,6 +41,9 @@ namespace mongo {
         if (!populated)
             populate();
 
+        if (mergePresorted)
+            return (limitSrc && nMerged >= limitSrc->getLimit()) || pSource->eof();
+
         return (docIterator == documents.end());
     }
 
@@ -50,6 +53,17 @@ namespace mongo {
         if (!populated)
             populate();
 
+        if (mergePresorted) {
+            verify(!eof());
+            ++nMerged;
+            if (limitSrc && nMerged >= limitSrc->getLimit()) {
+                // release the shards' results as soon as possible
+                pSource->dispose();
+                return false;
+            }
+            return pSource->advance();
+        }
+
         verify(docIterator != documents.end());
 
         ++docIterator;
@@ -66,9 +80,56 @@ namespace mongo {
         if (!populated)
             populate();
 
+        if (mergePresorted)
+            return eof() ? intrusive_ptr<Document>() : pSource->getCurrent();
+
         return pCurrent;
     }
 
+    void DocumentSourceSort::addToBsonArray(
+        BSONArrayBuilder *pBuilder, bool explain) const {
+        DocumentSource::addToBsonArray(pBuilder, explain);
+
+        /* an absorbed $limit is written back out after the sort */
+        if (limitSrc)
+            limitSrc->addToBsonArray(pBuilder, explain);
+    }
+
+    bool DocumentSourceSort::coalesce(
+        const intrusive_ptr<DocumentSource> &pNextSource) {
+        if (!dynamic_cast<DocumentSourceLimit *>(pNextSource.get()))
+            return false;
+
+        if (limitSrc)
+            return limitSrc->coalesce(pNextSource); // takes the lower limit
+
+        limitSrc = static_cast<DocumentSourceLimit *>(pNextSource.get());
+        return true;
+    }
+
+    long long DocumentSourceSort::getLimit() const {
+        return limitSrc ? limitSrc->getLimit() : -1;
+    }
+
+    intrusive_ptr<DocumentSource> DocumentSourceSort::getShardSource() {
+        verify(!mergePresorted);
+        return this;
+    }
+
+    intrusive_ptr<DocumentSource> DocumentSourceSort::getRouterSource() {
+        verify(!mergePresorted);
+        intrusive_ptr<DocumentSourceSort> pMerger(
+            DocumentSourceSort::create(pExpCtx));
+        pMerger->vSortKey = vSortKey;
+        pMerger->vAscending = vAscending;
+        pMerger->mergePresorted = true;
+        if (limitSrc) {
+            pMerger->limitSrc = DocumentSourceLimit::create(pExpCtx);
+            pMerger->limitSrc->setLimit(limitSrc->getLimit());
+        }
+        return pMerger;
+    }
+
     void DocumentSourceSort::sourceToBson(
         BSONObjBuilder *pBuilder, bool explain) const {
         BSONObjBuilder insides;
@@ -86,7 +147,9 @@ namespace mongo {
     DocumentSourceSort::DocumentSourceSort(
         const intrusive_ptr<ExpressionContext> &pExpCtx):
         SplittableDocumentSource(pExpCtx),
-        populated(false) {
+        populated(false),
+        mergePresorted(false),
+        nMerged(0) {
     }
 
     void DocumentSourceSort::addKey(const string &fieldPath, bool ascending) {
@@ -159,21 +222,51 @@ namespace mongo {
         /* make sure we've got a sort key */
         verify(vSortKey.size());
 
+        if (mergePresorted) {
+            /*
+              Each shard's output is already sorted, so it only needs to be
+              merged as it is read.  Without shards (a split pipeline run on
+              mongod for testing), the single input is already in order.
+            */
+            DocumentSourceCommandShards *pShards =
+                dynamic_cast<DocumentSourceCommandShards *>(pSource);
+            if (pShards)
+                pShards->mergeSortedBy(this);
+            populated = true;
+            return;
+        }
+
         /* track and warn about how much physical memory has been used */
         DocMemMonitor dmm(this);
 
-        /* pull everything from the underlying source */
+        /*
+          Pull everything from the underlying source.  With a $limit, keep
+          only the best documents seen so far, in a heap with the worst on
+          top.
+        */
+        Comparator comparator(this);
+        const long long limit = getLimit();
         for(bool hasNext = !pSource->eof(); hasNext;
             hasNext = pSource->advance()) {
             intrusive_ptr<Document> pDocument(pSource->getCurrent());
             documents.push_back(pDocument);
-
             dmm.addToTotal(pDocument->getApproximateSize());
+
+            if (limit >= 0) {
+                push_heap(documents.begin(), documents.end(), comparator);
+                if ((long long)documents.size() > limit) {
+                    pop_heap(documents.begin(), documents.end(), comparator);
+                    dmm.subtractFromTotal(documents.back()->getApproximateSize());
+                    documents.pop_back();
+                }
+            }
         }
 
         /* sort the list */
-        Comparator comparator(this);
-        sort(documents.begin(), documents.end(), comparator);
+        if (limit >= 0)
+            sort_heap(documents.begin(), documents.end(), comparator);
+        else
+            sort(documents.begin(), documents.end(), comparator);
 
         /* start the sort iterator */
         docIterator = documents.begin();
@@ -29,6 +29,7 @@ namespace mongo {
         doingMerge(false),
         inShard(false),
         inRouter(false),
+        allowDiskUse(false),
         intCheckCounter(1),
         pStatus(pS) {
     }
@@ -48,6 +49,7 @@ namespace mongo {
         newContext->setDoingMerge(getDoingMerge());
         newContext->setInShard(getInShard());
         newContext->setInRouter(getInRouter());
+        newContext->setAllowDiskUse(getAllowDiskUse());
         return newContext;
     }
 
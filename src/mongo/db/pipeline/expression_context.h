@@ -33,10 +33,13 @@ namespace mongo {
         void setDoingMerge(bool b);
         void setInShard(bool b);
         void setInRouter(bool b);
+        void setAllowDiskUse(bool b);
 
         bool getDoingMerge() const;
         bool getInShard() const;
         bool getInRouter() const;
+        /* whether stages may spill to disk when they outgrow memory */
+        bool getAllowDiskUse() const;
 
         /**
            Used by a pipeline to check for interrupts so that killOp() works.
@@ -55,6 +58,7 @@ namespace mongo {
         bool doingMerge;
         bool inShard;
         bool inRouter;
+        bool allowDiskUse;
         unsigned intCheckCounter; // interrupt check counter
         InterruptStatus *const pStatus;
     };
@@ -77,6 +81,10 @@ namespace mongo {
         inRouter = b;
     }
 
+    inline void ExpressionContext::setAllowDiskUse(bool b) {
+        allowDiskUse = b;
+    }
+
     inline bool ExpressionContext::getDoingMerge() const {
         return doingMerge;
     }
@@ -89,4 +97,8 @@ namespace mongo {
         return inRouter;
     }
 
+    inline bool ExpressionContext::getAllowDiskUse() const {
+        return allowDiskUse;
+    }
+
 };
@@ -34,6 +34,7 @@ namespace mongo {
     const char Pipeline::explainName[] = "explain";
     const char Pipeline::fromRouterName[] = "fromRouter";
     const char Pipeline::splitMongodPipelineName[] = "splitMongodPipeline";
+    const char Pipeline::allowDiskUseName[] = "allowDiskUse";
     const char Pipeline::serverPipelineName[] = "serverPipeline";
     const char Pipeline::mongosPipelineName[] = "mongosPipeline";
 
@@ -124,6 +125,12 @@ namespace mongo {
                 continue;
             }
 
+            /* stages that outgrow memory may spill to disk */
+            if (!strcmp(pFieldName, allowDiskUseName)) {
+                pCtx->setAllowDiskUse(cmdElement.trueValue());
+                continue;
+            }
+
             /* check for debug options */
             if (!strcmp(pFieldName, splitMongodPipelineName)) {
                 pPipeline->splitMongodPipeline = true;
@@ -397,6 +404,11 @@ namespace mongo {
         if ((btemp = pCtx->getInRouter())) {
             pBuilder->append(fromRouterName, btemp);
         }
+
+        /* only sent when set, so shards that don't know it still work */
+        if ((btemp = pCtx->getAllowDiskUse())) {
+            pBuilder->append(allowDiskUseName, btemp);
+        }
     }
 
     bool Pipeline::run(BSONObjBuilder &result, string &errmsg,
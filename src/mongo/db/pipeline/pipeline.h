@@ -145,6 +145,7 @@ namespace mongo {
         static const char explainName[];
         static const char fromRouterName[];
         static const char splitMongodPipelineName[];
+        static const char allowDiskUseName[];
         static const char serverPipelineName[];
         static const char mongosPipelineName[];
 
@@ -87,6 +87,11 @@ namespace mongo {
 
     intrusive_ptr<const Value> Value::createFromBsonElement(
         BSONElement *pBsonElement) {
+        return createFromBsonElement(pBsonElement, BSONObj());
+    }
+
+    intrusive_ptr<const Value> Value::createFromBsonElement(
+        BSONElement *pBsonElement, const BSONObj &owner) {
         switch (pBsonElement->type()) {
             case Undefined:
                 return getUndefined();
@@ -98,12 +103,12 @@ namespace mongo {
                 else
                     return getFalse();
             default:
-                intrusive_ptr<const Value> pValue(new Value(pBsonElement));
+                intrusive_ptr<const Value> pValue(new Value(pBsonElement, owner));
                 return pValue;
         }
     }
 
-    Value::Value(BSONElement *pBsonElement):
+    Value::Value(BSONElement *pBsonElement, const BSONObj &owner):
         type(pBsonElement->type()),
         pDocumentValue(),
         vpValue() {
@@ -118,7 +123,7 @@ namespace mongo {
 
         case Object: {
             BSONObj document(pBsonElement->embeddedObject());
-            pDocumentValue = Document::createFromBsonObj(&document);
+            pDocumentValue = Document::createFromBsonObj(&document, owner);
             break;
         }
 
@@ -130,7 +135,7 @@ namespace mongo {
 
             for(size_t i = 0; i < n; ++i) {
                 vpValue.push_back(
-                    Value::createFromBsonElement(&vElement[i]));
+                    Value::createFromBsonElement(&vElement[i], owner));
             }
             break;
         }
@@ -70,6 +70,19 @@ namespace mongo {
         static intrusive_ptr<const Value> createFromBsonElement(
             BSONElement *pBsonElement);
 
+        /*
+          Construct a Value from a BSONElement within an owned object.
+
+          Embedded objects become Documents that refer into owner's buffer
+          instead of copying it.
+
+          @param pBsonElement the element
+          @param owner an object whose buffer contains the element
+          @returns a new Value initialized from the bsonElement
+        */
+        static intrusive_ptr<const Value> createFromBsonElement(
+            BSONElement *pBsonElement, const BSONObj &owner);
+
         /*
           Construct an integer-valued Value.
 
@@ -313,7 +326,7 @@ namespace mongo {
         Value(int intValue);
 
     private:
-        Value(BSONElement *pBsonElement);
+        Value(BSONElement *pBsonElement, const BSONObj &owner);
 
         Value(long long longValue);
         Value(double doubleValue);
@@ -494,6 +494,72 @@ doneCheckOrder:
         return _d->isMultikey( _idxNo );
     }
 
+    /** Plans with more first field intervals than this are not worth estimating. */
+    static const unsigned MaxEstimatedIntervals = 16;
+
+    long long QueryPlan::estimatedKeys() const {
+        if ( _utility == Impossible ) {
+            return 0;
+        }
+        if ( willScanTable() ) {
+            // A partitioned collection's rows are spread over its partitions.
+            long long total = 0;
+            for ( int p = 0; p < _d->nPartitions(); p++ ) {
+                DB_BTREE_STAT64 stats;
+                _d->getPartition( p ).getStat64( &stats );
+                total += stats.bt_nkeys;
+            }
+            return total;
+        }
+        if ( !_index || _type || _startOrEndSpec || !_frv ) {
+            return -1;
+        }
+        const vector<FieldRange> &ranges = _frv->ranges();
+        if ( ranges.empty() || ranges.front().intervals().size() > MaxEstimatedIntervals ) {
+            return -1;
+        }
+
+        // Estimate each interval of the first field separately, bounding the remaining fields
+        // by their outermost intervals.  Like IndexCursor::_prelockRange, pad secondary keys
+        // with a primary key that sorts before or after every other one.
+        // A partitioned primary key is stored in one dictionary per partition, and the keys
+        // in range are the sum of each partition's.
+        const bool isSecondary = !_d->isPKIndex( *_index );
+        const int nDictionaries = isSecondary ? 1 : _d->nPartitions();
+        const vector<FieldInterval> &intervals = ranges.front().intervals();
+        long long total = 0;
+        for ( vector<FieldInterval>::const_iterator i = intervals.begin(); i != intervals.end(); ++i ) {
+            BSONObjBuilder lower;
+            BSONObjBuilder upper;
+            lower.appendAs( i->_lower._bound, "" );
+            upper.appendAs( i->_upper._bound, "" );
+            for ( vector<FieldRange>::const_iterator r = ranges.begin() + 1; r != ranges.end(); ++r ) {
+                lower.appendAs( r->intervals().front()._lower._bound, "" );
+                upper.appendAs( r->intervals().back()._upper._bound, "" );
+            }
+            // A reverse scan's bounds are backwards in the key space.
+            const BSONObj lowerKey = lower.obj();
+            const BSONObj upperKey = upper.obj();
+            const BSONObj &leftKey = _direction >= 0 ? lowerKey : upperKey;
+            const BSONObj &rightKey = _direction >= 0 ? upperKey : lowerKey;
+
+            for ( int p = 0; p < nDictionaries; p++ ) {
+                const IndexDetails &dictionary = isSecondary ? *_index : _d->getPartition( p );
+                uint64_t less, equal, greater;
+                dictionary.keyRange( storage::Key( leftKey, isSecondary ? &minKey : NULL ),
+                                     &less, &equal, &greater );
+                const uint64_t left = less;
+                dictionary.keyRange( storage::Key( rightKey, isSecondary ? &maxKey : NULL ),
+                                     &less, &equal, &greater );
+                const uint64_t right = less + equal;
+                if ( right > left ) {
+                    total += right - left;
+                }
+            }
+        }
+        return total;
+    }
+
     std::ostream &operator<< ( std::ostream &out, const QueryPlan::Utility &utility ) {
         out << "QueryPlan::";
         switch( utility ) {
@@ -879,6 +945,54 @@ doneCheckOrder:
         _plans.push_back( plan );
     }
 
+    /**
+     * The cheapest plan's estimate must be this many times smaller than every other plan's
+     * for it to run without racing the others.  This leaves room for estimation error and for
+     * the cost of fetching documents from a secondary index, which the estimates ignore.
+     */
+    static const long long PlanEstimateRatio = 4;
+
+    QueryPlanSet::QueryPlanPtr QueryPlanSet::clearlyCheapestPlan() const {
+        if ( !cmdLine.planEstimates || _plans.size() < 2 ) {
+            return QueryPlanPtr();
+        }
+
+        QueryPlanPtr best;
+        long long bestKeys = -1;
+        long long nextKeys = -1;
+        try {
+            for( PlanSet::const_iterator i = _plans.begin(); i != _plans.end(); ++i ) {
+                const long long keys = (*i)->estimatedKeys();
+                if ( keys < 0 ) {
+                    return QueryPlanPtr();
+                }
+                if ( !best || keys < bestKeys ) {
+                    nextKeys = bestKeys;
+                    best = *i;
+                    bestKeys = keys;
+                }
+                else if ( nextKeys < 0 || keys < nextKeys ) {
+                    nextKeys = keys;
+                }
+            }
+        }
+        catch ( DBException &e ) {
+            LOG(1) << "could not estimate query plans, racing them: " << e.what() << endl;
+            return QueryPlanPtr();
+        }
+
+        // An in order plan may stop early when there is a limit, however many keys it could
+        // scan, so only race it against an out of order plan.
+        if ( best->scanAndOrderRequired() && haveInOrderPlan() ) {
+            return QueryPlanPtr();
+        }
+        // Estimates of zero don't tell plans apart, so the race has to.
+        if ( nextKeys <= 0 || bestKeys * PlanEstimateRatio > nextKeys ) {
+            return QueryPlanPtr();
+        }
+        return best;
+    }
+
     bool QueryPlanSet::hasPossiblyExcludedPlans() const {
         return
             _usingCachedPlan &&
@@ -1014,13 +1128,27 @@ doneCheckOrder:
     shared_ptr<QueryOp> QueryPlanSet::Runner::init() {
         massert( 10369 ,  "no plans", _plans._plans.size() > 0 );
         
-        if ( _plans._plans.size() > 1 )
-            LOG(1) << "  running multiple plans" << endl;
-        for( PlanSet::iterator i = _plans._plans.begin(); i != _plans._plans.end(); ++i ) {
+        // Explain reports on every candidate plan, so it always races them.
+        QueryPlanPtr cheapest;
+        if ( !_explainClauseInfo ) {
+            cheapest = _plans.clearlyCheapestPlan();
+        }
+        if ( cheapest ) {
+            LOG(1) << "  running plan with the smallest estimated scan " << cheapest->indexKey()
+                   << endl;
             shared_ptr<QueryOp> op( _op.createChild() );
-            op->setQueryPlan( i->get() );
+            op->setQueryPlan( cheapest.get() );
             _ops.push_back( op );
         }
+        else {
+            if ( _plans._plans.size() > 1 )
+                LOG(1) << "  running multiple plans" << endl;
+            for( PlanSet::iterator i = _plans._plans.begin(); i != _plans._plans.end(); ++i ) {
+                shared_ptr<QueryOp> op( _op.createChild() );
+                op->setQueryPlan( i->get() );
+                _ops.push_back( op );
+            }
+        }
         
         // Initialize ops.
         for( vector<shared_ptr<QueryOp> >::iterator i = _ops.begin(); i != _ops.end(); ++i ) {
@@ -108,6 +108,13 @@ namespace mongo {
         
         QueryPlanSummary summary() const;
 
+        /**
+         * @return an estimate, from the storage layer's key range statistics, of how many keys
+         * (or documents, for a table scan) this plan will scan, or -1 if the plan's bounds are
+         * too complex to estimate.  No rows are read.
+         */
+        long long estimatedKeys() const;
+
         /** The following member functions are for testing, or public for testing. */
         
         shared_ptr<FieldRangeVector> frv() const { return _frv; }
@@ -406,6 +413,13 @@ namespace mongo {
         void setCachedPlan( const QueryPlanPtr &plan, const CachedQueryPlan &cachedPlan );
         /** Add a candidate query plan, potentially one of many. */
         void addCandidatePlan( const QueryPlanPtr &plan );
+
+        /**
+         * @return the candidate plan whose estimated scan is much smaller than every other
+         * candidate's, so that racing the plans is not worth it, or an empty pointer if the
+         * estimates are close, all zero or unavailable.
+         */
+        QueryPlanPtr clearlyCheapestPlan() const;
         
         //for testing
         bool modifiedKeys() const;
@@ -472,7 +486,6 @@ namespace mongo {
 
         void addFallbackPlans();
         void pushPlan( const QueryPlanPtr& plan );
-
         QueryPlanGenerator _generator;
         BSONObj _originalQuery;
         auto_ptr<FieldRangeSetPair> _frsp;
@@ -48,6 +48,7 @@
 #include "pcrecpp.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/queryutil.h"
+#include "mongo/util/net/message_compressor.h"
 
 namespace mongo {
 
@@ -188,6 +189,7 @@ namespace mongo {
 
             result.appendNumber("maxBsonObjectSize", BSONObjMaxUserSize);
             result.appendDate("localTime", jsTime());
+            MessageCompressor::negotiate(cmdObj, cc().port(), result);
             return true;
         }
     } cmdismaster;
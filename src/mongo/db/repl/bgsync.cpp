@@ -18,12 +18,17 @@
 #include "mongo/pch.h"
 
 #include "mongo/db/client.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/parallel_applier.h"
 #include "mongo/db/repl/rs_sync.h"
 
 namespace mongo {
     void incRBID();
+
+    // maximum number of transactions handed to the parallel applier at once
+    static const size_t parallelApplyBatchSize = 1000;
     BackgroundSync* BackgroundSync::s_instance = 0;
     boost::mutex BackgroundSync::s_mutex;
 
@@ -38,6 +43,9 @@ namespace mongo {
     {
     }
 
+    BackgroundSync::~BackgroundSync() {
+    }
+
     BackgroundSync::QueueCounter::QueueCounter() : waitTime(0) {
     }
 
@@ -60,6 +68,14 @@ namespace mongo {
         return counters.obj();
     }
 
+    BSONObj BackgroundSync::getApplierStats() {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        if (_parallelApplier) {
+            return _parallelApplier->getStats();
+        }
+        return BSON("threads" << 1);
+    }
+
     void BackgroundSync::shutdown() {
         // first get producer thread to exit
         log() << "trying to shutdown bgsync" << rsLog;
@@ -104,20 +120,24 @@ namespace mongo {
         }
         Client::initThread("applier");
         replLocalAuth();
+        if (cmdLine.replApplierThreads > 1) {
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            _parallelApplier.reset(new ParallelApplier(cmdLine.replApplierThreads));
+        }
         applyOpsFromOplog();
         cc().shutdown();
         {
             boost::unique_lock<boost::mutex> lock(_mutex);
+            _parallelApplier.reset();
             _applierInProgress = false;
         }
     }
 
     void BackgroundSync::applyOpsFromOplog() {
-        GTID lastLiveGTID;
-        GTID lastUnappliedGTID;
+        std::vector<BSONObj> batch;
         while (1) {
             try {
-                BSONObj curr;
+                batch.clear();
                 {
                     boost::unique_lock<boost::mutex> lck(_mutex);
                     // wait until we know an item has been produced
@@ -128,35 +148,34 @@ namespace mongo {
                     if (_deque.size() == 0 && _applierShouldExit) {
                         return; 
                     }
-                    curr = _deque.front();
+                    // With a parallel applier, take as many transactions
+                    // as can be applied together. Anything that cannot be
+                    // partitioned by primary key is applied by itself.
+                    const size_t n = _parallelApplier
+                            ? ParallelApplier::batchLength(_deque, parallelApplyBatchSize)
+                            : 1;
+                    batch.assign(_deque.begin(), _deque.begin() + n);
                 }
-                GTID currEntry = getGTIDFromOplogEntry(curr);
-                theReplSet->gtidManager->noteApplyingGTID(currEntry);
-                // we must do applyTransactionFromOplog in a loop
-                // because once we have called noteApplyingGTID, we must
-                // continue until we are successful in applying the transaction.
-                for (uint32_t numTries = 0; numTries <= 100; numTries++) {
-                    try {
-                        numTries++;
-                        applyTransactionFromOplog(curr);
-                        break;
-                    }
-                    catch (std::exception &e) {
-                        log() << "exception during applying transaction from oplog: " << e.what() << endl;
-                        if (numTries == 100) {
-                            // something is really wrong if we fail 100 times, let's abort
-                            ::abort();
-                        }
-                        sleepsecs(1);
-                    }
+                for (std::vector<BSONObj>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+                    theReplSet->gtidManager->noteApplyingGTID(getGTIDFromOplogEntry(*it));
+                }
+                if (batch.size() == 1) {
+                    const BSONObj &curr = batch[0];
+                    applyTransactionFromOplogWithRetries(curr);
+                    LOG(3) << "applied " << curr.toString(false, true) << endl;
+                    theReplSet->gtidManager->noteGTIDApplied(getGTIDFromOplogEntry(curr));
+                }
+                else {
+                    _parallelApplier->applyBatch(batch);
                 }
-                LOG(3) << "applied " << curr.toString(false, true) << endl;
-                theReplSet->gtidManager->noteGTIDApplied(currEntry);
 
                 {
                     boost::unique_lock<boost::mutex> lck(_mutex);
-                    dassert(_deque.size() > 0);
-                    _deque.pop_front();
+                    dassert(_deque.size() >= batch.size());
+                    const size_t sizeBefore = _deque.size();
+                    for (size_t i = 0; i < batch.size(); i++) {
+                        _deque.pop_front();
+                    }
                     
                     // this is a flow control mechanism, with bad numbers
                     // hard coded for now just to get something going.
@@ -165,7 +184,7 @@ namespace mongo {
                     // 10000. This is where we signal that we have gotten there
                     // Once we have spilling of transactions working, this
                     // logic will need to be redone
-                    if (_deque.size() == 10000) {
+                    if (sizeBefore > 10000 && _deque.size() <= 10000) {
                         _queueCond.notify_all();
                     }
                 }
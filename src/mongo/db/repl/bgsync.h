@@ -26,6 +26,7 @@
 
 namespace mongo {
 
+    class ParallelApplier;
 
     /**
      * Lock order:
@@ -71,6 +72,10 @@ namespace mongo {
         // to _queueCounter.numElems
         std::deque<BSONObj> _deque;
 
+        // applies transactions concurrently when --replApplierThreads > 1,
+        // NULL otherwise. Created and destroyed by the applier thread.
+        scoped_ptr<ParallelApplier> _parallelApplier;
+
         // these variables are relevant to shutdown
 
         // states if opSync should exit, because we are shutting down
@@ -119,7 +124,7 @@ namespace mongo {
     public:
         static BackgroundSync* get();
         void shutdown();
-        virtual ~BackgroundSync() {}
+        virtual ~BackgroundSync();
 
         void applierThread();
         void applyOpsFromOplog();
@@ -131,6 +136,8 @@ namespace mongo {
 
         // For monitoring
         BSONObj getCounters();
+        // per worker throughput of the applier, for replSetGetStatus
+        BSONObj getApplierStats();
 
         // for when we are assuming a primary
         // or we are going  into maintenance mode or we are blocking sync
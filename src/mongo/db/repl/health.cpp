@@ -30,6 +30,7 @@
 #include "../../util/startup_test.h"
 #include "../dbhelpers.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/parallel_cloner.h"
 
 namespace mongo {
     /* decls for connections.h */
@@ -449,6 +450,15 @@ namespace mongo {
             b.append("syncingTo", syncTarget->fullName());
         }
         b.append("members", v);
+        b.append("applier", BackgroundSync::get()->getApplierStats());
+        {
+            BSONObjBuilder ib;
+            ParallelCloner::appendProgress(ib);
+            BSONObj initialSync = ib.obj();
+            if (!initialSync.isEmpty()) {
+                b.append("initialSync", initialSync);
+            }
+        }
         if( replSetBlind )
             b.append("blind",true); // to avoid confusion if set...normally never set except for testing.
     }
@@ -0,0 +1,286 @@
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/parallel_applier.h"
+
+#include <boost/bind.hpp>
+
+#include "mongo/db/client.h"
+#include "mongo/db/hasher.h"
+#include "mongo/db/oplog.h"
+#include "mongo/db/oplog_helpers.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    void applyTransactionFromOplogWithRetries(const BSONObj& entry) {
+        // we must do applyTransactionFromOplog in a loop
+        // because once we have called noteApplyingGTID, we must
+        // continue until we are successful in applying the transaction.
+        for (uint32_t numTries = 0; numTries <= 100; numTries++) {
+            try {
+                numTries++;
+                applyTransactionFromOplog(entry);
+                break;
+            }
+            catch (std::exception &e) {
+                log() << "exception during applying transaction from oplog: " << e.what() << endl;
+                if (numTries == 100) {
+                    // something is really wrong if we fail 100 times, let's abort
+                    ::abort();
+                }
+                sleepsecs(1);
+            }
+        }
+    }
+
+    static string conflictKey(const char* ns, const BSONElement& pk) {
+        // Hash the canonical form of the pk so that values that compare
+        // equal in the collection (e.g. 1 and 1.0) map to the same key.
+        // A collision only adds a false dependency, which is safe.
+        const long long h = BSONElementHasher::hash64(pk, BSONElementHasher::DEFAULT_HASH_SEED);
+        return str::stream() << ns << '\0' << h;
+    }
+
+    bool ParallelApplier::canApplyInParallel(const BSONObj& entry, std::vector<string>* keys) {
+        if (keys != NULL) {
+            keys->clear();
+        }
+        if (entry["a"].trueValue()) {
+            // already applied, applyTransactionFromOplog is a no-op
+            return true;
+        }
+        if (!entry.hasElement("ops")) {
+            // spilled transaction, the ops live in oplog.refs
+            return false;
+        }
+        BSONObjIterator it(entry["ops"].Obj());
+        while (it.more()) {
+            BSONObj op = it.next().Obj();
+            const char* ns = op["ns"].valuestrsafe();
+            const char* opType = op["op"].valuestrsafe();
+            if (str::equals(opType, OpLogHelpers::OP_STR_COMMENT)) {
+                continue;
+            }
+            else if (str::equals(opType, OpLogHelpers::OP_STR_INSERT)) {
+                if (str::endsWith(ns, ".system.indexes")) {
+                    return false;
+                }
+                if (keys != NULL) {
+                    keys->push_back(conflictKey(ns, op["o"].Obj()["_id"]));
+                }
+            }
+            else if (str::equals(opType, OpLogHelpers::OP_STR_INSERT_MANY)) {
+                if (keys != NULL) {
+                    for (BSONObjIterator rows(op["o"].Obj()); rows.more(); ) {
+                        keys->push_back(conflictKey(ns, rows.next().Obj()["_id"]));
+                    }
+                }
+            }
+            else if (str::equals(opType, OpLogHelpers::OP_STR_DELETE)) {
+                if (keys != NULL) {
+                    keys->push_back(conflictKey(ns, op["o"].Obj()["_id"]));
+                }
+            }
+            else if (str::equals(opType, OpLogHelpers::OP_STR_UPDATE)) {
+                if (keys != NULL) {
+                    keys->push_back(conflictKey(ns, op["pk"].Obj().firstElement()));
+                }
+            }
+            else if (str::equals(opType, OpLogHelpers::OP_STR_CAPPED_INSERT) ||
+                     str::equals(opType, OpLogHelpers::OP_STR_CAPPED_DELETE)) {
+                // capped collections must see inserts and deletes in
+                // order, so serialize on the whole namespace
+                if (keys != NULL) {
+                    keys->push_back(ns);
+                }
+            }
+            else {
+                // commands, and anything we do not understand
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t ParallelApplier::batchLength(const std::deque<BSONObj>& queue, size_t maxBatchSize) {
+        size_t n = 0;
+        for (std::deque<BSONObj>::const_iterator it = queue.begin();
+             it != queue.end() && n < maxBatchSize; ++it, ++n) {
+            if (!canApplyInParallel(*it)) {
+                return n == 0 ? 1 : n;
+            }
+        }
+        return n;
+    }
+
+    void ParallelApplier::applyTransaction(const BSONObj& entry) {
+        applyTransactionFromOplogWithRetries(entry);
+    }
+
+    void ParallelApplier::noteApplied(const GTID& gtid) {
+        theReplSet->gtidManager->noteGTIDApplied(gtid);
+    }
+
+    ParallelApplier::ParallelApplier(int nThreads) :
+        _nextToNote(0),
+        _shutdown(false),
+        _workers(nThreads),
+        _batches(0)
+    {
+        verify(nThreads > 0);
+        for (int i = 0; i < nThreads; i++) {
+            _threads.create_thread(boost::bind(&ParallelApplier::workerThread, this, i));
+        }
+    }
+
+    ParallelApplier::~ParallelApplier() {
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            _shutdown = true;
+            _readyCond.notify_all();
+        }
+        _threads.join_all();
+    }
+
+    void ParallelApplier::applyBatch(const std::vector<BSONObj>& batch) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        dassert(_tasks.empty() && _ready.empty());
+        _tasks.resize(batch.size());
+        _nextToNote = 0;
+
+        // build the dependency graph: each task depends on the last
+        // earlier task that touched any of its conflict keys
+        map<string, size_t> lastWriter;
+        std::vector<string> keys;
+        for (size_t i = 0; i < batch.size(); i++) {
+            Task &task = _tasks[i];
+            task.entry = batch[i];
+            task.gtid = getGTIDFromOplogEntry(batch[i]);
+            bool ok = canApplyInParallel(batch[i], &keys);
+            verify(ok);
+            set<size_t> deps;
+            for (std::vector<string>::const_iterator k = keys.begin(); k != keys.end(); ++k) {
+                map<string, size_t>::iterator w = lastWriter.find(*k);
+                if (w != lastWriter.end()) {
+                    deps.insert(w->second);
+                    w->second = i;
+                }
+                else {
+                    lastWriter[*k] = i;
+                }
+            }
+            for (set<size_t>::const_iterator d = deps.begin(); d != deps.end(); ++d) {
+                _tasks[*d].dependents.push_back(i);
+            }
+            task.remainingDeps = deps.size();
+            if (task.remainingDeps == 0) {
+                _ready.push_back(i);
+            }
+        }
+
+        _readyCond.notify_all();
+        while (_nextToNote < _tasks.size()) {
+            _batchDone.wait(lk);
+        }
+        _tasks.clear();
+        _batches++;
+    }
+
+    // called with _mutex held
+    void ParallelApplier::noteAppliedPrefix() {
+        while (_nextToNote < _tasks.size() && _tasks[_nextToNote].done) {
+            noteApplied(_tasks[_nextToNote].gtid);
+            _nextToNote++;
+        }
+        if (_nextToNote == _tasks.size()) {
+            _batchDone.notify_all();
+        }
+    }
+
+    void ParallelApplier::workerThread(int id) {
+        const string name = str::stream() << "replApplier" << id;
+        Client::initThread(name.c_str());
+        replLocalAuth();
+        while (true) {
+            size_t i;
+            BSONObj entry;
+            {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                while (_ready.empty() && !_shutdown) {
+                    _readyCond.wait(lk);
+                }
+                if (_ready.empty()) {
+                    break;
+                }
+                i = _ready.front();
+                _ready.pop_front();
+                entry = _tasks[i].entry;
+            }
+
+            Timer timer;
+            applyTransaction(entry);
+            LOG(3) << "applied " << entry.toString(false, true) << endl;
+            const uint64_t micros = timer.micros();
+            const uint64_t nOps = entry.hasElement("ops") ? entry["ops"].Obj().nFields() : 0;
+
+            {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                Worker &w = _workers[id];
+                w.txnsApplied++;
+                w.opsApplied += nOps;
+                w.applyMicros += micros;
+
+                Task &task = _tasks[i];
+                task.done = true;
+                for (std::vector<size_t>::const_iterator d = task.dependents.begin();
+                     d != task.dependents.end(); ++d) {
+                    if (--_tasks[*d].remainingDeps == 0) {
+                        _ready.push_back(*d);
+                        _readyCond.notify_one();
+                    }
+                }
+                noteAppliedPrefix();
+            }
+        }
+        cc().shutdown();
+    }
+
+    BSONObj ParallelApplier::getStats() {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        BSONObjBuilder b;
+        b.append("threads", (int) _workers.size());
+        b.appendNumber("batches", (long long) _batches);
+        BSONArrayBuilder workers(b.subarrayStart("workers"));
+        for (size_t i = 0; i < _workers.size(); i++) {
+            const Worker &w = _workers[i];
+            BSONObjBuilder wb(workers.subobjStart());
+            wb.appendNumber("txnsApplied", (long long) w.txnsApplied);
+            wb.appendNumber("opsApplied", (long long) w.opsApplied);
+            wb.appendNumber("applyMillis", (long long) (w.applyMicros / 1000));
+            // throughput while actually applying, not counting idle time
+            wb.append("txnsPerSec", w.applyMicros > 0 ? (w.txnsApplied * 1000000.0) / w.applyMicros : 0.0);
+            wb.done();
+        }
+        workers.done();
+        return b.obj();
+    }
+
+} // namespace mongo
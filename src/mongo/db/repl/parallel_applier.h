@@ -0,0 +1,122 @@
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/gtid.h"
+
+namespace mongo {
+
+    // Applies a transaction from the oplog, retrying on failure. Once a
+    // GTID has been noted as applying we must not give up on it, so this
+    // aborts the server if the transaction cannot be applied after many tries.
+    void applyTransactionFromOplogWithRetries(const BSONObj& entry);
+
+    /**
+     * Applies batches of oplog transactions on a pool of worker threads.
+     *
+     * Each transaction in a batch is mapped to a set of conflict keys
+     * (namespace + primary key, or just the namespace for capped
+     * collections). A transaction only becomes runnable once every earlier
+     * transaction in the batch that shares one of its keys has been applied,
+     * so transactions that touch the same rows are applied in oplog order
+     * and everything else is applied concurrently.
+     *
+     * The caller notes every GTID in the batch as applying, in order, before
+     * handing the batch over. GTIDs are noted as applied in GTID order as
+     * the applied prefix of the batch grows.
+     *
+     * Transactions that cannot be partitioned (commands, index builds,
+     * transactions spilled to oplog.refs) must be applied alone, see
+     * canApplyInParallel.
+     */
+    class ParallelApplier : boost::noncopyable {
+    public:
+        explicit ParallelApplier(int nThreads);
+        virtual ~ParallelApplier();
+
+        // Applies every entry in batch, returns once all of them have been
+        // applied and noted in the GTIDManager.
+        void applyBatch(const std::vector<BSONObj>& batch);
+
+        // For replSetGetStatus, per worker counters
+        BSONObj getStats();
+
+        // @return false if the oplog entry must not be applied concurrently
+        // with any other entry. Otherwise fills keys, if non-NULL, with the
+        // entry's conflict keys.
+        static bool canApplyInParallel(const BSONObj& entry, std::vector<string>* keys = NULL);
+
+        // @return how many transactions from the front of queue make up the
+        // next batch: at most maxBatchSize, stopping before the first one
+        // that must be applied alone, which is a batch by itself.
+        static size_t batchLength(const std::deque<BSONObj>& queue, size_t maxBatchSize);
+
+    protected:
+        // Applies one transaction of the batch, on a worker thread.
+        virtual void applyTransaction(const BSONObj& entry);
+        // Notes gtid applied, in GTID order, with _mutex held.
+        virtual void noteApplied(const GTID& gtid);
+
+    private:
+        struct Worker {
+            Worker() : txnsApplied(0), opsApplied(0), applyMicros(0) {}
+            uint64_t txnsApplied;
+            uint64_t opsApplied;
+            uint64_t applyMicros;
+        };
+
+        struct Task {
+            Task() : remainingDeps(0), done(false) {}
+            BSONObj entry;
+            GTID gtid;
+            // number of earlier tasks in the batch this one waits on
+            int remainingDeps;
+            // tasks that wait on this one
+            std::vector<size_t> dependents;
+            bool done;
+        };
+
+        void workerThread(int id);
+        // called with _mutex held
+        void noteAppliedPrefix();
+
+        boost::mutex _mutex;
+        // signals workers that _ready has work or that we are shutting down
+        boost::condition _readyCond;
+        // signals applyBatch that the batch has been fully applied
+        boost::condition _batchDone;
+
+        std::vector<Task> _tasks;
+        std::deque<size_t> _ready;
+        // index of the first task whose GTID has not yet been noted applied
+        size_t _nextToNote;
+        bool _shutdown;
+
+        std::vector<Worker> _workers;
+        boost::thread_group _threads;
+        uint64_t _batches;
+    };
+
+} // namespace mongo
@@ -0,0 +1,377 @@
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/parallel_cloner.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/client/remote_transaction.h"
+#include "mongo/db/client.h"
+#include "mongo/db/curop.h"
+#include "mongo/db/gtid.h"
+#include "mongo/db/index.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/db/oplogreader.h"
+#include "mongo/db/ops/insert.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/repl/rs_optime.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Holds the cloner's connection mutex while a worker uses the
+        // shared connection, does nothing for a connection of its own.
+        class SourceLock : boost::noncopyable {
+        public:
+            SourceLock(boost::mutex &m, bool shared) : _lk(m, boost::defer_lock) {
+                if (shared) {
+                    _lk.lock();
+                }
+            }
+        private:
+            boost::unique_lock<boost::mutex> _lk;
+        };
+
+        // The GTIDs of the oplog entries matching query that conn's snapshot
+        // sees, in order.
+        std::vector<GTID> visibleGTIDs(DBClientConnection &conn, const BSONObj &query) {
+            const BSONObj fields = BSON("_id" << 1);
+            auto_ptr<DBClientCursor> c = conn.query(rsoplog, query, 0, 0, &fields, QueryOption_SlaveOk);
+            massert(16903, "query for the source's live oplog entries failed", c.get() != NULL);
+            std::vector<GTID> gtids;
+            while (c->more()) {
+                gtids.push_back(getGTIDFromOplogEntry(c->next()));
+            }
+            return gtids;
+        }
+
+        bool sameGTIDs(const std::vector<GTID> &a, const std::vector<GTID> &b) {
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.size(); i++) {
+                if (GTID::cmp(a[i], b[i]) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    } // namespace
+
+    boost::mutex ParallelCloner::_progressMutex;
+    ParallelCloner *ParallelCloner::_current = NULL;
+    BSONObj ParallelCloner::_lastProgress;
+
+    ParallelCloner::ParallelCloner(const string &host, int nThreads, bool buildIndexes) :
+        _host(host),
+        _nThreads(nThreads),
+        _buildIndexes(buildIndexes),
+        _shared(false),
+        _failed(false) {
+        verify(nThreads > 0);
+        boost::unique_lock<boost::mutex> lk(_progressMutex);
+        _current = this;
+    }
+
+    ParallelCloner::~ParallelCloner() {
+        boost::unique_lock<boost::mutex> lk(_progressMutex);
+        BSONObjBuilder b;
+        {
+            boost::unique_lock<boost::mutex> lk2(_mutex);
+            appendProgressLocked(b);
+        }
+        _lastProgress = b.obj();
+        _current = NULL;
+    }
+
+    bool ParallelCloner::mayLoad(const StringData &ns, const BSONObj &options) {
+        const string s = ns.toString();
+        if (NamespaceString::special(s.c_str()) || nsToDatabase(s) == "local") {
+            return false;
+        }
+        return !options["capped"].trueValue() &&
+               !options["natural"].trueValue() &&
+               !options["partitioned"].trueValue();
+    }
+
+    void ParallelCloner::add(const string &ns) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _tasks.push_back(Task(ns));
+    }
+
+    void ParallelCloner::connect(shared_ptr<DBClientConnection> reference) {
+        for (int attempt = 0; attempt < ConnectAttempts; attempt++) {
+            if (openSnapshots(reference)) {
+                LOG(0) << "replSet initial sync cloning " << _tasks.size() << " collections over "
+                       << _sources.size() << " connections" << rsLog;
+                return;
+            }
+        }
+        _sources.clear();
+        Source source;
+        source.conn = reference;
+        source.shared = true;
+        _sources.push_back(source);
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            _shared = true;
+        }
+        log() << "replSet initial sync could not open " << _nThreads << " matching snapshots of "
+              << _host << ", cloning " << _tasks.size() << " collections over one connection" << rsLog;
+    }
+
+    bool ParallelCloner::openSnapshots(shared_ptr<DBClientConnection> reference) {
+        _sources.clear();
+
+        // Everything before minLive is resolved in every snapshot, so only
+        // the entries from it on can differ. GTIDs are handed out before
+        // their transactions commit, so they commit out of order, and two
+        // snapshots are the same only if they see exactly the same GTIDs
+        // from minLive on, not merely as many of them.
+        const BSONObj minLive = reference->findOne(rsReplInfo, BSON("_id" << "minLive"), NULL, QueryOption_SlaveOk);
+        if (minLive.isEmpty()) {
+            return false;
+        }
+        BSONObjBuilder gte;
+        addGTIDToBSON("$gte", getGTIDFromBSON("GTID", minLive), gte);
+        const BSONObj query = BSON("_id" << gte.obj());
+        const std::vector<GTID> expected = visibleGTIDs(*reference, query);
+
+        for (int i = 0; i < _nThreads; i++) {
+            OplogReader r(false);
+            if (!r.connect(_host)) {
+                return false;
+            }
+            Source source;
+            source.conn = r.conn_shared();
+            source.txn.reset(new RemoteTransaction(*source.conn, "mvcc"));
+            _sources.push_back(source);
+            if (!sameGTIDs(visibleGTIDs(*source.conn, query), expected)) {
+                LOG(1) << "replSet initial sync snapshot " << i << " of " << _host
+                       << " sees different GTIDs than the first, retrying" << rsLog;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ParallelCloner::nextTask(size_t *i) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        if (_failed || _queue.empty()) {
+            return false;
+        }
+        *i = _queue.front();
+        _queue.pop_front();
+        _tasks[*i].start = time(0);
+        return true;
+    }
+
+    void ParallelCloner::setState(size_t i, const char *state) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _tasks[i].state = state;
+    }
+
+    void ParallelCloner::addLoaded(size_t i, long long docs, long long bytes) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _tasks[i].docs += docs;
+        _tasks[i].bytes += bytes;
+    }
+
+    void ParallelCloner::setError(const string &msg) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        if (!_failed) {
+            _failed = true;
+            _errorMsg = msg;
+        }
+    }
+
+    void ParallelCloner::run() {
+        verify(!_sources.empty());
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            for (size_t i = 0; i < _tasks.size(); i++) {
+                _queue.push_back(i);
+            }
+        }
+
+        boost::thread_group threads;
+        const int n = std::min((size_t) _nThreads, _tasks.size());
+        for (int i = 0; i < n; i++) {
+            threads.create_thread(boost::bind(&ParallelCloner::workerThread, this, i));
+        }
+        threads.join_all();
+
+        if (_failed) {
+            uasserted(16888, str::stream() << "parallel initial sync failed: " << _errorMsg);
+        }
+        for (std::vector<Source>::iterator it = _sources.begin(); it != _sources.end(); ++it) {
+            if (it->txn) {
+                bool ok = it->txn->commit();
+                verify(ok);  // it was read only
+            }
+        }
+    }
+
+    void ParallelCloner::workerThread(int id) {
+        const string name = str::stream() << "initialSyncClone" << id;
+        Client::initThread(name.c_str());
+        replLocalAuth();
+        Source &source = _sources[_shared ? 0 : id];
+        size_t i;
+        while (nextTask(&i)) {
+            try {
+                cloneCollection(source, i);
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                _tasks[i].state = "done";
+                _tasks[i].end = time(0);
+            }
+            catch (const std::exception &e) {
+                setState(i, "failed");
+                setError(str::stream() << "cloning " << _tasks[i].ns << ": " << e.what());
+            }
+        }
+        cc().shutdown();
+    }
+
+    void ParallelCloner::cloneCollection(Source &source, size_t i) {
+        const string ns = _tasks[i].ns;
+        Client::Transaction txn(DB_SERIALIZABLE);
+
+        scoped_ptr<IndexDetails::Builder> loader;
+        {
+            Lock::DBWrite lk(ns);
+            Client::Context ctx(ns);
+            NamespaceDetails *d = nsdetails(ns);
+            massert(16889, str::stream() << "collection " << ns << " to load was not created", d != NULL);
+            verify(d->nIndexes() == 1 && !d->isCapped() && !d->isPartitioned());
+            loader.reset(new IndexDetails::Builder(d->getPKIndex()));
+        }
+
+        // The loader is filled and closed without any locks, the dictionary
+        // is empty and only this transaction can see it.
+        setState(i, "loading");
+        auto_ptr<DBClientCursor> c;
+        {
+            SourceLock lk(_connMutex, source.shared);
+            c = source.conn->query(ns, Query(), 0, 0, NULL, QueryOption_NoCursorTimeout | QueryOption_SlaveOk);
+        }
+        massert(16890, str::stream() << "query for " << ns << " failed", c.get() != NULL);
+        try {
+            while (true) {
+                {
+                    SourceLock lk(_connMutex, source.shared);
+                    if (!c->more()) {
+                        break;
+                    }
+                }
+                long long docs = 0;
+                long long bytes = 0;
+                while (c->moreInCurrentBatch()) {
+                    const BSONObj obj = c->nextSafe();
+                    const BSONElement id = obj["_id"];
+                    massert(16891, str::stream() << "document in " << ns << " has no _id", id.ok());
+                    loader->insertPair(id.wrap(""), NULL, obj);
+                    docs++;
+                    bytes += obj.objsize();
+                }
+                addLoaded(i, docs, bytes);
+                killCurrentOp.checkForInterrupt(false); // uasserts if we should stop
+            }
+        }
+        catch (...) {
+            // the cursor's destructor may talk to the server
+            SourceLock lk(_connMutex, source.shared);
+            c.reset();
+            throw;
+        }
+        {
+            SourceLock lk(_connMutex, source.shared);
+            c.reset();
+        }
+        loader->done();
+        loader.reset();
+
+        if (_buildIndexes) {
+            vector<BSONObj> infos;
+            {
+                SourceLock lk(_connMutex, source.shared);
+                const string indexesNs = nsToDatabase(ns) + ".system.indexes";
+                auto_ptr<DBClientCursor> ic = source.conn->query(indexesNs, BSON("ns" << ns << "name" << NE << "_id_"),
+                                                                 0, 0, NULL, QueryOption_SlaveOk);
+                massert(16892, str::stream() << "query for " << ns << " indexes failed", ic.get() != NULL);
+                while (ic->more()) {
+                    // for now, skip the "v" field, as the cloner does
+                    infos.push_back(ic->nextSafe().removeField("v").getOwned());
+                }
+            }
+            if (!infos.empty()) {
+                setState(i, "building indexes");
+                Lock::DBWrite lk(ns);
+                Client::Context ctx(ns);
+                nsdetails(ns)->createIndexes(infos);
+
+                // Record the new indexes in the catalog, as createIndexes does.
+                const string indexesNs = nsToDatabase(ns) + ".system.indexes";
+                NamespaceDetails *indexesd = nsdetails_maybe_create(indexesNs);
+                NamespaceDetailsTransient *indexesnsdt = &NamespaceDetailsTransient::get(indexesNs);
+                for (vector<BSONObj>::iterator it = infos.begin(); it != infos.end(); ++it) {
+                    insertOneObject(indexesd, indexesnsdt, *it);
+                }
+            }
+        }
+
+        txn.commit(0);
+    }
+
+    void ParallelCloner::appendProgressLocked(BSONObjBuilder &b) const {
+        b.append("threads", _nThreads);
+        b.append("sharedConnection", _shared);
+        const time_t now = time(0);
+        BSONArrayBuilder ab(b.subarrayStart("collections"));
+        for (std::vector<Task>::const_iterator it = _tasks.begin(); it != _tasks.end(); ++it) {
+            BSONObjBuilder tb(ab.subobjStart());
+            tb.append("ns", it->ns);
+            tb.append("state", it->state);
+            tb.appendNumber("docs", it->docs);
+            tb.appendNumber("bytes", it->bytes);
+            if (it->start != 0) {
+                tb.appendNumber("secs", (long long) ((it->end != 0 ? it->end : now) - it->start));
+            }
+            tb.done();
+        }
+        ab.done();
+    }
+
+    void ParallelCloner::appendProgress(BSONObjBuilder &b) {
+        boost::unique_lock<boost::mutex> lk(_progressMutex);
+        if (_current != NULL) {
+            boost::unique_lock<boost::mutex> lk2(_current->_mutex);
+            _current->appendProgressLocked(b);
+        }
+        else if (!_lastProgress.isEmpty()) {
+            b.appendElements(_lastProgress);
+        }
+    }
+
+} // namespace mongo
@@ -0,0 +1,131 @@
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class DBClientConnection;
+    class RemoteTransaction;
+
+    /**
+     * Clones collections for initial sync on several threads, each loading
+     * one collection at a time into its empty primary key dictionary with the
+     * ydb's bulk loader, then building the collection's secondary indexes
+     * with the loader in a single scan (NamespaceDetails::createIndexes).
+     *
+     * The caller creates every collection it add()s, empty, and commits that
+     * before run(). Workers each use their own transaction per collection
+     * and take the database write lock only to look up the collection and to
+     * create its indexes, so the caller must hold no locks during run().
+     *
+     * Every worker must read the same data as the caller's own snapshot of
+     * the source, which the rest of initial sync (the replInfo and oplog it
+     * copies) is consistent with. connect() opens one connection per worker,
+     * each in its own mvcc transaction, and keeps them only if each sees
+     * exactly the GTIDs in the oplog that the caller's does, from minLive
+     * on: a write commits along with its oplog entry, so the same committed
+     * GTIDs mean the same data. If the source
+     * is busy enough that the snapshots keep differing, the workers share
+     * the caller's connection instead, one getMore at a time, and only the
+     * local loading and index building runs in parallel.
+     */
+    class ParallelCloner : boost::noncopyable {
+    public:
+        ParallelCloner(const string &host, int nThreads, bool buildIndexes);
+        ~ParallelCloner();
+
+        // @return true if the collection ns, with the given options from
+        // system.namespaces, is a plain collection keyed by _id that can be
+        // bulk loaded. Everything else is left to the serial Cloner.
+        static bool mayLoad(const StringData &ns, const BSONObj &options);
+
+        void add(const string &ns);
+        size_t size() const { return _tasks.size(); }
+
+        // Sets up the workers' connections. reference is the caller's
+        // connection, which must already be in an mvcc transaction and stay
+        // open until run() returns.
+        void connect(shared_ptr<DBClientConnection> reference);
+
+        // Clones every collection added, returns once all are done. Rethrows
+        // the first error any worker hit.
+        void run();
+
+        // Per collection progress of the last parallel initial sync, for
+        // replSetGetStatus. Does nothing if there hasn't been one.
+        static void appendProgress(BSONObjBuilder &b);
+
+        static const int ConnectAttempts = 3;
+
+    private:
+        struct Task {
+            Task(const string &n) : ns(n), state("pending"), docs(0), bytes(0), start(0), end(0) {}
+            string ns;
+            const char *state;
+            long long docs;
+            long long bytes;
+            time_t start;
+            time_t end;
+        };
+
+        struct Source {
+            Source() : shared(false) {}
+            shared_ptr<DBClientConnection> conn;
+            shared_ptr<RemoteTransaction> txn;
+            // true if this is the caller's connection, which the workers
+            // take turns on under _connMutex
+            bool shared;
+        };
+
+        bool openSnapshots(shared_ptr<DBClientConnection> reference);
+        bool nextTask(size_t *i);
+        void workerThread(int id);
+        void cloneCollection(Source &source, size_t i);
+        void setState(size_t i, const char *state);
+        void addLoaded(size_t i, long long docs, long long bytes);
+        void setError(const string &msg);
+        // called with _mutex held
+        void appendProgressLocked(BSONObjBuilder &b) const;
+
+        const string _host;
+        const int _nThreads;
+        const bool _buildIndexes;
+        std::vector<Source> _sources;
+        boost::mutex _connMutex;
+        bool _shared;
+
+        // guards _tasks' progress fields, _queue and the error
+        boost::mutex _mutex;
+        std::vector<Task> _tasks;
+        std::deque<size_t> _queue;
+        bool _failed;
+        string _errorMsg;
+
+        // the cloner in use, if any, otherwise what the last one reported
+        static boost::mutex _progressMutex;
+        static ParallelCloner *_current;
+        static BSONObj _lastProgress;
+    };
+
+} // namespace mongo
@@ -0,0 +1,452 @@
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/physical_sync.h"
+
+#include <fcntl.h>
+#include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/scoped_array.hpp>
+
+#include "mongo/db/client.h"
+#include "mongo/db/cmdline.h"
+#include "mongo/db/commands.h"
+#include "mongo/db/namespace_details.h"
+#include "mongo/db/oplogreader.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/security_common.h"
+#include "mongo/db/storage/env.h"
+#include "mongo/util/background.h"
+#include "mongo/util/file.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    extern string dbpath;
+
+    namespace {
+
+        // Most bytes one _physicalSyncRead returns, well under the largest
+        // BSON object.
+        const int ChunkSize = 8 * 1024 * 1024;
+
+        // A session the destination stops using is ended after this long,
+        // so an interrupted sync can't hold off checkpoints for good.
+        const int IdleSessionSecs = 10 * 60;
+
+        const char *EnvironmentFile = "tokudb.environment";
+        const char *StagingDir = "_physicalSync";
+
+        bool isLogFile(const string &name) {
+            return name.find(".tokulog") != string::npos;
+        }
+
+        string logDirectory() {
+            return cmdLine.logDir.empty() ? dbpath : cmdLine.logDir;
+        }
+
+        // The regular files in dir that are recovery logs, if logs is true,
+        // or that otherwise belong to the storage environment. The dbpath
+        // lock, the ydb's own directory locks and any loader temp
+        // directories stay behind.
+        void listFiles(const string &dir, bool logs, vector<string> &names) {
+            boost::filesystem::directory_iterator end;
+            for (boost::filesystem::directory_iterator it(dir); it != end; ++it) {
+                const boost::filesystem::path p = *it;
+                if (!boost::filesystem::is_regular(p)) {
+                    continue;
+                }
+                const string name = p.leaf();
+                if (isLogFile(name) != logs) {
+                    continue;
+                }
+                if (name == "mongod.lock" || str::startsWith(name, "__tokudb_lock")) {
+                    continue;
+                }
+                names.push_back(name);
+            }
+        }
+
+        // A source file, opened when its session lists it so that a
+        // dictionary dropped during the copy can still be read.
+        class SourceFile : boost::noncopyable {
+        public:
+            SourceFile(const string &path) : _fd(::open(path.c_str(), O_RDONLY)) {
+                uassert(16894, str::stream() << "couldn't open " << path << ' ' << errnoWithDescription(),
+                        _fd >= 0);
+            }
+            ~SourceFile() {
+                ::close(_fd);
+            }
+            // @return the number of bytes read, 0 at the end of the file
+            int read(long long offset, char *buf, int len) {
+                const ssize_t n = ::pread(_fd, buf, len, offset);
+                uassert(16895, str::stream() << "read failed " << errnoWithDescription(), n >= 0);
+                return n;
+            }
+        private:
+            const int _fd;
+        };
+
+        class SyncSessions : boost::noncopyable {
+        public:
+            SyncSessions() : _mutex("physicalSyncSessions"), _nextId(1) {}
+
+            // Holds off checkpoints and lists the data files as of the last
+            // one, which the session keeps open.
+            void begin(BSONObjBuilder &result) {
+                storage::hold_checkpoints();
+                try {
+                    shared_ptr<Session> s(new Session());
+                    BSONArrayBuilder ab(result.subarrayStart("files"));
+                    openFiles(dbpath, false, *s, ab);
+                    ab.done();
+
+                    SimpleMutex::scoped_lock lk(_mutex);
+                    const long long id = _nextId++;
+                    _sessions[id] = s;
+                    result.append("session", id);
+                    log() << "replSet physical initial sync session " << id << " began, "
+                          << s->files.size() << " data files" << rsLog;
+                }
+                catch (...) {
+                    storage::release_checkpoints();
+                    throw;
+                }
+            }
+
+            // Lists the logs as of now, once the destination has copied the
+            // data files.
+            bool logs(long long id, BSONObjBuilder &result, string &errmsg) {
+                shared_ptr<Session> s = get(id);
+                if (!s) {
+                    errmsg = str::stream() << "no physical sync session " << id;
+                    return false;
+                }
+                Session logs;
+                BSONArrayBuilder ab(result.subarrayStart("files"));
+                openFiles(logDirectory(), true, logs, ab);
+                ab.done();
+
+                SimpleMutex::scoped_lock lk(_mutex);
+                s->files.insert(logs.files.begin(), logs.files.end());
+                return true;
+            }
+
+            bool read(long long id, const string &name, long long offset, BSONObjBuilder &result, string &errmsg) {
+                shared_ptr<SourceFile> f;
+                {
+                    SimpleMutex::scoped_lock lk(_mutex);
+                    SessionMap::iterator it = _sessions.find(id);
+                    if (it == _sessions.end()) {
+                        errmsg = str::stream() << "no physical sync session " << id;
+                        return false;
+                    }
+                    it->second->lastUsed = time(0);
+                    FileMap::iterator fit = it->second->files.find(name);
+                    if (fit == it->second->files.end()) {
+                        errmsg = str::stream() << name << " is not part of physical sync session " << id;
+                        return false;
+                    }
+                    f = fit->second;
+                }
+                boost::scoped_array<char> buf(new char[ChunkSize]);
+                const int n = f->read(offset, buf.get(), ChunkSize);
+                result.appendBinData("data", n, BinDataGeneral, buf.get());
+                result.appendBool("eof", n < ChunkSize);
+                return true;
+            }
+
+            bool end(long long id) {
+                {
+                    SimpleMutex::scoped_lock lk(_mutex);
+                    if (_sessions.erase(id) == 0) {
+                        return false;
+                    }
+                }
+                storage::release_checkpoints();
+                log() << "replSet physical initial sync session " << id << " ended" << rsLog;
+                return true;
+            }
+
+            void expireIdle() {
+                vector<long long> idle;
+                {
+                    SimpleMutex::scoped_lock lk(_mutex);
+                    const time_t now = time(0);
+                    for (SessionMap::const_iterator it = _sessions.begin(); it != _sessions.end(); ++it) {
+                        if (now - it->second->lastUsed > IdleSessionSecs) {
+                            idle.push_back(it->first);
+                        }
+                    }
+                }
+                for (vector<long long>::const_iterator it = idle.begin(); it != idle.end(); ++it) {
+                    if (end(*it)) {
+                        log() << "replSet physical initial sync session " << *it << " was idle for over "
+                              << IdleSessionSecs << " seconds" << rsLog;
+                    }
+                }
+            }
+
+        private:
+            typedef map<string, shared_ptr<SourceFile> > FileMap;
+            struct Session {
+                Session() : lastUsed(time(0)) {}
+                FileMap files;
+                time_t lastUsed;
+            };
+            typedef map<long long, shared_ptr<Session> > SessionMap;
+
+            shared_ptr<Session> get(long long id) {
+                SimpleMutex::scoped_lock lk(_mutex);
+                SessionMap::iterator it = _sessions.find(id);
+                if (it == _sessions.end()) {
+                    return shared_ptr<Session>();
+                }
+                it->second->lastUsed = time(0);
+                return it->second;
+            }
+
+            static void openFiles(const string &dir, bool logs, Session &s, BSONArrayBuilder &ab) {
+                vector<string> names;
+                listFiles(dir, logs, names);
+                for (vector<string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+                    const string path = (boost::filesystem::path(dir) / *it).string();
+                    s.files[*it].reset(new SourceFile(path));
+                    ab.append(*it);
+                }
+            }
+
+            SimpleMutex _mutex;
+            SessionMap _sessions;
+            long long _nextId;
+        } syncSessions;
+
+        class IdleSessionExpirer : public PeriodicTask {
+        public:
+            virtual string taskName() const { return "PhysicalSyncSessionExpirer"; }
+            virtual void taskDoWork() { syncSessions.expireIdle(); }
+        } idleSessionExpirer;
+
+        class CmdPhysicalSyncBegin : public ReplSetCommand {
+        public:
+            CmdPhysicalSyncBegin() : ReplSetCommand("_physicalSyncBegin") { }
+            virtual bool run(const string&, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+                if (!check(errmsg, result)) {
+                    return false;
+                }
+                if (!theReplSet->isPrimary() && !theReplSet->isSecondary()) {
+                    errmsg = "only a primary or secondary can be physically synced from";
+                    return false;
+                }
+                syncSessions.begin(result);
+                return true;
+            }
+        } cmdPhysicalSyncBegin;
+
+        class CmdPhysicalSyncLogs : public ReplSetCommand {
+        public:
+            CmdPhysicalSyncLogs() : ReplSetCommand("_physicalSyncLogs") { }
+            virtual bool run(const string&, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+                if (!check(errmsg, result)) {
+                    return false;
+                }
+                return syncSessions.logs(cmdObj.firstElement().numberLong(), result, errmsg);
+            }
+        } cmdPhysicalSyncLogs;
+
+        class CmdPhysicalSyncRead : public ReplSetCommand {
+        public:
+            CmdPhysicalSyncRead() : ReplSetCommand("_physicalSyncRead") { }
+            virtual bool run(const string&, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+                if (!check(errmsg, result)) {
+                    return false;
+                }
+                return syncSessions.read(cmdObj.firstElement().numberLong(), cmdObj["file"].str(),
+                                         cmdObj["offset"].numberLong(), result, errmsg);
+            }
+        } cmdPhysicalSyncRead;
+
+        class CmdPhysicalSyncEnd : public ReplSetCommand {
+        public:
+            CmdPhysicalSyncEnd() : ReplSetCommand("_physicalSyncEnd") { }
+            virtual bool run(const string&, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+                if (!check(errmsg, result)) {
+                    return false;
+                }
+                const long long id = cmdObj.firstElement().numberLong();
+                if (!syncSessions.end(id)) {
+                    errmsg = str::stream() << "no physical sync session " << id;
+                    return false;
+                }
+                return true;
+            }
+        } cmdPhysicalSyncEnd;
+
+        BSONObj runSyncCommand(DBClientConnection *conn, const BSONObj &cmd) {
+            BSONObj res;
+            uassert(16896, str::stream() << cmd.firstElementFieldName() << " failed: " << res,
+                    conn->runCommand("admin", cmd, res));
+            return res;
+        }
+
+        string stagingDirectory(const string &dir) {
+            return (boost::filesystem::path(dir) / StagingDir).string();
+        }
+
+        // Copies every file named in files into dir, fsyncing each.
+        void copyFiles(DBClientConnection *conn, long long session, const BSONElement &files, const string &dir) {
+            boost::filesystem::create_directories(dir);
+            for (BSONObjIterator it(files.Obj()); it.more(); ) {
+                const string name = it.next().str();
+                // Names come from the source, keep them inside dir.
+                uassert(16897, str::stream() << "bad file name from source: " << name,
+                        !name.empty() && name.find('/') == string::npos && name != "." && name != "..");
+                const string path = (boost::filesystem::path(dir) / name).string();
+                File f;
+                f.open(path.c_str());
+                uassert(16898, str::stream() << "couldn't create " << path, f.is_open());
+                long long offset = 0;
+                while (true) {
+                    const BSONObj res = runSyncCommand(conn, BSON("_physicalSyncRead" << session <<
+                                                                  "file" << name <<
+                                                                  "offset" << offset));
+                    int len;
+                    const char *data = res["data"].binData(len);
+                    if (len > 0) {
+                        f.write(offset, data, len);
+                        uassert(16899, str::stream() << "couldn't write " << path, !f.bad());
+                        offset += len;
+                    }
+                    if (res["eof"].trueValue()) {
+                        break;
+                    }
+                    uassert(16902, "shutting down", !inShutdown());
+                }
+                f.fsync();
+                LOG(1) << "replSet physical initial sync copied " << name << ", " << offset << " bytes" << rsLog;
+            }
+        }
+
+        // Moves the staged files of dir into it, recovery logs or the rest.
+        // The environment file goes last: until it is in place, startup
+        // sees no environment and syncs again over whatever got moved.
+        void installFiles(const string &dir, bool logs) {
+            const string staging = stagingDirectory(dir);
+            vector<string> names;
+            listFiles(staging, logs, names);
+            bool haveEnvironment = false;
+            for (vector<string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+                if (*it == EnvironmentFile) {
+                    haveEnvironment = true;
+                    continue;
+                }
+                boost::filesystem::rename(boost::filesystem::path(staging) / *it, boost::filesystem::path(dir) / *it);
+            }
+            if (haveEnvironment) {
+                boost::filesystem::rename(boost::filesystem::path(staging) / EnvironmentFile,
+                                          boost::filesystem::path(dir) / EnvironmentFile);
+            }
+        }
+
+        void removeStaging() {
+            boost::filesystem::remove_all(stagingDirectory(dbpath));
+            boost::filesystem::remove_all(stagingDirectory(logDirectory()));
+        }
+
+        void copyFrom(const string &host) {
+            // Authenticating from local.system.users would need the storage
+            // engine, which hasn't started.
+            uassert(16900, "--physicalSyncFrom needs --keyFile when auth is on",
+                    noauth || !internalSecurity.pwd.empty());
+            replLocalAuth();
+            OplogReader r(false);
+            uassert(16901, str::stream() << "couldn't connect to " << host, r.connect(host));
+            DBClientConnection *conn = r.conn();
+
+            removeStaging();
+            const BSONObj begin = runSyncCommand(conn, BSON("_physicalSyncBegin" << 1));
+            const long long session = begin["session"].numberLong();
+            try {
+                copyFiles(conn, session, begin["files"], stagingDirectory(dbpath));
+                const BSONObj logs = runSyncCommand(conn, BSON("_physicalSyncLogs" << session));
+                copyFiles(conn, session, logs["files"], stagingDirectory(logDirectory()));
+            }
+            catch (...) {
+                BSONObj res;
+                conn->runCommand("admin", BSON("_physicalSyncEnd" << session), res);
+                throw;
+            }
+            runSyncCommand(conn, BSON("_physicalSyncEnd" << session));
+
+            installFiles(logDirectory(), true);
+            installFiles(dbpath, false);
+            removeStaging();
+        }
+
+    } // namespace
+
+    bool physicalSyncCopy() {
+        const string &host = cmdLine.physicalSyncFrom;
+        if (host.empty()) {
+            return false;
+        }
+        if (boost::filesystem::exists(boost::filesystem::path(dbpath) / EnvironmentFile)) {
+            LOG(1) << "replSet dbpath already has data, not syncing physically from " << host << rsLog;
+            return false;
+        }
+
+        for (int attempt = 1; attempt <= 3; attempt++) {
+            log() << "replSet physical initial sync from " << host << ", attempt " << attempt << rsLog;
+            try {
+                copyFrom(host);
+                log() << "replSet physical initial sync copied the files of " << host
+                      << ", recovering them" << rsLog;
+                return true;
+            }
+            catch (const std::exception &e) {
+                log() << "replSet physical initial sync from " << host << " failed: " << e.what() << rsLog;
+                try {
+                    removeStaging();
+                }
+                catch (const std::exception &e2) {
+                    log() << "replSet couldn't remove the physical initial sync staging directory: "
+                          << e2.what() << rsLog;
+                }
+            }
+            sleepsecs(5);
+        }
+        log() << "replSet giving up on physical initial sync from " << host
+              << ", will clone the data instead" << rsLog;
+        return false;
+    }
+
+    void physicalSyncCleanup() {
+        // local.me identifies the source for getLastError w:2+, make it
+        // generate our own on the first handshake.
+        Lock::GlobalWrite lk;
+        Client::Context ctx("local.me");
+        Client::Transaction txn(DB_SERIALIZABLE);
+        NamespaceDetails *d = nsdetails("local.me");
+        if (d != NULL) {
+            d->empty();
+        }
+        txn.commit();
+    }
+
+} // namespace mongo
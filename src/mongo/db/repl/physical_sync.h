@@ -0,0 +1,51 @@
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+namespace mongo {
+
+    /**
+     * Physical initial sync: a member started with --physicalSyncFrom and an
+     * empty dbpath copies the source member's dictionary files and recovery
+     * logs before the storage engine starts, instead of cloning its data
+     * collection by collection.
+     *
+     * The source holds off checkpoints for the duration of the copy
+     * (_physicalSyncBegin to _physicalSyncEnd), so each dictionary file
+     * keeps every block of its last checkpoint while new blocks are written
+     * elsewhere, and the logs since that checkpoint are not trimmed. The
+     * data files are copied first, then the logs, which therefore cover
+     * everything written to the data files after the checkpoint. Recovery
+     * on the new member then rolls forward from that checkpoint to the end
+     * of the copied logs, exactly as after a crash of the source, and leaves
+     * the oplog and the data consistent with each other. Replica set startup
+     * finds the oplog and catches up from its last GTID, as it does after
+     * any restart (see GTIDManager::resetAfterInitialSync).
+     */
+
+    // Copies cmdLine.physicalSyncFrom's files into dbpath (and logDir) if
+    // no storage environment exists there yet. Call after the dbpath lock is
+    // taken and before storage::startup(). Falls back to the logical
+    // initial sync, by leaving dbpath empty, if the copy keeps failing.
+    // @return true if the files were copied
+    bool physicalSyncCopy();
+
+    // After storage::startup(), forgets the source member's identity that
+    // came along with the copied local database.
+    void physicalSyncCleanup();
+
+} // namespace mongo
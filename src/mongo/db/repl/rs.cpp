@@ -1022,7 +1022,6 @@ namespace mongo {
 
     void ReplSetImpl::purgeOplogThread() {
         _replOplogPurgeRunning = true;
-        GTID lastTimeRead;
         Client::initThread("purgeOplog");
         while (_replBackgroundShouldRun) {
             const uint64_t expireMillis = expireOplogMilliseconds();
@@ -1030,47 +1029,20 @@ namespace mongo {
                 // Allow an additional slack period of one hour.
                 const uint64_t ageAllowed = expireMillis + (3600 * 1000);
                 const uint64_t minTime = curTimeMillis64() - ageAllowed;
-                // now get the minimum entry in the oplog, if it has timestamp
-                // less than minTime, delete it, otherwise, 
+                // The oplog gets a new partition every hour, or every day
+                // once it's kept for days, and the expired partitions are
+                // dropped whole. Then sleep until the next of either is due.
+                const uint64_t partitionMillis = (cmdLine.expireOplogDays > 0 ? 24 : 1) * 3600 * 1000;
                 uint64_t millisToWait = 0;
-                // do a possible deletion from the oplog, if we find an entry
-                // old enough. If not, we will sleep
                 try {
-                    BSONObj result;
-                    bool found = false;
-
-                    Client::ReadContext ctx(rsoplog);
-                    Client::Transaction transaction(DB_SERIALIZABLE);
-                    NamespaceDetails *d = nsdetails(rsoplog);
-                    if (d != NULL) {
-                        if (lastTimeRead.isInitial()) {
-                            found = d->findOne(BSONObj(), result);
-                        }
-                        else {
-                            BSONObjBuilder q;
-                            addGTIDToBSON("$gt", lastTimeRead, q);
-                            BSONObjBuilder query;
-                            query.append("_id", q.done());
-                            found = d->findOne(query.done(), result, false);
-                        }
+                    millisToWait = rotateOplog(partitionMillis);
+                    uint64_t nextExpiry = 0;
+                    while (purgeOplogPartition(minTime, &nextExpiry)) {
+                        LOG(1) << "dropped an expired oplog partition" << rsLog;
                     }
-                    if (found) {
-                        lastTimeRead = getGTIDFromBSON("_id", result);                    
-                        uint64_t ts = result["ts"]._numberLong();
-                        if (ts < minTime) {
-                            // delete the row "result"
-                            purgeEntryFromOplog(result);
-                        }
-                        else {
-                            millisToWait = ts - minTime;
-                        }
-                    }
-                    // there is no data, just sleep for now
-                    // this should be rare
-                    else {
-                        millisToWait = 2000;
+                    if (nextExpiry > 0) {
+                        millisToWait = std::min(millisToWait, nextExpiry - minTime);
                     }
-                    transaction.commit(DB_TXN_NOSYNC);
                 }
                 catch (...) {
                     log() << "exception cought in purgeOplog thread: " << rsLog;
@@ -54,6 +54,7 @@ namespace mongo {
     class DBClientConnection;
     class ReplSetImpl;
     class OplogReader;
+    class ParallelCloner;
     extern bool replSet; // true if using repl sets
     extern class ReplSet *theReplSet; // null until initialized
     extern Tee *rsLog;
@@ -527,7 +528,7 @@ namespace mongo {
         friend class Consensus;
 
     private:
-        bool _syncDoInitialSync_clone( const char *master, const list<string>& dbs, shared_ptr<DBClientConnection> conn);
+        bool _syncDoInitialSync_clone( const char *master, const list<string>& dbs, shared_ptr<DBClientConnection> conn, ParallelCloner *parallel);
         void _fillGaps(OplogReader* r); // helper function for initial sync
         void _applyMissingOpsDuringInitialSync(); // helper function for initial sync
         bool _syncDoInitialSync();
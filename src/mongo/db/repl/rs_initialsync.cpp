@@ -17,7 +17,9 @@
 
 #include "mongo/pch.h"
 
+#include "mongo/client/dbclientcursor.h"
 #include "mongo/client/remote_transaction.h"
+#include "mongo/db/cloner.h"
 #include "mongo/db/client.h"
 #include "mongo/db/cursor.h"
 #include "mongo/db/instance.h"
@@ -27,6 +29,7 @@
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/repl.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/parallel_cloner.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_optime.h"
 #include "mongo/db/repl/rs_sync.h"
@@ -85,12 +88,14 @@ namespace mongo {
         const char *master, 
         const std::string& db,
         shared_ptr<DBClientConnection> conn,
-        bool syncIndexes
+        bool syncIndexes,
+        const set<string>& collsToIgnore
         ) 
     {
         CloneOptions options;
 
         options.fromDB = db;
+        options.collsToIgnore = collsToIgnore;
 
         options.logForRepl = false;
         options.slaveOk = true;
@@ -105,10 +110,45 @@ namespace mongo {
     }
 
 
+    static void cloneReplInfo(shared_ptr<DBClientConnection> conn) {
+        // at this point, we have copied all of the data from the 
+        // remote machine. Now we need to copy the replication information
+        // on the remote machine's local database, we need to copy
+        // the entire (small) replInfo dictionary, and the necessary portion
+        // of the oplog
+
+        // first copy the replInfo, as we will use its information
+        // to determine  how much of the opLog to copy
+        BSONObj q;
+        cloneCollectionData(conn,
+                            rsReplInfo,
+                            q,
+                            true, //copyIndexes
+                            false //logForRepl
+                            );
+
+        // copy entire oplog (probably overkill)
+        cloneCollectionData(conn,
+                            rsoplog,
+                            q,
+                            true, //copyIndexes
+                            false //logForRepl
+                            );
+
+        // copy entire oplog.refs (probably overkill)
+        cloneCollectionData(conn,
+                            rsOplogRefs,
+                            q,
+                            true, //copyIndexes
+                            false //logForRepl
+                            );
+    }
+
     bool ReplSetImpl::_syncDoInitialSync_clone( 
         const char *master, 
         const list<string>& dbs,
-        shared_ptr<DBClientConnection> conn
+        shared_ptr<DBClientConnection> conn,
+        ParallelCloner *parallel
         ) 
     {
         verify(Lock::isW());
@@ -121,7 +161,29 @@ namespace mongo {
             sethbmsg(str::stream() << "initial sync cloning db: " << db, 0);
 
             Client::Context ctx(db);
-            if (!clone(master, db, conn, _buildIndexes)) {
+
+            // Create the collections the parallel cloner will load, empty,
+            // and leave everything else to the serial cloner.
+            set<string> loaded;
+            if (parallel != NULL) {
+                const string namespacesNs = db + ".system.namespaces";
+                auto_ptr<DBClientCursor> c = conn->query(namespacesNs, BSONObj(), 0, 0, NULL, QueryOption_SlaveOk);
+                isyncassert(str::stream() << "query failed " << namespacesNs, c.get() != NULL);
+                while (c->more()) {
+                    const BSONObj collection = c->nextSafe();
+                    const string ns = collection["name"].String();
+                    const BSONObj options = collection.getObjectField("options");
+                    if (ParallelCloner::mayLoad(ns, options)) {
+                        string err;
+                        const bool created = userCreateNS(ns, options, err, false);
+                        isyncassert(str::stream() << "could not create " << ns << ": " << err, created);
+                        parallel->add(ns);
+                        loaded.insert(ns);
+                    }
+                }
+            }
+
+            if (!clone(master, db, conn, _buildIndexes, loaded)) {
                 sethbmsg(str::stream() << "initial sync error clone of " << db << " failed sleeping 5 minutes", 0);
                 return false;
             }
@@ -441,6 +503,14 @@ namespace mongo {
 
                 list<string> dbs = conn->getDatabaseNames();
 
+                // With --initialSyncThreads, plain collections are bulk loaded
+                // by the parallel cloner after the serial clone below has
+                // created them and copied everything else.
+                scoped_ptr<ParallelCloner> parallel;
+                if (cmdLine.initialSyncThreads > 1) {
+                    parallel.reset(new ParallelCloner(sourceHostname, cmdLine.initialSyncThreads, _buildIndexes));
+                }
+
                 //
                 // Not sure if it is necessary to have a separate fileOps 
                 // transaction and clone transaction. The cloneTransaction
@@ -451,7 +521,7 @@ namespace mongo {
                 {
                     Lock::GlobalWrite lk;
                     Client::Transaction cloneTransaction(DB_SERIALIZABLE);
-                    bool ret = _syncDoInitialSync_clone(sourceHostname.c_str(), dbs, conn);
+                    bool ret = _syncDoInitialSync_clone(sourceHostname.c_str(), dbs, conn, parallel.get());
 
                     if (!ret) {
                         veto(source->fullName(), 600);
@@ -459,40 +529,23 @@ namespace mongo {
                         return false;
                     }
 
-                    // at this point, we have copied all of the data from the 
-                    // remote machine. Now we need to copy the replication information
-                    // on the remote machine's local database, we need to copy
-                    // the entire (small) replInfo dictionary, and the necessary portion
-                    // of the oplog
-
-                    // first copy the replInfo, as we will use its information
-                    // to determine  how much of the opLog to copy
-                    BSONObj q;
-                    cloneCollectionData(conn,
-                                        rsReplInfo,
-                                        q,
-                                        true, //copyIndexes
-                                        false //logForRepl
-                                        );
-
-                    // copy entire oplog (probably overkill)
-                    cloneCollectionData(conn,
-                                        rsoplog,
-                                        q,
-                                        true, //copyIndexes
-                                        false //logForRepl
-                                        );
-
-                    // copy entire oplog.refs (probably overkill)
-                    cloneCollectionData(conn,
-                                        rsOplogRefs,
-                                        q,
-                                        true, //copyIndexes
-                                        false //logForRepl
-                                        );
+                    if (!parallel) {
+                        cloneReplInfo(conn);
+                    }
                     cloneTransaction.commit(0);
                 }
 
+                if (parallel) {
+                    sethbmsg(str::stream() << "initial sync loading " << parallel->size() << " collections", 0);
+                    parallel->connect(conn);
+                    parallel->run();
+
+                    Lock::GlobalWrite lk;
+                    Client::Transaction replInfoTransaction(DB_SERIALIZABLE);
+                    cloneReplInfo(conn);
+                    replInfoTransaction.commit(0);
+                }
+
                 bool ok = rtxn.commit();
                 verify(ok);  // absolutely no reason this should fail, it was read only
                 // data should now be consistent
@@ -21,13 +21,156 @@
 
 #include "pch.h"
 #include "scanandorder.h"
+
+#include <fstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include "mongo/db/cmdline.h"
 #include "mongo/db/matcher.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/paths.h"
 
 namespace mongo {
 
     const unsigned ScanAndOrder::MaxScanAndOrderBytes = 32 * 1024 * 1024;
 
+    static AtomicWord<unsigned long long> nextSortRunId;
+
+    static string newSortRunPath() {
+        const string &dir = cmdLine.tmpDir.empty() ? dbpath : cmdLine.tmpDir;
+        const string name = str::stream() << "_sort." << getpid() << "."
+                                          << nextSortRunId.fetchAndAdd(1);
+        return (boost::filesystem::path(dir) / name).string();
+    }
+
+    /**
+     * A file of (key, object) pairs in sort order. Each pair is just the two
+     * BSON objects back to back. The file is removed when the run goes away.
+     */
+    class ScanAndOrder::SortedRun : boost::noncopyable {
+    public:
+        SortedRun() : _path(newSortRunPath()) {
+            _out.open(_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            uassert(16871, str::stream() << "could not create sort run file " << _path,
+                    _out.good());
+        }
+        ~SortedRun() {
+            if (_out.is_open()) {
+                _out.close();
+            }
+            try {
+                boost::filesystem::remove(_path);
+            }
+            catch (std::exception &e) {
+                warning() << "could not remove sort run file " << _path << ": " << e.what() << endl;
+            }
+        }
+        void append(const BSONObj &key, const BSONObj &obj) {
+            _out.write(key.objdata(), key.objsize());
+            _out.write(obj.objdata(), obj.objsize());
+        }
+        void finish() {
+            _out.close();
+            uassert(16872, str::stream() << "error writing sort run file " << _path,
+                    !_out.fail());
+        }
+        const string &path() const { return _path; }
+    private:
+        const string _path;
+        std::ofstream _out;
+    };
+
+    /** One sorted input of the merge in ScanAndOrderCursor. */
+    class ScanAndOrder::Source : boost::noncopyable {
+    public:
+        virtual ~Source() {}
+        virtual bool ok() const = 0;
+        virtual const BSONObj &key() const = 0;
+        virtual const BSONObj &obj() const = 0;
+        virtual void advance() = 0;
+    };
+
+    class ScanAndOrder::RunSource : public ScanAndOrder::Source {
+    public:
+        RunSource(const SortedRun &run) : _path(run.path()), _ok(true) {
+            _in.open(_path.c_str(), std::ios::in | std::ios::binary);
+            uassert(16873, str::stream() << "could not open sort run file " << _path,
+                    _in.good());
+            advance();
+        }
+        bool ok() const { return _ok; }
+        const BSONObj &key() const { return _key; }
+        const BSONObj &obj() const { return _obj; }
+        void advance() {
+            _ok = read(_key) && read(_obj);
+        }
+    private:
+        bool read(BSONObj &o) {
+            int size;
+            _in.read(reinterpret_cast<char *>(&size), sizeof size);
+            if (_in.gcount() == 0 && _in.eof()) {
+                return false;
+            }
+            massert(16874, str::stream() << "corrupt sort run file " << _path,
+                    _in.gcount() == (std::streamsize) sizeof size &&
+                    size >= 5 && size <= BSONObjMaxInternalSize);
+            _buf.reset(size);
+            _buf.appendNum(size);
+            _in.read(_buf.grow(size - sizeof size), size - sizeof size);
+            massert(16875, str::stream() << "error reading sort run file " << _path,
+                    _in.gcount() == (std::streamsize) (size - sizeof size));
+            o = BSONObj(_buf.buf()).getOwned();
+            return true;
+        }
+        const string _path;
+        std::ifstream _in;
+        BufBuilder _buf;
+        BSONObj _key;
+        BSONObj _obj;
+        bool _ok;
+    };
+
+    class ScanAndOrder::MemorySource : public ScanAndOrder::Source {
+    public:
+        MemorySource(const vector<Entry> &heap, const EntryLess &less) :
+            _entries(heap), _pos(0) {
+            std::sort_heap(_entries.begin(), _entries.end(), less);
+        }
+        bool ok() const { return _pos < _entries.size(); }
+        const BSONObj &key() const { return _entries[_pos].key; }
+        const BSONObj &obj() const { return _entries[_pos].obj; }
+        void advance() { _pos++; }
+    private:
+        vector<Entry> _entries;
+        size_t _pos;
+    };
+
+    /** Orders merge sources so that the one with the best key, then the earliest one, is on top. */
+    class ScanAndOrder::SourceGreater {
+    public:
+        SourceGreater(const vector< shared_ptr<Source> > &sources, const BSONObj &pattern) :
+            _sources(sources), _pattern(pattern) {}
+        bool operator()(size_t a, size_t b) const {
+            const int c = _sources[a]->key().woCompare(_sources[b]->key(), _pattern);
+            return c != 0 ? c > 0 : a > b;
+        }
+    private:
+        const vector< shared_ptr<Source> > &_sources;
+        const BSONObj _pattern;
+    };
+
+    ScanAndOrder::ScanAndOrder(int startFrom, int limit, const BSONObj &order, const FieldRangeSet &frs) :
+        _startFrom(startFrom), _order(order, frs), _less(_order._spec.keyPattern),
+        _approxSize(0), _maxBytes(MaxScanAndOrderBytes), _nextSeq(0),
+        _spillAllowed(false), _nSpilled(0) {
+        _limit = limit > 0 ? limit + _startFrom : 0x7fffffff;
+    }
+
+    ScanAndOrder::~ScanAndOrder() {
+    }
+
     void ScanAndOrder::add(const BSONObj& o) {
         verify( o.isValid() );
         BSONObj k;
@@ -46,70 +189,167 @@ namespace mongo {
         if ( k.isEmpty() ) {
             return;   
         }
+        if ( !_spillBound.isEmpty() && k.woCompare(_spillBound, _order._spec.keyPattern) >= 0 ) {
+            return;
+        }
         if ( (int) _best.size() < _limit ) {
             _add(k, o);
             return;
         }
-        BestMap::iterator i;
-        verify( _best.end() != _best.begin() );
-        i = _best.end();
-        i--;
-        _addIfBetter(k, o, i);
+        verify( !_best.empty() );
+        const BSONObj& worstBestKey = _best.front().key;
+        int cmp = worstBestKey.woCompare(k, _order._spec.keyPattern);
+        if ( cmp > 0 ) {
+            // k is better, 'upgrade'
+            _replaceWorst(k, o);
+        }
     }
 
-    void ScanAndOrder::fill( BufBuilder& b, const ParsedQuery *parsedQuery, int& nout ) const {
-        int n = 0;
-        int nFilled = 0;
-        Projection *projection = parsedQuery ? parsedQuery->getFields() : NULL;
-        scoped_ptr<Matcher> arrayMatcher;
-        scoped_ptr<MatchDetails> details;
-        if ( projection && projection->getArrayOpType() == Projection::ARRAY_OP_POSITIONAL ) {
-            // the projection specified an array positional match operator; create a new matcher
-            // for the projected array
-            arrayMatcher.reset( new Matcher( parsedQuery->getFilter() ) );
-            details.reset( new MatchDetails );
-            details->requestElemMatchKey();
-        }
-        for ( BestMap::const_iterator i = _best.begin(); i != _best.end(); i++ ) {
-            n++;
-            if ( n <= _startFrom )
-                continue;
-            const BSONObj& o = i->second;
-            massert( 16355, "positional operator specified, but no array match",
-                     ! arrayMatcher || arrayMatcher->matches( o, details.get() ) );
-            fillQueryResultFromObj( b, projection, o, details.get() );
-            nFilled++;
-            if ( nFilled >= _limit )
-                break;
+    void ScanAndOrder::_add(const BSONObj& k, const BSONObj& o) {
+        const int size = k.objsize() + o.objsize();
+        if ( _spillAllowed && !_best.empty() && _approxSize + size >= _maxBytes ) {
+            _spill();
         }
-        nout = nFilled;
+        _validateAndUpdateApproxSize( size );
+        _best.push_back( Entry( k.getOwned(), o.getOwned(), _nextSeq++ ) );
+        std::push_heap( _best.begin(), _best.end(), _less );
     }
 
-    void ScanAndOrder::_add(const BSONObj& k, const BSONObj& o) {
-        BSONObj docToReturn = o;
-        _validateAndUpdateApproxSize( k.objsize() + docToReturn.objsize() );
-        _best.insert(make_pair(k.getOwned(),docToReturn.getOwned()));
+    void ScanAndOrder::_popWorst() {
+        const Entry &worst = _best.front();
+        _validateAndUpdateApproxSize( -worst.key.objsize() + -worst.obj.objsize() );
+        std::pop_heap( _best.begin(), _best.end(), _less );
+        _best.pop_back();
     }
-    
-    void ScanAndOrder::_addIfBetter(const BSONObj& k, const BSONObj& o, const BestMap::iterator& i) {
-        const BSONObj& worstBestKey = i->first;
-        int cmp = worstBestKey.woCompare(k, _order._spec.keyPattern);
-        if ( cmp > 0 ) {
-            // k is better, 'upgrade'
-            _validateAndUpdateApproxSize( -i->first.objsize() + -i->second.objsize() );
-            _best.erase(i);
-            _add(k, o);
+
+    void ScanAndOrder::_replaceWorst(const BSONObj& k, const BSONObj& o) {
+        // Work out what _add() will check once the worst entry is popped.
+        const Entry &worst = _best.front();
+        const int size = k.objsize() + o.objsize();
+        const int afterPop = _approxSize - worst.key.objsize() - worst.obj.objsize();
+        const bool willSpill = _spillAllowed && _best.size() > 1 && afterPop + size >= (int) _maxBytes;
+        _validateApproxSize( ( willSpill ? 0 : afterPop ) + size );
+
+        // The heap was full, so the run _add() is about to spill and k
+        // together are _limit entries better than the worst one.
+        const BSONObj worstKey = worst.key;
+        _popWorst();
+        _add(k, o);
+        if ( willSpill ) {
+            _tightenSpillBound( worstKey );
+        }
+    }
+
+    void ScanAndOrder::_spill() {
+        std::sort_heap( _best.begin(), _best.end(), _less );
+        shared_ptr<SortedRun> run( new SortedRun() );
+        for ( vector<Entry>::const_iterator it = _best.begin(); it != _best.end(); ++it ) {
+            run->append( it->key, it->obj );
+        }
+        run->finish();
+        LOG(1) << "sort spilled " << _best.size() << " entries to " << run->path() << endl;
+
+        if ( (int) _best.size() >= _limit ) {
+            _tightenSpillBound( _best.back().key );
+        }
+        _runs.push_back( run );
+        _nSpilled += _best.size();
+        _best.clear();
+        _approxSize = 0;
+    }
+
+    void ScanAndOrder::_tightenSpillBound( const BSONObj &key ) {
+        if ( _spillBound.isEmpty() || key.woCompare( _spillBound, _order._spec.keyPattern ) < 0 ) {
+            _spillBound = key;
         }
     }
 
     void ScanAndOrder::_validateAndUpdateApproxSize( const int approxSizeDelta ) {
-        // note : adjust when bson return limit adjusts. note this limit should be a bit higher.
         int newApproxSize = _approxSize + approxSizeDelta;
+        _validateApproxSize( newApproxSize );
+        _approxSize = newApproxSize;
+    }
+
+    void ScanAndOrder::_validateApproxSize( const int newApproxSize ) const {
+        // note : adjust when bson return limit adjusts. note this limit should be a bit higher.
         verify( newApproxSize >= 0 );
         uassert( ScanAndOrderMemoryLimitExceededAssertionCode,
                 "too much data for sort() with no index.  add an index or specify a smaller limit",
-                (unsigned)newApproxSize < MaxScanAndOrderBytes );
-        _approxSize = newApproxSize;
+                (unsigned)newApproxSize < _maxBytes );
+    }
+
+    ScanAndOrderCursor::ScanAndOrderCursor( const shared_ptr<ScanAndOrder> &scanAndOrder,
+                                            const ParsedQuery *parsedQuery ) :
+        _scanAndOrder( scanAndOrder ),
+        _greater( new ScanAndOrder::SourceGreater( _sources, scanAndOrder->_order._spec.keyPattern ) ),
+        _remaining( scanAndOrder->_limit - scanAndOrder->_startFrom ),
+        _nMerged( 0 ) {
+        Projection *projection = parsedQuery ? parsedQuery->getFields() : NULL;
+        if ( projection && projection->getArrayOpType() == Projection::ARRAY_OP_POSITIONAL ) {
+            // the projection specified an array positional match operator; create a new matcher
+            // for the projected array
+            _filter = parsedQuery->getFilter().getOwned();
+            _arrayMatcher.reset( new Matcher( _filter ) );
+        }
+
+        // Runs were written in order, and the heap holds the most recent
+        // entries, so on equal keys the earlier source wins.
+        const vector< shared_ptr<ScanAndOrder::SortedRun> > &runs = _scanAndOrder->_runs;
+        for ( vector< shared_ptr<ScanAndOrder::SortedRun> >::const_iterator it = runs.begin(); it != runs.end(); ++it ) {
+            _sources.push_back( shared_ptr<ScanAndOrder::Source>( new ScanAndOrder::RunSource( **it ) ) );
+        }
+        _sources.push_back( shared_ptr<ScanAndOrder::Source>
+                            ( new ScanAndOrder::MemorySource( _scanAndOrder->_best, _scanAndOrder->_less ) ) );
+
+        // k-way merge, with the source holding the best key on top of the heap
+        for ( size_t i = 0; i < _sources.size(); i++ ) {
+            if ( _sources[i]->ok() ) {
+                _heap.push_back( i );
+            }
+        }
+        std::make_heap( _heap.begin(), _heap.end(), *_greater );
+
+        for ( int i = 0; i < _scanAndOrder->_startFrom && !_heap.empty(); i++ ) {
+            next();
+        }
+    }
+
+    ScanAndOrderCursor::~ScanAndOrderCursor() {
+    }
+
+    BSONObj ScanAndOrderCursor::current() {
+        verify( ok() );
+        return _sources[_heap.front()]->obj();
+    }
+
+    bool ScanAndOrderCursor::advance() {
+        if ( !ok() ) {
+            return false;
+        }
+        _remaining--;
+        next();
+        return ok();
+    }
+
+    void ScanAndOrderCursor::next() {
+        _nMerged++;
+        std::pop_heap( _heap.begin(), _heap.end(), *_greater );
+        ScanAndOrder::Source *best = _sources[_heap.back()].get();
+        best->advance();
+        if ( best->ok() ) {
+            std::push_heap( _heap.begin(), _heap.end(), *_greater );
+        }
+        else {
+            _heap.pop_back();
+        }
+    }
+
+    bool ScanAndOrderCursor::currentMatches( MatchDetails *details ) {
+        if ( _arrayMatcher ) {
+            massert( 16355, "positional operator specified, but no array match",
+                     _arrayMatcher->matches( current(), details ) );
+        }
+        return true;
     }
 
 } // namespace mongo
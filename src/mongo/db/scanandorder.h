@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include "cursor.h"
 #include "indexkey.h"
 #include "queryutil.h"
 #include "projection.h"
@@ -65,39 +66,85 @@ namespace mongo {
         }
     }
 
-    typedef multimap<BSONObj,BSONObj,BSONObjCmp> BestMap;
+    /**
+     * Sorts query results that don't come out of an index in order.
+     *
+     * Matches are kept in memory in a heap whose worst entry is on top, so with
+     * a limit only the best limit + skip matches are ever held. If memory usage
+     * would exceed MaxScanAndOrderBytes and spilling has been allowed, the
+     * heap is written out as a sorted run under --tmpDir (or --dbpath) and
+     * a ScanAndOrderCursor merges the runs with what is left in memory.
+     */
     class ScanAndOrder {
     public:
         static const unsigned MaxScanAndOrderBytes;
 
-        ScanAndOrder(int startFrom, int limit, const BSONObj &order, const FieldRangeSet &frs) :
-            _best( BSONObjCmp( order ) ),
-            _startFrom(startFrom), _order(order, frs) {
-            _limit = limit > 0 ? limit + _startFrom : 0x7fffffff;
-            _approxSize = 0;
-        }
+        ScanAndOrder(int startFrom, int limit, const BSONObj &order, const FieldRangeSet &frs);
+        ~ScanAndOrder();
 
-        int size() const { return _best.size(); }
+        int size() const { return _best.size() + _nSpilled; }
 
         /**
          * @throw ScanAndOrderMemoryLimitExceededAssertionCode if adding would grow memory usage
-         * to ScanAndOrder::MaxScanAndOrderBytes.
+         * to ScanAndOrder::MaxScanAndOrderBytes and spilling is not allowed.
          */
         void add(const BSONObj &o);
 
-        /* scanning complete. stick the query result in b for n objects. */
-        void fill(BufBuilder& b, const ParsedQuery *query, int& nout) const;
+        /** From now on, write sorted runs to disk rather than exceed the memory limit. */
+        void allowSpill() { _spillAllowed = true; }
 
     /** Functions for testing. */
     protected:
 
         unsigned approxSize() const { return _approxSize; }
+        int nRuns() const { return _runs.size(); }
+        void setMaxBytes(unsigned maxBytes) { _maxBytes = maxBytes; }
 
     private:
+        friend class ScanAndOrderCursor;
+
+        class SortedRun;
+        class Source;
+        class RunSource;
+        class MemorySource;
+        class SourceGreater;
+
+        struct Entry {
+            Entry(const BSONObj &k, const BSONObj &o, long long s) : key(k), obj(o), seq(s) {}
+            BSONObj key;
+            BSONObj obj;
+            // insertion order, so that entries with equal keys come out in the
+            // order they were added
+            long long seq;
+        };
+
+        // Orders entries best first. As a heap comparator, puts the worst entry on top.
+        class EntryLess {
+        public:
+            EntryLess(const BSONObj &pattern) : _pattern(pattern) {}
+            bool operator()(const Entry &a, const Entry &b) const {
+                const int c = a.key.woCompare(b.key, _pattern);
+                return c != 0 ? c < 0 : a.seq < b.seq;
+            }
+        private:
+            BSONObj _pattern;
+        };
 
         void _add(const BSONObj& k, const BSONObj& o);
 
-        void _addIfBetter(const BSONObj& k, const BSONObj& o, const BestMap::iterator& i);
+        void _popWorst();
+
+        /**
+         * Replaces the worst entry of a full heap with a better one. Checks the memory limit
+         * first, so that if it throws, the heap is left as it was.
+         */
+        void _replaceWorst(const BSONObj& k, const BSONObj& o);
+
+        /** Writes the in memory entries to a new sorted run and empties the heap. */
+        void _spill();
+
+        /** Lowers _spillBound to key, once _limit spilled entries are known to be better. */
+        void _tightenSpillBound( const BSONObj &key );
 
         /**
          * @throw ScanAndOrderMemoryLimitExceededAssertionCode if approxSize would grow too high,
@@ -105,12 +152,71 @@ namespace mongo {
          */
         void _validateAndUpdateApproxSize( const int approxSizeDelta );
 
-        BestMap _best; // key -> full object
+        /** @throw ScanAndOrderMemoryLimitExceededAssertionCode if newApproxSize is too high. */
+        void _validateApproxSize( const int newApproxSize ) const;
+
+        vector<Entry> _best; // heap, worst entry first
         int _startFrom;
         int _limit;   // max to send back.
         KeyType _order;
+        EntryLess _less;
         unsigned _approxSize;
+        unsigned _maxBytes;
+        long long _nextSeq;
+
+        bool _spillAllowed;
+        vector< shared_ptr<SortedRun> > _runs;
+        long long _nSpilled;
+        // With a limit, once _limit entries at least as good as some key have
+        // been spilled, nothing at or past the best such key can be part of
+        // the result.
+        BSONObj _spillBound;
 
     };
 
+    /**
+     * Returns a finished ScanAndOrder's results in order, skipped and limited, by merging its
+     * sorted runs with what is left in memory. The ScanAndOrder, and with it the runs, lives as
+     * long as the cursor, so a sorted result too big for one reply can be kept in a ClientCursor
+     * and returned through getMore.
+     */
+    class ScanAndOrderCursor : public Cursor {
+    public:
+        /**
+         * @param parsedQuery, if given, has its projection's positional operator matched
+         * against each result by currentMatches().
+         */
+        ScanAndOrderCursor( const shared_ptr<ScanAndOrder> &scanAndOrder,
+                            const ParsedQuery *parsedQuery );
+        virtual ~ScanAndOrderCursor();
+
+        virtual bool ok() { return _remaining > 0 && !_heap.empty(); }
+        virtual BSONObj current();
+        virtual bool advance();
+        virtual bool supportGetMore() { return true; }
+        virtual string toString() const { return "ScanAndOrderCursor"; }
+        virtual bool getsetdup(const BSONObj &pk) { return false; }
+        virtual bool isMultiKey() const { return false; }
+        // the results aren't read from an index
+        virtual bool modifiedKeys() const { return true; }
+        virtual long long nscanned() const { return _nMerged; }
+
+        /** Always true; fills in the positional operator's array match, if there is one. */
+        virtual bool currentMatches( MatchDetails *details = 0 );
+
+    private:
+        /** Moves past the best entry, without counting it against the limit. */
+        void next();
+
+        shared_ptr<ScanAndOrder> _scanAndOrder;
+        vector< shared_ptr<ScanAndOrder::Source> > _sources;
+        scoped_ptr<ScanAndOrder::SourceGreater> _greater;
+        // indexes of the sources that aren't done, the one with the best key on top
+        vector<size_t> _heap;
+        int _remaining;
+        long long _nMerged;
+        BSONObj _filter;
+        scoped_ptr<Matcher> _arrayMatcher;
+    };
+
 } // namespace mongo
@@ -21,6 +21,8 @@
 
 #include <string>
 
+#include <boost/thread/tss.hpp>
+
 #include "mongo/db/nonce.h"
 #include "mongo/db/security_common.h"
 #include "mongo/client/authentication_table.h"
@@ -141,4 +143,7 @@ namespace mongo {
         static bool _warned;
     };
 
+    // the nonce from this connection's last getnonce, which authenticate must echo
+    extern boost::thread_specific_ptr<nonce64> lastNonce;
+
 } // namespace mongo
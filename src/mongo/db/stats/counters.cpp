@@ -44,35 +44,15 @@ namespace mongo {
         }
     }
 
-    BSONObj OpCounters::getObj() {
-        const unsigned MAX = 1 << 30;
-        RARELY {
-            bool wrap =
-            _insert.get() > MAX ||
-            _query.get() > MAX ||
-            _update.get() > MAX ||
-            _delete.get() > MAX ||
-            _getmore.get() > MAX ||
-            _command.get() > MAX;
-
-            if ( wrap ) {
-                _insert.zero();
-                _query.zero();
-                _update.zero();
-                _delete.zero();
-                _getmore.zero();
-                _command.zero();
-            }
-
-        }
+    BSONObj OpCounters::getObj() const {
         BSONObjBuilder b;
         {
-            b.append( "insert" , _insert.get() );
-            b.append( "query" , _query.get() );
-            b.append( "update" , _update.get() );
-            b.append( "delete" , _delete.get() );
-            b.append( "getmore" , _getmore.get() );
-            b.append( "command" , _command.get() );
+            b.appendNumber( "insert" , getInsert() );
+            b.appendNumber( "query" , getQuery() );
+            b.appendNumber( "update" , getUpdate() );
+            b.appendNumber( "delete" , getDelete() );
+            b.appendNumber( "getmore" , getGetMore() );
+            b.appendNumber( "command" , getCommand() );
         }
         return b.obj();
     }
@@ -95,34 +75,15 @@ namespace mongo {
 
 
     void NetworkCounter::hit( long long bytesIn , long long bytesOut ) {
-        const long long MAX = 1ULL << 60;
-
-        // don't care about the race as its just a counter
-        bool overflow = _bytesIn > MAX || _bytesOut > MAX;
-
-        if ( overflow ) {
-            _lock.lock();
-            _overflows++;
-            _bytesIn = bytesIn;
-            _bytesOut = bytesOut;
-            _requests = 1;
-            _lock.unlock();
-        }
-        else {
-            _lock.lock();
-            _bytesIn += bytesIn;
-            _bytesOut += bytesOut;
-            _requests++;
-            _lock.unlock();
-        }
+        _counters.add( BYTES_IN , bytesIn );
+        _counters.add( BYTES_OUT , bytesOut );
+        _counters.add( REQUESTS , 1 );
     }
 
-    void NetworkCounter::append( BSONObjBuilder& b ) {
-        _lock.lock();
-        b.appendNumber( "bytesIn" , _bytesIn );
-        b.appendNumber( "bytesOut" , _bytesOut );
-        b.appendNumber( "numRequests" , _requests );
-        _lock.unlock();
+    void NetworkCounter::append( BSONObjBuilder& b ) const {
+        b.appendNumber( "bytesIn" , _counters.get( BYTES_IN ) );
+        b.appendNumber( "bytesOut" , _counters.get( BYTES_OUT ) );
+        b.appendNumber( "numRequests" , _counters.get( REQUESTS ) );
     }
 
     OpCounters globalOpCounters;
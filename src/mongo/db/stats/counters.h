@@ -23,48 +23,42 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/processinfo.h"
-#include "mongo/util/concurrency/spin_lock.h"
+#include "mongo/util/concurrency/striped_counters.h"
 
 namespace mongo {
 
     /**
      * for storing operation counters
-     * note: not thread safe.  ok with that for speed
+     * striped, see StripedCounters, as every operation bumps one of these
      */
     class OpCounters {
     public:
 
         OpCounters();
-        void incInsertInWriteLock(int n) { _insert.x += n; }
-        void gotInsert() { _insert++; }
-        void gotQuery() { _query++; }
-        void gotUpdate() { _update++; }
-        void gotDelete() { _delete++; }
-        void gotGetMore() { _getmore++; }
-        void gotCommand() { _command++; }
+        void incInsertInWriteLock(int n) { gotInserts(n); }
+        void gotInsert() { gotInserts(1); }
+        void gotInserts(int n) { _counters.add(INSERTS, n); }
+        void gotQuery() { _counters.add(QUERIES, 1); }
+        void gotUpdate() { _counters.add(UPDATES, 1); }
+        void gotDelete() { _counters.add(DELETES, 1); }
+        void gotGetMore() { _counters.add(GETMORES, 1); }
+        void gotCommand() { _counters.add(COMMANDS, 1); }
 
         void gotOp( int op , bool isCommand );
 
-        BSONObj getObj();
+        BSONObj getObj() const;
         
         // thse are used by snmp, and other things, do not remove
-        const AtomicUInt * getInsert() const { return &_insert; }
-        const AtomicUInt * getQuery() const { return &_query; }
-        const AtomicUInt * getUpdate() const { return &_update; }
-        const AtomicUInt * getDelete() const { return &_delete; }
-        const AtomicUInt * getGetMore() const { return &_getmore; }
-        const AtomicUInt * getCommand() const { return &_command; }
+        long long getInsert() const { return _counters.get(INSERTS); }
+        long long getQuery() const { return _counters.get(QUERIES); }
+        long long getUpdate() const { return _counters.get(UPDATES); }
+        long long getDelete() const { return _counters.get(DELETES); }
+        long long getGetMore() const { return _counters.get(GETMORES); }
+        long long getCommand() const { return _counters.get(COMMANDS); }
 
     private:
-
-        // todo: there will be a lot of cache line contention on these.  need to do something 
-        //       else eventually.
-        AtomicUInt _insert;
-        AtomicUInt _query;
-        AtomicUInt _update;
-        AtomicUInt _delete;
-        AtomicUInt _getmore;
-        AtomicUInt _command;
+        enum { INSERTS, QUERIES, UPDATES, DELETES, GETMORES, COMMANDS, NCOUNTERS };
+        StripedCounters<NCOUNTERS> _counters;
     };
 
     extern OpCounters globalOpCounters;
@@ -82,17 +76,11 @@ namespace mongo {
 
     class NetworkCounter {
     public:
-        NetworkCounter() : _bytesIn(0), _bytesOut(0), _requests(0), _overflows(0) {}
         void hit( long long bytesIn , long long bytesOut );
-        void append( BSONObjBuilder& b );
+        void append( BSONObjBuilder& b ) const;
     private:
-        long long _bytesIn;
-        long long _bytesOut;
-        long long _requests;
-
-        long long _overflows;
-
-        SpinLock _lock;
+        enum { BYTES_IN, BYTES_OUT, REQUESTS, NCOUNTERS };
+        StripedCounters<NCOUNTERS> _counters;
     };
 
     extern NetworkCounter networkCounter;
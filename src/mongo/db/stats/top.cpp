@@ -43,52 +43,118 @@ namespace mongo {
 
     }
 
+    boost::thread_specific_ptr<Top::ThreadCache> Top::_threadCache;
+
+    namespace {
+        // a thread that touches more collections than this starts its cache over
+        const size_t MaxCachedUsages = 128;
+    }
+
+    unsigned long long Top::nextGeneration() {
+        static AtomicUInt64 generations;
+        return generations.addAndFetch( 1 );
+    }
+
+    Top::Usage* Top::cachedUsage( const StringData& ns ) const {
+        const ThreadCache* cache = _threadCache.get();
+        if ( cache == NULL || cache->generation != _generation.load() )
+            return NULL;
+        LiveMap::const_iterator i = cache->usages.find( ns );
+        return i == cache->usages.end() ? NULL : i->second.get();
+    }
+
+    Top::Usage* Top::findAndCacheUsage( const StringData& ns ) const {
+        LiveMap::const_iterator i = _usage.find( ns );
+        if ( i == _usage.end() )
+            return NULL;
+
+        ThreadCache* cache = _threadCache.get();
+        const unsigned long long generation = _generation.load();
+        if ( cache == NULL || cache->generation != generation ||
+             cache->usages.size() >= MaxCachedUsages ) {
+            cache = new ThreadCache();
+            cache->generation = generation;
+            _threadCache.reset( cache );
+        }
+        cache->usages[ns] = i->second;
+        return i->second.get();
+    }
+
     void Top::record( const StringData& ns , int op , int lockType , long long micros , bool command ) {
         if ( ns[0] == '?' )
             return;
 
         //cout << "record: " << ns << "\t" << op << "\t" << command << endl;
-        SimpleMutex::scoped_lock lk(_lock);
+        const bool maybeDropped = command || op == dbQuery;
 
-        if ( ( command || op == dbQuery ) && ns == _lastDropped ) {
+        // A cached usage was found after the last drop, so ns can't be the
+        // collection just dropped.
+        Usage* usage = cachedUsage( ns );
+        if ( usage == NULL ) {
+            SimpleRWLock::Shared lk(_lock);
+            if ( ! ( maybeDropped && ns == _lastDropped ) )
+                usage = findAndCacheUsage( ns );
+        }
+        if ( usage != NULL ) {
+            usage->record( op , lockType , micros , command );
+            _global.record( op , lockType , micros , command );
+            return;
+        }
+
+        SimpleRWLock::Exclusive lk(_lock);
+
+        if ( maybeDropped && ns == _lastDropped ) {
             _lastDropped = "";
             return;
         }
 
-        CollectionData& coll = _usage[ns];
-        _record( coll , op , lockType , micros , command );
-        _record( _global , op , lockType , micros , command );
+        shared_ptr<Usage>& coll = _usage[ns];
+        if ( ! coll )
+            coll.reset( new Usage() );
+        coll->record( op , lockType , micros , command );
+        _global.record( op , lockType , micros , command );
     }
 
-    void Top::_record( CollectionData& c , int op , int lockType , long long micros , bool command ) {
-        c.total.inc( micros );
+    Top::Usage::Usage( bool global ) {
+        for ( int i = 0; i < NUSAGES - QUERIES; i++ ) {
+            _latencies[i].reset( new LatencyHistogram( global ) );
+        }
+    }
+
+    void Top::Usage::inc( int usage , long long micros ) {
+        _counters.add( 2 * usage , 1 );
+        _counters.add( 2 * usage + 1 , micros );
+    }
+
+    void Top::Usage::record( int op , int lockType , long long micros , bool command ) {
+        inc( TOTAL , micros );
 
         if ( lockType > 0 )
-            c.writeLock.inc( micros );
+            inc( WRITE_LOCK , micros );
         else if ( lockType < 0 )
-            c.readLock.inc( micros );
+            inc( READ_LOCK , micros );
 
         switch ( op ) {
         case 0:
             // use 0 for unknown, non-specific
             break;
         case dbUpdate:
-            c.update.inc( micros );
+            inc( UPDATE , micros );
             break;
         case dbInsert:
-            c.insert.inc( micros );
+            inc( INSERT , micros );
             break;
         case dbQuery:
             if ( command )
-                c.commands.inc( micros );
+                inc( COMMANDS , micros );
             else
-                c.queries.inc( micros );
+                inc( QUERIES , micros );
             break;
         case dbGetMore:
-            c.getmore.inc( micros );
+            inc( GETMORE , micros );
             break;
         case dbDelete:
-            c.remove.inc( micros );
+            inc( REMOVE , micros );
             break;
         case dbKillCursors:
             break;
@@ -102,28 +168,129 @@ namespace mongo {
 
     }
 
+    void Top::Usage::get( int usage , UsageData& out ) const {
+        out.count = _counters.get( 2 * usage );
+        out.time = _counters.get( 2 * usage + 1 );
+    }
+
+    void Top::Usage::get( CollectionData& out ) const {
+        get( TOTAL , out.total );
+        get( READ_LOCK , out.readLock );
+        get( WRITE_LOCK , out.writeLock );
+        get( QUERIES , out.queries );
+        get( GETMORE , out.getmore );
+        get( INSERT , out.insert );
+        get( UPDATE , out.update );
+        get( REMOVE , out.remove );
+        get( COMMANDS , out.commands );
+    }
+
+    Top::CollectionData Top::getGlobalData() const {
+        CollectionData c;
+        _global.get( c );
+        return c;
+    }
+
     void Top::collectionDropped( const StringData& ns ) {
         //cout << "collectionDropped: " << ns << endl;
-        SimpleMutex::scoped_lock lk(_lock);
+        SimpleRWLock::Exclusive lk(_lock);
         _usage.erase(ns);
         _lastDropped = ns.toString();
+        _generation.store( nextGeneration() );
     }
 
     void Top::cloneMap(Top::UsageMap& out) const {
-        SimpleMutex::scoped_lock lk(_lock);
-        out = _usage;
+        UsageMap m;
+        {
+            SimpleRWLock::Shared lk(_lock);
+            for ( LiveMap::const_iterator i = _usage.begin(); i != _usage.end(); ++i ) {
+                i->second->get( m[i->first] );
+            }
+        }
+        out = m;
     }
 
-    void Top::append( BSONObjBuilder& b ) {
-        SimpleMutex::scoped_lock lk( _lock );
-        _appendToUsageMap( b , _usage );
+    void Top::recordLatency( const StringData& ns , int op , bool command , long long micros ) {
+        _global.recordLatency( op , command , micros );
+
+        if ( ns.empty() || ns[0] == '?' )
+            return;
+
+        Usage* usage = cachedUsage( ns );
+        if ( usage == NULL ) {
+            SimpleRWLock::Shared lk(_lock);
+            usage = findAndCacheUsage( ns );
+        }
+        if ( usage != NULL )
+            usage->recordLatency( op , command , micros );
     }
 
-    void Top::_appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ) const {
+    namespace {
+        // the name of each of Top::Usage's latency histograms
+        const char * const latencyNames[] = { "queries" , "getmore" , "insert" , "update" , "remove" , "commands" };
+    }
+
+    void Top::Usage::recordLatency( int op , bool command , long long micros ) {
+        int usage;
+        switch ( op ) {
+        case dbQuery:
+            usage = command ? COMMANDS : QUERIES;
+            break;
+        case dbGetMore:
+            usage = GETMORE;
+            break;
+        case dbInsert:
+            usage = INSERT;
+            break;
+        case dbUpdate:
+            usage = UPDATE;
+            break;
+        case dbDelete:
+            usage = REMOVE;
+            break;
+        default:
+            return;
+        }
+        _latencies[usage - QUERIES]->record( micros );
+    }
+
+    void Top::Usage::appendLatencies( BSONObjBuilder& b ) const {
+        for ( int i = 0; i < NUSAGES - QUERIES; i++ ) {
+            const LatencyHistogram& h = *_latencies[i];
+            BSONObjBuilder bb( b.subobjStart( latencyNames[i] ) );
+            bb.appendNumber( "count" , (long long) h.count() );
+            bb.appendNumber( "p50" , (long long) h.percentile( 0.5 ) );
+            bb.appendNumber( "p99" , (long long) h.percentile( 0.99 ) );
+            bb.appendNumber( "p999" , (long long) h.percentile( 0.999 ) );
+            bb.done();
+        }
+    }
+
+    void Top::Usage::resetLatencies() {
+        for ( int i = 0; i < NUSAGES - QUERIES; i++ ) {
+            _latencies[i]->reset();
+        }
+    }
+
+    void Top::appendGlobalLatencies( BSONObjBuilder& b ) const {
+        _global.appendLatencies( b );
+    }
+
+    void Top::resetLatencies() {
+        _global.resetLatencies();
+        SimpleRWLock::Shared lk(_lock);
+        for ( LiveMap::const_iterator i = _usage.begin(); i != _usage.end(); ++i ) {
+            i->second->resetLatencies();
+        }
+    }
+
+    void Top::append( BSONObjBuilder& b ) {
+        SimpleRWLock::Shared lk( _lock );
+
         // pull all the names into a vector so we can sort them for the user
         
         vector<string> names;
-        for ( UsageMap::const_iterator i = map.begin(); i != map.end(); ++i ) {
+        for ( LiveMap::const_iterator i = _usage.begin(); i != _usage.end(); ++i ) {
             names.push_back( i->first );
         }
         
@@ -132,7 +299,9 @@ namespace mongo {
         for ( size_t i=0; i<names.size(); i++ ) {
             BSONObjBuilder bb( b.subobjStart( names[i] ) );
 
-            const CollectionData& coll = map.find(names[i])->second;
+            const Usage& usage = *_usage.find(names[i])->second;
+            CollectionData coll;
+            usage.get( coll );
 
             _appendStatsEntry( b , "total" , coll.total );
 
@@ -146,6 +315,10 @@ namespace mongo {
             _appendStatsEntry( b , "remove" , coll.remove );
             _appendStatsEntry( b , "commands" , coll.commands );
 
+            BSONObjBuilder lb( bb.subobjStart( "latencyMicros" ) );
+            usage.appendLatencies( lb );
+            lb.done();
+
             bb.done();
         }
     }
@@ -162,7 +335,10 @@ namespace mongo {
         TopCmd() : InformationCommand("top") {}
 
         virtual bool adminOnly() const { return true; }
-        virtual void help( stringstream& help ) const { help << "usage by collection, in micros "; }
+        virtual void help( stringstream& help ) const {
+            help << "usage by collection, in micros\n"
+                 << "{ top : 1 , resetLatencies : true } starts the latency percentiles over after reporting them";
+        }
 
         virtual bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
             {
@@ -171,6 +347,9 @@ namespace mongo {
                 Top::global.append( b );
                 b.done();
             }
+            if ( cmdObj["resetLatencies"].trueValue() ) {
+                Top::global.resetLatencies();
+            }
             return true;
         }
 
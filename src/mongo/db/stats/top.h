@@ -18,29 +18,39 @@
 #pragma once
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread/tss.hpp>
 
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/rwlock.h"
+#include "mongo/util/concurrency/striped_counters.h"
+#include "mongo/util/histogram.h"
 #include "mongo/util/string_map.h"
 
 namespace mongo {
 
     /**
      * tracks usage by collection
+     *
+     * record() runs for every operation, so the counts are striped (see
+     * StripedCounters) and the collection is usually found in a per thread
+     * cache, without writing anything other threads read. The cache is
+     * filled under _lock shared, and is thrown away once a drop changes
+     * _generation. _lock is taken exclusively to add or drop a collection.
+     *
+     * Also keeps a latency histogram of each kind of operation, from
+     * receiving it to replying, for the percentiles top and serverStatus
+     * report.
      */
     class Top {
 
     public:
-        Top() : _lock("Top") { }
+        Top() : _lock("Top"), _global( true ), _generation( nextGeneration() ) { }
 
         struct UsageData {
             UsageData() : time(0) , count(0) {}
             UsageData( const UsageData& older , const UsageData& newer );
             long long time;
             long long count;
-
-            void inc( long long micros ) {
-                count++;
-                time += micros;
-            }
         };
 
         struct CollectionData {
@@ -67,23 +77,74 @@ namespace mongo {
 
     public:
         void record( const StringData& ns , int op , int lockType , long long micros , bool command );
+
+        /**
+         * Records how long a whole operation took, overall and for ns if
+         * record() is tracking it already.
+         */
+        void recordLatency( const StringData& ns , int op , bool command , long long micros );
+
         void append( BSONObjBuilder& b );
+        void appendGlobalLatencies( BSONObjBuilder& b ) const;
+        void resetLatencies();
         void cloneMap(UsageMap& out) const;
-        CollectionData getGlobalData() const { return _global; }
+        CollectionData getGlobalData() const;
         void collectionDropped( const StringData& ns );
 
     public: // static stuff
         static Top global;
 
     private:
-        void _appendToUsageMap( BSONObjBuilder& b , const UsageMap& map ) const;
         void _appendStatsEntry( BSONObjBuilder& b , const char * statsName , const UsageData& map ) const;
-        void _record( CollectionData& c , int op , int lockType , long long micros , bool command );
 
-        mutable SimpleMutex _lock;
-        CollectionData _global;
-        UsageMap _usage;
+        /** what record() adds to, for one collection or for all of them */
+        class Usage : boost::noncopyable {
+        public:
+            // only the overall usage, which every operation records into,
+            // stripes its latency histograms
+            explicit Usage( bool global = false );
+
+            void record( int op , int lockType , long long micros , bool command );
+            void get( CollectionData& out ) const;
+
+            void recordLatency( int op , bool command , long long micros );
+            void appendLatencies( BSONObjBuilder& b ) const;
+            void resetLatencies();
+        private:
+            // the usages from QUERIES on are kinds of operations, which
+            // also have latency histograms
+            enum { TOTAL, READ_LOCK, WRITE_LOCK, QUERIES, GETMORE, INSERT, UPDATE, REMOVE, COMMANDS, NUSAGES };
+            void inc( int usage , long long micros );
+            void get( int usage , UsageData& out ) const;
+            // count then time, for each usage
+            StripedCounters<2 * NUSAGES> _counters;
+            boost::scoped_ptr<LatencyHistogram> _latencies[NUSAGES - QUERIES];
+        };
+
+        typedef StringMap< shared_ptr<Usage> > LiveMap;
+
+        /** the usages a thread has found, as of one generation */
+        struct ThreadCache {
+            ThreadCache() : generation( 0 ) { }
+            unsigned long long generation;
+            LiveMap usages;
+        };
+
+        /** @return ns's usage from this thread's cache, or NULL if it isn't there or is stale */
+        Usage* cachedUsage( const StringData& ns ) const;
+        /** Finds ns's usage and caches it for this thread. Call with _lock held. */
+        Usage* findAndCacheUsage( const StringData& ns ) const;
+
+        /** unique across all Tops, so a cache never outlives what it was filled from */
+        static unsigned long long nextGeneration();
+
+        mutable SimpleRWLock _lock;
+        Usage _global;
+        LiveMap _usage;
         string _lastDropped;
+        // changed, with _lock held exclusively, whenever a usage leaves _usage
+        AtomicUInt64 _generation;
+        static boost::thread_specific_ptr<ThreadCache> _threadCache;
     };
 
 } // namespace mongo
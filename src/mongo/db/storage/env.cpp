@@ -69,6 +69,163 @@ namespace mongo {
             }
         }
 
+        static UpdateMessageFunction update_message_function = NULL;
+
+        void set_update_message_function(UpdateMessageFunction f) {
+            update_message_function = f;
+        }
+
+        static int update_callback(DB *db, const DBT *key, const DBT *old_val, const DBT *extra,
+                                   void (*set_val)(const DBT *new_val, void *set_extra),
+                                   void *set_extra) {
+            if (old_val == NULL) {
+                // No upserts through update messages, the object was deleted
+                // or never existed.
+                return 0;
+            }
+            try {
+                // Same as a comparison: the ydb has no way to return an error,
+                // so the update message function must not throw for a message
+                // it merely can't apply, just return false.
+                verify(update_message_function != NULL);
+                const BSONObj oldObj(static_cast<const char *>(old_val->data));
+                const BSONObj msg(static_cast<const char *>(extra->data));
+                BSONObj newObj;
+                if (update_message_function(oldObj, msg, newObj)) {
+                    DBT new_val = make_dbt(newObj.objdata(), newObj.objsize());
+                    set_val(&new_val, set_extra);
+                }
+                return 0;
+            } catch (std::exception &e) {
+                log() << "Caught an exception in an update callback, this is impossible to handle:" << endl;
+                DBException *dbe = dynamic_cast<DBException *>(&e);
+                if (dbe) {
+                    log() << "DBException " << dbe->getCode() << ": " << e.what() << endl;
+                } else {
+                    log() << e.what() << endl;
+                }
+                fassertFailed(16854);
+            }
+        }
+
+        static GenerateKeysFunction generate_keys_function = NULL;
+
+        void set_generate_keys_function(GenerateKeysFunction f) {
+            generate_keys_function = f;
+        }
+
+        static NoteMisfitFunction note_misfit_function = NULL;
+
+        void set_note_misfit_function(NoteMisfitFunction f) {
+            note_misfit_function = f;
+        }
+
+        // The descriptor is the index's ordering, followed by its info object
+        // for dictionaries created since put_multiple support was added.
+        bool descriptor_has_info(const DB *db) {
+            return db->descriptor->dbt.size > sizeof(Ordering);
+        }
+
+        static BSONObj descriptor_info(const DB *db) {
+            verify(descriptor_has_info(db));
+            return BSONObj(static_cast<const char *>(db->descriptor->dbt.data) + sizeof(Ordering));
+        }
+
+        static void set_dbt(DBT *dbt, const char *buf, size_t size) {
+            if (dbt->flags == DB_DBT_REALLOC) {
+                dbt->data = realloc(dbt->data, size);
+                dbt->ulen = size;
+            }
+            verify(size <= dbt->ulen);
+            memcpy(dbt->data, buf, size);
+            dbt->size = size;
+        }
+
+        // put_multiple and del_multiple (and recovery, when it replays them)
+        // hand us the primary key and object and ask for the row in each
+        // secondary dictionary. The caller only does this for dictionaries
+        // whose descriptor has the index info and for objects with exactly
+        // one key in that index, see NamespaceDetails::insertIntoIndexes,
+        // except for an index being built by the hot indexer.
+        //
+        // The hot indexer, and writers while it runs, ask for every object in
+        // the collection, but this ydb takes only one row per dictionary. An
+        // object with several keys gets the first of them, and one with none
+        // the index's null key, and its pk is noted so that the indexer can
+        // write the other keys or delete the null one once it's done (see
+        // NamespaceDetails::HotIndexer). The placeholder depends only on the
+        // object, so a later delete of it, or recovery, generates the same row.
+        static BSONObj placeholder_key(const BSONObj &info, const BSONObjSet &keys) {
+            if (!keys.empty()) {
+                return *keys.begin();
+            }
+            BSONObjBuilder b;
+            for (BSONObjIterator it(info["key"].Obj()); it.more(); it.next()) {
+                b.appendNull("");
+            }
+            return b.obj();
+        }
+
+        static int generate_key(DB *dest_db, DBT *dest_key, DBT *dest_val,
+                                const DBT *src_key, const DBT *src_val) {
+            verify(generate_keys_function != NULL);
+            const BSONObj info = descriptor_info(dest_db);
+            const BSONObj obj(static_cast<const char *>(src_val->data));
+            const BSONObj pk = Key(src_key).key();
+            BSONObjSet keys;
+            generate_keys_function(dest_db, info, obj, keys);
+            BSONObj key;
+            if (keys.size() == 1) {
+                key = *keys.begin();
+            } else {
+                key = placeholder_key(info, keys);
+                if (note_misfit_function != NULL) {
+                    note_misfit_function(dest_db, pk);
+                }
+            }
+            const Key skey(key, &pk);
+            set_dbt(dest_key, skey.buf(), skey.size());
+            if (dest_val != NULL) {
+                if (info["clustering"].trueValue()) {
+                    set_dbt(dest_val, obj.objdata(), obj.objsize());
+                } else {
+                    dest_val->size = 0;
+                }
+            }
+            return 0;
+        }
+
+        static void generate_row_failed(std::exception &e) {
+            log() << "Caught an exception in a row generation callback, this is impossible to handle:" << endl;
+            DBException *dbe = dynamic_cast<DBException *>(&e);
+            if (dbe) {
+                log() << "DBException " << dbe->getCode() << ": " << e.what() << endl;
+            } else {
+                log() << e.what() << endl;
+            }
+            fassertFailed(16857);
+        }
+
+        static int generate_row_for_put(DB *dest_db, DB *src_db, DBT *dest_key, DBT *dest_val,
+                                        const DBT *src_key, const DBT *src_val) {
+            try {
+                return generate_key(dest_db, dest_key, dest_val, src_key, src_val);
+            } catch (std::exception &e) {
+                generate_row_failed(e);
+                return -1;
+            }
+        }
+
+        static int generate_row_for_del(DB *dest_db, DB *src_db, DBT *dest_key,
+                                        const DBT *src_key, const DBT *src_val) {
+            try {
+                return generate_key(dest_db, dest_key, NULL, src_key, src_val);
+            } catch (std::exception &e) {
+                generate_row_failed(e);
+                return -1;
+            }
+        }
+
         static uint64_t calculate_cachesize(void) {
             uint64_t physmem, maxdata;
             physmem = toku_os_get_phys_memory_size();
@@ -136,6 +293,19 @@ namespace mongo {
             }
             env->change_fsync_log_period(env, cmdLine.logFlushPeriod);
 
+            r = env->set_update(env, update_callback);
+            if (r != 0) {
+                handle_ydb_error_fatal(r);
+            }
+            r = env->set_generate_row_callback_for_put(env, generate_row_for_put);
+            if (r != 0) {
+                handle_ydb_error_fatal(r);
+            }
+            r = env->set_generate_row_callback_for_del(env, generate_row_for_del);
+            if (r != 0) {
+                handle_ydb_error_fatal(r);
+            }
+
             const int redzone_threshold = cmdLine.fsRedzone;
             r = env->set_redzone(env, redzone_threshold);
             if (r != 0) {
@@ -202,10 +372,15 @@ namespace mongo {
         }
 
         // set a descriptor for the given dictionary. the descriptor is
-        // a serialization of the index's ordering bits.
-        static void set_db_descriptor(DB *db, DB_TXN *txn, const BSONObj &key_pattern) {
+        // a serialization of the index's ordering bits, followed by the
+        // index info, which row generation for put_multiple needs.
+        static void set_db_descriptor(DB *db, DB_TXN *txn, const BSONObj &info) {
+            const BSONObj key_pattern = info["key"].Obj();
             const Ordering ordering = Ordering::make(key_pattern);
-            DBT dbt = make_dbt((const char *) &ordering, sizeof(Ordering));
+            BufBuilder b(sizeof(Ordering) + info.objsize());
+            b.appendBuf(&ordering, sizeof(Ordering));
+            b.appendBuf(info.objdata(), info.objsize());
+            DBT dbt = make_dbt(b.buf(), b.len());
             const int flags = DB_UPDATE_CMP_DESCRIPTOR;
             int r = db->change_descriptor(db, txn, &dbt, flags);
             if (r != 0) {
@@ -215,7 +390,7 @@ namespace mongo {
         }
 
         static void verify_db_descriptor(DB *db, const BSONObj &key_pattern) {
-            verify(db->cmp_descriptor->dbt.size == sizeof(Ordering));
+            verify(db->cmp_descriptor->dbt.size >= sizeof(Ordering));
             const Ordering ordering = Ordering::make(key_pattern);
             const int c = memcmp(db->cmp_descriptor->dbt.data, &ordering, sizeof(Ordering));
             if (c != 0) {
@@ -309,7 +484,7 @@ namespace mongo {
             }
 
             if (may_create) {
-                set_db_descriptor(db, txn, key_pattern);
+                set_db_descriptor(db, txn, info);
             }
             verify_db_descriptor(db, key_pattern);
             *dbp = db;
@@ -324,6 +499,50 @@ namespace mongo {
             }
         }
 
+        void put_multiple(DB *src_db, const DBT *src_key, const DBT *src_val,
+                          const std::vector<DB *> &dbs, bool prelocked, bool src_prelocked) {
+            const size_t n = dbs.size();
+            std::vector<DBT> keys(n), vals(n);
+            std::vector<uint32_t> flags(n, prelocked ? DB_PRELOCKED_WRITE : 0);
+            if (src_prelocked) {
+                flags[0] = DB_PRELOCKED_WRITE;
+            }
+            for (size_t i = 0; i < n; i++) {
+                keys[i] = make_dbt(NULL, 0);
+                keys[i].flags = DB_DBT_REALLOC;
+                vals[i] = make_dbt(NULL, 0);
+                vals[i].flags = DB_DBT_REALLOC;
+            }
+            int r = env->put_multiple(env, src_db, cc().txn().db_txn(), src_key, src_val,
+                                      n, const_cast<DB **>(&dbs[0]), &keys[0], &vals[0], &flags[0]);
+            for (size_t i = 0; i < n; i++) {
+                free(keys[i].data);
+                free(vals[i].data);
+            }
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+        }
+
+        void del_multiple(DB *src_db, const DBT *src_key, const DBT *src_val,
+                          const std::vector<DB *> &dbs, bool prelocked) {
+            const size_t n = dbs.size();
+            std::vector<DBT> keys(n);
+            std::vector<uint32_t> flags(n, (prelocked ? DB_PRELOCKED_WRITE : 0) | DB_DELETE_ANY);
+            for (size_t i = 0; i < n; i++) {
+                keys[i] = make_dbt(NULL, 0);
+                keys[i].flags = DB_DBT_REALLOC;
+            }
+            int r = env->del_multiple(env, src_db, cc().txn().db_txn(), src_key, src_val,
+                                      n, const_cast<DB **>(&dbs[0]), &keys[0], &flags[0]);
+            for (size_t i = 0; i < n; i++) {
+                free(keys[i].data);
+            }
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+        }
+
         void db_remove(const string &name) {
             int r = env->dbremove(env, cc().txn().db_txn(), name.c_str(), NULL, 0);
             if (r == ENOENT) {
@@ -341,6 +560,41 @@ namespace mongo {
                            r == 0);
         }
 
+        static void append_status_row(BSONObjBuilder &status, TOKU_ENGINE_STATUS_ROW row) {
+            switch (row->type) {
+            case FS_STATE:
+            case UINT64:
+                status.appendNumber( row->keyname, (long long) row->value.num );
+                break;
+            case CHARSTR:
+                status.append( row->keyname, row->value.str );
+                break;
+            case UNIXTIME:
+                {
+                    time_t t = row->value.num;
+                    char tbuf[26];
+                    status.appendNumber( row->keyname, (long long) ctime_r(&t, tbuf) );
+                }
+                break;
+            case TOKUTIME:
+                status.appendNumber( row->keyname, tokutime_to_seconds(row->value.num) );
+                break;
+            case PARCOUNT:
+                {
+                    uint64_t v = read_partitioned_counter(row->value.parcount);
+                    status.appendNumber( row->keyname, (long long) v );
+                }
+                break;
+            default:
+                {
+                    StringBuilder s;
+                    s << "Unknown type. Code: " << (int) row->type;
+                    status.append( row->keyname, s.str() );
+                }
+                break;
+            }
+        }
+
         void get_status(BSONObjBuilder &status) {
             uint64_t num_rows;
             uint64_t max_rows;
@@ -380,39 +634,47 @@ namespace mongo {
                         status.append( "filesystem status", s.str() );
                     }
             }
+            for (uint64_t i = 0; i < num_rows; i++) {
+                append_status_row(status, &mystat[i]);
+            }
+        }
+
+        // The rows of engine status that describe cachetable pressure:
+        // evictions, partial evictions and how often nodes or their
+        // partitions had to be fetched back in.
+        static const char *cachetable_status_prefixes[] = {
+            "CT_",
+            "FT_PARTIAL_EVICTIONS",
+            "FT_FULL_EVICTIONS",
+            "FT_NUM_BASEMENTS_FETCHED",
+            "FT_NUM_MSG_BUFFER_FETCHED",
+            NULL
+        };
+
+        void get_cachetable_status(BSONObjBuilder &status) {
+            uint64_t num_rows;
+            uint64_t max_rows;
+            uint64_t panic;
+            size_t panic_string_len = 128;
+            char panic_string[panic_string_len];
+            fs_redzone_state redzone_state;
+
+            int r = storage::env->get_engine_status_num_rows(storage::env, &max_rows);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+            TOKU_ENGINE_STATUS_ROW_S mystat[max_rows];
+            r = env->get_engine_status(env, mystat, max_rows, &num_rows, &redzone_state, &panic, panic_string, panic_string_len, TOKU_ENGINE_STATUS);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
             for (uint64_t i = 0; i < num_rows; i++) {
                 TOKU_ENGINE_STATUS_ROW row = &mystat[i];
-                switch (row->type) {
-                case FS_STATE:
-                case UINT64:
-                    status.appendNumber( row->keyname, (long long) row->value.num );
-                    break;
-                case CHARSTR:
-                    status.append( row->keyname, row->value.str );
-                    break;
-                case UNIXTIME:
-                    {
-                        time_t t = row->value.num;
-                        char tbuf[26];
-                        status.appendNumber( row->keyname, (long long) ctime_r(&t, tbuf) );
+                for (const char **prefix = cachetable_status_prefixes; *prefix != NULL; prefix++) {
+                    if (str::startsWith(row->keyname, *prefix)) {
+                        append_status_row(status, row);
+                        break;
                     }
-                    break;
-                case TOKUTIME:
-                    status.appendNumber( row->keyname, tokutime_to_seconds(row->value.num) );
-                    break;
-                case PARCOUNT:
-                    {
-                        uint64_t v = read_partitioned_counter(row->value.parcount);
-                        status.appendNumber( row->keyname, (long long) v );
-                    }
-                    break;
-                default:
-                    {
-                        StringBuilder s;
-                        s << "Unknown type. Code: " << (int) row->type;
-                        status.append( row->keyname, s.str() );
-                    }
-                    break;                
                 }
             }
         }
@@ -426,7 +688,7 @@ namespace mongo {
             }
         }
 
-        void checkpoint() {
+        static void _checkpoint() {
             // Run a checkpoint. The zeros mean nothing (bdb-API artifacts).
             int r = env->txn_checkpoint(env, 0, 0, 0);
             if (r != 0) {
@@ -434,6 +696,53 @@ namespace mongo {
             }
         }
 
+        // Number of hold_checkpoints() callers that haven't released yet.
+        static SimpleMutex _checkpointHoldMutex("checkpointHold");
+        static int _checkpointHolds = 0;
+
+        void checkpoint() {
+            {
+                SimpleMutex::scoped_lock lk(_checkpointHoldMutex);
+                uassert(16893, "checkpoints are held for a physical initial sync", _checkpointHolds == 0);
+            }
+            _checkpoint();
+        }
+
+        void hold_checkpoints() {
+            SimpleMutex::scoped_lock lk(_checkpointHoldMutex);
+            if (_checkpointHolds++ > 0) {
+                return;
+            }
+            // A period of zero stops the checkpointer thread. Our own
+            // checkpoint waits for one the thread may have begun.
+            int r = env->checkpointing_set_period(env, 0);
+            if (r != 0) {
+                _checkpointHolds--;
+                handle_ydb_error(r);
+            }
+            try {
+                _checkpoint();
+            } catch (...) {
+                _checkpointHolds--;
+                env->checkpointing_set_period(env, cmdLine.checkpointPeriod);
+                throw;
+            }
+            TOKULOG(1) << "checkpoints held" << endl;
+        }
+
+        void release_checkpoints() {
+            SimpleMutex::scoped_lock lk(_checkpointHoldMutex);
+            verify(_checkpointHolds > 0);
+            if (--_checkpointHolds > 0) {
+                return;
+            }
+            int r = env->checkpointing_set_period(env, cmdLine.checkpointPeriod);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+            TOKULOG(1) << "checkpoints released, period " << cmdLine.checkpointPeriod << " seconds." << endl;
+        }
+
         void set_log_flush_interval(uint32_t period_ms) {
             cmdLine.logFlushPeriod = period_ms;
             env->change_fsync_log_period(env, cmdLine.logFlushPeriod);
@@ -441,7 +750,13 @@ namespace mongo {
         }
 
         void set_checkpoint_period(uint32_t period_seconds) {
+            SimpleMutex::scoped_lock lk(_checkpointHoldMutex);
             cmdLine.checkpointPeriod = period_seconds;
+            if (_checkpointHolds > 0) {
+                // release_checkpoints() applies it
+                TOKULOG(1) << "checkpoint period set to " << period_seconds << " seconds, once released." << endl;
+                return;
+            }
             int r = env->checkpointing_set_period(env, period_seconds);
             if (r != 0) {
                 handle_ydb_error(r);
@@ -18,6 +18,7 @@
 
 #include "mongo/pch.h"
 #include "mongo/bson/bsonobj.h"
+#include "mongo/bson/bsonmisc.h"
 
 #include <db.h>
 
@@ -27,17 +28,60 @@ namespace mongo {
 
         extern DB_ENV *env;
 
+        // Applies an update message to the existing object oldObj. Returns
+        // false if the object should be left as it is.
+        typedef bool (*UpdateMessageFunction)(const BSONObj &oldObj, const BSONObj &msg, BSONObj &newObj);
+
+        // The ydb may apply update messages during recovery, so this must be
+        // called before startup() by anything that might issue them.
+        void set_update_message_function(UpdateMessageFunction f);
+
+        // Generates the keys for obj in the index described by info, whose
+        // dictionary is db. Used to generate secondary rows for put_multiple
+        // and del_multiple, during normal operation and recovery alike, so
+        // like the update message function it must be set before startup().
+        typedef void (*GenerateKeysFunction)(DB *db, const BSONObj &info, const BSONObj &obj, BSONObjSet &keys);
+        void set_generate_keys_function(GenerateKeysFunction f);
+
+        // Notes that the object with primary key pk got a placeholder row in
+        // db, because it doesn't have exactly one key there, see generate_key
+        // in env.cpp. May be called from several threads at once.
+        typedef void (*NoteMisfitFunction)(DB *db, const BSONObj &pk);
+        void set_note_misfit_function(NoteMisfitFunction f);
+
+        // @return true if db's descriptor has the index info, so put_multiple
+        // and del_multiple may generate rows for it.
+        bool descriptor_has_info(const DB *db);
+
         void startup(void);
         void shutdown(void);
 
         int db_open(DB **dbp, const string &name, const BSONObj &info, bool may_create);
         void db_close(DB *db);
         void db_remove(const string &name);
+
+        // Write the row (src_key, src_val) to src_db, if it is the first of
+        // dbs, and a generated row to every other db, in one ydb call.
+        // src_prelocked skips the row lock in src_db alone.
+        void put_multiple(DB *src_db, const DBT *src_key, const DBT *src_val,
+                          const std::vector<DB *> &dbs, bool prelocked, bool src_prelocked = false);
+        // Delete src_key from src_db, if it is the first of dbs, and the
+        // generated key from every other db, in one ydb call.
+        void del_multiple(DB *src_db, const DBT *src_key, const DBT *src_val,
+                          const std::vector<DB *> &dbs, bool prelocked);
         void db_rename(const string &old_name, const string &new_name);
 
         void get_status(BSONObjBuilder &status);
+        // Just the cachetable eviction and fetch counters from get_status.
+        void get_cachetable_status(BSONObjBuilder &status);
         void log_flush();
         void checkpoint();
+        // Holds off checkpoints until every hold is released, so that the
+        // dictionary files keep the blocks of the last checkpoint and the
+        // logs since it are not trimmed. The first hold takes a checkpoint
+        // once no other can start, to keep the logs to replay short.
+        void hold_checkpoints();
+        void release_checkpoints();
 
         void set_log_flush_interval(uint32_t period_ms);
         void set_checkpoint_period(uint32_t period_seconds);
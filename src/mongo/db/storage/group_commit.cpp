@@ -0,0 +1,125 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/storage/group_commit.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/storage/env.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace storage {
+
+        GroupCommit groupCommit;
+
+        namespace {
+
+            // [0..1], [2..2], [3..4], ..., [2049..max]
+            Histogram::Options batchSizeOptions() {
+                Histogram::Options opts;
+                opts.numBuckets = 13;
+                opts.bucketSize = 1;
+                opts.exponential = true;
+                return opts;
+            }
+
+            // [0..100], [101..200], [201..400], ..., [1638401..max] microseconds
+            Histogram::Options latencyOptions() {
+                Histogram::Options opts;
+                opts.numBuckets = 16;
+                opts.bucketSize = 100;
+                opts.exponential = true;
+                return opts;
+            }
+
+            void appendHistogram(BSONObjBuilder &b, const char *name, const Histogram &h) {
+                BSONArrayBuilder ab(b.subarrayStart(name));
+                for (uint32_t i = 0; i < h.getBucketsNum(); i++) {
+                    BSONObjBuilder bucket(ab.subobjStart());
+                    if (i + 1 < h.getBucketsNum()) {
+                        bucket.append("upTo", h.getBoundary(i));
+                    }
+                    bucket.appendNumber("count", (long long) h.getCount(i));
+                    bucket.done();
+                }
+                ab.done();
+            }
+
+        } // namespace
+
+        GroupCommit::GroupCommit() :
+            _flushing(false),
+            _requested(0),
+            _durable(0),
+            _flushes(0),
+            _flushMicros(0),
+            _batchSizes(batchSizeOptions()),
+            _latencies(latencyOptions()) {
+        }
+
+        void GroupCommit::waitDurable() {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            const unsigned long long ticket = ++_requested;
+            while (_durable < ticket) {
+                if (_flushing) {
+                    _flushed.wait(lk);
+                    continue;
+                }
+
+                // Everyone who holds a ticket up to target committed before
+                // this flush starts, so it makes all of them durable.
+                const unsigned long long target = _requested;
+                _flushing = true;
+                lk.unlock();
+                const unsigned long long start = curTimeMicros64();
+                try {
+                    log_flush();
+                }
+                catch (...) {
+                    // Let a waiter try again as the next leader.
+                    lk.lock();
+                    _flushing = false;
+                    _flushed.notify_all();
+                    throw;
+                }
+                const unsigned long long micros = curTimeMicros64() - start;
+                lk.lock();
+
+                _batchSizes.insert(target - _durable);
+                _latencies.insert(std::min(micros, 0xffffffffULL));
+                _flushes++;
+                _flushMicros += micros;
+                _durable = target;
+                _flushing = false;
+                _flushed.notify_all();
+            }
+        }
+
+        void GroupCommit::appendStats(BSONObjBuilder &b) const {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            b.appendNumber("commits", (long long) _durable);
+            b.appendNumber("flushes", (long long) _flushes);
+            b.appendNumber("flushMicros", (long long) _flushMicros);
+            appendHistogram(b, "batchSizes", _batchSizes);
+            appendHistogram(b, "flushLatencyMicros", _latencies);
+        }
+
+    } // namespace storage
+
+} // namespace mongo
@@ -0,0 +1,74 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/util/histogram.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    namespace storage {
+
+        /**
+         * Shares recovery log fsyncs between concurrent committers.
+         *
+         * A committer commits with DB_TXN_NOSYNC and then calls waitDurable().
+         * If no flush is running, it becomes the leader and flushes the whole
+         * log, which covers its own commit and those of everyone who arrived
+         * before the flush began. Otherwise it waits for the running flush to
+         * finish and, if that flush began before it arrived, for the next one,
+         * which some waiter will lead. Each caller takes a ticket on arrival,
+         * after its commit, so the ydb's log_flush(NULL) stands in for waiting
+         * on the commit's LSN, which the ydb does not hand out.
+         */
+        class GroupCommit : boost::noncopyable {
+        public:
+            GroupCommit();
+
+            // Returns once everything committed before the call is on disk.
+            void waitDurable();
+
+            // flush and commit counts, batch size and latency histograms
+            void appendStats(BSONObjBuilder &b) const;
+
+        private:
+            mutable boost::mutex _mutex;
+            boost::condition_variable _flushed;
+            bool _flushing;
+            // tickets handed out, and the last ticket known to be durable
+            unsigned long long _requested;
+            unsigned long long _durable;
+
+            unsigned long long _flushes;
+            unsigned long long _flushMicros;
+            // commits made durable by one fsync
+            Histogram _batchSizes;
+            // microseconds spent in one fsync
+            Histogram _latencies;
+        };
+
+        extern GroupCommit groupCommit;
+
+    } // namespace storage
+
+} // namespace mongo
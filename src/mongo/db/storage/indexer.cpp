@@ -0,0 +1,94 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/curop.h"
+#include "mongo/db/interrupt_status.h"
+#include "mongo/db/storage/env.h"
+#include "mongo/db/storage/indexer.h"
+
+namespace mongo {
+
+    namespace storage {
+
+        Indexer::Indexer(DB *src_db, DB *dest_db) :
+            _dest_db(dest_db), _indexer(NULL),
+            _poll_extra(cc()), _closed(false) {
+
+            uint32_t db_flags = 0;
+            const int indexer_flags = 0;
+            int r = storage::env->create_indexer(storage::env, cc().txn().db_txn(),
+                                                 &_indexer, src_db, 1, &_dest_db,
+                                                 &db_flags, indexer_flags);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+            r = _indexer->set_poll_function(_indexer, poll_function, &_poll_extra);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+        }
+
+        Indexer::~Indexer() {
+            if (!_closed && _indexer != NULL) {
+                int r = _indexer->abort(_indexer);
+                if (r != 0) {
+                    problem() << "storage::~Indexer, failed to abort DB_INDEXER, error: "
+                              << r << endl;
+                }
+            }
+        }
+
+        int Indexer::poll_function(void *extra, float progress) {
+            poll_function_extra *info = static_cast<poll_function_extra *>(extra);
+            try {
+                killCurrentOp.checkForInterrupt(info->c); // uasserts if we should stop
+                // Report progress in currentOp, in tenths of a percent.
+                const unsigned long long permille = static_cast<unsigned long long>(progress * 1000);
+                if (permille > info->permille) {
+                    info->c.curop()->getProgressMeter().hit(permille - info->permille);
+                    info->permille = permille;
+                }
+                return 0;
+            } catch (std::exception &e) {
+                info->ex = &e;
+                return -1;
+            }
+        }
+
+        int Indexer::build() {
+            _poll_extra.c.curop()->setMessage("index: (hot) building", 1000);
+            const int r = _indexer->build(_indexer);
+            if (r == -1) {
+                verify(_poll_extra.ex != NULL);
+                throw *_poll_extra.ex;
+            }
+            return r;
+        }
+
+        int Indexer::close() {
+            const int r = _indexer->close(_indexer);
+            if (r == 0) {
+                _closed = true;
+                _poll_extra.c.curop()->getProgressMeter().finished();
+            }
+            return r;
+        }
+
+    } // namespace storage
+
+} // namespace mongo
@@ -0,0 +1,58 @@
+/**
+*    Copyright (C) 2013 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+#include "mongo/db/client.h"
+
+#include <db.h>
+
+namespace mongo {
+
+    namespace storage {
+
+        // RAII wrapper for a DB_INDEXER, which fills dest_db from the rows
+        // in src_db while other transactions keep writing to both.
+        class Indexer {
+        public:
+
+            Indexer(DB *src_db, DB *dest_db);
+
+            ~Indexer();
+
+            int build();
+
+            int close();
+
+            struct poll_function_extra {
+                poll_function_extra(Client &client) : c(client), ex(NULL), permille(0) { }
+                Client &c;
+                std::exception *ex;
+                unsigned long long permille;
+            };
+            static int poll_function(void *extra, float progress);
+
+        private:
+            DB *_dest_db;
+            DB_INDEXER *_indexer;
+            poll_function_extra _poll_extra;
+            bool _closed;
+        };
+
+    } // namespace storage
+
+} // namespace mongo
@@ -26,16 +26,26 @@ namespace mongo {
     namespace storage {
 
         Loader::Loader(DB *db) :
-            _db(db), _loader(NULL),
+            _loader(NULL),
             _poll_extra(cc()), _closed(false) {
+            init(db, &db, 1);
+        }
+
+        Loader::Loader(DB **dbs, int n) :
+            _loader(NULL),
+            _poll_extra(cc()), _closed(false) {
+            // no source dictionary, so every row is generated
+            init(NULL, dbs, n);
+        }
 
-            uint32_t db_flags = 0;
-            uint32_t dbt_flags = 0;
+        void Loader::init(DB *src_db, DB **dbs, int n) {
+            std::vector<uint32_t> db_flags(n, 0);
+            std::vector<uint32_t> dbt_flags(n, 0);
             // TODO: Use a command line option for LOADER_COMPRESS_INTERMEDIATES
             const int loader_flags = 0; 
             int r = storage::env->create_loader(storage::env, cc().txn().db_txn(),
-                                                &_loader, _db, 1, &_db,
-                                                &db_flags, &dbt_flags, loader_flags);
+                                                &_loader, src_db, n, dbs,
+                                                &db_flags[0], &dbt_flags[0], loader_flags);
             if (r != 0) {
                 handle_ydb_error(r);
             }
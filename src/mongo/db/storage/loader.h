@@ -31,6 +31,11 @@ namespace mongo {
 
             Loader(DB *db);
 
+            // Loads every one of the n dbs at once. Each put is a primary
+            // row, from which the environment's generate_row callback makes
+            // the row for each db (see storage::set_generate_keys_function).
+            Loader(DB **dbs, int n);
+
             ~Loader();
 
             int put(DBT *key, DBT *val);
@@ -45,7 +50,8 @@ namespace mongo {
             static int poll_function(void *extra, float progress);
 
         private:
-            DB *_db;
+            void init(DB *src_db, DB **dbs, int n);
+
             DB_LOADER *_loader;
             poll_function_extra _poll_extra;
             bool _closed;
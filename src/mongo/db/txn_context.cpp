@@ -417,6 +417,11 @@ namespace mongo {
         c.sizeDelta -= size;
     }
 
+    void CappedCollectionRollback::noteUpdate(const string &ns, long long sizeDelta) {
+        Context &c = _map[ns];
+        c.sizeDelta += sizeDelta;
+    }
+
     bool CappedCollectionRollback::hasNotedInsert(const string &ns) {
         const Context &c = _map[ns];
         return !c.minPK.isEmpty();
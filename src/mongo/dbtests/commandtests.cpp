@@ -83,6 +83,142 @@ namespace CommandTests {
         };
     }
 
+    namespace CreateIndexes {
+        struct Base {
+            Base() {
+                db.dropCollection(ns());
+                for (int i = 0; i < 100; i++) {
+                    db.insert(ns(), BSON("_id" << i << "a" << i << "b" << (i % 10) << "c" << BSON_ARRAY(i << -i)));
+                }
+            }
+            ~Base() {
+                db.dropCollection(ns());
+            }
+
+            const char* ns() { return "test.createindexes"; }
+            BSONObj spec(const BSONObj &key, const char *name, bool unique = false) {
+                BSONObjBuilder b;
+                b.append("key", key);
+                b.append("name", name);
+                if (unique) {
+                    b.appendBool("unique", true);
+                }
+                return b.obj();
+            }
+
+            DBDirectClient db;
+        };
+        struct BuildsAll : Base {
+            void run() {
+                BSONObj result;
+                ASSERT( db.runCommand("test", BSON("createIndexes" << "createindexes" << "indexes" <<
+                                                   BSON_ARRAY(spec(BSON("a" << 1), "a_1", true) <<
+                                                              spec(BSON("b" << 1), "b_1") <<
+                                                              spec(BSON("c" << 1), "c_1"))), result) );
+                ASSERT_EQUALS( 1, result["numIndexesBefore"].numberInt() );
+                ASSERT_EQUALS( 4, result["numIndexesAfter"].numberInt() );
+                ASSERT_EQUALS( 4U, db.count("test.system.indexes", BSON("ns" << ns())) );
+                ASSERT_EQUALS( 10U, db.count(ns(), BSON("b" << 3)) );
+                ASSERT_EQUALS( 1U, db.count(ns(), BSON("c" << -5)) );
+                ASSERT( db.findOne(ns(), Query(BSON("b" << 3)).hint(BSON("b" << 1))).hasField("_id") );
+            }
+        };
+        // "d" is only an array in the last document and "e" is only in every
+        // other one, so neither is known not to fit the shared loader until
+        // the scan has seen them.
+        struct MultikeyAndSparse : Base {
+            void run() {
+                db.update(ns(), BSON("_id" << 99), BSON("$set" << BSON("d" << BSON_ARRAY(1 << 2 << 3))));
+                for (int i = 0; i < 100; i += 2) {
+                    db.update(ns(), BSON("_id" << i), BSON("$set" << BSON("e" << i)));
+                }
+                BSONObj result;
+                ASSERT( db.runCommand("test", BSON("createIndexes" << "createindexes" << "indexes" <<
+                                                   BSON_ARRAY(spec(BSON("b" << 1), "b_1") <<
+                                                              spec(BSON("d" << 1), "d_1") <<
+                                                              BSON("key" << BSON("e" << 1) << "name" << "e_1" << "sparse" << true))), result) );
+                ASSERT_EQUALS( 4, result["numIndexesAfter"].numberInt() );
+                ASSERT_EQUALS( 10U, db.count(ns(), BSON("b" << 3)) );
+                ASSERT_EQUALS( 1, count(BSON("d" << 2), BSON("d" << 1)) );
+                ASSERT_EQUALS( 99, count(BSON("d" << BSONNULL), BSON("d" << 1)) );
+                ASSERT_EQUALS( 50, count(BSON("e" << GTE << 0), BSON("e" << 1)) );
+            }
+            int count(const BSONObj &query, const BSONObj &hint) {
+                return db.query(ns(), Query(query).hint(hint))->itcount();
+            }
+        };
+        struct DupKeyBuildsNone : Base {
+            void run() {
+                BSONObj result;
+                ASSERT( !db.runCommand("test", BSON("createIndexes" << "createindexes" << "indexes" <<
+                                                    BSON_ARRAY(spec(BSON("a" << 1), "a_1") <<
+                                                               spec(BSON("b" << 1), "b_1", true))), result) );
+                ASSERT_EQUALS( 1U, db.count("test.system.indexes", BSON("ns" << ns())) );
+            }
+        };
+    }
+
+    namespace ParallelScans {
+        struct Base {
+            Base() {
+                db.dropCollection(ns());
+                const string pad(200, 'x');
+                for (int i = 0; i < 10000; i++) {
+                    db.insert(ns(), BSON("_id" << i << "a" << (i % 7) << "b" << BSON_ARRAY(i % 3 << i % 5) << "pad" << pad));
+                }
+            }
+            ~Base() {
+                db.dropCollection(ns());
+            }
+
+            const char* ns() { return "test.parallelscan"; }
+            BSONObj runCommand(const BSONObj &cmd) {
+                BSONObj result;
+                ASSERT( db.runCommand("test", cmd, result) );
+                return result;
+            }
+
+            DBDirectClient db;
+        };
+        struct Count : Base {
+            void run() {
+                for (int p = 1; p <= 8; p *= 2) {
+                    ASSERT_EQUALS( 10000, runCommand(BSON("count" << "parallelscan" << "parallelism" << p))["n"].numberInt() );
+                    ASSERT_EQUALS( 1428, runCommand(BSON("count" << "parallelscan" << "query" << BSON("a" << 6) <<
+                                                  "parallelism" << p))["n"].numberInt() );
+                }
+            }
+        };
+        struct Distinct : Base {
+            void run() {
+                BSONObj serial = runCommand(BSON("distinct" << "parallelscan" << "key" << "b" <<
+                                          "query" << BSON("a" << BSON("$gt" << 2)) << "parallelism" << 1));
+                ASSERT_EQUALS( 5, serial["values"].Obj().nFields() );
+                for (int p = 2; p <= 8; p *= 2) {
+                    BSONObj parallel = runCommand(BSON("distinct" << "parallelscan" << "key" << "b" <<
+                                                "query" << BSON("a" << BSON("$gt" << 2)) << "parallelism" << p));
+                    // ranges are merged in primary key order, so even the order matches
+                    ASSERT_EQUALS( serial["values"].Obj(), parallel["values"].Obj() );
+                    ASSERT_EQUALS( serial["stats"]["n"].numberLong(), parallel["stats"]["n"].numberLong() );
+                }
+            }
+        };
+        // Run inside a transaction that has written, as a DBDirectClient
+        // call made while writing is, the scans have to see the writes, so
+        // they stay serial.
+        struct InWriteTransaction : Base {
+            void run() {
+                Client::Transaction txn(DB_SERIALIZABLE);
+                db.insert(ns(), BSON("_id" << 10000 << "a" << 6 << "b" << BSON_ARRAY(7)));
+                ASSERT_EQUALS( 10001, runCommand(BSON("count" << "parallelscan" << "parallelism" << 8))["n"].numberInt() );
+                BSONObj distinct = runCommand(BSON("distinct" << "parallelscan" << "key" << "b" << "parallelism" << 8));
+                ASSERT_EQUALS( 6, distinct["values"].Obj().nFields() );
+                ASSERT( !distinct["stats"].Obj().hasField("parallelism") );
+                txn.abort();
+            }
+        };
+    }
+
     class All : public Suite {
     public:
         All() : Suite( "commands" ) {
@@ -91,6 +227,12 @@ namespace CommandTests {
         void setupTests() {
             add< FileMD5::Type0 >();
             add< FileMD5::Type2 >();
+            add< CreateIndexes::BuildsAll >();
+            add< CreateIndexes::MultikeyAndSparse >();
+            add< CreateIndexes::DupKeyBuildsNone >();
+            add< ParallelScans::Count >();
+            add< ParallelScans::Distinct >();
+            add< ParallelScans::InWriteTransaction >();
         }
 
     } all;
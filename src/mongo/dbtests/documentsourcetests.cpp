@@ -25,6 +25,7 @@
 #include "mongo/db/client.h"
 #include "mongo/db/interrupt_status_mongod.h"
 #include "mongo/db/pipeline/expression_context.h"
+#include "mongo/s/shard.h"
 
 #include "dbtests.h"
 
@@ -362,7 +363,7 @@ namespace DocumentSourceTests {
 
         class Base : public DocumentSourceCursor::Base {
         protected:
-            void createGroup( const BSONObj &spec, bool inShard = false ) {
+            void createGroup( const BSONObj &spec, bool inShard = false, bool allowDiskUse = false ) {
                 BSONObj namedSpec = BSON( "$group" << spec );
                 BSONElement specElement = namedSpec.firstElement();
                 intrusive_ptr<ExpressionContext> expressionContext =
@@ -370,6 +371,7 @@ namespace DocumentSourceTests {
                 if ( inShard ) {
                     expressionContext->setInShard( true );
                 }
+                expressionContext->setAllowDiskUse( allowDiskUse );
                 _group = DocumentSourceGroup::createFromBson( &specElement, expressionContext );
                 assertRoundTrips( _group );
                 _group->setSource( source() );
@@ -883,6 +885,85 @@ namespace DocumentSourceTests {
             string expectedResultSetString() { return "[{_id:[1,2,3],a:[[4,5,6]]}]"; }
         };
 
+        /** Groups that outgrow the memory limit are spilled to disk and re-aggregated. */
+        class Spill : public CheckResultsBase {
+        public:
+            void run() {
+                runSpilled( false );
+                client.dropCollection( ns );
+                runSpilled( true );
+            }
+        protected:
+            virtual bool allowDiskUse() { return true; }
+            virtual void checkSpillDepth( int depth ) { ASSERT( depth >= 0 ); }
+        private:
+            void runSpilled( bool sharded ) {
+                populateData();
+                createSource();
+                createGroup( groupSpec(), false, allowDiskUse() );
+
+                intrusive_ptr<DocumentSource> sink = group();
+                if ( sharded ) {
+                    sink = createMerger();
+                    createGroup( toBson( group() )[ "$group" ].Obj(), true, allowDiskUse() );
+                    sink->setSource( group() );
+                }
+                // Spill after every document.
+                DocumentSourceGroup *spilling = static_cast<DocumentSourceGroup*>( group() );
+                spilling->setMaxMemoryUsageBytes( 1 );
+
+                checkResultSet( sink );
+                checkSpillDepth( spilling->getSpillDepth() );
+            }
+            void populateData() {
+                for( int i = 0; i < 20; ++i ) {
+                    client.insert( ns, BSON( "_id" << i << "id" << i % 4 << "a" << i ) );
+                }
+            }
+            BSONObj groupSpec() {
+                return fromjson( "{_id:'$id',sum:{$sum:'$a'},avg:{$avg:'$a'},"
+                                 "first:{$first:'$a'},last:{$last:'$a'},list:{$push:'$a'},"
+                                 "set:{$addToSet:{$mod:['$a',2]}}}" );
+            }
+            string expectedResultSetString() {
+                return "[{_id:0,sum:40,avg:8,first:0,last:16,list:[0,4,8,12,16],set:[0]},"
+                        "{_id:1,sum:45,avg:9,first:1,last:17,list:[1,5,9,13,17],set:[1]},"
+                        "{_id:2,sum:50,avg:10,first:2,last:18,list:[2,6,10,14,18],set:[0]},"
+                        "{_id:3,sum:55,avg:11,first:3,last:19,list:[3,7,11,15,19],set:[1]}]";
+            }
+        };
+
+        /** Without allowDiskUse, groups stay in memory however much they use. */
+        class NoSpillWithoutAllowDiskUse : public Spill {
+        protected:
+            virtual bool allowDiskUse() { return false; }
+            virtual void checkSpillDepth( int depth ) { ASSERT_EQUALS( -1, depth ); }
+        };
+
+        /** Spilled partitions that still outgrow the memory limit are split again. */
+        class SpillRepartitions : public Spill {
+        protected:
+            // 200 groups over 16 partitions put at least two groups in one of them.
+            virtual void checkSpillDepth( int depth ) { ASSERT( depth >= 1 ); }
+        private:
+            void populateData() {
+                for( int i = 0; i < 1000; ++i ) {
+                    client.insert( ns, BSON( "_id" << i << "id" << i % 200 << "a" << i ) );
+                }
+            }
+            BSONObj groupSpec() {
+                return fromjson( "{_id:'$id',sum:{$sum:'$a'},first:{$first:'$a'},last:{$last:'$a'}}" );
+            }
+            BSONObj expectedResultSet() {
+                BSONArrayBuilder expected;
+                for( int i = 0; i < 200; ++i ) {
+                    expected << BSON( "_id" << i << "sum" << 5 * i + 2000 <<
+                                      "first" << i << "last" << i + 800 );
+                }
+                return expected.arr();
+            }
+        };
+
     } // namespace DocumentSourceGroup
 
     namespace DocumentSourceProject {
@@ -1412,6 +1493,73 @@ namespace DocumentSourceTests {
             }
         };
         
+        /** A $limit following the sort is absorbed, and only the top documents are kept. */
+        class CoalesceLimit : public Base {
+        public:
+            void run() {
+                for ( int i = 0; i < 10; ++i ) {
+                    client.insert( ns, BSON( "_id" << i << "a" << ( i * 7 ) % 10 ) );
+                }
+                createSource();
+                BSONObj sortSpec = BSON( "$sort" << BSON( "a" << -1 ) );
+                BSONElement sortElement = sortSpec.firstElement();
+                intrusive_ptr<DocumentSource> sort =
+                        DocumentSourceSort::createFromBson( &sortElement, ctx() );
+                BSONObj limitSpec = BSON( "$limit" << 3 );
+                BSONElement limitElement = limitSpec.firstElement();
+                ASSERT( sort->coalesce( mongo::DocumentSourceLimit::createFromBson( &limitElement,
+                                                                                    ctx() ) ) );
+                // The limit is written back out after the sort.
+                BSONArrayBuilder bab;
+                sort->addToBsonArray( &bab, false );
+                ASSERT_EQUALS( BSON_ARRAY( sortSpec << limitSpec ), bab.arr() );
+
+                sort->setSource( source() );
+                for ( int a = 9; a >= 7; --a ) {
+                    ASSERT( !sort->eof() );
+                    ASSERT_EQUALS( a, sort->getCurrent()->getField( "a" )->getInt() );
+                    sort->advance();
+                }
+                ASSERT( sort->eof() );
+            }
+        };
+
+        /** The router merges the shards' sorted outputs, applying the limit. */
+        class RouterMerge : public Base {
+        public:
+            void run() {
+                BSONObj sortSpec = BSON( "$sort" << BSON( "a" << 1 ) );
+                BSONElement sortElement = sortSpec.firstElement();
+                intrusive_ptr<DocumentSourceSort> sort = static_cast<DocumentSourceSort*>(
+                        DocumentSourceSort::createFromBson( &sortElement, ctx() ).get() );
+                BSONObj limitSpec = BSON( "$limit" << 5 );
+                BSONElement limitElement = limitSpec.firstElement();
+                ASSERT( sort->coalesce( mongo::DocumentSourceLimit::createFromBson( &limitElement,
+                                                                                    ctx() ) ) );
+                // Each shard runs the sort itself.
+                ASSERT( sort->getShardSource() == sort );
+                intrusive_ptr<DocumentSource> merger = sort->getRouterSource();
+
+                DocumentSourceCommandShards::ShardOutput shardOutput;
+                shardOutput[ Shard( "shard0", "localhost:30000" ) ] =
+                        fromjson( "{ok:1,result:[{a:1},{a:4},{a:6}]}" );
+                shardOutput[ Shard( "shard1", "localhost:30001" ) ] =
+                        fromjson( "{ok:1,result:[]}" );
+                shardOutput[ Shard( "shard2", "localhost:30002" ) ] =
+                        fromjson( "{ok:1,result:[{a:2},{a:3},{a:5},{a:7}]}" );
+                intrusive_ptr<DocumentSourceCommandShards> shards =
+                        DocumentSourceCommandShards::create( shardOutput, ctx() );
+                merger->setSource( shards.get() );
+
+                for ( int a = 1; a <= 5; ++a ) {
+                    ASSERT( !merger->eof() );
+                    ASSERT_EQUALS( a, merger->getCurrent()->getField( "a" )->getInt() );
+                    ASSERT_EQUALS( a < 5, merger->advance() );
+                }
+                ASSERT( merger->eof() );
+            }
+        };
+
     } // namespace DocumentSourceSort
 
     namespace DocumentSourceUnwind {
@@ -1780,6 +1928,9 @@ namespace DocumentSourceTests {
             add<DocumentSourceGroup::Dependencies>();
             add<DocumentSourceGroup::StringConstantIdAndAccumulatorExpressions>();
             add<DocumentSourceGroup::ArrayConstantAccumulatorExpression>();
+            add<DocumentSourceGroup::Spill>();
+            add<DocumentSourceGroup::NoSpillWithoutAllowDiskUse>();
+            add<DocumentSourceGroup::SpillRepartitions>();
 
             add<DocumentSourceProject::EofInit>();
             add<DocumentSourceProject::AdvanceInit>();
@@ -1815,6 +1966,8 @@ namespace DocumentSourceTests {
             add<DocumentSourceSort::MissingObjectWithinArray>();
             add<DocumentSourceSort::ExtractArrayValues>();
             add<DocumentSourceSort::Dependencies>();
+            add<DocumentSourceSort::CoalesceLimit>();
+            add<DocumentSourceSort::RouterMerge>();
 
             add<DocumentSourceUnwind::EofInit>();
             add<DocumentSourceUnwind::AdvanceInit>();
@@ -20,6 +20,7 @@
 
 #include "mongo/db/pipeline/document.h"
 #include "mongo/db/pipeline/value.h"
+#include "mongo/util/timer.h"
 
 #include "dbtests.h"
 
@@ -73,6 +74,92 @@ namespace DocumentTests {
             }            
         };
 
+        /** A Document created from BSON it does not own outlives that BSON. */
+        class CreateFromUnownedBsonObj {
+        public:
+            void run() {
+                intrusive_ptr<Document> document;
+                {
+                    BSONObj outer = BSON( "x" << BSON( "a" << 1 << "b" << "q" ) );
+                    BSONObj inner = outer[ "x" ].Obj();
+                    ASSERT( !inner.isOwned() );
+                    document = fromBson( inner );
+                }
+                ASSERT_EQUALS( 1, document->getValue( "a" )->getInt() );
+                ASSERT_EQUALS( BSON( "a" << 1 << "b" << "q" ), toBson( document ) );
+                ASSERT_EQUALS( 2U, document->getFieldCount() );
+                ASSERT_EQUALS( "q", document->getField( 1 ).second->getString() );
+                assertRoundTrips( document );
+            }
+        };
+
+        /** A field looked up by name is converted once, and kept when materialized. */
+        class GetValueConvertsOnce {
+        public:
+            void run() {
+                intrusive_ptr<Document> document =
+                        fromBson( BSON( "a" << 1 << "b" << BSON( "c" << "d" ) ) );
+                intrusive_ptr<const Value> a = document->getValue( "a" );
+                intrusive_ptr<const Value> b = document->getValue( "b" );
+                ASSERT_EQUALS( a.get(), document->getValue( "a" ).get() );
+                ASSERT_EQUALS( b.get(), document->getField( "b" ).get() );
+                ASSERT( !document->getValue( "e" ) );
+                ASSERT( !document->getValue( "e" ) );
+                // Materializing reuses the Values already converted.
+                ASSERT_EQUALS( 2U, document->getFieldCount() );
+                ASSERT_EQUALS( a.get(), document->getField( 0 ).second.get() );
+                ASSERT_EQUALS( b.get(), document->getField( 1 ).second.get() );
+                ASSERT_EQUALS( "d", b->getDocument()->getValue( "c" )->getString() );
+                assertRoundTrips( document );
+            }
+        };
+
+        /** An embedded Document keeps the enclosing BSON alive rather than copying it. */
+        class EmbeddedOutlivesOwner {
+        public:
+            void run() {
+                intrusive_ptr<const Value> embedded;
+                {
+                    intrusive_ptr<Document> document =
+                            fromBson( BSON( "x" << BSON( "a" << BSON_ARRAY( BSON( "b" << 2 ) ) ) ) );
+                    embedded = document->getValue( "x" );
+                }
+                intrusive_ptr<Document> x = embedded->getDocument();
+                ASSERT_EQUALS( BSON( "a" << BSON_ARRAY( BSON( "b" << 2 ) ) ), toBson( x ) );
+                intrusive_ptr<const Value> element = x->getValue( "a" )->getArray()->next();
+                ASSERT_EQUALS( 2, element->getDocument()->getValue( "b" )->getInt() );
+            }
+        };
+
+        /**
+         * Times creating Documents from wide BSON with nested objects and reading a few fields
+         * from each, the way $match and a narrow $project do.
+         */
+        class LookupBenchmark {
+        public:
+            void run() {
+                BSONObjBuilder bob;
+                for ( int i = 0; i < 50; ++i ) {
+                    bob.append( string( str::stream() << "f" << i ), BSON( "x" << i << "y" << "text" ) );
+                }
+                BSONObj obj = bob.obj();
+                const int iterations = 100000;
+                Timer t;
+                long long sum = 0;
+                for ( int i = 0; i < iterations; ++i ) {
+                    intrusive_ptr<Document> document = fromBson( obj );
+                    for ( int j = 0; j < 4; ++j ) {
+                        intrusive_ptr<const Value> f = document->getValue( "f40" );
+                        sum += f->getDocument()->getValue( "x" )->getInt();
+                    }
+                }
+                const int ms = t.millis();
+                ASSERT_EQUALS( 160LL * iterations, sum );
+                cout << "Document " << iterations << " x 50 fields, 4 nested lookups: "
+                     << ms << "ms" << endl;
+            }
+        };
+
         /** Add Document fields. */
         class AddField {
         public:
@@ -1160,6 +1247,10 @@ namespace DocumentTests {
         void setupTests() {
             add<Document::Create>();
             add<Document::CreateFromBsonObj>();
+            add<Document::CreateFromUnownedBsonObj>();
+            add<Document::GetValueConvertsOnce>();
+            add<Document::EmbeddedOutlivesOwner>();
+            add<Document::LookupBenchmark>();
             add<Document::AddField>();
             add<Document::GetValue>();
             add<Document::SetField>();
@@ -31,7 +31,9 @@
 
 #include "mongo/db/client.h"
 #include "mongo/db/cmdline.h"
+#include "mongo/db/index.h"
 #include "mongo/db/instance.h"
+#include "mongo/db/ops/update.h"
 #include "mongo/db/storage/env.h"
 #include "mongo/unittest/unittest.h"
 #include "mongo/util/background.h"
@@ -222,6 +224,9 @@ namespace mongo {
             }
 
             mongo::setTxnCompleteHooks(&mongo::_txnCompleteHooks);
+            storage::set_update_message_function(mongo::applyUpdateMessage);
+            storage::set_generate_keys_function(mongo::IndexDetails::generateKeys);
+            storage::set_note_misfit_function(mongo::IndexDetails::noteMisfit);
             storage::startup();
 
             TestWatchDog twd;
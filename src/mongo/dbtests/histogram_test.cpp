@@ -18,6 +18,9 @@
 
 #include "../pch.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "dbtests.h"
 #include "../util/histogram.h"
 
@@ -79,6 +82,89 @@ namespace mongo {
         }
     };
 
+    class LatencyBuckets {
+    public:
+        void run() {
+            // exact below 8, then 8 buckets per power of two
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( 0 ), 0u );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( 7 ), 7u );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( 8 ), 8u );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( 15 ), 15u );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( 16 ), 16u );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( 17 ), 16u );
+            ASSERT_EQUALS( LatencyHistogram::bucketMax( 16 ), 17u );
+
+            // every value is in the bucket it maps to, and within 12.5% of its top
+            for ( uint64_t v = 0; v < 100000; v++ ) {
+                uint32_t b = LatencyHistogram::bucketFor( v );
+                ASSERT( v <= LatencyHistogram::bucketMax( b ) );
+                ASSERT( LatencyHistogram::bucketMax( b ) - v <= v / 8 );
+                if ( b > 0 ) {
+                    ASSERT( v > LatencyHistogram::bucketMax( b - 1 ) );
+                }
+            }
+
+            // larger values than it covers go in the last bucket
+            const uint32_t last = LatencyHistogram::NumBuckets - 1;
+            ASSERT_EQUALS( LatencyHistogram::bucketMax( last ), numeric_limits<uint32_t>::max() );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( numeric_limits<uint32_t>::max() ), last );
+            ASSERT_EQUALS( LatencyHistogram::bucketFor( numeric_limits<uint64_t>::max() ), last );
+        }
+    };
+
+    class LatencyPercentiles {
+    public:
+        void run() {
+            LatencyHistogram h;
+            ASSERT_EQUALS( h.count(), 0u );
+            ASSERT_EQUALS( h.percentile( 0.5 ), 0u );
+
+            for ( uint64_t v = 1; v <= 1000; v++ ) {
+                h.record( v );
+            }
+            ASSERT_EQUALS( h.count(), 1000u );
+            // 500 is in [480..511], 900 in [896..959], 990 and 999 in [960..1023]
+            ASSERT_EQUALS( h.percentile( 0.5 ), 511u );
+            ASSERT_EQUALS( h.percentile( 0.9 ), 959u );
+            ASSERT_EQUALS( h.percentile( 0.99 ), 1023u );
+            ASSERT_EQUALS( h.percentile( 0.999 ), 1023u );
+            ASSERT_EQUALS( h.percentile( 1 ), 1023u );
+            ASSERT_EQUALS( h.percentile( 0 ), 1u );
+
+            h.reset();
+            ASSERT_EQUALS( h.count(), 0u );
+            ASSERT_EQUALS( h.percentile( 0.99 ), 0u );
+        }
+    };
+
+    class LatencyConcurrentRecord {
+    public:
+        void run() {
+            // threads on different stripes, and sharing them, lose no values
+            check( true );
+            check( false );
+        }
+    private:
+        void check( bool striped ) {
+            LatencyHistogram h( striped );
+            boost::thread_group threads;
+            for ( int i = 0; i < 2 * LatencyHistogram::Stripes; i++ ) {
+                threads.create_thread( boost::bind( &LatencyConcurrentRecord::recordMany, &h ) );
+            }
+            threads.join_all();
+            ASSERT_EQUALS( h.count(), (uint64_t) ( 2 * LatencyHistogram::Stripes * PerThread ) );
+            ASSERT_EQUALS( h.percentile( 0.5 ), 511u );
+            h.reset();
+            ASSERT_EQUALS( h.count(), 0u );
+        }
+        enum { PerThread = 10000 };
+        static void recordMany( LatencyHistogram *h ) {
+            for ( int i = 0; i < PerThread; i++ ) {
+                h->record( 500 );
+            }
+        }
+    };
+
     class HistogramSuite : public Suite {
     public:
         HistogramSuite() : Suite( "histogram" ) {}
@@ -87,6 +173,9 @@ namespace mongo {
             add< BoundariesInit >();
             add< BoundariesExponential >();
             add< BoundariesFind >();
+            add< LatencyBuckets >();
+            add< LatencyPercentiles >();
+            add< LatencyConcurrentRecord >();
             // TODO: complete the test suite
         }
     } histogramSuite;
@@ -1094,6 +1094,25 @@ namespace JsobjTests {
                 }
             }
         };
+
+        class GenBatch {
+        public:
+            void run() {
+                OID oids[1000];
+                OID::gen(oids, 1000);
+                int wraps = 0;
+                for ( int i=1; i<1000; i++ ) {
+                    ASSERT_EQUALS( oids[0].asTimeT() , oids[i].asTimeT() );
+                    if ( oids[i] < oids[i-1] )
+                        wraps++; // the 3 byte counter wrapped
+                }
+                ASSERT( wraps <= 1 );
+                if ( wraps == 0 ) {
+                    OID next = OID::gen();
+                    ASSERT( !( oids[0] < next && next < oids[999] ) );
+                }
+            }
+        };
     } // namespace OIDTests
 
 
@@ -1907,6 +1926,7 @@ namespace JsobjTests {
             add< OIDTests::ToDate >();
             add< OIDTests::FromDate >();
             add< OIDTests::Seq >();
+            add< OIDTests::GenBatch >();
             add< ValueStreamTests::LabelBasic >();
             add< ValueStreamTests::LabelShares >();
             add< ValueStreamTests::LabelDouble >();
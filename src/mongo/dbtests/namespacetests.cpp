@@ -906,6 +906,32 @@ namespace NamespaceTests {
         
         // also test numeric string field names
         
+        class KeyDiff {
+        public:
+            void run() {
+                BSONObjSet oldKeys;
+                BSONObjSet newKeys;
+                for ( int i = 0; i < 10; i++ ) {
+                    oldKeys.insert( BSON( "" << i ) );
+                    newKeys.insert( BSON( "" << i + 5 ) );
+                }
+                IndexKeyDiff diff( oldKeys, newKeys );
+                ASSERT_EQUALS( 5U, diff.deleted.size() );
+                ASSERT_EQUALS( 5U, diff.inserted.size() );
+                ASSERT_EQUALS( 5U, diff.unchanged.size() );
+                for ( int i = 0; i < 5; i++ ) {
+                    ASSERT_EQUALS( BSON( "" << i ), *diff.deleted[i] );
+                    ASSERT_EQUALS( BSON( "" << i + 10 ), *diff.inserted[i] );
+                    ASSERT_EQUALS( BSON( "" << i + 5 ), *diff.unchanged[i] );
+                }
+
+                // an empty side yields everything on the other side
+                IndexKeyDiff all( oldKeys, BSONObjSet() );
+                ASSERT_EQUALS( 10U, all.deleted.size() );
+                ASSERT( all.inserted.empty() && all.unchanged.empty() );
+            }
+        };
+
     } // namespace IndexDetailsTests
 
     namespace IndexSpecTests {
@@ -1073,6 +1099,428 @@ namespace NamespaceTests {
             }
         };
         
+        /**
+         * Inserts and deletes maintain every index, whether the secondary rows are
+         * generated by put_multiple/del_multiple (single key) or written one at a
+         * time (multikey, sparse with no key).
+         */
+        class MultiIndexWrites : public Base {
+        public:
+            void run() {
+                getAndMaybeCreateNS( ns(), false );
+                DBDirectClient client;
+                client.ensureIndex( ns(), BSON( "a" << 1 ) );
+                client.ensureIndex( ns(), BSON( "b" << 1 ) );
+                client.insert( "unittests.system.indexes",
+                               BSON( "ns" << ns() << "key" << BSON( "c" << 1 ) << "name" << "c_1" << "sparse" << true ) );
+                client.ensureIndex( ns(), BSON( "a" << 1 << "b" << -1 ) );
+                client.ensureIndex( ns(), BSON( "d" << 1 ), true );
+                for ( int i = 0; i < 100; i++ ) {
+                    BSONObjBuilder b;
+                    b << "_id" << i << "a" << i % 10 << "b" << BSON_ARRAY( i << i + 1000 ) << "d" << i;
+                    if ( i % 2 == 0 ) {
+                        b << "c" << i;
+                    }
+                    client.insert( ns(), b.obj() );
+                }
+                ASSERT( client.getLastError().empty() );
+                // duplicate key on d, nothing may be written
+                client.insert( ns(), BSON( "_id" << 100 << "a" << 0 << "d" << 5 ) );
+                ASSERT( !client.getLastError().empty() );
+                assertCounts( 100, 10, 50 );
+
+                client.remove( ns(), BSON( "a" << 3 ) );
+                ASSERT( client.getLastError().empty() );
+                assertCounts( 90, 0, 45 );
+            }
+        private:
+            void assertCounts( int all, int a3, int sparse ) {
+                DBDirectClient client;
+                ASSERT_EQUALS( all, (int) client.count( ns() ) );
+                ASSERT_EQUALS( a3, countHint( BSON( "a" << 3 ), BSON( "a" << 1 ) ) );
+                ASSERT_EQUALS( a3, countHint( BSON( "a" << 3 ), BSON( "a" << 1 << "b" << -1 ) ) );
+                ASSERT_EQUALS( a3 > 0 ? 1 : 0, countHint( BSON( "b" << 1013 ), BSON( "b" << 1 ) ) );
+                ASSERT_EQUALS( a3 > 0 ? 1 : 0, countHint( BSON( "d" << 13 ), BSON( "d" << 1 ) ) );
+                ASSERT_EQUALS( sparse, countHint( BSON( "c" << GTE << 0 ), BSON( "c" << 1 ) ) );
+                // every document, reached through the multikey index
+                ASSERT_EQUALS( all, countHint( BSON( "b" << GTE << 1000 ), BSON( "b" << 1 ) ) );
+            }
+            int countHint( const BSONObj &query, const BSONObj &hint ) {
+                DBDirectClient client;
+                auto_ptr<DBClientCursor> c = client.query( ns(), Query( query ).hint( hint ) );
+                int n = 0;
+                while ( c->more() ) {
+                    c->next();
+                    n++;
+                }
+                return n;
+            }
+        };
+        
+        /**
+         * Each index counts the queries, keys scanned and writes it has served,
+         * and reports them with its node statistics in collStats.
+         */
+        class IndexOperationCounters : public Base {
+        public:
+            void run() {
+                getAndMaybeCreateNS( ns(), false );
+                DBDirectClient client;
+                client.ensureIndex( ns(), BSON( "a" << 1 ) );
+                for ( int i = 0; i < 20; i++ ) {
+                    client.insert( ns(), BSON( "_id" << i << "a" << i ) );
+                }
+                client.remove( ns(), BSON( "_id" << 0 ) );
+                ASSERT( client.getLastError().empty() );
+                ASSERT_EQUALS( 5, (int) client.count( ns(), BSON( "a" << LT << 6 ) ) );
+
+                BSONObj pk = indexStats( 0 );
+                BSONObj a = indexStats( 1 );
+                ASSERT_EQUALS( 20, pk["operations"]["inserts"].numberLong() );
+                ASSERT_EQUALS( 1, pk["operations"]["deletes"].numberLong() );
+                ASSERT_EQUALS( 20, a["operations"]["inserts"].numberLong() );
+                ASSERT_EQUALS( 1, a["operations"]["deletes"].numberLong() );
+                ASSERT( a["operations"]["queries"].numberLong() >= 1 );
+                ASSERT( a["operations"]["nscanned"].numberLong() >= 5 );
+                ASSERT( pk.hasField( "dataBlocks" ) );
+                ASSERT( pk.hasField( "avgDataBlockSize" ) );
+            }
+        private:
+            BSONObj indexStats( int idxNum ) {
+                DBDirectClient client;
+                BSONObj res;
+                ASSERT( client.runCommand( "unittests", BSON( "collStats" << "NamespaceDetailsTests" ), res ) );
+                return res["indexDetails"].Obj()[idxNum].Obj().getOwned();
+            }
+        };
+
+        /**
+         * A capped collection's count and size are persisted at a clean shutdown,
+         * and used on reopening only while they still match the data.
+         */
+        class CappedStatsPersisted {
+        public:
+            CappedStatsPersisted() : _ns( "unittests.NamespaceDetailsTests_cappedStats" ) {}
+            ~CappedStatsPersisted() {
+                Lock::GlobalWrite lk;
+                Client::Transaction txn(DB_SERIALIZABLE);
+                Client::Context ctx( _ns );
+                string errmsg;
+                BSONObjBuilder result;
+                dropCollection( _ns, errmsg, result );
+                txn.commit();
+            }
+            void run() {
+                Lock::GlobalWrite lk;
+                {
+                    Client::Transaction txn(DB_SERIALIZABLE);
+                    Client::Context ctx( _ns );
+                    string err;
+                    ASSERT( userCreateNS( _ns, fromjson( "{capped:true,size:100000,max:5}" ), err, false ) );
+                    txn.commit();
+                }
+                DBDirectClient client;
+                for ( int i = 0; i < 10; i++ ) {
+                    client.insert( _ns, BSON( "_id" << i << "x" << string( i, 'x' ) ) );
+                }
+                persistStats();
+                assertStatsAfterReopen();
+
+                // inserted since the stats were persisted, they no longer match
+                client.insert( _ns, BSON( "_id" << 10 << "x" << string( 10, 'x' ) ) );
+                assertStatsAfterReopen();
+
+                // a shrinking update doesn't move the keys, it removes the stats
+                persistStats();
+                client.update( _ns, BSON( "_id" << 9 ), BSON( "_id" << 9 << "x" << "" ) );
+                ASSERT( client.getLastError().empty() );
+                assertStatsAfterReopen();
+
+                // an aborted insert changes neither the data nor the stats
+                persistStats();
+                {
+                    Client::Transaction txn(DB_SERIALIZABLE);
+                    client.insert( _ns, BSON( "_id" << 11 ) );
+                }
+                assertStatsAfterReopen();
+            }
+        private:
+            void persistStats() {
+                Client::Transaction txn(DB_SERIALIZABLE);
+                Client::Context ctx( _ns );
+                nsindex( _ns )->persist_stats();
+                txn.commit();
+            }
+            void assertStatsAfterReopen() {
+                long long count = 0;
+                long long size = 0;
+                DBDirectClient client;
+                for ( auto_ptr<DBClientCursor> c = client.query( _ns, Query() ); c->more(); ) {
+                    count++;
+                    size += c->next().objsize();
+                }
+                ASSERT_EQUALS( 5, count );
+
+                Client::Transaction txn(DB_SERIALIZABLE);
+                Client::Context ctx( _ns );
+                ASSERT( nsindex( _ns )->close_ns( _ns ) );
+                BSONObjBuilder b;
+                nsdetails( _ns )->fillSpecificStats( &b, 1 );
+                BSONObj stats = b.obj();
+                ASSERT_EQUALS( count, stats["cappedCount"].numberLong() );
+                ASSERT_EQUALS( size, stats["cappedSizeCurrent"].numberLong() );
+                txn.commit();
+            }
+            const char *_ns;
+        };
+
+        /**
+         * ensureIndex with background: true builds the index with the hot indexer,
+         * fixes up multikey documents and those missing from a sparse index, and
+         * leaves nothing behind when a unique build fails.
+         */
+        class BackgroundIndexBuild {
+        public:
+            BackgroundIndexBuild() : _ns( "unittests.NamespaceDetailsTests_bgIndex" ) {}
+            ~BackgroundIndexBuild() {
+                _client.dropCollection( _ns );
+            }
+            void run() {
+                for ( int i = 0; i < 100; i++ ) {
+                    _client.insert( _ns, BSON( "_id" << i << "a" << i % 10 << "b" << BSON_ARRAY( i << -i ) << "c" << i % 10 ) );
+                }
+                ASSERT( _client.getLastError().empty() );
+
+                ensureBackgroundIndex( BSON( "a" << 1 ), false );
+                ASSERT( _client.getLastError().empty() );
+                ASSERT_EQUALS( 10, countHint( BSON( "a" << 3 ), BSON( "a" << 1 ) ) );
+
+                // multikey, the keys after the first written by commit
+                ensureBackgroundIndex( BSON( "b" << 1 ), false );
+                ASSERT( _client.getLastError().empty() );
+                ASSERT_EQUALS( 1, countHint( BSON( "b" << -42 ), BSON( "b" << 1 ) ) );
+
+                // duplicate keys, the index must not exist afterwards
+                ensureBackgroundIndex( BSON( "c" << 1 ), true );
+                ASSERT( !_client.getLastError().empty() );
+                ASSERT_EQUALS( 3, nIndexes() );
+
+                // no document has d, the placeholder rows must be gone
+                _client.insert( "unittests.system.indexes",
+                                BSON( "ns" << _ns << "key" << BSON( "d" << 1 ) << "name" << "d_1" <<
+                                      "sparse" << true << "background" << true ) );
+                ASSERT( _client.getLastError().empty() );
+                ASSERT_EQUALS( 4, nIndexes() );
+                ASSERT_EQUALS( 0, countHint( BSONObj(), BSON( "d" << 1 ) ) );
+
+                // the new indexes are maintained like any other
+                _client.insert( _ns, BSON( "_id" << 100 << "a" << 3 << "b" << BSON_ARRAY( 1000 ) << "d" << 1 ) );
+                ASSERT_EQUALS( 11, countHint( BSON( "a" << 3 ), BSON( "a" << 1 ) ) );
+                ASSERT_EQUALS( 1, countHint( BSON( "b" << 1000 ), BSON( "b" << 1 ) ) );
+                ASSERT_EQUALS( 1, countHint( BSONObj(), BSON( "d" << 1 ) ) );
+            }
+        private:
+            void ensureBackgroundIndex( const BSONObj &key, bool unique ) {
+                _client.ensureIndex( _ns, key, unique, false, "", false, true );
+            }
+            int countHint( const BSONObj &query, const BSONObj &hint ) {
+                auto_ptr<DBClientCursor> c = _client.query( _ns, Query( query ).hint( hint ) );
+                int n = 0;
+                while ( c->more() ) {
+                    c->next();
+                    n++;
+                }
+                return n;
+            }
+            int nIndexes() {
+                auto_ptr<DBClientCursor> c = _client.getIndexes( _ns );
+                int n = 0;
+                while ( c->more() ) {
+                    c->next();
+                    n++;
+                }
+                return n;
+            }
+            const char *_ns;
+            DBDirectClient _client;
+        };
+
+        /**
+         * A partitioned collection keeps each _id range in its own dictionary.
+         * Queries see every partition they need, and dropping a partition
+         * removes exactly the documents in its range.
+         */
+        class Partitioned {
+        public:
+            Partitioned() : _ns( "unittests.NamespaceDetailsTests_partitioned" ) {}
+            ~Partitioned() {
+                _client.dropCollection( _ns );
+            }
+            void run() {
+                ASSERT( command( BSON( "create" << coll() << "partitioned" << true ) ) );
+                for ( int i = 0; i < 30; i++ ) {
+                    if ( i > 0 && i % 10 == 0 ) {
+                        ASSERT( command( BSON( "addPartition" << coll() << "newMax" << BSON( "_id" << i ) ) ) );
+                    }
+                    _client.insert( _ns, BSON( "_id" << i << "a" << i ) );
+                }
+                ASSERT( _client.getLastError().empty() );
+                // newMax has to be past every _id in the last partition
+                ASSERT( !command( BSON( "addPartition" << coll() << "newMax" << BSON( "_id" << 25 ) ) ) );
+
+                ASSERT_EQUALS( 30U, _client.count( _ns ) );
+                ASSERT_EQUALS( 29, _client.findOne( _ns, Query().sort( BSON( "$natural" << -1 ) ) )["_id"].numberInt() );
+                ASSERT_EQUALS( 5, count( BSON( "_id" << GTE << 8 << LT << 13 ) ) );
+                ASSERT_EQUALS( 3, count( BSON( "_id" << BSON( "$in" << BSON_ARRAY( 1 << 15 << 25 ) ) ) ) );
+                _client.update( _ns, BSON( "_id" << 15 ), BSON( "$set" << BSON( "a" << -15 ) ) );
+                ASSERT_EQUALS( -15, _client.findOne( _ns, BSON( "_id" << 15 ) )["a"].numberInt() );
+                _client.remove( _ns, BSON( "_id" << 16 ) );
+                ASSERT_EQUALS( 29U, _client.count( _ns ) );
+
+                // the first partition has id 0 and holds _ids 0 through 9
+                ASSERT( command( BSON( "dropPartition" << coll() << "id" << 0 ) ) );
+                ASSERT_EQUALS( 19U, _client.count( _ns ) );
+                ASSERT( _client.findOne( _ns, BSON( "_id" << 5 ) ).isEmpty() );
+                ASSERT( !command( BSON( "dropPartition" << coll() << "id" << 2 ) ) );
+
+                // the dropped range now belongs to the next partition
+                _client.insert( _ns, BSON( "_id" << 5 ) );
+                ASSERT( _client.getLastError().empty() );
+                ASSERT_EQUALS( 20U, _client.count( _ns ) );
+
+                _client.ensureIndex( _ns, BSON( "a" << 1 ) );
+                ASSERT( !_client.getLastError().empty() );
+
+                // the partitions are reopened from the nsindex
+                {
+                    Lock::GlobalWrite lk;
+                    Client::Transaction txn(DB_SERIALIZABLE);
+                    Client::Context ctx( _ns );
+                    ASSERT( nsindex( _ns )->close_ns( _ns ) );
+                    ASSERT_EQUALS( 2, nsdetails( _ns )->nPartitions() );
+                    txn.commit();
+                }
+                ASSERT_EQUALS( 20U, _client.count( _ns ) );
+                ASSERT_EQUALS( 10, count( BSON( "_id" << LT << 20 ) ) );
+            }
+        private:
+            string coll() const {
+                return string( _ns ).substr( strlen( "unittests." ) );
+            }
+            bool command( const BSONObj &cmd ) {
+                BSONObj info;
+                return _client.runCommand( "unittests", cmd, info );
+            }
+            int count( const BSONObj &query ) {
+                auto_ptr<DBClientCursor> c = _client.query( _ns, query );
+                int n = 0;
+                while ( c->more() ) {
+                    c->next();
+                    n++;
+                }
+                return n;
+            }
+            const char *_ns;
+            DBDirectClient _client;
+        };
+
+        /**
+         * Times writing documents into a collection with five secondary indexes
+         * with one put_multiple per document, against writing the same
+         * documents into an identical collection one index at a time, and
+         * checks that both leave every index complete.
+         */
+        class PutMultipleVsPerIndexPuts {
+        public:
+            PutMultipleVsPerIndexPuts() :
+                _multiNs( "unittests.NamespaceDetailsTests_putMultiple" ),
+                _perIndexNs( "unittests.NamespaceDetailsTests_perIndexPuts" ) {}
+            ~PutMultipleVsPerIndexPuts() {
+                _client.dropCollection( _multiNs );
+                _client.dropCollection( _perIndexNs );
+            }
+            void run() {
+                static const int n = 20000;
+                createIndexes( _multiNs );
+                createIndexes( _perIndexNs );
+
+                Lock::GlobalWrite lk;
+                Timer t;
+                {
+                    Client::Transaction txn(DB_SERIALIZABLE);
+                    Client::Context ctx( _multiNs );
+                    NamespaceDetails *d = nsdetails( _multiNs );
+                    for ( int i = 0; i < n; i++ ) {
+                        BSONObj obj = doc( i );
+                        d->insertObject( obj, 0 );
+                    }
+                    txn.commit();
+                }
+                const int multiMillis = t.millis();
+
+                t.reset();
+                {
+                    Client::Transaction txn(DB_SERIALIZABLE);
+                    Client::Context ctx( _perIndexNs );
+                    NamespaceDetails *d = nsdetails( _perIndexNs );
+                    for ( int i = 0; i < n; i++ ) {
+                        const BSONObj obj = doc( i );
+                        const BSONObj pk = obj["_id"].wrap( "" );
+                        d->getPKIndex().insertPair( pk, NULL, obj, 0 );
+                        for ( int j = 1; j < d->nIndexes(); j++ ) {
+                            IndexDetails &idx = d->idx( j );
+                            BSONObjSet keys;
+                            idx.getKeysFromObject( obj, keys );
+                            for ( BSONObjSet::const_iterator ki = keys.begin(); ki != keys.end(); ++ki ) {
+                                idx.insertPair( *ki, &pk, obj, 0 );
+                            }
+                        }
+                    }
+                    txn.commit();
+                }
+                const int perIndexMillis = t.millis();
+
+                cout << "put_multiple: " << n << " documents x 6 indexes: " << multiMillis << "ms, "
+                     << "per index puts: " << perIndexMillis << "ms" << endl;
+
+                for ( int j = 0; j < nKeys; j++ ) {
+                    ASSERT_EQUALS( n, countHint( _multiNs, keyPattern( j ) ) );
+                    ASSERT_EQUALS( n, countHint( _perIndexNs, keyPattern( j ) ) );
+                }
+            }
+        private:
+            static const int nKeys = 5;
+            static BSONObj keyPattern( int j ) {
+                return BSON( string( 1, 'a' + j ) << 1 );
+            }
+            static BSONObj doc( int i ) {
+                BSONObjBuilder b;
+                b << "_id" << i;
+                for ( int j = 0; j < nKeys; j++ ) {
+                    b << string( 1, 'a' + j ) << ( i * ( j + 7 ) ) % 1009;
+                }
+                return b.obj();
+            }
+            void createIndexes( const char *ns ) {
+                for ( int j = 0; j < nKeys; j++ ) {
+                    _client.ensureIndex( ns, keyPattern( j ) );
+                }
+                ASSERT( _client.getLastError().empty() );
+            }
+            int countHint( const char *ns, const BSONObj &hint ) {
+                auto_ptr<DBClientCursor> c = _client.query( ns, Query().hint( hint ) );
+                int n = 0;
+                while ( c->more() ) {
+                    c->next();
+                    n++;
+                }
+                return n;
+            }
+            const char *_multiNs;
+            const char *_perIndexNs;
+            DBDirectClient _client;
+        };
+
     } // namespace NamespaceDetailsTests
 
     namespace NamespaceDetailsTransientTests {
@@ -1134,10 +1582,17 @@ namespace NamespaceTests {
             add< IndexDetailsTests::MissingField >();
             add< IndexDetailsTests::SubobjectMissing >();
             add< IndexDetailsTests::CompoundMissing >();
+            add< IndexDetailsTests::KeyDiff >();
             add< IndexSpecTests::Suitability >();
             add< IndexSpecTests::NumericFieldSuitability >();
             add< NamespaceDetailsTests::TruncateCapped >();
             add< NamespaceDetailsTests::SetIndexIsMultikey >();
+            add< NamespaceDetailsTests::MultiIndexWrites >();
+            add< NamespaceDetailsTests::IndexOperationCounters >();
+            add< NamespaceDetailsTests::CappedStatsPersisted >();
+            add< NamespaceDetailsTests::BackgroundIndexBuild >();
+            add< NamespaceDetailsTests::Partitioned >();
+            add< NamespaceDetailsTests::PutMultipleVsPerIndexPuts >();
             add< NamespaceDetailsTransientTests::ClearQueryCache >();
         }
     } myall;
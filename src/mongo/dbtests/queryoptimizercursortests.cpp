@@ -25,6 +25,7 @@
 #include "mongo/db/queryoptimizer.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/clientcursor.h"
+#include "mongo/db/cmdline.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/json.h"
 #include "mongo/dbtests/dbtests.h"
@@ -909,6 +910,51 @@ namespace QueryOptimizerCursorTests {
         }
     };
 
+    /**
+     * A plan whose estimated scan is far smaller than every other plan's runs alone, while
+     * without estimates the same query races all its plans.
+     */
+    class RunClearlyCheapestPlan : public Base {
+    public:
+        RunClearlyCheapestPlan() : _old( cmdLine.planEstimates ) {}
+        ~RunClearlyCheapestPlan() {
+            cmdLine.planEstimates = _old;
+        }
+        void run() {
+            for( int i = 0; i < 200; ++i ) {
+                _cli.insert( ns(), BSON( "_id" << i << "a" << i << "b" << i % 2 ) );
+            }
+            _cli.ensureIndex( ns(), BSON( "a" << 1 ) );
+            _cli.ensureIndex( ns(), BSON( "b" << 1 ) );
+
+            // {a:1} covers one key, {b:1} about 100 and the table 200.
+            cmdLine.planEstimates = true;
+            ASSERT( !otherPlanRan() );
+            cmdLine.planEstimates = false;
+            ASSERT( otherPlanRan() );
+        }
+    private:
+        /** @return true if any plan but {a:1} produced a document for {a:5,b:1}. */
+        bool otherPlanRan() {
+            Client::Transaction transaction(DB_SERIALIZABLE);
+            Lock::GlobalWrite lk;
+            Client::Context ctx( ns() );
+            NamespaceDetailsTransient::get_inlock( ns() ).clearQueryCache();
+            shared_ptr<Cursor> c = newQueryOptimizerCursor( ns(), BSON( "a" << 5 << "b" << 1 ) );
+            ASSERT_EQUALS( BSON( "_id" << 5 << "a" << 5 << "b" << 1 ), c->current() );
+            ASSERT_EQUALS( BSON( "a" << 1 ), c->indexKeyPattern() );
+            bool other = false;
+            while( c->advance() ) {
+                if ( c->indexKeyPattern() != BSON( "a" << 1 ) ) {
+                    other = true;
+                }
+            }
+            transaction.commit();
+            return other;
+        }
+        bool _old;
+    };
+
     /** Add other plans when the recorded one is doing more poorly than expected, with deletion. */
     class AddOtherPlansDelete : public Base {
     public:
@@ -3402,6 +3448,7 @@ namespace QueryOptimizerCursorTests {
             add<Multikey>();
             add<AddOtherPlans>();
             add<AddOtherPlansDelete>();
+            add<RunClearlyCheapestPlan>();
             add<AddOtherPlansContinuousDelete>();
             add<AddOtherPlansWhenOptimalBecomesNonOptimal>();
             add<OrRangeElimination>();
@@ -846,6 +846,95 @@ namespace QueryOptimizerTests {
 
         } // namespace QueryBoundsExactOrderSuffix
 
+        /** Plans estimate how many keys their bounds cover. */
+        class EstimatedKeys : public Base {
+        public:
+            void run() {
+                for( int i = 0; i < 100; ++i ) {
+                    client().insert( ns(), BSON( "_id" << i << "a" << i ) );
+                }
+                int idx = INDEXNO( "a" << 1 );
+                long long narrow = estimate( idx, fromjson( "{a:{$gte:10,$lt:20}}" ) );
+                long long wide = estimate( idx, fromjson( "{a:{$gte:0}}" ) );
+                ASSERT( narrow >= 0 );
+                ASSERT( wide > narrow );
+                // A reverse scan covers the same keys.
+                scoped_ptr<QueryPlan> reverse( QueryPlan::make( nsd(), idx,
+                                                               FRSP( fromjson( "{a:{$gte:0}}" ) ),
+                                                               FRSP2( fromjson( "{a:{$gte:0}}" ) ),
+                                                               fromjson( "{a:{$gte:0}}" ),
+                                                               BSON( "a" << -1 ) ) );
+                ASSERT_EQUALS( wide, reverse->estimatedKeys() );
+                // A table scan is costed by the collection's row count estimate.
+                ASSERT( estimate( -1, BSONObj() ) >= 0 );
+                // An impossible plan scans nothing.
+                ASSERT_EQUALS( 0, estimate( idx, fromjson( "{a:{$gt:5,$lt:5}}" ) ) );
+                // Too many intervals to be worth estimating.
+                BSONArrayBuilder in;
+                for( int i = 0; i < 20; ++i ) {
+                    in << i * 5;
+                }
+                ASSERT_EQUALS( -1, estimate( idx, BSON( "a" << BSON( "$in" << in.arr() ) ) ) );
+            }
+        private:
+            long long estimate( int idx, const BSONObj &query ) {
+                scoped_ptr<QueryPlan> p( QueryPlan::make( nsd(), idx, FRSP( query ),
+                                                         FRSP2( query ), query, BSONObj() ) );
+                return p->estimatedKeys();
+            }
+        };
+
+        /** A partitioned collection's estimates count the keys in every partition. */
+        class EstimatedKeysPartitioned {
+        public:
+            EstimatedKeysPartitioned() : _ns( "unittests.QueryPlanTests_partitioned" ) {}
+            ~EstimatedKeysPartitioned() {
+                _client.dropCollection( _ns );
+            }
+            void run() {
+                BSONObj info;
+                ASSERT( _client.runCommand( "unittests",
+                                            BSON( "create" << coll() << "partitioned" << true ),
+                                            info ) );
+                for( int i = 0; i < 30; ++i ) {
+                    if ( i > 0 && i % 10 == 0 ) {
+                        ASSERT( _client.runCommand( "unittests",
+                                                    BSON( "addPartition" << coll() <<
+                                                          "newMax" << BSON( "_id" << i ) ),
+                                                    info ) );
+                    }
+                    _client.insert( _ns, BSON( "_id" << i ) );
+                }
+
+                Client::Transaction transaction(DB_SERIALIZABLE);
+                Lock::GlobalWrite lk;
+                Client::Context ctx( _ns );
+                NamespaceDetails *d = nsdetails( _ns );
+                ASSERT_EQUALS( 3, d->nPartitions() );
+                // Every row, not just the last partition's.
+                ASSERT( estimate( d, -1, BSONObj() ) > 10 );
+                // A range spanning all three partitions covers more keys than one inside the
+                // last partition, which is the one the pk index refers to.
+                const long long spanning = estimate( d, 0, fromjson( "{_id:{$gte:5,$lt:25}}" ) );
+                const long long last = estimate( d, 0, fromjson( "{_id:{$gte:20,$lt:25}}" ) );
+                ASSERT( last >= 0 );
+                ASSERT( spanning > last );
+                transaction.commit();
+            }
+        private:
+            string coll() const {
+                return string( _ns ).substr( strlen( "unittests." ) );
+            }
+            long long estimate( NamespaceDetails *d, int idx, const BSONObj &query ) {
+                FieldRangeSetPair frsp( _ns, query );
+                scoped_ptr<QueryPlan> p( QueryPlan::make( d, idx, frsp, NULL, query,
+                                                         BSONObj() ) );
+                return p->estimatedKeys();
+            }
+            const char *_ns;
+            DBDirectClient _client;
+        };
+
         /** Checks related to 'special' QueryPlans. */
         class Special : public Base {
         public:
@@ -1143,6 +1232,30 @@ namespace QueryOptimizerTests {
             }
         };
 
+        /** A plan is only run without a race when its estimate is clearly the smallest. */
+        class ClearlyCheapestPlan : public Base {
+        public:
+            void run() {
+                ensureIndex( ns(), BSON( "a" << 1 ), false, "a_1" );
+                ensureIndex( ns(), BSON( "b" << 1 ), false, "b_1" );
+                for( int i = 0; i < 200; ++i ) {
+                    BSONObj temp = BSON( "_id" << i << "a" << i << "b" << i % 2 );
+                    insertObject( ns(), temp );
+                }
+                // {a:1} covers one key, {b:1} about 100.
+                shared_ptr<QueryPlanSet> s = makeQps( BSON( "a" << 5 << "b" << 1 ) );
+                QueryPlanSet::QueryPlanPtr p = s->clearlyCheapestPlan();
+                ASSERT( p );
+                ASSERT_EQUALS( BSON( "a" << 1 ), p->indexKey() );
+                // Both indexes estimate no keys, which doesn't pick either.
+                s = makeQps( BSON( "a" << 1000 << "b" << 5 ) );
+                ASSERT( !s->clearlyCheapestPlan() );
+                // Close estimates race.
+                s = makeQps( BSON( "a" << GTE << 0 << LT << 150 << "b" << 1 ) );
+                ASSERT( !s->clearlyCheapestPlan() );
+            }
+        };
+
         class InQueryIntervals : public Base {
         public:
             void run() {
@@ -1664,6 +1777,8 @@ namespace QueryOptimizerTests {
             add<QueryPlanTests::QueryBoundsExactOrderSuffix::RangeRange>();
             add<QueryPlanTests::QueryBoundsExactOrderSuffix::Unsatisfiable>();
             add<QueryPlanTests::QueryBoundsExactOrderSuffix::EqualityUnsatisfiable>();
+            add<QueryPlanTests::EstimatedKeys>();
+            add<QueryPlanTests::EstimatedKeysPartitioned>();
             // TokuMX: no geo
             //add<QueryPlanTests::Special>();
             add<QueryPlanSetTests::ToString>();
@@ -1683,6 +1798,7 @@ namespace QueryOptimizerTests {
             add<QueryPlanSetTests::Delete>();
             add<QueryPlanSetTests::DeleteOneScan>();
             add<QueryPlanSetTests::DeleteOneIndex>();
+            add<QueryPlanSetTests::ClearlyCheapestPlan>();
             add<QueryPlanSetTests::InQueryIntervals>();
             add<QueryPlanSetTests::EqualityThenIn>();
             add<QueryPlanSetTests::NotEqualityThenIn>();
@@ -592,6 +592,51 @@ namespace QueryTests {
         }
     };
 
+    class BatchInsert : public ClientBase {
+    public:
+        ~BatchInsert() {
+            client().dropCollection( "unittests.querytests.BatchInsert" );
+        }
+        void run() {
+            const char *ns = "unittests.querytests.BatchInsert";
+            client().ensureIndex( ns, BSON( "a" << 1 ) );
+            vector<BSONObj> objs;
+            for ( int i = 0; i < 100; i++ ) {
+                objs.push_back( BSON( "a" << i ) );
+            }
+            client().insert( ns, objs );
+            ASSERT( !error() );
+            ASSERT_EQUALS( 100U, client().count( ns, BSONObj() ) );
+            ASSERT_EQUALS( 1U, client().count( ns, BSON( "a" << 50 ) ) );
+            BSONObj first = client().findOne( ns, BSON( "a" << 0 ) );
+            ASSERT_EQUALS( jstOID, first.firstElement().type() );
+            ASSERT_EQUALS( string( "_id" ), first.firstElement().fieldName() );
+
+            // user supplied _ids stay where the user put them
+            objs.clear();
+            objs.push_back( BSON( "_id" << 3 << "a" << 3 ) );
+            objs.push_back( BSON( "a" << 1 << "_id" << 1 ) );
+            objs.push_back( BSON( "_id" << 2 << "a" << 2 ) );
+            client().insert( ns, objs );
+            ASSERT( !error() );
+            ASSERT_EQUALS( 103U, client().count( ns, BSONObj() ) );
+            ASSERT_EQUALS( string( "a" ), client().findOne( ns, BSON( "_id" << 1 ) ).firstElement().fieldName() );
+
+            // without keepGoing a duplicate fails the whole batch
+            objs.clear();
+            objs.push_back( BSON( "_id" << 4 ) );
+            objs.push_back( BSON( "_id" << 1 ) );
+            client().insert( ns, objs );
+            ASSERT( error() );
+            ASSERT_EQUALS( 103U, client().count( ns, BSONObj() ) );
+
+            // with keepGoing only the duplicate is skipped
+            objs.push_back( BSON( "_id" << 5 ) );
+            client().insert( ns, objs, InsertOption_ContinueOnError );
+            ASSERT_EQUALS( 105U, client().count( ns, BSONObj() ) );
+        }
+    };
+
     class UniqueIndexPreexistingData : public ClientBase {
     public:
         ~UniqueIndexPreexistingData() {
@@ -1455,17 +1500,20 @@ namespace QueryTests {
             : ScanAndOrder( startFrom, limit, order, frs ) {
             }
             unsigned approxSize() const { return ScanAndOrder::approxSize(); }
+            int nRuns() const { return ScanAndOrder::nRuns(); }
+            void setMaxBytes( unsigned maxBytes ) { ScanAndOrder::setMaxBytes( maxBytes ); }
         };
         typedef TestableScanAndOrder Testable;
         
         class Base {
         protected:
-            void assertNumFilled( int expected, const Testable &t ) {
-                ASSERT_EQUALS( expected, t.size() );
-                BufBuilder bb;
-                int nout;
-                t.fill( bb, 0, nout );
-                ASSERT_EQUALS( expected, nout );                
+            void assertNumFilled( int expected, const shared_ptr<Testable> &t ) {
+                ASSERT_EQUALS( expected, t->size() );
+                int n = 0;
+                for ( ScanAndOrderCursor c( t, 0 ); c.ok(); c.advance() ) {
+                    n++;
+                }
+                ASSERT_EQUALS( expected, n );
             }
         };
         
@@ -1473,7 +1521,8 @@ namespace QueryTests {
         public:
             void run() {
                 FieldRangeSet frs( "n/a", BSONObj(), true, true );
-                Testable t( 0, 0, BSON( "a" << 1 ), frs );
+                shared_ptr<Testable> tp( new Testable( 0, 0, BSON( "a" << 1 ), frs ) );
+                Testable &t = *tp;
                 ASSERT_EQUALS( 0U, t.approxSize() );
                 BSONObj o = BSON( "a" << 1 );
                 t.add( o );
@@ -1482,7 +1531,7 @@ namespace QueryTests {
                 t.add( o );
                 ASSERT( (int)t.approxSize() > 2 * o.objsize() );
 
-                assertNumFilled( 2, t );
+                assertNumFilled( 2, tp );
             }
         };
 
@@ -1490,7 +1539,8 @@ namespace QueryTests {
         public:
             void run() {
                 FieldRangeSet frs( "n/a", BSONObj(), true, true );
-                Testable t( 0, 1, BSON( "a" << 1 ), frs );
+                shared_ptr<Testable> tp( new Testable( 0, 1, BSON( "a" << 1 ), frs ) );
+                Testable &t = *tp;
                 ASSERT_EQUALS( 0U, t.approxSize() );
                 t.add( BSON( "a" << 3 ) );
                 unsigned smallSize = t.approxSize();
@@ -1502,10 +1552,183 @@ namespace QueryTests {
                 t.add( BSON( "a" << 1 ) );
                 ASSERT_EQUALS( smallSize, t.approxSize() );
 
-                assertNumFilled( 1, t );
+                assertNumFilled( 1, tp );
             }
         };
-        
+
+        class SpillBase : public Base {
+        protected:
+            /** @return the values of "a" in the objects a ScanAndOrderCursor returns */
+            vector<int> filled( const shared_ptr<Testable> &t ) {
+                vector<int> ret;
+                for ( ScanAndOrderCursor c( t, 0 ); c.ok(); c.advance() ) {
+                    ret.push_back( c.current()["a"].numberInt() );
+                }
+                return ret;
+            }
+            BSONObj doc( int a, int pad = 200 ) {
+                return BSON( "a" << a << "pad" << string( pad, 'x' ) );
+            }
+            void addMany( Testable &t, int n ) {
+                for ( int i = 0; i < n; i++ ) {
+                    t.add( doc( i ) );
+                }
+            }
+        };
+
+        /** An unlimited sort that outgrows memory is merged from sorted runs on disk. */
+        class Spill : public SpillBase {
+        public:
+            void run() {
+                FieldRangeSet frs( "n/a", BSONObj(), true, true );
+                shared_ptr<Testable> tp( new Testable( 10, 0, BSON( "a" << 1 ), frs ) );
+                Testable &t = *tp;
+                t.setMaxBytes( 2000 );
+                t.allowSpill();
+                for ( int i = 0; i < 100; i++ ) {
+                    t.add( doc( ( i * 37 ) % 100 ) );
+                }
+                ASSERT( t.nRuns() > 1 );
+                ASSERT( t.approxSize() < 2000 );
+                ASSERT_EQUALS( 100, t.size() );
+                vector<int> a = filled( tp );
+                ASSERT_EQUALS( 90U, a.size() );
+                for ( int i = 0; i < 90; i++ ) {
+                    ASSERT_EQUALS( i + 10, a[i] );
+                }
+            }
+        };
+
+        /** Without allowSpill(), outgrowing memory still fails the sort. */
+        class NoSpill : public SpillBase {
+        public:
+            void run() {
+                FieldRangeSet frs( "n/a", BSONObj(), true, true );
+                shared_ptr<Testable> tp( new Testable( 0, 0, BSON( "a" << 1 ), frs ) );
+                Testable &t = *tp;
+                t.setMaxBytes( 2000 );
+                ASSERT_THROWS( addMany( t, 100 ), UserException );
+                ASSERT_EQUALS( 0, t.nRuns() );
+            }
+        };
+
+        /** With a limit, the best entries survive spilling and the rest are pruned. */
+        class SpillLimit : public SpillBase {
+        public:
+            void run() {
+                FieldRangeSet frs( "n/a", BSONObj(), true, true );
+                shared_ptr<Testable> tp( new Testable( 0, 20, BSON( "a" << -1 ), frs ) );
+                Testable &t = *tp;
+                t.setMaxBytes( 2000 );
+                t.allowSpill();
+                for ( int i = 0; i < 200; i++ ) {
+                    t.add( doc( ( i * 73 ) % 200 ) );
+                }
+                ASSERT( t.nRuns() > 0 );
+                vector<int> a = filled( tp );
+                ASSERT_EQUALS( 20U, a.size() );
+                for ( int i = 0; i < 20; i++ ) {
+                    ASSERT_EQUALS( 199 - i, a[i] );
+                }
+            }
+        };
+
+        /** Hitting the memory limit while replacing the worst of a full heap loses nothing. */
+        class LimitReplaceAtMemoryLimit : public SpillBase {
+        public:
+            void run() {
+                FieldRangeSet frs( "n/a", BSONObj(), true, true );
+                shared_ptr<Testable> tp( new Testable( 0, 3, BSON( "a" << 1 ), frs ) );
+                Testable &t = *tp;
+                for ( int i = 10; i < 13; i++ ) {
+                    t.add( BSON( "a" << i ) );
+                }
+                const unsigned size = t.approxSize();
+                t.setMaxBytes( size + 100 );
+                // better than the worst entry, but too big to swap in
+                ASSERT_THROWS( t.add( doc( 1 ) ), UserException );
+                ASSERT_EQUALS( size, t.approxSize() );
+                vector<int> a = filled( tp );
+                ASSERT_EQUALS( 3U, a.size() );
+                for ( int i = 0; i < 3; i++ ) {
+                    ASSERT_EQUALS( 10 + i, a[i] );
+                }
+                // a swap that fits still happens
+                t.add( BSON( "a" << 1 ) );
+                a = filled( tp );
+                ASSERT_EQUALS( 3U, a.size() );
+                ASSERT_EQUALS( 1, a[0] );
+                ASSERT_EQUALS( 11, a[2] );
+            }
+        };
+
+        /**
+         * Spilling to make room for a better entry in a full heap sets the bound, so later
+         * entries that can't make the result are dropped rather than held or spilled.
+         */
+        class SpillBoundOnReplace : public SpillBase {
+        public:
+            void run() {
+                FieldRangeSet frs( "n/a", BSONObj(), true, true );
+                shared_ptr<Testable> tp( new Testable( 0, 3, BSON( "a" << 1 ), frs ) );
+                Testable &t = *tp;
+                t.allowSpill();
+                for ( int i = 10; i < 13; i++ ) {
+                    t.add( doc( i ) );
+                }
+                t.setMaxBytes( t.approxSize() + 100 );
+                // better than the worst entry, and only fits once the others are spilled
+                t.add( doc( 1, 400 ) );
+                ASSERT_EQUALS( 1, t.nRuns() );
+                ASSERT_EQUALS( 3, t.size() );
+                // no better than the worst entry replaced
+                t.add( doc( 12 ) );
+                t.add( doc( 50 ) );
+                ASSERT_EQUALS( 3, t.size() );
+                t.add( doc( 5 ) );
+                ASSERT_EQUALS( 4, t.size() );
+                vector<int> a = filled( tp );
+                ASSERT_EQUALS( 3U, a.size() );
+                ASSERT_EQUALS( 1, a[0] );
+                ASSERT_EQUALS( 5, a[1] );
+                ASSERT_EQUALS( 10, a[2] );
+            }
+        };
+
+        /**
+         * An unindexed sort bigger than any one reply is returned in batches through getMore,
+         * unprojected and in order.
+         */
+        class SpilledResultGetMore {
+        public:
+            ~SpilledResultGetMore() {
+                _client.dropCollection( ns() );
+            }
+            void run() {
+                const string pad( 1024 * 1024, 'x' );
+                for ( int i = 0; i < 80; i++ ) {
+                    _client.insert( ns(), BSON( "_id" << i << "a" << ( i * 37 ) % 80 << "pad" << pad ) );
+                }
+                ASSERT( _client.getLastError().empty() );
+                auto_ptr<DBClientCursor> c = _client.query( ns(), Query().sort( BSON( "a" << 1 ) ) );
+                ASSERT( c->getCursorId() != 0 );
+                long long bytes = 0;
+                int n = 0;
+                while ( c->more() ) {
+                    BSONObj o = c->next();
+                    ASSERT_EQUALS( n, o["a"].numberInt() );
+                    ASSERT_EQUALS( pad, o["pad"].String() );
+                    bytes += o.objsize();
+                    n++;
+                }
+                ASSERT_EQUALS( 80, n );
+                ASSERT( bytes > 64 * 1024 * 1024 );
+            }
+        private:
+            static const char *ns() { return "unittests.querytests.SpilledResultGetMore"; }
+            DBDirectClient _client;
+        };
+
     } // namespace ScanAndOrderTests
 
     class All : public Suite {
@@ -1535,6 +1758,7 @@ namespace QueryTests {
             add< EmbeddedNumericTypes >();
             add< AutoResetIndexCache >();
             add< UniqueIndex >();
+            add< BatchInsert >();
             add< UniqueIndexPreexistingData >();
             add< SubobjectInArray >();
             add< Size >();
@@ -1575,6 +1799,12 @@ namespace QueryTests {
             
             add< ScanAndOrderTests::Unlimited >();
             add< ScanAndOrderTests::LimitOne >();
+            add< ScanAndOrderTests::Spill >();
+            add< ScanAndOrderTests::NoSpill >();
+            add< ScanAndOrderTests::SpillLimit >();
+            add< ScanAndOrderTests::LimitReplaceAtMemoryLimit >();
+            add< ScanAndOrderTests::SpillBoundOnReplace >();
+            add< ScanAndOrderTests::SpilledResultGetMore >();
         }
     } myall;
 
@@ -26,6 +26,7 @@
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/parallel_applier.h"
 #include "mongo/dbtests/dbtests.h"
 
 namespace mongo {
@@ -423,12 +424,194 @@ namespace ReplSetTests {
         }
     };
 
+    // checks how the parallel applier partitions oplog transactions
+    class ParallelApplierConflictKeys {
+        static BSONObj txn(const BSONArray& ops, bool applied = false) {
+            return BSON("_id" << 1 << "a" << applied << "ops" << ops);
+        }
+        static vector<string> keysFor(const BSONObj& entry) {
+            vector<string> keys;
+            ASSERT(ParallelApplier::canApplyInParallel(entry, &keys));
+            return keys;
+        }
+    public:
+        void run() {
+            BSONObj ins1 = BSON("op" << "i" << "ns" << "unittests.foo" << "o" << BSON("_id" << 1 << "x" << 1));
+            BSONObj ins1d = BSON("op" << "i" << "ns" << "unittests.foo" << "o" << BSON("_id" << 1.0 << "x" << 2));
+            BSONObj ins2 = BSON("op" << "i" << "ns" << "unittests.foo" << "o" << BSON("_id" << 2));
+            BSONObj ins1other = BSON("op" << "i" << "ns" << "unittests.bar" << "o" << BSON("_id" << 1));
+            BSONObj upd1 = BSON("op" << "u" << "ns" << "unittests.foo" << "pk" << BSON("" << 1) <<
+                                "o" << BSON("_id" << 1) << "o2" << BSON("_id" << 1 << "y" << 1));
+            BSONObj del2 = BSON("op" << "d" << "ns" << "unittests.foo" << "o" << BSON("_id" << 2));
+
+            // the same pk in the same collection conflicts, regardless of op type
+            // or numeric representation of the pk
+            ASSERT(keysFor(txn(BSON_ARRAY(ins1))) == keysFor(txn(BSON_ARRAY(upd1))));
+            ASSERT(keysFor(txn(BSON_ARRAY(ins1))) == keysFor(txn(BSON_ARRAY(ins1d))));
+            ASSERT(keysFor(txn(BSON_ARRAY(ins2))) == keysFor(txn(BSON_ARRAY(del2))));
+            // different pks or different collections do not
+            ASSERT(keysFor(txn(BSON_ARRAY(ins1))) != keysFor(txn(BSON_ARRAY(ins2))));
+            ASSERT(keysFor(txn(BSON_ARRAY(ins1))) != keysFor(txn(BSON_ARRAY(ins1other))));
+            ASSERT_EQUALS(2U, keysFor(txn(BSON_ARRAY(ins1 << del2))).size());
+            // already applied transactions conflict with nothing
+            ASSERT(keysFor(txn(BSON_ARRAY(ins1), true)).empty());
+
+            // capped collections serialize on the whole namespace
+            BSONObj ci1 = BSON("op" << "ci" << "ns" << "unittests.capped" << "pk" << BSON("" << 1) << "o" << BSON("x" << 1));
+            BSONObj cd2 = BSON("op" << "cd" << "ns" << "unittests.capped" << "pk" << BSON("" << 2) << "o" << BSON("x" << 2));
+            ASSERT(keysFor(txn(BSON_ARRAY(ci1))) == keysFor(txn(BSON_ARRAY(cd2))));
+
+            // commands, index builds and spilled transactions are applied alone
+            BSONObj cmd = BSON("op" << "c" << "ns" << "unittests.$cmd" << "o" << BSON("drop" << "foo"));
+            BSONObj idx = BSON("op" << "i" << "ns" << "unittests.system.indexes" <<
+                               "o" << BSON("ns" << "unittests.foo" << "key" << BSON("x" << 1) << "name" << "x_1"));
+            ASSERT(!ParallelApplier::canApplyInParallel(txn(BSON_ARRAY(ins1 << cmd))));
+            ASSERT(!ParallelApplier::canApplyInParallel(txn(BSON_ARRAY(idx))));
+            ASSERT(!ParallelApplier::canApplyInParallel(BSON("_id" << 1 << "a" << false << "ref" << OID::gen())));
+        }
+    };
+
+    // checks which transactions the applier takes from its queue as one batch
+    class ParallelApplierBatches {
+        static BSONObj txn(const BSONObj& op) {
+            return BSON("_id" << 1 << "a" << false << "ops" << BSON_ARRAY(op));
+        }
+    public:
+        void run() {
+            BSONObj ins1 = txn(BSON("op" << "i" << "ns" << "unittests.foo" << "o" << BSON("_id" << 1)));
+            BSONObj ins2 = txn(BSON("op" << "i" << "ns" << "unittests.foo" << "o" << BSON("_id" << 2)));
+            BSONObj cmd = txn(BSON("op" << "c" << "ns" << "unittests.$cmd" << "o" << BSON("drop" << "foo")));
+            BSONObj spilled = BSON("_id" << 1 << "a" << false << "ref" << OID::gen());
+
+            deque<BSONObj> queue;
+            queue.push_back(ins1);
+            queue.push_back(ins2);
+            queue.push_back(cmd);
+            queue.push_back(ins1);
+            queue.push_back(spilled);
+
+            // transactions that can be partitioned go together, up to the limit
+            ASSERT_EQUALS(2U, ParallelApplier::batchLength(queue, 1000));
+            ASSERT_EQUALS(1U, ParallelApplier::batchLength(queue, 1));
+            queue.pop_front();
+            queue.pop_front();
+            // anything else falls back to being applied by itself
+            ASSERT_EQUALS(1U, ParallelApplier::batchLength(queue, 1000));
+            queue.pop_front();
+            ASSERT_EQUALS(1U, ParallelApplier::batchLength(queue, 1000));
+            queue.pop_front();
+            ASSERT_EQUALS(1U, ParallelApplier::batchLength(queue, 1000));
+            queue.pop_front();
+            ASSERT_EQUALS(0U, ParallelApplier::batchLength(queue, 1000));
+        }
+    };
+
+    // A ParallelApplier that records what its workers do instead of
+    // applying transactions. A transaction with "waitMillis" blocks until
+    // another transaction starts, or until the time is up.
+    class RecordingApplier : public ParallelApplier {
+    public:
+        explicit RecordingApplier(int nThreads) : ParallelApplier(nThreads), overlapped(false) {}
+        // the "n" of each transaction, in the order workers started them
+        vector<int> started;
+        vector<GTID> noted;
+        bool overlapped;
+    protected:
+        virtual void applyTransaction(const BSONObj& entry) {
+            boost::unique_lock<boost::mutex> lk(_m);
+            const size_t before = started.size();
+            started.push_back(entry["n"].numberInt());
+            _started.notify_all();
+            if (entry.hasField("waitMillis")) {
+                const boost::system_time deadline = boost::get_system_time() +
+                        boost::posix_time::milliseconds(entry["waitMillis"].numberInt());
+                while (started.size() == before + 1 && _started.timed_wait(lk, deadline)) {
+                }
+                overlapped = started.size() > before + 1;
+            }
+        }
+        virtual void noteApplied(const GTID& gtid) {
+            noted.push_back(gtid);
+        }
+    private:
+        boost::mutex _m;
+        boost::condition _started;
+    };
+
+    class ParallelApplierBase {
+    protected:
+        static BSONObj txn(int n, int pk, int waitMillis = 0) {
+            BSONObjBuilder b;
+            addGTIDToBSON("_id", GTID(0, n), b);
+            b.append("n", n);
+            b.append("a", false);
+            b.append("ops", BSON_ARRAY(BSON("op" << "i" << "ns" << "unittests.foo" << "o" << BSON("_id" << pk))));
+            if (waitMillis > 0) {
+                b.append("waitMillis", waitMillis);
+            }
+            return b.obj();
+        }
+        static void assertNotedInOrder(const RecordingApplier& applier, size_t n) {
+            ASSERT_EQUALS(n, applier.noted.size());
+            for (size_t i = 0; i < n; i++) {
+                ASSERT_EQUALS(0, GTID::cmp(GTID(0, i), applier.noted[i]));
+            }
+        }
+    };
+
+    // transactions on different rows are applied at the same time, and
+    // still noted applied in GTID order
+    class ParallelApplierNoConflicts : public ParallelApplierBase {
+    public:
+        void run() {
+            RecordingApplier applier(2);
+            vector<BSONObj> batch;
+            // the first one only finishes once the second has started
+            batch.push_back(txn(0, 1, 10000));
+            batch.push_back(txn(1, 2));
+            applier.applyBatch(batch);
+            ASSERT(applier.overlapped);
+            ASSERT_EQUALS(2U, applier.started.size());
+            assertNotedInOrder(applier, 2);
+        }
+    };
+
+    // transactions on the same row are applied one after another, in oplog order
+    class ParallelApplierConflicts : public ParallelApplierBase {
+    public:
+        void run() {
+            RecordingApplier applier(4);
+            vector<BSONObj> batch;
+            batch.push_back(txn(0, 1, 200));
+            batch.push_back(txn(1, 2));
+            batch.push_back(txn(2, 1, 200));
+            batch.push_back(txn(3, 1));
+            applier.applyBatch(batch);
+            ASSERT_EQUALS(4U, applier.started.size());
+            vector<int> onRow1;
+            for (vector<int>::const_iterator it = applier.started.begin(); it != applier.started.end(); ++it) {
+                if (*it != 1) {
+                    onRow1.push_back(*it);
+                }
+            }
+            ASSERT_EQUALS(3U, onRow1.size());
+            ASSERT_EQUALS(0, onRow1[0]);
+            ASSERT_EQUALS(2, onRow1[1]);
+            ASSERT_EQUALS(3, onRow1[2]);
+            assertNotedInOrder(applier, 4);
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "replset" ) {
         }
 
         void setupTests() {
+            add< ParallelApplierConflictKeys >();
+            add< ParallelApplierBatches >();
+            add< ParallelApplierNoConflicts >();
+            add< ParallelApplierConflicts >();
             LOG(0) << "replication tests disabled" << endl;
 #if 0
             add< TestInitApplyOp >();
@@ -18,6 +18,8 @@
  */
 
 #include "pch.h"
+#include "../util/net/message.h"
+#include "../util/net/message_compressor.h"
 #include "../util/net/sock.h"
 #include "dbtests.h"
 
@@ -36,11 +38,45 @@ namespace SockTests {
         }
     };
 
+    class CompressRoundTrip {
+    public:
+        void run() {
+            string body;
+            for ( int i = 0; i < 1000; i++ ) {
+                body += "compressible ";
+            }
+            Message m;
+            m.setData( dbQuery , body.c_str() , body.size() + 1 );
+            m.header()->id = 17;
+            m.header()->responseTo = 42;
+
+            Message c;
+            ASSERT( MessageCompressor::compress( MessageCompressor::ZLIB , m , c ) );
+            ASSERT_EQUALS( dbCompressed , c.operation() );
+            ASSERT( c.size() < m.size() );
+
+            MessageCompressor::decompress( c );
+            ASSERT_EQUALS( dbQuery , c.operation() );
+            ASSERT_EQUALS( m.size() , c.size() );
+            ASSERT_EQUALS( 17 , c.header()->id );
+            ASSERT_EQUALS( 42 , c.header()->responseTo );
+            ASSERT_EQUALS( body , string( c.singleData()->_data ) );
+
+            // too small to be worth it
+            Message small;
+            small.setData( dbQuery , "x" );
+            Message out;
+            ASSERT( ! MessageCompressor::compress( MessageCompressor::ZLIB , small , out ) );
+            ASSERT( out.empty() );
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "sock" ) {}
         void setupTests() {
             add< HostByName >();
+            add< CompressRoundTrip >();
         }
     } myall;
 
@@ -31,6 +31,11 @@
 #include "../util/concurrency/synchronization.h"
 #include "../util/concurrency/qlock.h"
 #include "dbtests.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/lockstat.h"
+#include "mongo/db/stats/top.h"
+#include "mongo/db/storage/group_commit.h"
+#include "mongo/util/concurrency/striped_counters.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/platform/atomic_word.h"
 
@@ -287,6 +292,123 @@ namespace ThreadedTests {
         }
     };
 
+    // Every add lands in some stripe, whichever threads share them.
+    class StripedCountersTest : public ThreadedTest<> {
+        static const int iterations = 100000;
+        StripedCounters<3> counters;
+
+        void subthread(int x) {
+            for(int i=0; i < iterations; i++) {
+                counters.add(0, 1);
+                counters.add(2, x);
+            }
+        }
+        void validate() {
+            ASSERT_EQUALS((long long) nthreads * iterations, counters.get(0));
+            ASSERT_EQUALS(0, counters.get(1));
+            ASSERT_EQUALS((long long) nthreads * (nthreads + 1) / 2 * iterations, counters.get(2));
+            counters.reset();
+            ASSERT_EQUALS(0, counters.get(0));
+            ASSERT_EQUALS(0, counters.get(2));
+        }
+    };
+
+    // The contention striping takes away: the same adds timed against one
+    // shared atomic counter, as OpCounters used, and against striped ones.
+    struct SharedCounter {
+        AtomicInt64 value;
+        void add(int, long long n) { value.fetchAndAdd(n); }
+        long long get(int) const { return value.load(); }
+    };
+
+    template <class Counter>
+    class CounterContention : public ThreadedTest<16> {
+        static const int iterations = 1000000;
+        Counter counter;
+        Timer t;
+
+        void setup() { t.reset(); }
+        void subthread(int) {
+            for(int i=0; i < iterations; i++) {
+                counter.add(0, 1);
+            }
+        }
+        void validate() {
+            const int ms = t.millis();
+            ASSERT_EQUALS((long long) nthreads * iterations, counter.get(0));
+            cout << typeid(Counter).name() << " " << nthreads << " threads x " << iterations
+                 << " adds: " << ms << "ms" << endl;
+        }
+    };
+
+    // What every operation records on its way out, timed from 16 threads:
+    // Top::record and recordLatency on a few collections, and a LockStat.
+    class TopRecordContention : public ThreadedTest<16> {
+        static const int iterations = 200000;
+        Top top;
+        Timer t;
+
+        void setup() { t.reset(); }
+        void subthread(int x) {
+            const string ns = mongoutils::str::stream() << "unittests.top" << (x % 4);
+            for(int i=0; i < iterations; i++) {
+                top.record(ns, dbQuery, -1, 1, false);
+                top.recordLatency(ns, dbQuery, false, 1);
+            }
+        }
+        void validate() {
+            const int ms = t.millis();
+            Top::UsageMap usages;
+            top.cloneMap(usages);
+            ASSERT_EQUALS(4U, usages.size());
+            long long queries = 0;
+            for (Top::UsageMap::const_iterator it = usages.begin(); it != usages.end(); ++it) {
+                queries += it->second.queries.count;
+            }
+            ASSERT_EQUALS((long long) nthreads * iterations, queries);
+            ASSERT_EQUALS((long long) nthreads * iterations, top.getGlobalData().queries.count);
+            cout << "Top " << nthreads << " threads x " << iterations
+                 << " record and recordLatency: " << ms << "ms" << endl;
+        }
+    };
+
+    class LockStatContention : public ThreadedTest<16> {
+        static const int iterations = 1000000;
+        LockStat stat;
+        Timer t;
+
+        void setup() { t.reset(); }
+        void subthread(int) {
+            for(int i=0; i < iterations; i++) {
+                stat.recordLockTimeMicros('r', 1);
+            }
+        }
+        void validate() {
+            const int ms = t.millis();
+            ASSERT_EQUALS((long long) nthreads * iterations, stat.getTimeLocked('r'));
+            cout << "LockStat " << nthreads << " threads x " << iterations
+                 << " recordLockTimeMicros: " << ms << "ms" << endl;
+        }
+    };
+
+    // A drop throws away what threads cached, so its usage starts over.
+    class TopDropForgetsCachedUsage {
+    public:
+        void run() {
+            Top top;
+            top.record("unittests.topdrop", dbInsert, 1, 1, false);
+            top.record("unittests.topdrop", dbInsert, 1, 1, false);
+            top.collectionDropped("unittests.topdrop");
+            // the drop command itself is recorded after the drop, and ignored
+            top.record("unittests.topdrop", dbQuery, 1, 1, true);
+            top.record("unittests.topdrop", dbInsert, 1, 1, false);
+            Top::UsageMap usages;
+            top.cloneMap(usages);
+            ASSERT_EQUALS(1, usages["unittests.topdrop"].insert.count);
+            ASSERT_EQUALS(3, top.getGlobalData().insert.count);
+        }
+    };
+
     class MVarTest : public ThreadedTest<> {
         static const int iterations = 10000;
         MVar<int> target;
@@ -333,6 +455,34 @@ namespace ThreadedTests {
         }
     };
 
+    /** A task queued behind a blocked one runs once a thread is added. */
+    class ThreadPoolAddThreads {
+        Notification blocked;
+        Notification release;
+        Notification queuedRan;
+        void block() {
+            blocked.notifyOne();
+            release.waitToBeNotified();
+        }
+        void queued() {
+            queuedRan.notifyOne();
+        }
+    public:
+        void run() {
+            ThreadPool tp(1);
+            tp.schedule(&ThreadPoolAddThreads::block, this);
+            blocked.waitToBeNotified();
+            tp.schedule(&ThreadPoolAddThreads::queued, this);
+            ASSERT_EQUALS(2, tp.tasks_remaining());
+
+            tp.addThreads(1);
+            queuedRan.waitToBeNotified();
+            release.notifyOne();
+            tp.join();
+            ASSERT_EQUALS(0, tp.tasks_remaining());
+        }
+    };
+
     class LockTest {
     public:
         void run() {
@@ -926,6 +1076,31 @@ namespace ThreadedTests {
 
     };
 
+    // Every waiter is covered by some flush, and concurrent waiters share them.
+    class GroupCommitTest : public ThreadedTest<8> {
+        enum { N = 200 };
+        storage::GroupCommit _gc;
+    public:
+        virtual void subthread(int) {
+            for ( int i = 0; i < N; i++ ) {
+                _gc.waitDurable();
+            }
+        }
+        virtual void validate() {
+            BSONObjBuilder b;
+            _gc.appendStats( b );
+            BSONObj stats = b.obj();
+            ASSERT_EQUALS( (long long) N * nthreads , stats["commits"].numberLong() );
+            ASSERT( stats["flushes"].numberLong() >= 1 );
+            ASSERT( stats["flushes"].numberLong() <= stats["commits"].numberLong() );
+            long long batched = 0;
+            for ( BSONObjIterator it( stats["batchSizes"].Obj() ); it.more(); ) {
+                batched += it.next().Obj()["count"].numberLong();
+            }
+            ASSERT_EQUALS( stats["flushes"].numberLong() , batched );
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "threading" ) { }
@@ -950,8 +1125,15 @@ namespace ThreadedTests {
             add< IsAtomicUIntAtomic >();
             add< IsAtomicWordAtomic<AtomicUInt32> >();
             add< IsAtomicWordAtomic<AtomicUInt64> >();
+            add< StripedCountersTest >();
+            add< CounterContention<SharedCounter> >();
+            add< CounterContention< StripedCounters<1> > >();
+            add< TopRecordContention >();
+            add< LockStatContention >();
+            add< TopDropForgetsCachedUsage >();
             add< MVarTest >();
             add< ThreadPoolTest >();
+            add< ThreadPoolAddThreads >();
             add< LockTest >();
 
 
@@ -962,6 +1144,7 @@ namespace ThreadedTests {
 
             add< MongoMutexTest >();
             add< TicketHolderWaits >();
+            add< GroupCommitTest >();
         }
     } myall;
 }
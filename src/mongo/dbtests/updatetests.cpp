@@ -231,6 +231,100 @@ namespace UpdateTests {
         }
     };
 
+    class FastUpdateBase : public SetBase {
+    public:
+        FastUpdateBase() : _old( cmdLine.fastUpdates ) {
+            cmdLine.fastUpdates = true;
+        }
+        ~FastUpdateBase() {
+            cmdLine.fastUpdates = _old;
+        }
+    private:
+        const bool _old;
+    };
+
+    class FastUpdateInc : public FastUpdateBase {
+    public:
+        void run() {
+            client().insert( ns(), fromjson( "{'_id':0,a:1}" ) );
+            client().insert( ns(), fromjson( "{'_id':1,a:1}" ) );
+            client().update( ns(), BSON( "_id" << 0 ), BSON( "$inc" << BSON( "a" << 2 ) ) );
+            client().update( ns(), BSON( "_id" << 0 ), BSON( "$set" << BSON( "b" << "x" ) ) );
+            ASSERT_EQUALS( client().findOne( ns(), BSON( "_id" << 0 ) ), fromjson( "{'_id':0,a:3,b:'x'}" ) );
+            ASSERT_EQUALS( client().findOne( ns(), BSON( "_id" << 1 ) ), fromjson( "{'_id':1,a:1}" ) );
+        }
+    };
+
+    class FastUpdateMissing : public FastUpdateBase {
+    public:
+        void run() {
+            client().insert( ns(), fromjson( "{'_id':0,a:1}" ) );
+            // not an upsert, so nothing is created
+            client().update( ns(), BSON( "_id" << 1 ), BSON( "$inc" << BSON( "a" << 2 ) ) );
+            // and whether anything matched isn't known
+            BSONObj le = client().getLastErrorDetailed();
+            ASSERT( le["n"].isNull() );
+            ASSERT( le["updatedExisting"].isNull() );
+            ASSERT_EQUALS( 1U, client().count( ns() ) );
+            // mods that can't be applied to the object leave it alone
+            client().insert( ns(), fromjson( "{'_id':2,a:'s'}" ) );
+            client().update( ns(), BSON( "_id" << 2 ), BSON( "$inc" << BSON( "a" << 2 ) ) );
+            ASSERT_EQUALS( client().findOne( ns(), BSON( "_id" << 2 ) ), fromjson( "{'_id':2,a:'s'}" ) );
+        }
+    };
+
+    /**
+     * Updates a document with a large indexed array, changing one element at a
+     * time. The index keys are diffed with one merge (see IndexKeyDiff), so the
+     * time per update should grow linearly with the array size.
+     */
+    class MultikeyUpdateScaling : public SetBase {
+    public:
+        void run() {
+            client().ensureIndex( ns(), BSON( "a" << 1 ) );
+            const int sizes[] = { 10, 100, 1000, 2000 };
+            for ( size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++ ) {
+                const int n = sizes[s];
+                BSONArrayBuilder a;
+                for ( int i = 0; i < n; i++ ) {
+                    a.append( i );
+                }
+                client().insert( ns(), BSON( "_id" << n << "a" << a.arr() ) );
+
+                const int nUpdates = 20;
+                Timer t;
+                for ( int i = 0; i < nUpdates; i++ ) {
+                    client().update( ns(), BSON( "_id" << n ),
+                                     BSON( "$set" << BSON( "a.0" << -( i + 1 ) ) ) );
+                }
+                log() << "MultikeyUpdateScaling: array of " << n << ", "
+                      << t.micros() / nUpdates << " micros per update" << endl;
+
+                ASSERT( client().findOne( ns(), QUERY( "a" << -nUpdates ).hint( BSON( "a" << 1 ) ) )["_id"].numberInt() == n );
+                ASSERT( client().findOne( ns(), QUERY( "a" << -1 ).hint( BSON( "a" << 1 ) ) ).isEmpty() );
+                ASSERT( !client().findOne( ns(), QUERY( "a" << n - 1 ).hint( BSON( "a" << 1 ) ) ).isEmpty() );
+            }
+        }
+    };
+
+    /** Callers that need to know what matched, like findAndModify, never update blindly. */
+    class FastUpdateNeedsResult : public FastUpdateBase {
+    public:
+        void run() {
+            client().insert( ns(), fromjson( "{'_id':0,a:1}" ) );
+            BSONObj ret;
+            ASSERT( client().runCommand( "unittests",
+                                         BSON( "findAndModify" << "updatetests.SetBase" <<
+                                               "query" << BSON( "_id" << 0 ) <<
+                                               "update" << BSON( "$inc" << BSON( "a" << 2 ) ) <<
+                                               "new" << true ),
+                                         ret ) );
+            ASSERT_EQUALS( 3, ret["value"]["a"].numberInt() );
+            ASSERT_EQUALS( 1, ret["lastErrorObject"]["n"].numberInt() );
+            ASSERT( ret["lastErrorObject"]["updatedExisting"].trueValue() );
+        }
+    };
+
     class IncMissing : public SetBase {
     public:
         void run() {
@@ -1252,6 +1346,10 @@ namespace UpdateTests {
             add< SetMissingDotted >();
             add< SetAdjacentDotted >();
             add< IncMissing >();
+            add< FastUpdateInc >();
+            add< FastUpdateMissing >();
+            add< FastUpdateNeedsResult >();
+            add< MultikeyUpdateScaling >();
             add< MultiInc >();
             add< UnorderedNewSet >();
             add< UnorderedNewSetAdjacent >();
@@ -185,6 +185,10 @@ namespace mongo {
 
         static ShardedConnectionInfo* get( bool create );
         static void reset();
+        // Detach this thread's info without deleting it, and attach one (which
+        // may be null), for connections that move between threads.
+        static ShardedConnectionInfo* release();
+        static void reset( ShardedConnectionInfo* info );
         static void addHook();
 
         bool inForceVersionOkMode() const {
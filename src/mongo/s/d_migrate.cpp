@@ -28,6 +28,7 @@
 #include <string>
 #include <algorithm>
 
+#include <boost/bind.hpp>
 #include <boost/thread/thread.hpp>
 
 #include "mongo/pch.h"
@@ -1019,7 +1020,8 @@ namespace mongo {
                                                           "min" << min <<
                                                           "max" << max <<
                                                           "shardKeyPattern" << shardKeyPattern <<
-                                                          "configServer" << configServer.modelServer()
+                                                          "configServer" << configServer.modelServer() <<
+                                                          "toShardName" << toShard.getName()
                                                           ) ,
                                                     res );
                 }
@@ -1378,6 +1380,7 @@ namespace mongo {
             verify( ! active );
             state = READY;
             errmsg = "";
+            toShardName = "";
 
             numCloned = 0;
             clonedBytes = 0;
@@ -1404,6 +1407,138 @@ namespace mongo {
             setActive( false );
         }
 
+        /**
+         * The result of one _migrateClone call. fetch() may run on its own
+         * thread, so it reports failure through ok/err instead of throwing.
+         */
+        struct CloneBatch {
+            CloneBatch() : ok(false) {}
+            // fetch() on a thread of its own, which needs a Client like any other
+            void fetchInThread(DBClientBase *conn) {
+                Client::initThread( "migrateCloneFetcher" );
+                fetch( conn );
+                cc().shutdown();
+            }
+            void fetch(DBClientBase *conn) {
+                try {
+                    // gets array of objects to copy, in disk order
+                    ok = conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res );
+                    if ( ! ok )
+                        err = res.toString();
+                }
+                catch ( DBException &e ) {
+                    ok = false;
+                    err = e.toString();
+                }
+            }
+            bool ok;
+            BSONObj res;
+            string err;
+        };
+
+        /**
+         * Asks the config server whether this shard owns any chunks of the
+         * collection. Only a migration can give it one, and only one
+         * migration at a time runs here, so the answer holds until this one
+         * commits. Says false if the donor didn't tell us our shard name or
+         * the config server can't be reached.
+         */
+        bool ownsNoChunks() {
+            if ( toShardName.empty() ) {
+                return false;
+            }
+            try {
+                scoped_ptr<ScopedDbConnection> conn(
+                        ScopedDbConnection::getInternalScopedDbConnection(
+                                shardingState.getConfigServer(), 10.0 ) );
+                const unsigned long long n =
+                        conn->get()->count( ShardNS::chunk, BSON( "ns" << ns << "shard" << toShardName ) );
+                conn->done();
+                return n == 0;
+            }
+            catch ( DBException &e ) {
+                warning() << "could not count chunks of " << ns << " on " << toShardName
+                          << causedBy( e ) << migrateLog;
+                return false;
+            }
+        }
+
+        /**
+         * Decides, inside the clone transaction, whether cloned documents can
+         * be inserted directly rather than upserted one by one.
+         *
+         * If this shard owns no chunks of the collection and holds no
+         * documents for it, nothing can conflict with the donor's documents
+         * and no one else writes the collection here until the migration
+         * commits, so the inserts skip both unique checks and row locks. A
+         * shard that owns chunks may take writes to them at any time, so
+         * being empty once isn't enough to drop row locks.
+         *
+         * If the shard key is just _id, ascending or hashed, and the chunk's
+         * range is empty (step 2 removed anything left behind), a document
+         * with the same _id as a cloned one could only be in the range, so
+         * unique checks are skipped but row locks are still taken. That doesn't hold for a compound key starting with
+         * _id: { _id : 1, x : 1 } may put the same _id in another chunk.
+         */
+        bool canBulkInsertClone(bool noChunks, uint64_t *flags) {
+            NamespaceDetails *d = nsdetails( ns.c_str() );
+            if ( d == NULL || d->isCapped() ) {
+                return false;
+            }
+            if ( noChunks && ! BasicCursor::make( d )->ok() ) {
+                *flags = NamespaceDetails::NO_UNIQUE_CHECKS | NamespaceDetails::NO_LOCKTREE;
+                return true;
+            }
+            const BSONElement keyField = shardKeyPattern.firstElement();
+            if ( shardKeyPattern.nFields() != 1 ||
+                 ! mongoutils::str::equals( keyField.fieldName(), "_id" ) ||
+                 ! ( ( keyField.isNumber() && keyField.number() == 1 ) ||
+                     mongoutils::str::equals( keyField.valuestrsafe(), "hashed" ) ) ) {
+                return false;
+            }
+            const BSONObj keyPattern = findShardKeyIndexPattern_locked( ns , shardKeyPattern );
+            const IndexDetails &idx = d->idx( d->findIndexByKeyPattern( keyPattern ) );
+            shared_ptr<Cursor> c( IndexCursor::make( d, idx,
+                                                     Helpers::modifiedRangeBound( min , keyPattern , -1 ),
+                                                     Helpers::modifiedRangeBound( max , keyPattern , -1 ),
+                                                     false, 1, 1 ) );
+            if ( c->ok() ) {
+                return false;
+            }
+            *flags = NamespaceDetails::NO_UNIQUE_CHECKS;
+            return true;
+        }
+
+        void applyCloneBatch(const BSONObj &arr, bool bulk, uint64_t insertFlags) {
+            vector<BSONObj> objs;
+            BSONObjIterator i( arr );
+            while( i.more() ) {
+                BSONObj o = i.next().Obj();
+                if ( bulk ) {
+                    objs.push_back( o );
+                }
+                else {
+                    BSONObj id = o["_id"].wrap();
+                    OpDebug debug;
+                    updateObjects(ns.c_str(),
+                                  o,
+                                  id,
+                                  true,  // upsert
+                                  false, // multi
+                                  true,  // logop
+                                  debug,
+                                  true   // fromMigrate
+                                  );
+                }
+
+                numCloned++;
+                clonedBytes += o.objsize();
+            }
+            if ( bulk ) {
+                insertObjects( ns.c_str(), objs, false, insertFlags, true );
+            }
+        }
+
         void _go() {
             verify( getActive() );
             verify( state == READY );
@@ -1477,45 +1612,44 @@ namespace mongo {
                 // 3. initial bulk clone
                 state = CLONE;
 
+                const bool noChunks = ownsNoChunks();
+
                 Client::ReadContext ctx(ns);
                 Client::Transaction txn(DB_SERIALIZABLE);
 
+                uint64_t insertFlags = 0;
+                const bool bulk = canBulkInsertClone(noChunks, &insertFlags);
+                log() << "migrate clone of " << ns << " will "
+                      << (bulk ? "bulk insert" : "upsert each document") << migrateLog;
+
+                CloneBatch batch;
+                batch.fetch(&conn.conn());
                 while ( true ) {
-                    BSONObj res;
-                    if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {  // gets array of objects to copy, in disk order
+                    if ( ! batch.ok ) {
                         state = FAIL;
                         errmsg = "_migrateClone failed: ";
-                        errmsg += res.toString();
+                        errmsg += batch.err;
                         error() << errmsg << migrateLog;
                         conn.done();
                         return;
                     }
 
-                    BSONObj arr = res["objects"].Obj();
-                    int thisTime = 0;
-
-                    BSONObjIterator i( arr );
-                    while( i.more() ) {
-                        BSONObj o = i.next().Obj();
-                        BSONObj id = o["_id"].wrap();
-                        OpDebug debug;
-                        updateObjects(ns.c_str(),
-                                      o,
-                                      id,
-                                      true,  // upsert
-                                      false, // multi
-                                      true,  // logop
-                                      debug,
-                                      true   // fromMigrate
-                                      );
-
-                        thisTime++;
-                        numCloned++;
-                        clonedBytes += o.objsize();
-                    }
-
-                    if ( thisTime == 0 )
+                    BSONObj arr = batch.res["objects"].Obj();
+                    if ( arr.isEmpty() )
                         break;
+
+                    // Fetch the next batch from the donor while this one is applied.
+                    CloneBatch next;
+                    boost::thread fetcher(boost::bind(&CloneBatch::fetchInThread, &next, &conn.conn()));
+                    try {
+                        applyCloneBatch(arr, bulk, insertFlags);
+                    }
+                    catch (...) {
+                        fetcher.join();
+                        throw;
+                    }
+                    fetcher.join();
+                    batch = next;
                 }
 
                 txn.commit();
@@ -1763,6 +1897,8 @@ namespace mongo {
 
         string ns;
         string from;
+        // this shard's name, as the config server knows it; empty if the donor didn't send it
+        string toShardName;
 
         BSONObj min;
         BSONObj max;
@@ -1818,6 +1954,9 @@ namespace mongo {
 
             migrateStatus.ns = cmdObj.firstElement().String();
             migrateStatus.from = cmdObj["from"].String();
+            if (cmdObj.hasField("toShardName")) {
+                migrateStatus.toShardName = cmdObj["toShardName"].String();
+            }
             migrateStatus.min = cmdObj["min"].Obj().getOwned();
             migrateStatus.max = cmdObj["max"].Obj().getOwned();
             if (cmdObj.hasField("shardKeyPattern")) {
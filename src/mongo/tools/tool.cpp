@@ -26,8 +26,10 @@
 
 #include "mongo/client/dbclient_rs.h"
 #include "mongo/db/databaseholder.h"
+#include "mongo/db/index.h"
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/json.h"
+#include "mongo/db/ops/update.h"
 #include "mongo/db/storage/env.h"
 #include "mongo/util/password.h"
 #include "mongo/util/version.h"
@@ -242,6 +244,9 @@ namespace mongo {
             // txn complete hooks, which live in namespace_details.cpp
             extern TxnCompleteHooks _txnCompleteHooks;
             setTxnCompleteHooks(&_txnCompleteHooks);
+            storage::set_update_message_function(applyUpdateMessage);
+            storage::set_generate_keys_function(IndexDetails::generateKeys);
+            storage::set_note_misfit_function(IndexDetails::noteMisfit);
             storage::startup();
         }
 
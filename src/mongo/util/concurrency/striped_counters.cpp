@@ -0,0 +1,43 @@
+// striped_counters.cpp
+
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/concurrency/striped_counters.h"
+
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+    namespace {
+        AtomicUInt32 nextSlot;
+    }
+
+    TSP_DECLARE(unsigned, stripedCountersSlot_tsp);
+    TSP_DEFINE(unsigned, stripedCountersSlot_tsp);
+
+    unsigned stripedCountersSlot() {
+        unsigned *slot = stripedCountersSlot_tsp.get();
+        if (slot == NULL) {
+            slot = new unsigned(nextSlot.fetchAndAdd(1));
+            stripedCountersSlot_tsp.reset(slot);
+        }
+        return *slot;
+    }
+
+} // namespace mongo
@@ -0,0 +1,91 @@
+// striped_counters.h
+
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include "mongo/platform/atomic_word.h"
+
+namespace mongo {
+
+    /**
+     * The calling thread's stripe, handed out round robin on its first call,
+     * so that threads started together land on different stripes.
+     */
+    unsigned stripedCountersSlot();
+
+    // Stripes of a StripedCounters unless it says otherwise.
+    const int DefaultCounterStripes = 16;
+
+    /**
+     * N counters that many threads add to at once, for statistics.
+     *
+     * A single atomic counter bounces its cache line between every core that
+     * adds to it. Here each thread adds to its own stripe's copy of the
+     * counters, a stripe being one or more whole cache lines, and reading a
+     * counter sums it over the stripes. Threads outnumbering the stripes
+     * share them, which is why adds stay atomic, but contend Stripes times
+     * less. Reads are not a snapshot across counters or stripes, and
+     * reset() may lose adds that race with it, which is fine for stats.
+     *
+     * Use Stripes == 1 for counters only ever added to by one thread at a
+     * time, e.g. per operation ones, to keep them small and cheap to read.
+     */
+    template <int N, int Stripes = DefaultCounterStripes>
+    class StripedCounters : boost::noncopyable {
+    public:
+        void add(int i, long long n) { at(slot(), i).fetchAndAdd(n); }
+
+        long long get(int i) const {
+            long long sum = 0;
+            for (int s = 0; s < Stripes; s++) {
+                sum += at(s, i).load();
+            }
+            return sum;
+        }
+
+        void reset() {
+            for (int s = 0; s < Stripes; s++) {
+                for (int i = 0; i < N; i++) {
+                    at(s, i).store(0);
+                }
+            }
+        }
+
+    private:
+        enum { CacheLineSize = 64,
+               LineValues = CacheLineSize / sizeof(long long),
+               // values per stripe, N rounded up to whole cache lines
+               Stride = ((N + LineValues - 1) / LineValues) * LineValues };
+
+        static unsigned slot() { return Stripes == 1 ? 0 : stripedCountersSlot() % Stripes; }
+
+        // _raw has a cache line of slack so that the stripes can start on a
+        // line boundary wherever the object was allocated.
+        AtomicInt64 *base() const {
+            const size_t p = reinterpret_cast<size_t>(_raw);
+            return reinterpret_cast<AtomicInt64 *>((p + CacheLineSize - 1) & ~size_t(CacheLineSize - 1));
+        }
+        AtomicInt64 &at(int s, int i) { return base()[s * Stride + i]; }
+        const AtomicInt64 &at(int s, int i) const { return base()[s * Stride + i]; }
+
+        mutable AtomicInt64 _raw[Stripes * Stride + LineValues];
+    };
+
+} // namespace mongo
@@ -104,6 +104,38 @@ namespace mongo {
             }
         }
 
+        void ThreadPool::addThreads(int nThreads) {
+            scoped_lock lock(_mutex);
+            _nThreads += nThreads;
+            while (nThreads-- > 0) {
+                Worker* worker = new Worker(*this);
+                if (!_tasks.empty()) {
+                    worker->set_task(_tasks.front());
+                    _tasks.pop_front();
+                }
+                else {
+                    _freeWorkers.push_front(worker);
+                }
+            }
+        }
+
+        int ThreadPool::removeThreads(int nThreads) {
+            std::list<Worker*> idle;
+            {
+                scoped_lock lock(_mutex);
+                while (nThreads-- > 0 && !_freeWorkers.empty()) {
+                    idle.push_back(_freeWorkers.front());
+                    _freeWorkers.pop_front();
+                }
+                _nThreads -= idle.size();
+            }
+            // joins each thread, which is waiting for a task
+            for (std::list<Worker*>::iterator it = idle.begin(); it != idle.end(); ++it) {
+                delete *it;
+            }
+            return idle.size();
+        }
+
         void ThreadPool::join() {
             scoped_lock lock(_mutex);
             while(_tasksRemaining) {
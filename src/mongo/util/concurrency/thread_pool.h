@@ -62,6 +62,12 @@ namespace mongo {
 
             int tasks_remaining() { return _tasksRemaining; }
 
+            // starts nThreads more threads, which take queued tasks first
+            void addThreads(int nThreads);
+
+            // stops up to nThreads idle threads, @return how many were stopped
+            int removeThreads(int nThreads);
+
         private:
             mongo::mutex _mutex;
             boost::condition _condition;
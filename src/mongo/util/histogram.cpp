@@ -16,6 +16,7 @@
 
 #include "histogram.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <limits>
 #include <sstream>
@@ -126,4 +127,112 @@ namespace mongo {
         return low;
     }
 
+    namespace {
+
+        // index of the highest bit set in v, which isn't 0
+        inline uint32_t highestBit( uint64_t v ) {
+#if defined(__GNUC__)
+            return 63 - __builtin_clzll( v );
+#else
+            uint32_t bit = 0;
+            while ( v >>= 1 ) {
+                bit++;
+            }
+            return bit;
+#endif
+        }
+
+    }  // namespace
+
+    LatencyHistogram::LatencyHistogram( bool striped ) {
+        if ( striped ) {
+            _striped.reset( new StripedCounters<NumBuckets, Stripes>() );
+        }
+    }
+
+    void LatencyHistogram::add( uint32_t bucket ) {
+        if ( _striped ) {
+            _striped->add( bucket , 1 );
+        }
+        else {
+            _buckets.add( bucket , 1 );
+        }
+    }
+
+    uint64_t LatencyHistogram::get( uint32_t bucket ) const {
+        return _striped ? _striped->get( bucket ) : _buckets.get( bucket );
+    }
+
+    void LatencyHistogram::record( uint64_t micros ) {
+        add( bucketFor( micros ) );
+    }
+
+    void LatencyHistogram::reset() {
+        if ( _striped ) {
+            _striped->reset();
+        }
+        else {
+            _buckets.reset();
+        }
+    }
+
+    uint64_t LatencyHistogram::count() const {
+        uint64_t n = 0;
+        for ( uint32_t i = 0; i < NumBuckets; i++ ) {
+            n += get( i );
+        }
+        return n;
+    }
+
+    uint64_t LatencyHistogram::percentile( double q ) const {
+        uint64_t counts[NumBuckets];
+        uint64_t total = 0;
+        for ( uint32_t i = 0; i < NumBuckets; i++ ) {
+            counts[i] = get( i );
+            total += counts[i];
+        }
+        if ( total == 0 ) {
+            return 0;
+        }
+
+        // rank of the value wanted, 1 based
+        uint64_t rank = (uint64_t) ( q * total );
+        if ( rank < q * total ) {
+            rank++;
+        }
+        rank = std::max( rank , (uint64_t) 1 );
+        rank = std::min( rank , total );
+
+        uint64_t seen = 0;
+        for ( uint32_t i = 0; i < NumBuckets; i++ ) {
+            seen += counts[i];
+            if ( seen >= rank ) {
+                return bucketMax( i );
+            }
+        }
+        return bucketMax( NumBuckets - 1 );
+    }
+
+    uint32_t LatencyHistogram::bucketFor( uint64_t micros ) {
+        if ( micros < SubBuckets ) {
+            return micros;
+        }
+        if ( micros >> MaxBits ) {
+            return NumBuckets - 1;
+        }
+        // the bits below the highest one pick the bucket within its power of two
+        const uint32_t high = highestBit( micros );
+        return ( high - SubBucketBits + 1 ) * SubBuckets +
+               ( ( micros >> ( high - SubBucketBits ) ) & ( SubBuckets - 1 ) );
+    }
+
+    uint64_t LatencyHistogram::bucketMax( uint32_t bucket ) {
+        if ( bucket < SubBuckets ) {
+            return bucket;
+        }
+        const uint32_t high = bucket / SubBuckets + SubBucketBits - 1;
+        const uint64_t sub = bucket % SubBuckets;
+        return ( ( SubBuckets + sub + 1 ) << ( high - SubBucketBits ) ) - 1;
+    }
+
 }  // namespace mongo
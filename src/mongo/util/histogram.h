@@ -20,6 +20,10 @@
 #include <string>
 #include <stdint.h>
 
+#include <boost/scoped_ptr.hpp>
+
+#include "mongo/util/concurrency/striped_counters.h"
+
 namespace mongo {
 
     /**
@@ -118,6 +122,72 @@ namespace mongo {
         Histogram& operator=( const Histogram& );
     };
 
+    /**
+     * A histogram of latencies in micros, bucketed in the style of
+     * HdrHistogram: exactly below 8, then 8 buckets to each power of two, so
+     * any value is known to within 12.5% of it. Values from 2^32 micros
+     * (over an hour) on all count in the last bucket.
+     *
+     * Recording is one atomic add to the value's bucket, without locks, so
+     * it is cheap enough to do for every operation. A striped histogram keeps
+     * Stripes copies of the buckets, so that threads recording at once
+     * mostly add to different cache lines. Each copy is about 2KB, so only
+     * histograms that every operation records into, like Top's overall
+     * ones, should be striped, not ones kept per collection. Reads add up
+     * the buckets one by one, and reset() may lose values recorded
+     * meanwhile, which percentiles don't notice.
+     */
+    class LatencyHistogram {
+    public:
+        explicit LatencyHistogram( bool striped = false );
+
+        void record( uint64_t micros );
+
+        void reset();
+
+        /**
+         * Return the number of values recorded.
+         */
+        uint64_t count() const;
+
+        /**
+         * Return the value that a fraction 'q' of the recorded ones are at
+         * or below, e.g. the median for 0.5, rounded up to the largest of
+         * its bucket. Returns 0 if nothing was recorded.
+         */
+        uint64_t percentile( double q ) const;
+
+        // testing interface below -- consider it private
+
+        enum { SubBucketBits = 3,
+               SubBuckets = 1 << SubBucketBits,
+               MaxBits = 32,
+               NumBuckets = ( MaxBits - SubBucketBits + 1 ) * SubBuckets };
+
+        /**
+         * Return the bucket where 'micros' falls.
+         */
+        static uint32_t bucketFor( uint64_t micros );
+
+        /**
+         * Return the largest value that falls in 'bucket'.
+         */
+        static uint64_t bucketMax( uint32_t bucket );
+
+        enum { Stripes = 4 };
+
+    private:
+        void add( uint32_t bucket );
+        uint64_t get( uint32_t bucket ) const;
+
+        // _buckets unless striped, when _striped holds the counts instead
+        StripedCounters<NumBuckets, 1> _buckets;
+        boost::scoped_ptr< StripedCounters<NumBuckets, Stripes> > _striped;
+
+        LatencyHistogram( const LatencyHistogram& );
+        LatencyHistogram& operator=( const LatencyHistogram& );
+    };
+
 }  // namespace mongo
 
 #endif  //  UTIL_HISTOGRAM_HEADER
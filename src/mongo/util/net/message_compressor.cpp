@@ -0,0 +1,233 @@
+// message_compressor.cpp
+
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message_compressor.h"
+
+#include <zlib.h>
+
+#include "mongo/db/cmdline.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/stringutils.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace MessageCompressor {
+
+        namespace {
+
+#pragma pack(1)
+            struct CompressedHeader {
+                int originalOpCode;
+                int uncompressedSize;
+                unsigned char compressorId;
+            };
+#pragma pack()
+
+            struct Counters {
+                AtomicUInt64 messages;
+                AtomicUInt64 bytesIn;
+                AtomicUInt64 bytesOut;
+                AtomicUInt64 micros;
+
+                void hit(size_t in, size_t out, unsigned long long t) {
+                    messages.fetchAndAdd(1);
+                    bytesIn.fetchAndAdd(in);
+                    bytesOut.fetchAndAdd(out);
+                    micros.fetchAndAdd(t);
+                }
+
+                void append(BSONObjBuilder &b, const char *name) const {
+                    const unsigned long long in = bytesIn.load();
+                    const unsigned long long out = bytesOut.load();
+                    BSONObjBuilder c(b.subobjStart(name));
+                    c.appendNumber("messages", (long long) messages.load());
+                    c.appendNumber("bytesIn", (long long) in);
+                    c.appendNumber("bytesOut", (long long) out);
+                    c.appendNumber("micros", (long long) micros.load());
+                    c.done();
+                }
+            };
+
+            Counters compressorCounters;
+            Counters decompressorCounters;
+
+            vector<Id> enabledCompressors() {
+                vector<string> names;
+                splitStringDelim(cmdLine.networkMessageCompressors, &names, ',');
+                vector<Id> ids;
+                for (vector<string>::const_iterator it = names.begin(); it != names.end(); ++it) {
+                    const Id id = fromName(*it);
+                    if (id != NONE) {
+                        ids.push_back(id);
+                    }
+                }
+                return ids;
+            }
+
+        } // namespace
+
+        Id fromName(const StringData &name) {
+            if (name == "zlib") {
+                return ZLIB;
+            }
+            return NONE;
+        }
+
+        const char *name(Id id) {
+            switch (id) {
+            case ZLIB: return "zlib";
+            default: return "none";
+            }
+        }
+
+        bool validate(const string &names, string &errmsg) {
+            vector<string> parts;
+            splitStringDelim(names, &parts, ',');
+            for (vector<string>::const_iterator it = parts.begin(); it != parts.end(); ++it) {
+                if (*it != "none" && fromName(*it) == NONE) {
+                    errmsg = str::stream() << "unknown network message compressor: " << *it
+                                           << ", must be one of: zlib, none";
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool compress(Id id, Message &m, Message &out) {
+            verify(id == ZLIB);
+            if (m.size() < cmdLine.networkCompressionMinBytes || m.operation() == dbCompressed) {
+                return false;
+            }
+            const unsigned long long start = curTimeMicros64();
+            m.concat();
+            MsgData *src = m.singleData();
+            const uLong srcLen = src->dataLen();
+
+            const uLong bound = compressBound(srcLen);
+            const size_t headerSize = MsgDataHeaderSize + sizeof(CompressedHeader);
+            MsgData *dst = (MsgData *) malloc(headerSize + bound);
+            verify(dst);
+            uLongf dstLen = bound;
+            const int r = compress2(reinterpret_cast<Bytef *>(dst->_data) + sizeof(CompressedHeader), &dstLen,
+                                    reinterpret_cast<const Bytef *>(src->_data), srcLen, Z_BEST_SPEED);
+            if (r != Z_OK || headerSize + dstLen >= (size_t) src->len) {
+                free(dst);
+                return false;
+            }
+
+            dst->len = headerSize + dstLen;
+            dst->id = src->id;
+            dst->responseTo = src->responseTo;
+            dst->setOperation(dbCompressed);
+            CompressedHeader *ch = reinterpret_cast<CompressedHeader *>(dst->_data);
+            ch->originalOpCode = src->operation();
+            ch->uncompressedSize = srcLen;
+            ch->compressorId = id;
+            out.setData(dst, true);
+
+            compressorCounters.hit(src->len, dst->len, curTimeMicros64() - start);
+            return true;
+        }
+
+        void decompress(Message &m) {
+            const unsigned long long start = curTimeMicros64();
+            MsgData *src = m.singleData();
+            verify(src->operation() == dbCompressed);
+            uassert(16884, "compressed message too short", src->dataLen() >= (int) sizeof(CompressedHeader));
+            const CompressedHeader *ch = reinterpret_cast<const CompressedHeader *>(src->_data);
+            uassert(16885, str::stream() << "unknown message compressor " << (int) ch->compressorId,
+                    ch->compressorId == ZLIB);
+            // the same bound MessagingPort::recv puts on uncompressed messages
+            uassert(16886, str::stream() << "bad uncompressed message size " << ch->uncompressedSize,
+                    ch->uncompressedSize >= 0 && ch->uncompressedSize <= 48000000 - MsgDataHeaderSize);
+
+            MsgData *dst = (MsgData *) malloc(MsgDataHeaderSize + ch->uncompressedSize);
+            verify(dst);
+            uLongf dstLen = ch->uncompressedSize;
+            const int r = uncompress(reinterpret_cast<Bytef *>(dst->_data), &dstLen,
+                                     reinterpret_cast<const Bytef *>(src->_data) + sizeof(CompressedHeader),
+                                     src->dataLen() - sizeof(CompressedHeader));
+            if (r != Z_OK || dstLen != (uLongf) ch->uncompressedSize) {
+                free(dst);
+                uasserted(16887, str::stream() << "failed to decompress message, zlib error " << r);
+            }
+
+            dst->len = MsgDataHeaderSize + ch->uncompressedSize;
+            dst->id = src->id;
+            dst->responseTo = src->responseTo;
+            dst->setOperation(ch->originalOpCode);
+
+            decompressorCounters.hit(src->len, dst->len, curTimeMicros64() - start);
+            m.reset();
+            m.setData(dst, true);
+        }
+
+        void appendRequest(BSONObjBuilder &isMasterCmd) {
+            const vector<Id> ids = enabledCompressors();
+            BSONArrayBuilder b(isMasterCmd.subarrayStart("compression"));
+            for (vector<Id>::const_iterator it = ids.begin(); it != ids.end(); ++it) {
+                b.append(name(*it));
+            }
+            b.done();
+        }
+
+        void applyReply(const BSONObj &isMasterReply, MessagingPort &port) {
+            BSONElement e = isMasterReply["compression"];
+            if (e.type() == Array) {
+                BSONObj picked = e.Obj();
+                if (!picked.isEmpty()) {
+                    port.setCompressor(fromName(picked.firstElement().valuestrsafe()));
+                }
+            }
+        }
+
+        void negotiate(const BSONObj &isMasterCmd, AbstractMessagingPort *port, BSONObjBuilder &result) {
+            BSONElement e = isMasterCmd["compression"];
+            MessagingPort *mp = dynamic_cast<MessagingPort *>(port);
+            if (e.type() != Array || mp == NULL) {
+                return;
+            }
+            const vector<Id> ours = enabledCompressors();
+            BSONArrayBuilder b(result.subarrayStart("compression"));
+            for (BSONObjIterator it(e.Obj()); it.more(); ) {
+                const Id id = fromName(it.next().valuestrsafe());
+                if (id != NONE && std::find(ours.begin(), ours.end(), id) != ours.end()) {
+                    mp->setCompressor(id);
+                    b.append(name(id));
+                    break;
+                }
+            }
+            b.done();
+        }
+
+        void appendStats(BSONObjBuilder &b) {
+            BSONObjBuilder z(b.subobjStart(name(ZLIB)));
+            compressorCounters.append(z, "compressor");
+            decompressorCounters.append(z, "decompressor");
+            z.done();
+        }
+
+    } // namespace MessageCompressor
+
+} // namespace mongo
@@ -0,0 +1,85 @@
+// message_compressor.h
+
+/**
+ *    Copyright (C) 2013 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "mongo/pch.h"
+
+namespace mongo {
+
+    class AbstractMessagingPort;
+    class BSONObj;
+    class BSONObjBuilder;
+    class Message;
+    class MessagingPort;
+
+    /**
+     * Compression of wire protocol messages.
+     *
+     * A compressed message is a dbCompressed message with the id and
+     * responseTo of the message it wraps, and a body of
+     *   int32  opCode of the original message
+     *   int32  size of the original message's body (everything after its header)
+     *   uint8  compressor id
+     *   ...    the original body, compressed
+     *
+     * Peers agree on a compressor in isMaster: the client lists the ones it
+     * can use, in order of preference, under "compression", and the server
+     * replies with the one it picked, if any. From then on both sides
+     * compress messages of at least --networkCompressionMinBytes. Whatever
+     * was negotiated, a compressed message that arrives is always
+     * decompressed.
+     */
+    namespace MessageCompressor {
+
+        enum Id {
+            NONE = 0,
+            ZLIB = 1
+        };
+
+        // @return NONE if name is not a known compressor
+        Id fromName(const StringData &name);
+        const char *name(Id id);
+
+        // checks a --networkMessageCompressors value, @return false with errmsg set if invalid
+        bool validate(const string &names, string &errmsg);
+
+        /**
+         * Compresses m into out with compressor id.
+         * @return false, leaving out empty, if m is too small to be worth
+         * compressing or would not shrink, in which case send m as is
+         */
+        bool compress(Id id, Message &m, Message &out);
+
+        // Replaces m, a dbCompressed message, with the message it wraps.
+        void decompress(Message &m);
+
+        // Client side of negotiation: appends our compressors to an isMaster command.
+        void appendRequest(BSONObjBuilder &isMasterCmd);
+        // Client side of negotiation: applies the server's isMaster reply to port.
+        void applyReply(const BSONObj &isMasterReply, MessagingPort &port);
+        // Server side of negotiation: picks a compressor for port from the
+        // client's isMaster command and reports it in result.
+        void negotiate(const BSONObj &isMasterCmd, AbstractMessagingPort *port, BSONObjBuilder &result);
+
+        // per compressor message and byte counts, and time spent, for serverStatus
+        void appendStats(BSONObjBuilder &b);
+
+    } // namespace MessageCompressor
+
+} // namespace mongo
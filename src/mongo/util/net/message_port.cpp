@@ -126,18 +126,18 @@ namespace mongo {
     }
 
     MessagingPort::MessagingPort(int fd, const SockAddr& remote) 
-        : psock( new Socket( fd , remote ) ) , piggyBackData(0) {
+        : psock( new Socket( fd , remote ) ) , piggyBackData(0) , _compressor( MessageCompressor::NONE ) {
         ports.insert(this);
     }
 
     MessagingPort::MessagingPort( double timeout, int ll ) 
-        : psock( new Socket( timeout, ll ) ) {
+        : psock( new Socket( timeout, ll ) ) , _compressor( MessageCompressor::NONE ) {
         ports.insert(this);
         piggyBackData = 0;
     }
 
     MessagingPort::MessagingPort( boost::shared_ptr<Socket> sock )
-        : psock( sock ), piggyBackData( 0 ) {
+        : psock( sock ), piggyBackData( 0 ), _compressor( MessageCompressor::NONE ) {
         ports.insert(this);
     }
 
@@ -162,26 +162,13 @@ again:
             int lft = 4;
             psock->recv( lenbuf, lft );
 
-            if ( len < 16 || len > 48000000 ) { // messages must be large enough for headers
-                if ( len == -1 ) {
-                    // Endian check from the client, after connecting, to see what mode server is running in.
-                    unsigned foo = 0x10203040;
-                    send( (char *) &foo, 4, "endian" );
-                    goto again;
-                }
-
-                if ( len == 542393671 ) {
-                    // an http GET
-                    LOG( psock->getLogLevel() ) << "looks like you're trying to access db over http on native driver port.  please add 1000 for webserver" << endl;
-                    string msg = "You are trying to access MongoDB on the native driver port. For http diagnostic access, add 1000 to the port number\n";
-                    stringstream ss;
-                    ss << "HTTP/1.0 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: " << msg.size() << "\r\n\r\n" << msg;
-                    string s = ss.str();
-                    send( s.c_str(), s.size(), "http" );
-                    return false;
-                }
-                LOG(0) << "recv(): message len " << len << " is too large" << len << endl;
+            switch ( checkHeaderLength( len ) ) {
+            case EndianCheck:
+                goto again;
+            case BadLength:
                 return false;
+            case MessageLength:
+                break;
             }
 
             int z = (len+1023)&0xfffffc00;
@@ -198,6 +185,9 @@ again:
 
             guard.Dismiss();
             m.setData(md, true);
+            if ( md->operation() == dbCompressed ) {
+                MessageCompressor::decompress( m );
+            }
             return true;
 
         }
@@ -208,6 +198,32 @@ again:
         }
     }
 
+    MessagingPort::HeaderLength MessagingPort::checkHeaderLength(int len) {
+        if ( len >= 16 && len <= 48000000 ) { // messages must be large enough for headers
+            return MessageLength;
+        }
+
+        if ( len == -1 ) {
+            // Endian check from the client, after connecting, to see what mode server is running in.
+            unsigned foo = 0x10203040;
+            send( (char *) &foo, 4, "endian" );
+            return EndianCheck;
+        }
+
+        if ( len == 542393671 ) {
+            // an http GET
+            LOG( psock->getLogLevel() ) << "looks like you're trying to access db over http on native driver port.  please add 1000 for webserver" << endl;
+            string msg = "You are trying to access MongoDB on the native driver port. For http diagnostic access, add 1000 to the port number\n";
+            stringstream ss;
+            ss << "HTTP/1.0 200 OK\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: " << msg.size() << "\r\n\r\n" << msg;
+            string s = ss.str();
+            send( s.c_str(), s.size(), "http" );
+            return BadLength;
+        }
+        LOG(0) << "recv(): message len " << len << " is too large" << len << endl;
+        return BadLength;
+    }
+
     void MessagingPort::reply(Message& received, Message& response) {
         say(/*received.from, */response, received.header()->id);
     }
@@ -265,6 +281,14 @@ again:
             }
         }
 
+        if ( _compressor != MessageCompressor::NONE ) {
+            Message compressed;
+            if ( MessageCompressor::compress( _compressor , toSend , compressed ) ) {
+                compressed.send( *this, "say" );
+                return;
+            }
+        }
+
         toSend.send( *this, "say" );
     }
 
@@ -19,6 +19,7 @@
 
 #include "sock.h"
 #include "message.h"
+#include "message_compressor.h"
 
 namespace mongo {
 
@@ -69,6 +70,16 @@ namespace mongo {
            also, the Message data will go out of scope on the subsequent recv call.
         */
         bool recv(Message& m);
+
+        /** What the length a message starts with, read off the socket, says to do next. */
+        enum HeaderLength {
+            MessageLength, // read the rest of a message that long
+            EndianCheck,   // the client's check after connecting, already answered
+            BadLength      // not a message, close the connection
+        };
+        /** Answers the endian check and an http GET on the driver port. */
+        HeaderLength checkHeaderLength(int len);
+
         void reply(Message& received, Message& response, MSGID responseTo);
         void reply(Message& received, Message& response);
         bool call(Message& toSend, Message& response);
@@ -88,6 +99,10 @@ namespace mongo {
 
         void piggyBack( Message& toSend , int responseTo = -1 );
 
+        /** compress large messages sent from now on, see message_compressor.h */
+        void setCompressor( MessageCompressor::Id id ) { _compressor = id; }
+        MessageCompressor::Id compressor() const { return _compressor; }
+
         unsigned remotePort() const { return psock->remotePort(); }
         virtual HostAndPort remote() const;
 
@@ -112,6 +127,8 @@ namespace mongo {
     private:
         
         PiggyBackData * piggyBackData;
+
+        MessageCompressor::Id _compressor;
         
         // this is the parsed version of remote
         // mutable because its initialized only on call to remote()
@@ -26,8 +26,19 @@
 
 namespace mongo {
 
+    class BSONObjBuilder;
     struct LastError;
 
+    /**
+     * A connection's thread local state (its Client, LastError, ...) while
+     * it is detached from any thread, see MessageHandler::suspend().
+     * Deleting it releases the state.
+     */
+    class ConnectionState {
+    public:
+        virtual ~ConnectionState() {}
+    };
+
     class MessageHandler {
     public:
         virtual ~MessageHandler() {}
@@ -47,6 +58,18 @@ namespace mongo {
          * called once when a socket is disconnected
          */
         virtual void disconnected( AbstractMessagingPort* p ) = 0;
+
+        /**
+         * A server with a pool of workers runs each message of a connection
+         * on whichever worker is free. It calls suspend() on the thread that
+         * handled connected() or a message, to detach the connection's thread
+         * local state from it, and resume() on the thread that handles the
+         * next message, to attach it there.
+         * Handlers that return false from canSuspend() get a thread per connection.
+         */
+        virtual bool canSuspend() const { return false; }
+        virtual ConnectionState* suspend( AbstractMessagingPort* p ) { return 0; }
+        virtual void resume( AbstractMessagingPort* p , ConnectionState* state ) {}
     };
 
     class MessageServer {
@@ -54,8 +77,9 @@ namespace mongo {
         struct Options {
             int port;                   // port to bind to
             string ipList;             // addresses to bind to
+            int workers;               // size of the worker pool, 0 for a thread per connection
 
-            Options() : port(0), ipList("") {}
+            Options() : port(0), ipList(""), workers(0) {}
         };
 
         virtual ~MessageServer() {}
@@ -65,4 +89,10 @@ namespace mongo {
 
     // TODO use a factory here to decide between port and asio variations
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler );
+
+    /**
+     * appends the worker pool's queue and per stage latency counters to b
+     * @return false if the server runs a thread per connection
+     */
+    bool appendMessageServerStats( BSONObjBuilder& b );
 }
@@ -256,6 +256,10 @@ namespace mongo {
         return new AsyncMessageServer( opts , handler );
     }
 
+    bool appendMessageServerStats( BSONObjBuilder& b ) {
+        return false;
+    }
+
 }
 
 #endif
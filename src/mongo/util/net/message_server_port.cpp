@@ -29,10 +29,14 @@
 #include "../../db/cmdline.h"
 #include "../../db/lasterror.h"
 #include "../../db/stats/counters.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/time_support.h"
 
 #ifdef __linux__  // TODO: consider making this ifndef _WIN32
 # include <sys/resource.h>
+# include <sys/epoll.h>
 #endif
 
 namespace mongo {
@@ -110,30 +114,11 @@ namespace mongo {
             handler->disconnected( p.get() );
         }
 
-    }
-
-    class PortMessageServer : public MessageServer , public Listener {
-    public:
-        PortMessageServer(  const MessageServer::Options& opts, MessageHandler * handler ) :
-            Listener( "" , opts.ipList, opts.port ) {
-
-            uassert( 10275 ,  "multiple PortMessageServer not supported" , ! pms::handler );
-            pms::handler = handler;
-        }
-
-        virtual void acceptedMP(MessagingPort * p) {
-
-            if ( ! connTicketHolder.tryAcquire() ) {
-                log() << "connection refused because too many open connections: " << connTicketHolder.used() << endl;
-
-                // TODO: would be nice if we notified them...
-                p->shutdown();
-                delete p;
-
-                sleepmillis(2); // otherwise we'll hard loop
-                return;
-            }
-
+        /**
+         * runs threadRun( p ) on a new thread, which takes over p and the
+         * connection ticket the caller acquired for it
+         */
+        void startThread( MessagingPort * p ) {
             try {
 #ifndef __linux__  // TODO: consider making this ifdef _WIN32
                 {
@@ -186,7 +171,33 @@ namespace mongo {
 
                 sleepmillis(2);
             }
+        }
+
+    }
+
+    class PortMessageServer : public MessageServer , public Listener {
+    public:
+        PortMessageServer(  const MessageServer::Options& opts, MessageHandler * handler ) :
+            Listener( "" , opts.ipList, opts.port ) {
+
+            uassert( 10275 ,  "multiple PortMessageServer not supported" , ! pms::handler );
+            pms::handler = handler;
+        }
+
+        virtual void acceptedMP(MessagingPort * p) {
+
+            if ( ! connTicketHolder.tryAcquire() ) {
+                log() << "connection refused because too many open connections: " << connTicketHolder.used() << endl;
+
+                // TODO: would be nice if we notified them...
+                p->shutdown();
+                delete p;
+
+                sleepmillis(2); // otherwise we'll hard loop
+                return;
+            }
 
+            pms::startThread( p );
         }
 
         virtual void setAsTimeTracker() {
@@ -201,10 +212,527 @@ namespace mongo {
     };
 
 
+#ifdef __linux__
+    /**
+     * Multiplexes idle connections on one epoll event loop and runs each
+     * message on a pool of worker threads, instead of parking a thread (and
+     * its stack) on every connection.
+     *
+     * The event loop reads messages off the sockets without blocking, a
+     * little at a time as they arrive, and hands a worker only a complete
+     * message, so a slow client holds a buffer rather than a worker. A
+     * connection is registered with EPOLLONESHOT, so once it has a message
+     * it belongs to a single worker until that worker has processed it and
+     * rearmed it. Between messages the connection's thread local state lives
+     * in a ConnectionState, see MessageHandler::suspend().
+     *
+     * The admission queue bounds the messages scheduled or running at once.
+     * When it is full the event loop (and the listener, for new connections)
+     * waits for a worker to finish, so clients see backpressure instead of
+     * the server queueing without limit.
+     *
+     * A message that blocks waiting on another connection (e.g. on a row
+     * lock held by a multi-statement transaction) holds its worker while it
+     * waits. If every worker is busy, messages are queued and none has
+     * finished for StallMillis, they are probably all blocked, possibly on a
+     * connection whose next message is queued behind them, so the pool grows
+     * by one worker (and the admission queue with it), up to MaxGrowth times
+     * --networkWorkers. Once a worker has been spare for IdleMillis, one
+     * added this way is stopped again.
+     *
+     * Sockets secured with SSL still get a thread each: data already
+     * decrypted into the SSL layer's buffers is invisible to epoll.
+     */
+    class PooledMessageServer : public MessageServer , public Listener {
+    public:
+        PooledMessageServer( const MessageServer::Options& opts , MessageHandler * handler ) :
+            Listener( "" , opts.ipList, opts.port ),
+            _epfd( epoll_create( 1024 ) ),
+            _workers( opts.workers ),
+            _minWorkers( opts.workers ),
+            _maxWorkers( opts.workers * MaxGrowth ),
+            _mutex( "PooledMessageServer" ),
+            _nWorkers( opts.workers ),
+            _maxInFlight( opts.workers * QueuedPerWorker ),
+            _inFlight( 0 ),
+            _completed( 0 ),
+            _lastCompleted( 0 ),
+            _lastProgressMillis( curTimeMillis64() ),
+            _warnedAtMax( false ),
+            _lastBusyMillis( curTimeMillis64() ) {
+
+            uassert( 16882 , "multiple PortMessageServer not supported" , ! pms::handler );
+            uassert( 16883 , str::stream() << "epoll_create failed: " << errnoWithDescription() , _epfd >= 0 );
+            pms::handler = handler;
+            _current = this;
+        }
+
+        virtual void acceptedMP(MessagingPort * p) {
+
+            if ( ! connTicketHolder.tryAcquire() ) {
+                log() << "connection refused because too many open connections: " << connTicketHolder.used() << endl;
+
+                p->shutdown();
+                delete p;
+
+                sleepmillis(2); // otherwise we'll hard loop
+                return;
+            }
+
+#ifdef MONGO_SSL
+            if ( p->psock->isSecure() ) {
+                pms::startThread( p );
+                return;
+            }
+#endif
+
+            _stats.connections.fetchAndAdd( 1 );
+            admit( new Connection( p ) , &PooledMessageServer::connectTask );
+        }
+
+        virtual void setAsTimeTracker() {
+            Listener::setAsTimeTracker();
+        }
+
+        void run() {
+            log() << "running " << _nWorkers << " network worker threads, at most " << _maxWorkers << endl;
+            boost::thread eventLoop( boost::bind( &PooledMessageServer::eventLoop , this ) );
+            initAndListen();
+        }
+
+        virtual bool useUnixSockets() const { return true; }
+
+        static PooledMessageServer* current() { return _current; }
+
+        void appendStats( BSONObjBuilder& b ) {
+            {
+                scoped_lock lk( _mutex );
+                b.append( "workers" , _nWorkers );
+                b.append( "maxWorkers" , _maxWorkers );
+                b.append( "inFlight" , _inFlight );
+                b.append( "maxInFlight" , _maxInFlight );
+            }
+            b.appendNumber( "workersAdded" , (long long) _stats.workersAdded.load() );
+            b.appendNumber( "workersRemoved" , (long long) _stats.workersRemoved.load() );
+            b.appendNumber( "connections" , (long long) _stats.connections.load() );
+            b.appendNumber( "messages" , (long long) _stats.messages.load() );
+            b.appendNumber( "admissionWaits" , (long long) _stats.admissionWaits.load() );
+            BSONObjBuilder stages( b.subobjStart( "stages" ) );
+            appendStage( stages , "recv" , _stats.recvMicros.load() );
+            appendStage( stages , "queue" , _stats.queueMicros.load() );
+            appendStage( stages , "process" , _stats.processMicros.load() );
+            stages.done();
+        }
+
+    private:
+        // admission queue size, as a multiple of the number of workers
+        static const int QueuedPerWorker = 4;
+        // how long every worker may be busy, with messages queued and none
+        // finishing, before the pool grows
+        static const unsigned long long StallMillis = 500;
+        // the pool grows to at most this many times --networkWorkers
+        static const int MaxGrowth = 4;
+        // how long a worker must have been spare before one the pool grew
+        // by is stopped
+        static const unsigned long long IdleMillis = 60 * 1000;
+
+        struct Connection {
+            Connection( MessagingPort * p ) : port( p ) , le( new LastError() ) , state( 0 ) ,
+                                              registered( false ) , readyMicros( 0 ) ,
+                                              len( 0 ) , md( 0 ) , have( 0 ) {}
+            ~Connection() {
+                free( md );
+            }
+            scoped_ptr<MessagingPort> port;
+            scoped_ptr<LastError> le;
+            // the handler's thread local state, while no worker has it
+            ConnectionState * state;
+            // whether the socket has been added to the epoll set
+            bool registered;
+            // when the socket became readable, then when the message was complete
+            unsigned long long readyMicros;
+            // the message being read by the event loop: its length, its
+            // buffer once the length is known, and the bytes of the length,
+            // then of the buffer, read so far
+            int len;
+            MsgData * md;
+            int have;
+            // the complete message, for a worker
+            Message message;
+        };
+
+        struct Stats {
+            AtomicUInt64 connections;
+            AtomicUInt64 messages;
+            AtomicUInt64 admissionWaits;
+            AtomicUInt64 workersAdded;
+            AtomicUInt64 workersRemoved;
+            AtomicUInt64 recvMicros;    // readable until the whole message arrived
+            AtomicUInt64 queueMicros;   // complete until a worker picks it up
+            AtomicUInt64 processMicros; // handling the message and replying
+        };
+
+        void appendStage( BSONObjBuilder& b , const char* name , unsigned long long micros ) {
+            const unsigned long long messages = _stats.messages.load();
+            BSONObjBuilder stage( b.subobjStart( name ) );
+            stage.appendNumber( "totalMicros" , (long long) micros );
+            stage.append( "avgMicros" , messages ? (double) micros / messages : 0.0 );
+            stage.done();
+        }
+
+        typedef void (PooledMessageServer::*Task)( Connection * c );
+
+        // schedules task( c ) on a worker, waits first if the admission queue is full
+        void admit( Connection * c , Task task ) {
+            {
+                scoped_lock lk( _mutex );
+                if ( _inFlight >= _maxInFlight ) {
+                    _stats.admissionWaits.fetchAndAdd( 1 );
+                    while ( _inFlight >= _maxInFlight ) {
+                        _admitted.timed_wait( lk.boost() , boost::posix_time::milliseconds( 100 ) );
+                        growIfStalled();
+                    }
+                }
+                _inFlight++;
+            }
+            _workers.schedule( task , this , c );
+        }
+
+        void taskDone() {
+            scoped_lock lk( _mutex );
+            _inFlight--;
+            _completed++;
+            _admitted.notify_one();
+        }
+
+        // Adds a worker if every worker has been busy, with messages queued,
+        // and none has finished for StallMillis, unless the pool is at
+        // _maxWorkers.
+        // requires: _mutex is held
+        void growIfStalled() {
+            const unsigned long long now = curTimeMillis64();
+            if ( _inFlight <= _nWorkers || _completed != _lastCompleted ) {
+                _lastCompleted = _completed;
+                _lastProgressMillis = now;
+                _warnedAtMax = false;
+                return;
+            }
+            if ( now - _lastProgressMillis < StallMillis ) {
+                return;
+            }
+            _lastProgressMillis = now;
+            if ( _nWorkers >= _maxWorkers ) {
+                if ( ! _warnedAtMax ) {
+                    warning() << "all " << _nWorkers << " network workers busy for " << StallMillis
+                              << "ms with messages waiting, and the pool can't grow any more" << endl;
+                    _warnedAtMax = true;
+                }
+                return;
+            }
+            log() << "all " << _nWorkers << " network workers busy for " << StallMillis
+                  << "ms with messages waiting, adding one" << endl;
+            _workers.addThreads( 1 );
+            _nWorkers++;
+            _maxInFlight = _nWorkers * QueuedPerWorker;
+            _stats.workersAdded.fetchAndAdd( 1 );
+        }
+
+        // Stops a worker if the pool has grown and, each time the event loop
+        // looked over the last IdleMillis, had one to spare.
+        void shrinkIfIdle() {
+            {
+                scoped_lock lk( _mutex );
+                const unsigned long long now = curTimeMillis64();
+                if ( _nWorkers <= _minWorkers || _inFlight >= _nWorkers ) {
+                    _lastBusyMillis = now;
+                    return;
+                }
+                if ( now - _lastBusyMillis < IdleMillis ) {
+                    return;
+                }
+                _lastBusyMillis = now;
+            }
+            // outside _mutex, it waits for the worker's thread to end
+            if ( _workers.removeThreads( 1 ) == 1 ) {
+                scoped_lock lk( _mutex );
+                _nWorkers--;
+                _maxInFlight = _nWorkers * QueuedPerWorker;
+                _stats.workersRemoved.fetchAndAdd( 1 );
+                log() << "network workers idle for " << IdleMillis << "ms, stopped one, "
+                      << _nWorkers << " left" << endl;
+            }
+        }
+
+        // (re)registers c to be read from when it is next readable
+        bool arm( Connection * c ) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+            ev.data.ptr = c;
+            const int op = c->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+            c->registered = true;
+            if ( epoll_ctl( _epfd , op , c->port->psock->rawFD() , &ev ) != 0 ) {
+                log() << "epoll_ctl failed, closing client connection: " << errnoWithDescription() << endl;
+                return false;
+            }
+            return true;
+        }
+
+        enum ReadResult { Incomplete , Complete , Closed };
+
+        // Reads what has arrived of c's next message, without blocking and
+        // without reading past its end. Complete leaves it in c->message.
+        ReadResult readSome( Connection * c ) {
+            const int fd = c->port->psock->rawFD();
+            while ( true ) {
+                char * buf = c->md ? (char *) c->md : (char *) &c->len;
+                const int want = ( c->md ? c->len : 4 ) - c->have;
+                const int n = ::recv( fd , buf + c->have , want , MSG_DONTWAIT );
+                if ( n == 0 ) {
+                    return Closed;
+                }
+                if ( n < 0 ) {
+                    if ( errno == EINTR ) {
+                        continue;
+                    }
+                    if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                        return Incomplete;
+                    }
+                    LOG(1) << "recv failed, closing client connection: " << errnoWithDescription() << endl;
+                    return Closed;
+                }
+                c->have += n;
+                if ( c->md == 0 ) {
+                    if ( c->have < 4 ) {
+                        continue;
+                    }
+                    try {
+                        switch ( c->port->checkHeaderLength( c->len ) ) {
+                        case MessagingPort::EndianCheck:
+                            c->have = 0;
+                            continue;
+                        case MessagingPort::BadLength:
+                            return Closed;
+                        case MessagingPort::MessageLength:
+                            break;
+                        }
+                    }
+                    catch ( SocketException& e ) {
+                        LOG(1) << "SocketException answering client, closing connection: " << e << endl;
+                        return Closed;
+                    }
+                    c->md = (MsgData *) malloc( ( c->len + 1023 ) & 0xfffffc00 );
+                    verify( c->md );
+                    c->md->len = c->len;
+                }
+                else if ( c->have == c->len ) {
+                    c->message.setData( c->md , true );
+                    c->md = 0;
+                    c->have = 0;
+                    return Complete;
+                }
+            }
+        }
+
+        // attaches c's thread local state to this worker
+        void attach( Connection * c ) {
+            lastError.reset( c->le.get() );
+            pms::handler->resume( c->port.get() , c->state );
+            c->state = 0;
+        }
+
+        // detaches c's thread local state from this worker
+        void detach( Connection * c ) {
+            c->state = pms::handler->suspend( c->port.get() );
+            lastError.release();
+            setThreadName( "netWorker" );
+        }
+
+        void eventLoop() {
+            setThreadName( "netEventLoop" );
+            const int MaxEvents = 256;
+            struct epoll_event events[MaxEvents];
+            while ( ! inShutdown() ) {
+                {
+                    scoped_lock lk( _mutex );
+                    growIfStalled();
+                }
+                shrinkIfIdle();
+                int n = epoll_wait( _epfd , events , MaxEvents , 100 );
+                if ( n < 0 ) {
+                    if ( errno != EINTR ) {
+                        error() << "epoll_wait failed: " << errnoWithDescription() << endl;
+                        sleepmillis( 10 );
+                    }
+                    continue;
+                }
+                const unsigned long long now = curTimeMicros64();
+                for ( int i = 0; i < n; i++ ) {
+                    Connection * c = static_cast<Connection *>( events[i].data.ptr );
+                    if ( c->md == 0 && c->have == 0 ) {
+                        c->readyMicros = now;
+                    }
+                    const ReadResult r = readSome( c );
+                    if ( r == Complete ) {
+                        const unsigned long long received = curTimeMicros64();
+                        _stats.recvMicros.fetchAndAdd( received - c->readyMicros );
+                        c->readyMicros = received;
+                        admit( c , &PooledMessageServer::messageTask );
+                    }
+                    else if ( r == Closed || ! arm( c ) ) {
+                        admit( c , &PooledMessageServer::closeTask );
+                    }
+                }
+            }
+        }
+
+        void connectTask( Connection * c ) {
+            MessagingPort * p = c->port.get();
+            bool ok = false;
+            lastError.reset( c->le.get() );
+            try {
+                p->psock->setLogLevel(1);
+                p->psock->postFork();
+                pms::handler->connected( p );
+                ok = true;
+            }
+            catch ( const DBException& e ) {
+                log() << "DBException setting up connection, closing it: " << e << endl;
+            }
+            catch ( std::exception &e ) {
+                log() << "exception setting up connection, closing it: " << e.what() << endl;
+            }
+            finishTask( c , ok );
+        }
+
+        void messageTask( Connection * c ) {
+            const unsigned long long start = curTimeMicros64();
+            _stats.queueMicros.fetchAndAdd( start - c->readyMicros );
+
+            MessagingPort * p = c->port.get();
+            attach( c );
+
+            bool ok = false;
+            try {
+                const int bytesIn = c->message.header()->len;
+                if ( c->message.operation() == dbCompressed ) {
+                    MessageCompressor::decompress( c->message );
+                }
+                p->psock->clearCounters();
+                pms::handler->process( c->message , p , c->le.get() );
+                networkCounter.hit( bytesIn , p->psock->getBytesOut() );
+
+                _stats.processMicros.fetchAndAdd( curTimeMicros64() - start );
+                _stats.messages.fetchAndAdd( 1 );
+                ok = true;
+            }
+            catch ( AssertionException& e ) {
+                log() << "AssertionException handling request, closing client connection: " << e << endl;
+            }
+            catch ( SocketException& e ) {
+                log() << "SocketException handling request, closing client connection: " << e << endl;
+            }
+            catch ( const DBException& e ) { // must be right above std::exception to avoid catching subclasses
+                log() << "DBException handling request, closing client connection: " << e << endl;
+            }
+            catch ( std::exception &e ) {
+                error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+                dbexit( EXIT_UNCAUGHT );
+            }
+            catch ( ... ) {
+                error() << "Uncaught exception, terminating" << endl;
+                dbexit( EXIT_UNCAUGHT );
+            }
+            c->message.reset();
+            finishTask( c , ok && ! inShutdown() );
+        }
+
+        // the event loop found c closed, or couldn't read from it
+        void closeTask( Connection * c ) {
+            attach( c );
+            if( !cmdLine.quiet ){
+                int conns = connTicketHolder.used()-1;
+                const char* word = (conns == 1 ? " connection" : " connections");
+                log() << "end connection " << c->port->psock->remoteString() << " (" << conns << word << " now open)" << endl;
+            }
+            finishTask( c , false );
+        }
+
+        // parks c until its next message, or closes it, then leaves the
+        // admission queue. c's state must be attached to this worker.
+        void finishTask( Connection * c , bool keep ) {
+            if ( keep ) {
+                detach( c );
+                // the event loop may read from c as soon as it is armed
+                if ( ! arm( c ) ) {
+                    attach( c );
+                    keep = false;
+                }
+            }
+            if ( ! keep ) {
+                pms::handler->disconnected( c->port.get() );
+                detach( c );
+                delete c->state;
+                c->port->shutdown();
+                delete c;
+                _stats.connections.fetchAndSubtract( 1 );
+                connTicketHolder.release();
+            }
+            taskDone();
+        }
+
+        int _epfd;
+        ThreadPool _workers;
+        const int _minWorkers;
+        const int _maxWorkers;
+
+        mongo::mutex _mutex;
+        // signaled when a task leaves the admission queue
+        boost::condition _admitted;
+        // these are protected by _mutex
+        int _nWorkers;
+        int _maxInFlight;
+        // tasks scheduled or running
+        int _inFlight;
+        // tasks finished, and as of the last growIfStalled() that saw progress
+        unsigned long long _completed;
+        unsigned long long _lastCompleted;
+        unsigned long long _lastProgressMillis;
+        // whether growIfStalled() has warned of this stall at _maxWorkers
+        bool _warnedAtMax;
+        // when shrinkIfIdle() last saw no worker to spare
+        unsigned long long _lastBusyMillis;
+
+        Stats _stats;
+
+        static PooledMessageServer* _current;
+    };
+
+    PooledMessageServer* PooledMessageServer::_current = 0;
+#endif
+
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler ) {
+#ifdef __linux__
+        if ( opts.workers > 0 ) {
+            if ( handler->canSuspend() ) {
+                return new PooledMessageServer( opts , handler );
+            }
+            warning() << "this server cannot share network worker threads between connections, "
+                      << "running a thread per connection" << endl;
+        }
+#endif
         return new PortMessageServer( opts , handler );
     }
 
+    bool appendMessageServerStats( BSONObjBuilder& b ) {
+#ifdef __linux__
+        if ( PooledMessageServer::current() ) {
+            PooledMessageServer::current()->appendStats( b );
+            return true;
+        }
+#endif
+        return false;
+    }
+
 }
 
 #endif
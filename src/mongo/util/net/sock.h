@@ -235,7 +235,13 @@ namespace mongo {
         void secure( SSLManager * ssl );
 
         void secureAccepted( SSLManager * ssl );
+
+        /** data may be buffered in the SSL layer, where poll() does not see it */
+        bool isSecure() const { return _ssl != NULL || _sslAccepted != NULL; }
 #endif
+
+        /** for registering with poll()/epoll(), not for reading or writing */
+        int rawFD() const { return _fd; }
         
         /**
          * call this after a fork for server sockets
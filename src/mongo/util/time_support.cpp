@@ -227,6 +227,12 @@ namespace mongo {
         }
         else return 0;
     }
+    long long* releaseJSTimeVirtualThreadSkew(){
+        return jsTime_virtual_thread_skew.release();
+    }
+    void resetJSTimeVirtualThreadSkew( long long* skew ){
+        jsTime_virtual_thread_skew.reset(skew);
+    }
 
     /** Date_t is milliseconds since epoch */
     Date_t jsTime();
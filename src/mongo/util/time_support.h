@@ -71,6 +71,10 @@ namespace mongo {
 
     void jsTimeVirtualThreadSkew( long long skew );
     long long getJSTimeVirtualThreadSkew();
+    // Detach this thread's skew without deleting it, and attach one (which may
+    // be null), for connections that move between threads.
+    long long* releaseJSTimeVirtualThreadSkew();
+    void resetJSTimeVirtualThreadSkew( long long* skew );
 
     /** Date_t is milliseconds since epoch */
      Date_t jsTime();